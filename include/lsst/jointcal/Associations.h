@@ -28,6 +28,10 @@
 #include <string>
 #include <iostream>
 #include <list>
+#include <memory>
+#include <vector>
+
+#include "Eigen/Core"
 
 #include "lsst/afw/table/Source.h"
 #include "lsst/afw/geom/SkyWcs.h"
@@ -41,6 +45,7 @@
 #include "lsst/jointcal/FittedStar.h"
 #include "lsst/jointcal/CcdImage.h"
 #include "lsst/jointcal/Point.h"
+#include "lsst/jointcal/Instrumentation.h"
 #include "lsst/jointcal/JointcalControl.h"
 
 #include "lsst/afw/table/SortedCatalog.h"
@@ -69,7 +74,10 @@ public:
     Associations()
             : _commonTangentPoint(Point(std::numeric_limits<double>::quiet_NaN(),
                                         std::numeric_limits<double>::quiet_NaN())),
-              _maxMeasuredStars(0) {}
+              _maxMeasuredStars(0),
+              _wcsSurrogateMaxError(0),
+              _wcsSurrogateMaxOrder(9),
+              _reuseAssociation(false) {}
 
     /**
      * Create an Associations object from a pre-built list of ccdImages.
@@ -85,7 +93,10 @@ public:
               _commonTangentPoint(Point(std::numeric_limits<double>::quiet_NaN(),
                                         std::numeric_limits<double>::quiet_NaN())),
               _maxMeasuredStars(0),
-              _epoch(epoch) {}
+              _epoch(epoch),
+              _wcsSurrogateMaxError(0),
+              _wcsSurrogateMaxOrder(9),
+              _reuseAssociation(false) {}
 
     /// No moves or copies: jointcal only ever needs one Associations object.
     Associations(Associations const &) = delete;
@@ -108,6 +119,46 @@ public:
     Point getCommonTangentPoint() const { return _commonTangentPoint; }
     ///@}
 
+    /**
+     * Replace each ccdImage's pixel to tangent plane transform by a polynomial surrogate, for speed.
+     *
+     * Takes effect at the next setCommonTangentPoint() (or computeCommonTangentPoint()); see
+     * CcdImage::useWcsSurrogate(). ccdImages whose WCS can not be approximated within maxErrorInArcsec
+     * keep the exact transform.
+     *
+     * @param maxErrorInArcsec  The largest acceptable surrogate error (arcseconds); 0 disables surrogates.
+     * @param maxOrder  The highest polynomial order to try.
+     */
+    void setWcsSurrogate(double maxErrorInArcsec, std::size_t maxOrder = 9) {
+        _wcsSurrogateMaxError = maxErrorInArcsec;
+        _wcsSurrogateMaxOrder = maxOrder;
+    }
+
+    /**
+     * Store the catalogs to fit in a memory-mapped scratch file instead of on the heap.
+     *
+     * For tracts whose catalogs do not fit in memory together with the factorization of the Hessian: the
+     * operating system can then page out the catalogs of the ccdImages that are not in use to the scratch
+     * file, rather than to swap. The stars of each ccdImage are stored contiguously, in the order in which
+     * the fit loops read them. The whole catalogs are moved there at once, and the catalogs to fit from the
+     * next associateCatalogs() on, for all current and future ccdImages, including those of the views made
+     * by createFitView().
+     *
+     * @param directory  The directory to create the scratch file in; empty to store the catalogs on the
+     *                   heap.
+     *
+     * @throws lsst::pex::exceptions::IoError if the scratch file can not be created.
+     */
+    void setFitCatalogStorage(std::string const &directory);
+
+    /// The size of the fit catalog scratch file, in bytes; 0 if the catalogs are on the heap.
+    std::size_t getFitCatalogMappedSize() const {
+        return _fitCatalogArena == nullptr ? 0 : _fitCatalogArena->getMappedSize();
+    }
+
+    /// The size of the ccdImage catalogs that are on the heap, in bytes; see CcdImage::getCatalogHeapSize.
+    std::size_t getFitCatalogHeapSize() const;
+
     /// The number of MeasuredStars at the start of fitting, before any outliers are removed.
     size_t getMaxMeasuredStars() const { return _maxMeasuredStars; }
 
@@ -142,12 +193,48 @@ public:
     /**
      * Add a pre-constructed ccdImage to the ccdImageList.
      */
-    void addCcdImage(std::shared_ptr<CcdImage> const ccdImage) { ccdImageList.push_back(ccdImage); }
+    void addCcdImage(std::shared_ptr<CcdImage> const ccdImage) {
+        if (_fitCatalogArena != nullptr) ccdImage->setFitCatalogArena(_fitCatalogArena);
+        ccdImageList.push_back(ccdImage);
+        _snapshot.reset();
+    }
 
     //! incrementaly builds a merged catalog of all image catalogs
     void associateCatalogs(const double matchCutInArcsec = 0, const bool useFittedList = false,
                            const bool enlargeFittedList = true);
 
+    /**
+     * Reuse the measured-to-fitted star association between calls to associateCatalogs().
+     *
+     * When set, associateCatalogs() (with the default useFittedList and enlargeFittedList) records the
+     * FittedStars it builds and which of them each MeasuredStar is associated with. A later call with the
+     * same matchCutInArcsec restores that state instead of matching all the catalogs again: e.g. the
+     * photometry fit can start from the association made for the astrometry fit. Each fit still collects
+     * its own reference stars, and starts with fresh (valid) MeasuredStars and FittedStars.
+     *
+     * The record is discarded when ccdImages are added or the common tangent point changes.
+     */
+    ///@{
+    void setReuseAssociation(bool reuseAssociation) {
+        _reuseAssociation = reuseAssociation;
+        if (!reuseAssociation) _snapshot.reset();
+    }
+    bool getReuseAssociation() const { return _reuseAssociation; }
+    ///@}
+
+    /**
+     * Return an independent view of the association recorded by the last associateCatalogs().
+     *
+     * The view holds a CcdImage::makeFitView() of each ccdImage, and restores the recorded association
+     * into its own MeasuredStars and FittedStars when its associateCatalogs() is called with the same match
+     * cut. Views share no state that a fit changes, so that e.g. the astrometric and photometric fits can
+     * run concurrently, each on its own view.
+     *
+     * @throws pex::exceptions::LogicError if no association has been recorded: call
+     *         setReuseAssociation(true) and associateCatalogs() first.
+     */
+    std::shared_ptr<Associations> createFitView() const;
+
     /**
      * @brief      Collect stars from an external reference catalog and associate them with fittedStars.
      *
@@ -168,6 +255,30 @@ public:
     //! track of that.
     void deprojectFittedStars();
 
+    /**
+     * The FittedStars of the fittedStarList, one per row, e.g. to save the solution of a fit.
+     *
+     * The columns are the on-sky position (ra, dec, in degrees) and its variances vx, vy and vxy, then the
+     * flux, fluxErr, mag and magErr, whether or not the fittedStarList has been deprojected.
+     *
+     * @param includeFixed  Whether to include the fixed stars (see FittedStar::isFixed()).
+     */
+    Eigen::MatrixXd getFittedStarArray(bool includeFixed = true) const;
+
+    /**
+     * Replace the fittedStarList with the FittedStars of a previous fit, held fixed (see
+     * FittedStar::isFixed()), to associate the catalogs of new visits against them with
+     * `associateCatalogs(matchCut, true, true)`.
+     *
+     * The stars are projected onto the common tangent plane, which must have been set.
+     *
+     * @param stars  The stars, one per row, with the columns of getFittedStarArray().
+     *
+     * @throws pex::exceptions::LengthError if stars does not have the columns of getFittedStarArray().
+     * @throws pex::exceptions::LogicError if the common tangent point has not been set.
+     */
+    void setFixedFittedStars(Eigen::MatrixXd const &stars);
+
     /**
      * Prepare the fittedStar list by making quality cuts and normalizing measurements.
      *
@@ -208,7 +319,16 @@ public:
      */
     size_t nFittedStarsWithAssociatedRefStar() const;
 
+    /// Return the timing and counters of associateCatalogs() and collectRefStars().
+    Instrumentation getInstrumentation() const { return _instrumentation; }
+
+    /// Forget the phases recorded so far, e.g. once they have been reported.
+    void resetInstrumentation() { _instrumentation.clear(); }
+
 private:
+    // Checkpoint writes and rebuilds the state of the association.
+    friend class Checkpoint;
+
     void associateRefStars(double matchCutInArcsec, const AstrometryTransform *transform);
 
     void assignMags();
@@ -228,6 +348,10 @@ private:
      */
     void normalizeFittedStars();
 
+    // Record the association made by associateCatalogs(), and restore it; see setReuseAssociation().
+    void snapshotAssociation(double matchCutInArcsec);
+    void restoreAssociation();
+
     // Common tangent point on-sky of all of the ccdImages, typically determined by computeCommonTangentPoint.
     // (decimal degrees)
     Point _commonTangentPoint;
@@ -240,6 +364,27 @@ private:
     // Julian Epoch Year (e.g. 2000.0 for J2000)
     // Common epoch of all of the ccdImages, typically computed externally via astropy and then set.
     double _epoch;
+
+    // Largest error (arcseconds) of the polynomial surrogates to the ccdImage WCSs; 0 to use the exact WCS.
+    double _wcsSurrogateMaxError;
+    std::size_t _wcsSurrogateMaxOrder;
+
+    // The association recorded by snapshotAssociation(), if _reuseAssociation is set.
+    struct AssociationSnapshot {
+        double matchCutInArcsec;
+        // The FittedStars as associateCatalogs() left them.
+        std::vector<std::shared_ptr<FittedStar const>> fittedStars;
+        // For each ccdImage, the index in fittedStars of the FittedStar of each of its catalogForFit stars.
+        std::vector<std::vector<std::size_t>> fittedStarIndices;
+    };
+    bool _reuseAssociation;
+    // Shared with the views made by createFitView().
+    std::shared_ptr<AssociationSnapshot const> _snapshot;
+
+    // Where the ccdImages allocate their catalogs to fit, if not on the heap; see setFitCatalogStorage().
+    std::shared_ptr<MappedArena> _fitCatalogArena;
+
+    Instrumentation _instrumentation;
 };
 
 }  // namespace jointcal
@@ -127,6 +127,17 @@ public:
     void checkStuff();
 
 protected:
+    /// @copydoc FitterBase::validateModel
+    bool validateModel(int ndof) const override {
+        return _astrometryModel->validate(_associations->getCcdImageList(), ndof);
+    }
+
+    /// @copydoc FitterBase::assignCovariance
+    void assignCovariance(SparseMatrixD const &covariance) override;
+
+    /// @copydoc FitterBase::getModelParameters
+    Eigen::VectorXd getModelParameters() const override { return _astrometryModel->getParameters(); }
+
     /// @copydoc FitterBase::saveChi2MeasContributions
     void saveChi2MeasContributions(std::string const &filename) const override;
 
@@ -153,6 +164,8 @@ private:
 
     void getIndicesOfMeasuredStar(MeasuredStar const &measuredStar, IndexVector &indices) const override;
 
+    void getIndicesOfCcdImage(CcdImage const &ccdImage, IndexVector &indices) const override;
+
     /**
      * Transform the positions of a FittedStar into the frame of a MeasuredStar.
      *
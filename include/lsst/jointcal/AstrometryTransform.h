@@ -27,11 +27,14 @@
 
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <sstream>
 #include <vector>
 
 #include "Eigen/Core"
+#include "Eigen/Cholesky"
+#include "Eigen/QR"
 
 #include "lsst/pex/exceptions.h"
 #include "lsst/afw/geom/SkyWcs.h"
@@ -51,9 +54,9 @@ class AstrometryTransformLinear;
 /*! We implement here One AstrometryTransform interface class, and actual derived
     classes. Composition in the usual (mathematical) sense is provided
     using compose(), and some classes (e.g. AstrometryTransformLinear)
-    handle a * operator.  Generic inversion by iteration exists, but
-    it is at least 10 times slower than the corresponding "direct
-    transformation". If a transform has an analytical inverse, then
+    handle a * operator.  Generic inversion exists (a polynomial fit,
+    refined by iterations where needed), but it is costly to set up and
+    less accurate than an analytical inverse. If a transform has one, then
     providing inverseTransform is obviously a very good idea. Before
     resorting to inverseTransform, consider using
     StarMatchList::inverseTransform().  AstrometryTransformLinear::inverted() and
@@ -88,6 +91,14 @@ public:
      */
     Frame apply(Frame const &inputframe, bool inscribed) const;
 
+    /**
+     * Transform a batch of points.
+     *
+     * @param[in] in The points to be transformed.
+     * @param[out] out The transformed points, resized to match in.
+     */
+    virtual void apply(std::vector<Point> const &in, std::vector<Point> &out) const;
+
     //! prints the transform coefficients to stream.
     virtual void print(std::ostream &out) const = 0;
 
@@ -151,7 +162,13 @@ public:
 
     //! returns an inverse transform. Numerical if not overloaded.
     /*! precision and region refer to the "input" side of this,
-      and hence to the output side of the returned AstrometryTransform. */
+      and hence to the output side of the returned AstrometryTransform.
+      The numerical inverse starts from a polynomial fit once over region,
+      and only iterates where that polynomial is not known to be within
+      precision, or where one call to this shows its output is not. The fit
+      is reused by later calls with the same precision and region, as long
+      as this transform looks unchanged; the check of each output keeps the
+      inverse accurate if it changed anyway. Safe to call concurrently. */
     virtual std::unique_ptr<AstrometryTransform> inverseTransform(const double precision,
                                                                   const Frame &region) const;
 
@@ -195,6 +212,34 @@ public:
     virtual void write(std::ostream &stream) const;
 
     virtual ~AstrometryTransform(){};
+
+private:
+    friend class AstrometryTransformInverse;
+
+    // A polynomial inverse of this over some region, as fit for inverseTransform().
+    struct PolynomialInverse;
+
+    /* Return the polynomial inverse of this for precision and region, from _inverseCache if it still
+       matches this transform at a few probe points, else fit a new one and cache it. Callers check each
+       point they invert, so a change that the probes miss costs iterations, not accuracy. */
+    std::shared_ptr<PolynomialInverse const> getPolynomialInverse(double precision,
+                                                                  Frame const &region) const;
+
+    // The most recently used polynomial inverses, most recent last, guarded for concurrent const calls.
+    // Copies start empty: the inverses of one transform say nothing about another.
+    struct InverseCache {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<PolynomialInverse const>> inverses;
+
+        InverseCache() = default;
+        InverseCache(InverseCache const &) {}
+        InverseCache &operator=(InverseCache const &) {
+            std::lock_guard<std::mutex> lock(mutex);
+            inverses.clear();
+            return *this;
+        }
+    };
+    mutable InverseCache _inverseCache;
 };
 
 std::ostream &operator<<(std::ostream &stream, AstrometryTransform const &transform);
@@ -371,10 +416,23 @@ public:
     /// @copydoc AstrometryTransform::toAstMap
     std::shared_ptr<ast::Mapping> toAstMap(jointcal::Frame const &domain) const override;
 
+    /**
+     * Fit the inverse that toAstMap(domain) gives to the AST PolyMap.
+     *
+     * This fit is the expensive part of toAstMap; it only reads this transform, so inverses of different
+     * transforms may be fit concurrently and reused with toAstMap(inverse).
+     */
+    std::shared_ptr<AstrometryTransformPolynomial> fitAstMapInverse(jointcal::Frame const &domain) const;
+
+    /// Create an AST PolyMap of this transform, using an inverse computed by fitAstMapInverse().
+    std::shared_ptr<ast::Mapping> toAstMap(AstrometryTransformPolynomial const &inverse) const;
+
     void write(std::ostream &s) const override;
     void read(std::istream &s);
 
 private:
+    friend class AstrometryTransformPolynomialFitter;  // for computeMonomials and _coeffs
+
     double computeFit(StarMatchList const &starMatchList, AstrometryTransform const &shiftToCenter,
                       const bool useErrors);
 
@@ -537,6 +595,142 @@ public:
     std::size_t getNpar() const { return 2; }
 };
 
+/**
+ * Least-squares polynomial fits of a StarMatchList (point1 -> point2), for several orders and
+ * sigma-clipping passes, without re-reading the matches.
+ *
+ * The monomials of a polynomial are ordered by increasing total degree, so the fits of every order up to
+ * maxOrder are solved from leading sub-blocks of a single accumulation. With the default monomial basis,
+ * the Cholesky factor of the normal matrix is kept, and removing a match is a rank-1 downdate of it. The
+ * orthogonal basis instead keeps a QR factorization of the design matrix (i.e. orthogonal polynomials
+ * evaluated at the matches), which is more stable at high order; it is recomputed in one batch at the
+ * next fit after matches were removed.
+ *
+ * Without a guess transform, matches all have unit weight, as in the first pass of
+ * AstrometryTransformPolynomial::fit(), which suits matches of equal precision, such as samples of a
+ * transform on a grid. Given one, each match is weighted with the inverse of its covariance, as in the
+ * later passes of fit(). The x and y coefficients are then coupled by the covariances and fit together,
+ * interleaved monomial by monomial so that the leading sub-blocks still hold the lower orders.
+ */
+class AstrometryTransformPolynomialFitter {
+public:
+    /**
+     * @param starMatchList The matches to fit; it is only read by the constructor.
+     * @param maxOrder The highest order that will be fit.
+     * @param orthogonal Use the orthogonal (QR) basis rather than the normal equations.
+     */
+    AstrometryTransformPolynomialFitter(StarMatchList const &starMatchList, std::size_t maxOrder,
+                                        bool orthogonal = false);
+
+    /**
+     * Weight each match with the inverse of its covariance: that of point2, plus that of point1
+     * propagated through guess.
+     *
+     * @param starMatchList The matches to fit; it is only read by the constructor.
+     * @param guess An approximation of the transform to fit, to propagate the errors of point1 with.
+     * @param maxOrder The highest order that will be fit.
+     * @param orthogonal Use the orthogonal (QR) basis rather than the normal equations.
+     *
+     * @throws pex::exceptions::InvalidParameterError if the covariance of a match is not positive
+     *         definite.
+     */
+    AstrometryTransformPolynomialFitter(StarMatchList const &starMatchList, AstrometryTransform const &guess,
+                                        std::size_t maxOrder, bool orthogonal = false);
+
+    /// Stop using the match at position index of the StarMatchList.
+    void remove(std::size_t index);
+
+    /// Use all the matches again.
+    void reset();
+
+    /// Number of matches currently used.
+    std::size_t getNUsed() const { return _nUsed; }
+
+    /**
+     * Fit a polynomial of the given order (<= maxOrder) to the used matches.
+     *
+     * @param order The order of the polynomial to fit.
+     * @param[out] result The fitted polynomial, from point1 to point2 coordinates.
+     * @param[out] chi2 The sum of the (weighted) squared residuals of the used matches, summed from the
+     *             residuals themselves; 0 if there are exactly as many matches as parameters per
+     *             coordinate.
+     *
+     * @return false, leaving result and chi2 unchanged, if there are not enough matches or the fit
+     *         failed.
+     */
+    bool fit(std::size_t order, AstrometryTransformPolynomial &result, double &chi2);
+
+    /**
+     * Fit a polynomial of the given order, removing the matches with squared residuals above
+     * nSigmas^2 times their median and refitting, until no more matches are removed.
+     *
+     * @return As fit().
+     */
+    bool fitWithClipping(std::size_t order, double nSigmas, AstrometryTransformPolynomial &result,
+                         double &chi2);
+
+private:
+    std::size_t _maxOrder;
+    bool _orthogonal;
+    AstrometryTransformLinear _conditioner;  // maps point1 to about [-1, 1]
+
+    // Unweighted, the monomials of the conditioned point1 and the point2 (x, y) of each match, in one row.
+    // Weighted, the rows of the whitened x and y residuals of each match, with interleaved x and y
+    // coefficients and one target column.
+    Eigen::MatrixXd _design;
+    Eigen::MatrixXd _targets;
+    std::size_t _rowsPerMatch;  // 1 unweighted, 2 weighted
+    std::vector<bool> _used;
+    std::size_t _nUsed;
+    double _roundOff2;  // squared residuals below this are rounding errors, never clipped
+
+    // monomial basis: normal matrix, right-hand sides, and Cholesky factor of the normal matrix
+    Eigen::MatrixXd _normal;
+    Eigen::MatrixXd _rhs;
+    Eigen::LLT<Eigen::MatrixXd> _factor;
+    bool _factorValid;
+    // orthogonal basis: factorization of the used rows of _design, and Q^T _targets
+    Eigen::HouseholderQR<Eigen::MatrixXd> _qr;
+    Eigen::MatrixXd _qTargets;
+    bool _qrValid;
+
+    // Fill _design and _targets, weighted if guess is not null.
+    void setMatches(StarMatchList const &starMatchList, AstrometryTransform const *guess);
+    void accumulate();
+    // Solve for the coefficients (one column per coordinate) of order; return false if that failed.
+    bool solve(std::size_t order, Eigen::MatrixXd &solution);
+    // (Weighted) squared residual of every match, used or not, to solution.
+    Eigen::VectorXd computeResiduals2(Eigen::MatrixXd const &solution) const;
+    // The chi2 that fit() returns for solution, whose squared residuals are residuals2.
+    double computeChi2(Eigen::MatrixXd const &solution, Eigen::VectorXd const &residuals2) const;
+    // The polynomial of order in point1 coordinates of solution.
+    void toPolynomial(std::size_t order, Eigen::MatrixXd const &solution,
+                      AstrometryTransformPolynomial &result) const;
+};
+
+/**
+ * Approximate transform over domain by the lowest order polynomial whose largest error on a grid is
+ * within maxError.
+ *
+ * The polynomials are fit on an nSteps x nSteps grid spanning domain, and the error is checked both on
+ * that grid and at the centers of its cells.
+ *
+ * @param[in]  transform  The transform to approximate, typically an expensive one.
+ * @param[in]  domain  The domain over which to approximate transform.
+ * @param[in]  maxError  The largest acceptable distance between the polynomial and transform, in the
+ *                       output coordinates of transform.
+ * @param[in]  maxOrder  The highest order to try.
+ * @param[in]  nSteps  The number of grid points per axis.
+ * @param[out]  error  The largest error on the grid of the returned polynomial, or the smallest one reached
+ *                     if there is none.
+ *
+ * @return The polynomial, or nullptr if no order up to maxOrder is within maxError.
+ */
+std::shared_ptr<AstrometryTransformPolynomial> fitPolynomialSurrogate(AstrometryTransform const &transform,
+                                                                      Frame const &domain, double maxError,
+                                                                      std::size_t maxOrder,
+                                                                      std::size_t nSteps, double &error);
+
 /**
  * A AstrometryTransform that holds a SkyWcs
  *
@@ -0,0 +1,117 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LSST_JOINTCAL_BLOCK_ARROWHEAD_SOLVER_H
+#define LSST_JOINTCAL_BLOCK_ARROWHEAD_SOLVER_H
+
+#include <memory>
+#include <vector>
+
+#include "Eigen/Core"
+
+#include "lsst/jointcal/Eigenstuff.h"
+
+namespace lsst {
+namespace jointcal {
+
+/**
+ * Solve a Hessian with a block arrowhead structure, as in a fit of a model and of star positions:
+ *
+ * @f[
+ * H = \begin{pmatrix} A & B \\ B^T & C \end{pmatrix}
+ * @f]
+ *
+ * where the first nModel parameters are the model (A, e.g. one dense block per CcdImage for a
+ * SimpleAstrometryModel), and C, the star-star part, is block diagonal with one small block per star.
+ * The stars are eliminated block by block, leaving the Schur complement @f$S = A - B C^{-1} B^T@f$ on the
+ * model parameters, which is factorized with a sparse Cholesky factorization; the star parameters are then
+ * recovered block by block.
+ *
+ * This never factorizes the (much larger) full Hessian, and its fill is limited to S.
+ */
+class BlockArrowheadSolver {
+public:
+    BlockArrowheadSolver();
+    ~BlockArrowheadSolver();
+
+    /// No copy or move: the factorization is held in a cholmod object.
+    BlockArrowheadSolver(BlockArrowheadSolver const &) = delete;
+    BlockArrowheadSolver(BlockArrowheadSolver &&) = delete;
+    BlockArrowheadSolver &operator=(BlockArrowheadSolver const &) = delete;
+    BlockArrowheadSolver &operator=(BlockArrowheadSolver &&) = delete;
+
+    /**
+     * Find the diagonal blocks of the star part of hessian.
+     *
+     * @param[in]  hessian  The (full, symmetric) Hessian.
+     * @param[in]  nModel  The number of model parameters, which come first in hessian.
+     * @param[out]  blockStarts  The first index of each star block, followed by hessian.rows().
+     * @param[in]  maxBlockSize  The largest block to accept.
+     *
+     * @return True if the star part of hessian is block diagonal with blocks of at most maxBlockSize.
+     */
+    static bool findStarBlocks(SparseMatrixD const &hessian, Eigen::Index nModel,
+                               std::vector<Eigen::Index> &blockStarts, Eigen::Index maxBlockSize = 4);
+
+    /**
+     * Factorize hessian.
+     *
+     * The symbolic analysis of the Schur complement is reused if it has the same sparsity pattern as at
+     * the previous call.
+     *
+     * @param hessian  The (full, symmetric) Hessian.
+     * @param nModel  The number of model parameters, which come first in hessian.
+     * @param blockStarts  The star blocks, as returned by findStarBlocks().
+     *
+     * @return True if the factorization succeeded; false if a star block or the Schur complement is not
+     *         positive definite.
+     */
+    bool compute(SparseMatrixD const &hessian, Eigen::Index nModel, std::vector<Eigen::Index> blockStarts);
+
+    /// Solve hessian*x = rhs with the last successful factorization.
+    Eigen::VectorXd solve(Eigen::VectorXd const &rhs) const;
+
+    /// Number of entries stored: the inverted star blocks, @f$B C^{-1}@f$ and the Schur factor.
+    Eigen::Index getFactorNonZeros() const;
+
+private:
+    Eigen::Index _nModel;
+    std::vector<Eigen::Index> _blockStarts;
+    // The inverse of each star block, concatenated in column-major order.
+    std::vector<double> _starInverses;
+    // B*C^-1, from which both the Schur complement and the star part of the solution follow.
+    SparseMatrixD _couplingTimesInverse;
+    // The factorization of the Schur complement and its sparsity pattern.
+    std::unique_ptr<CholmodSimplicialLDLT2<SparseMatrixD>> _schurFactorization;
+    std::vector<Eigen::Index> _schurOuterIndex;
+    std::vector<Eigen::Index> _schurInnerIndex;
+
+    // Multiply the star part of x (size hessian.rows() - nModel) in place by C^-1.
+    void applyStarInverse(Eigen::Ref<Eigen::VectorXd> x) const;
+};
+
+}  // namespace jointcal
+}  // namespace lsst
+
+#endif  // LSST_JOINTCAL_BLOCK_ARROWHEAD_SOLVER_H
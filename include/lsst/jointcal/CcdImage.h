@@ -39,6 +39,7 @@
 #include "lsst/jointcal/MeasuredStar.h"
 #include "lsst/jointcal/AstrometryTransform.h"
 #include "lsst/jointcal/Frame.h"
+#include "lsst/jointcal/MappedArena.h"
 
 namespace lsst {
 namespace jointcal {
@@ -70,11 +71,20 @@ public:
              std::string const &fluxField);
 
     /// No move or copy: each CCD image is unique to that ccd+visit, and Associations holds all CcdImages.
-    CcdImage(CcdImage const &) = delete;
+    /// See makeFitView() for the one exception.
     CcdImage(CcdImage &&) = delete;
     CcdImage &operator=(CcdImage const &) = delete;
     CcdImage &operator=(CcdImage &&) = delete;
 
+    /**
+     * Return a CcdImage for the same ccd+visit that shares this one's whole catalog, transforms and
+     * metadata, but has its own (empty) catalog to fit.
+     *
+     * Fits that run concurrently (e.g. astrometry and photometry) each work on their own view, so that the
+     * MeasuredStars one fit changes (validity, FittedStar) are not those the other fit uses.
+     */
+    std::shared_ptr<CcdImage> makeFitView() const;
+
     //! Return the _name that identifies this ccdImage.
     std::string getName() const { return _name; }
 
@@ -95,11 +105,27 @@ public:
     MeasuredStarList &getCatalogForFit() { return _catalogForFit; }
     //@}
 
-    /// Clear the catalog for fitting and set it to a copy of the whole catalog.
-    void resetCatalogForFit() {
-        getCatalogForFit().clear();
-        getWholeCatalog().copyTo(getCatalogForFit());
-    }
+    /**
+     * Clear the catalog for fitting and set it to a copy of the whole catalog.
+     *
+     * The copied stars are allocated from the fit catalog arena, if one was set.
+     */
+    void resetCatalogForFit();
+
+    /**
+     * Allocate the stars of the catalog for fitting from arena (e.g. a memory-mapped scratch file) from
+     * the next resetCatalogForFit() on; nullptr to allocate them on the heap.
+     *
+     * The stars of the whole catalog, which are only read to reset the catalog for fitting, are moved
+     * there at once.
+     */
+    void setFitCatalogArena(std::shared_ptr<MappedArena> arena);
+
+    /**
+     * The size of the MeasuredStars of the whole catalog and of the catalog for fitting that are on the
+     * heap, in bytes, without the allocator's overhead; those in a fit catalog arena are not counted.
+     */
+    std::size_t getCatalogHeapSize() const;
 
     /**
      * Count the number of valid measured and reference stars that fall within this ccdImage.
@@ -118,6 +144,22 @@ public:
      */
     void setCommonTangentPoint(Point const &commonTangentPoint);
 
+    /**
+     * Replace the exact pixel to tangent plane transforms with a polynomial fit to them.
+     *
+     * The exact transforms go through the full SkyWcs mapping for every point, which dominates the cost
+     * of association. The polynomial is fit over the image frame, and only used if its largest error on a
+     * grid covering the frame is within maxError; the read WCS is left untouched for outputs. Must be
+     * called after setCommonTangentPoint(), which restores the exact transforms.
+     *
+     * @param[in]  maxError  The largest acceptable error on this ccdImage's tangent plane (degrees).
+     * @param[in]  maxOrder  The highest polynomial order to try.
+     *
+     * @return The order of the polynomial in use, or 0 if none is accurate enough and the exact transforms
+     *         were kept.
+     */
+    std::size_t useWcsSurrogate(double maxError, std::size_t maxOrder = 9);
+
     /**
      * @brief      Gets the common tangent point, shared between all ccdImages.
      *
@@ -190,13 +232,25 @@ public:
     Frame const &getImageFrame() const { return _imageFrame; }
 
 private:
+    // Checkpoint writes and rebuilds all of the below.
+    friend class Checkpoint;
+    CcdImage() = default;
+
+    // Shares everything with other, including its catalog to fit: only for makeFitView().
+    CcdImage(CcdImage const &other) = default;
+
     void loadCatalog(lsst::afw::table::SortedCatalogT<lsst::afw::table::SourceRecord> const &Cat,
                      std::string const &fluxField);
 
+    // Copy star into the fit catalog arena, or onto the heap if there is none.
+    std::shared_ptr<MeasuredStar> copyStar(MeasuredStar const &star) const;
+
     jointcal::Frame _imageFrame;  // in pixels
 
     MeasuredStarList _wholeCatalog;  // the catalog of measured objets
     MeasuredStarList _catalogForFit;
+    std::shared_ptr<MappedArena> _fitCatalogArena;  // where the catalogs' stars are; nullptr for the heap
+    bool _catalogForFitOnHeap = true;                // whether _catalogForFit was allocated on the heap
 
     std::shared_ptr<AstrometryTransformSkyWcs> _readWcs;  // apply goes from pix to sky
 
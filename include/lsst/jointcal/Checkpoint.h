@@ -0,0 +1,112 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LSST_JOINTCAL_CHECKPOINT_H
+#define LSST_JOINTCAL_CHECKPOINT_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "Eigen/Core"
+
+#include "lsst/afw/cameraGeom/Detector.h"
+
+#include "lsst/jointcal/Associations.h"
+#include "lsst/jointcal/CcdImage.h"
+
+namespace lsst {
+namespace jointcal {
+
+/**
+ * A binary checkpoint of a fit, from which it can be resumed without reloading, reassociating and
+ * reinitializing anything.
+ *
+ * The file holds the Associations (each CcdImage with its metadata and its catalogs, the FittedStars and
+ * RefStars, and the links between all of them, including outlier rejection so far) and the parameters of
+ * the model being fit, as returned by AstrometryModel::getParameters() or PhotometryModel::getParameters().
+ * Each list is written as one array of fixed-size records, so that reading a checkpoint is a few large
+ * sequential reads.
+ *
+ * Not stored:
+ *  - the Detectors, which are looked up by ccd id when reading;
+ *  - the PhotoCalibs, of which only the calibration mean and error are kept, which is all the models use;
+ *  - the VisitInfos, of which only the quantities CcdImage derives from them are kept.
+ *
+ * The records are written in the native byte order, and a checkpoint can only be read by the same
+ * version of jointcal: it is meant for restarting a fit, not for archiving it.
+ */
+class Checkpoint {
+public:
+    /// The detectors of the CcdImages, by ccd id.
+    using DetectorMap = std::unordered_map<CcdIdType, std::shared_ptr<afw::cameraGeom::Detector>>;
+
+    /**
+     * Read a checkpoint written by write().
+     *
+     * @param filename  The checkpoint to read.
+     * @param detectors  The detector of each ccd in the checkpoint.
+     *
+     * @throws lsst::pex::exceptions::IoError if filename can not be read, or is not a checkpoint written
+     *         by this version of jointcal on a machine with the same byte order.
+     * @throws lsst::pex::exceptions::NotFoundError if the detector of a CcdImage is not in detectors.
+     */
+    Checkpoint(std::string const &filename, DetectorMap const &detectors);
+
+    /// No copy or move: use the Associations it holds instead.
+    Checkpoint(Checkpoint const &) = delete;
+    Checkpoint(Checkpoint &&) = delete;
+    Checkpoint &operator=(Checkpoint const &) = delete;
+    Checkpoint &operator=(Checkpoint &&) = delete;
+
+    /**
+     * Write a checkpoint of a fit.
+     *
+     * The checkpoint is first written next to filename and then renamed, so that filename is always
+     * either the previous checkpoint or the new one, even if the process is killed while writing.
+     *
+     * @param filename  The file to write.
+     * @param associations  The associations being fit.
+     * @param modelParameters  The current parameters of the model being fit.
+     *
+     * @throws lsst::pex::exceptions::IoError if filename can not be written.
+     */
+    static void write(std::string const &filename, Associations const &associations,
+                      Eigen::VectorXd const &modelParameters);
+
+    /// The associations, ready to be fit.
+    std::shared_ptr<Associations> getAssociations() const { return _associations; }
+
+    /// The parameters to give to the model's setParameters().
+    Eigen::VectorXd const &getModelParameters() const { return _modelParameters; }
+
+private:
+    std::shared_ptr<Associations> _associations;
+    Eigen::VectorXd _modelParameters;
+};
+
+}  // namespace jointcal
+}  // namespace lsst
+
+#endif  // LSST_JOINTCAL_CHECKPOINT_H
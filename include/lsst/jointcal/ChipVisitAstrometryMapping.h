@@ -88,13 +88,6 @@ private:
 
     std::shared_ptr<SimpleAstrometryMapping> _m1, _m2;
     Eigen::Index _nPar1, _nPar2;
-    struct tmpVars  // just there to get around constness issues
-    {
-        Eigen::MatrixX2d h1, h2;
-        Eigen::Matrix2d dt2dx;
-    };
-
-    std::unique_ptr<tmpVars> tmp;
 };
 }  // namespace jointcal
 }  // namespace lsst
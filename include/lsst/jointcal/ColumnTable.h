@@ -0,0 +1,98 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LSST_JOINTCAL_COLUMN_TABLE_H
+#define LSST_JOINTCAL_COLUMN_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lsst {
+namespace jointcal {
+
+/**
+ * A table of named and documented columns of doubles or 64-bit integers, filled one row at a time and
+ * written in one go to a binary column file.
+ *
+ * This is how the fitters save their chi2 contributions (see FitterBase::saveChi2Contributions): each
+ * column is one contiguous array, so that writing a file is a handful of large writes, and reading it back
+ * (see lsst.jointcal.chi2Contributions in python) needs no parsing.
+ *
+ * The file layout, with every number little-endian whatever the byte order of the writing host, is:
+ *  - the 8 characters "JCCOLS02", whose last two are the format version;
+ *  - the number of columns and the number of rows, as int64;
+ *  - for each column: its type (0 for float64, 1 for int64), the length of its name, the name, the length
+ *    of its description and the description, the types and lengths as int64;
+ *  - for each column, in the same order: its nRows values.
+ */
+class ColumnTable {
+public:
+    using FloatColumn = std::vector<double>;
+    using IntColumn = std::vector<std::int64_t>;
+
+    ColumnTable() = default;
+
+    /// No copy or move: the columns returned by add*Column refer to this table.
+    ColumnTable(ColumnTable const &) = delete;
+    ColumnTable(ColumnTable &&) = delete;
+    ColumnTable &operator=(ColumnTable const &) = delete;
+    ColumnTable &operator=(ColumnTable &&) = delete;
+
+    /// Add a column of doubles, returning it to push the values of each row onto.
+    FloatColumn &addFloatColumn(std::string const &name, std::string const &description);
+
+    /// Add a column of integers, returning it to push the values of each row onto.
+    IntColumn &addIntColumn(std::string const &name, std::string const &description);
+
+    /// Reserve space for nRows rows in each of the columns added so far.
+    void reserve(std::size_t nRows);
+
+    /**
+     * Write the table to filename.
+     *
+     * @throws lsst::pex::exceptions::LengthError if the columns do not all have the same length.
+     * @throws lsst::pex::exceptions::IoError if filename can not be written.
+     */
+    void write(std::string const &filename) const;
+
+private:
+    struct Column {
+        std::string name;
+        std::string description;
+        bool isInt;
+        FloatColumn floats;
+        IntColumn ints;
+    };
+
+    // Held by pointer, so that the vectors returned by add*Column stay valid as columns are added.
+    std::vector<std::unique_ptr<Column>> _columns;
+};
+
+}  // namespace jointcal
+}  // namespace lsst
+
+#endif  // LSST_JOINTCAL_COLUMN_TABLE_H
@@ -40,6 +40,7 @@ class CcdImage;
 #include "lsst/jointcal/CcdImage.h"
 
 #include <map>
+#include <mutex>
 
 namespace lsst {
 namespace jointcal {
@@ -87,6 +88,12 @@ public:
      */
     void offsetParams(Eigen::VectorXd const &Delta) override;
 
+    /// @copydoc AstrometryModel::setParameters
+    void setParameters(Eigen::VectorXd const &parameters) override;
+
+    /// @copydoc AstrometryModel::setMappingParameters
+    std::size_t setMappingParameters(MappingParameters const &parameters) override;
+
     /**
      * From there on, measurement errors are propagated using the current
      * transforms (and no longer evolve).
@@ -118,6 +125,10 @@ public:
     /// @copydoc AstrometryModel::makeSkyWcs
     std::shared_ptr<afw::geom::SkyWcs> makeSkyWcs(CcdImage const &ccdImage) const override;
 
+    /// @copydoc AstrometryModel::makeSkyWcsMap
+    std::unordered_map<CcdImageKey, std::shared_ptr<afw::geom::SkyWcs>> makeSkyWcsMap(
+            CcdImageList const &ccdImageList, unsigned nThreads = 0) const override;
+
     void print(std::ostream &out) const override;
 
 private:
@@ -127,8 +138,34 @@ private:
     const std::shared_ptr<ProjectionHandler const> _skyToTangentPlane;
     bool _fittingChips, _fittingVisits;
 
+    // The image frame of each chip: the domain of the chip transform's AST inverse.
+    std::map<CcdIdType, Frame> _chipFrames;
+
+    // AST versions of the chip and visit transforms, computed once for all the makeSkyWcs calls and
+    // discarded whenever the parameters change.
+    mutable std::map<CcdIdType, std::shared_ptr<ast::Mapping>> _chipAstMaps;
+    mutable std::unordered_map<CcdImageKey, std::shared_ptr<ast::Mapping>> _visitAstMaps;
+    mutable std::mutex _astMapsMutex;
+
+    /// Discard _chipAstMaps and _visitAstMaps, as the parameters are about to change.
+    void clearAstMaps() const;
+
     /// @copydoc AstrometryModel::findMapping
     AstrometryMapping *findMapping(CcdImage const &ccdImage) const override;
+
+    /// @copydoc AstrometryModel::getAllMappings
+    std::vector<KeyedMapping> getAllMappings() const override;
+
+    /**
+     * Fill _chipAstMaps and _visitAstMaps, fitting the polynomial inverses concurrently on nThreads
+     * threads (0 means one per available core), then creating the AST mappings serially.
+     *
+     * As in the single-CcdImage computation, the inverse of a visit transform is fit over the focal
+     * plane region of the chip it is composed with, so _visitAstMaps holds one entry per CcdImage.
+     *
+     * Must be called with _astMapsMutex held.
+     */
+    void computeAstMaps(unsigned nThreads = 0) const;
 };
 }  // namespace jointcal
 }  // namespace lsst
@@ -26,6 +26,10 @@
 #define LSST_JOINTCAL_CONSTRAINED_PHOTOMETRY_MODEL_H
 
 #include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "Eigen/Core"
 
 #include "lsst/jointcal/CcdImage.h"
 #include "lsst/jointcal/PhotometryModel.h"
@@ -91,8 +95,43 @@ public:
     /// @copydoc PhotometryModel::print
     void print(std::ostream &out) const override;
 
+    /**
+     * Precompute the basis of the visit polynomial at the focal plane position of every measurement in the
+     * catalogs for fit of ccdImageList.
+     *
+     * The basis does not change during the fit, only the coefficients do, so transform(), transformError()
+     * and computeParameterDerivatives() then reduce to dot products with the visit parameters.
+     * Measurements that are not cached are computed directly, as without a cache. Remake the cache if
+     * the catalogs for fit are rebuilt.
+     *
+     * @param ccdImageList The ccdImages whose measurements to cache.
+     * @param maxBytes Do not make the cache if it would need more memory than this.
+     *
+     * @return The memory used by the cache in bytes, 0 if it was not made.
+     */
+    std::size_t makeBasisCache(CcdImageList const &ccdImageList, std::size_t maxBytes);
+
+    /// Release the memory held by the basis cache.
+    void clearBasisCache();
+
+    /// Return the (approximate) memory used by the basis cache, in bytes.
+    std::size_t getBasisCacheSize() const;
+
 protected:
-    PhotometryMappingBase *findMapping(CcdImage const &ccdImage) const override;
+    ChipVisitPhotometryMapping *findMapping(CcdImage const &ccdImage) const override;
+
+    /// @copydoc PhotometryModel::getAllMappings
+    std::vector<KeyedMapping> getAllMappings() const override;
+
+    /// Return the column of _basisCache for measuredStar, or -1 if it is not cached.
+    Eigen::Index findBasis(MeasuredStar const &measuredStar) const {
+        if (_basisIndex.empty()) return -1;
+        auto found = _basisIndex.find(&measuredStar);
+        return (found == _basisIndex.end()) ? -1 : found->second;
+    }
+
+    // The visit polynomial basis of each cached measurement, one column per measurement.
+    Eigen::MatrixXd _basisCache;
 
     /* The per-ccdImage transforms, each of which is a composition of a chip and visit transform.
      * Not all pairs of _visitMap[visit] and _chipMap[chip] are guaranteed to have an entry in
@@ -132,6 +171,11 @@ private:
     // Which components of the model are we fitting currently?
     bool _fittingChips;
     bool _fittingVisits;
+
+    // The _basisCache column of each cached measurement; _basisStars keeps them alive, so that their
+    // addresses cannot be reused by other measurements.
+    std::unordered_map<MeasuredStar const *, Eigen::Index> _basisIndex;
+    std::vector<std::shared_ptr<MeasuredStar const>> _basisStars;
 };
 
 class ConstrainedFluxModel : public ConstrainedPhotometryModel {
@@ -150,6 +194,11 @@ public:
         fittedStar.getFlux() -= delta;
     }
 
+    /// @copydoc PhotometryModel::setFittedStarError
+    void setFittedStarError(FittedStar &fittedStar, double error) const override {
+        fittedStar.setFluxErr(error);
+    }
+
     /// @copydoc PhotometryModel::computeResidual
     double computeResidual(CcdImage const &ccdImage, MeasuredStar const &measuredStar) const override;
 
@@ -196,6 +245,11 @@ public:
         fittedStar.getMag() -= delta;
     }
 
+    /// @copydoc PhotometryModel::setFittedStarError
+    void setFittedStarError(FittedStar &fittedStar, double error) const override {
+        fittedStar.setMagErr(error);
+    }
+
     /// @copydoc PhotometryModel::computeResidual
     double computeResidual(CcdImage const &ccdImage, MeasuredStar const &measuredStar) const override;
 
@@ -25,6 +25,10 @@
 #ifndef LSST_JOINTCAL_EIGENSTUFF_H
 #define LSST_JOINTCAL_EIGENSTUFF_H
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include "lsst/pex/exceptions.h"
 
 #include "Eigen/CholmodSupport"  // to switch to cholmod
@@ -86,6 +90,114 @@ public:
         }
     }
 
+    /// Return the number of entries stored in the factor, including its diagonal.
+    Index getFactorNonZeros() const {
+        cholmod_factor const *factor = Base::m_cholmodFactor;
+        if (factor == nullptr) return 0;
+        if (factor->is_super) return factor->xsize;
+        auto const *Lnz = static_cast<Eigen::Index const *>(factor->nz);
+        Index nonZeros = 0;
+        for (Index j = 0; j < static_cast<Index>(factor->n); ++j) nonZeros += Lnz[j];
+        return nonZeros;
+    }
+
+    /**
+     * Compute the selected inverse of the factorized matrix: the elements of its inverse that lie within
+     * the sparsity pattern of the factor, which include all the non-zero elements of the matrix itself.
+     *
+     * Uses the recursion of Takahashi, Fagan & Chin (1973) on the LDLt factor, which never forms the dense
+     * inverse.
+     *
+     * @param diagonalOnly  Only return the diagonal of the inverse. The recursion still has to visit the
+     *                      whole pattern of the factor, but the off-diagonal output is not assembled.
+     *
+     * @return The lower triangle of the selected inverse, in the ordering of the factorized matrix.
+     */
+    SparseMatrixD selectedInverse(bool diagonalOnly = false) const {
+        cholmod_factor const *factor = Base::m_cholmodFactor;
+        if (factor == nullptr || factor->is_super) {
+            throw(LSST_EXCEPT(lsst::pex::exceptions::LogicError,
+                              "selectedInverse requires a simplicial factorization"));
+        }
+        Index const n = factor->n;
+        auto const *Lp = static_cast<Eigen::Index const *>(factor->p);
+        auto const *Li = static_cast<Eigen::Index const *>(factor->i);
+        auto const *Lnz = static_cast<Eigen::Index const *>(factor->nz);
+        auto const *Lx = static_cast<double const *>(factor->x);
+        auto const *perm = static_cast<Eigen::Index const *>(factor->Perm);
+
+        // Copy the strictly lower part of the unit factor into sorted columns, and D into its own vector.
+        std::vector<Eigen::Index> colStart(n + 1, 0);
+        for (Index j = 0; j < n; ++j) colStart[j + 1] = colStart[j] + Lnz[j] - 1;
+        std::vector<Eigen::Index> rows(colStart[n]);
+        std::vector<double> values(colStart[n]);
+        std::vector<double> d(n);
+        std::vector<std::pair<Eigen::Index, double>> column;
+        for (Index j = 0; j < n; ++j) {
+            column.clear();
+            double diagonal = 0;
+            for (Eigen::Index k = Lp[j]; k < Lp[j] + Lnz[j]; ++k) {
+                if (Li[k] == j) {
+                    diagonal = Lx[k];
+                } else {
+                    column.emplace_back(Li[k], Lx[k]);
+                }
+            }
+            std::sort(column.begin(), column.end());
+            // A LLt factor has to be rescaled to unit diagonal.
+            double scale = (factor->is_ll) ? diagonal : 1.0;
+            d[j] = (factor->is_ll) ? diagonal * diagonal : diagonal;
+            for (std::size_t k = 0; k < column.size(); ++k) {
+                rows[colStart[j] + k] = column[k].first;
+                values[colStart[j] + k] = column[k].second / scale;
+            }
+        }
+
+        // The inverse Z, on the pattern of the factor: zDiag(j) and zValues aligned with rows/values.
+        std::vector<double> zValues(rows.size());
+        std::vector<double> zDiag(n);
+        auto lookup = [&](Eigen::Index i, Eigen::Index k) {
+            if (i == k) return zDiag[i];
+            if (i < k) std::swap(i, k);
+            auto begin = rows.begin() + colStart[k];
+            auto end = rows.begin() + colStart[k + 1];
+            auto found = std::lower_bound(begin, end, i);
+            if (found == end || *found != i) {
+                throw(LSST_EXCEPT(lsst::pex::exceptions::RuntimeError,
+                                  "selectedInverse: element is outside the pattern of the factor"));
+            }
+            return zValues[found - rows.begin()];
+        };
+        for (Index j = n - 1; j >= 0; --j) {
+            Eigen::Index const start = colStart[j];
+            Eigen::Index const end = colStart[j + 1];
+            for (Eigen::Index a = start; a < end; ++a) {
+                double sum = 0;
+                for (Eigen::Index b = start; b < end; ++b) sum += lookup(rows[a], rows[b]) * values[b];
+                zValues[a] = -sum;
+            }
+            double sum = 0;
+            for (Eigen::Index a = start; a < end; ++a) sum += values[a] * zValues[a];
+            zDiag[j] = 1.0 / d[j] - sum;
+        }
+
+        // Undo the fill-reducing permutation, keeping the lower triangle.
+        std::vector<Eigen::Triplet<double, Eigen::Index>> triplets;
+        triplets.reserve(diagonalOnly ? n : n + rows.size());
+        for (Index j = 0; j < n; ++j) {
+            Eigen::Index const col = (perm) ? perm[j] : j;
+            triplets.emplace_back(col, col, zDiag[j]);
+            if (diagonalOnly) continue;
+            for (Eigen::Index a = colStart[j]; a < colStart[j + 1]; ++a) {
+                Eigen::Index const row = (perm) ? perm[rows[a]] : rows[a];
+                triplets.emplace_back(std::max(row, col), std::min(row, col), zValues[a]);
+            }
+        }
+        SparseMatrixD result(n, n);
+        result.setFromTriplets(triplets.begin(), triplets.end());
+        return result;
+    }
+
 protected:
     void init() {
         m_cholmod.final_asis = 1;
@@ -49,10 +49,10 @@ class AstrometryTransform;
  */
 class FittedStar : public BaseStar {
 public:
-    FittedStar() : BaseStar(), _indexInMatrix(-1), _measurementCount(0), _refStar(nullptr) {}
+    FittedStar() : BaseStar(), _indexInMatrix(-1), _measurementCount(0), _refStar(nullptr), _fixed(false) {}
 
     FittedStar(const BaseStar& baseStar)
-            : BaseStar(baseStar), _indexInMatrix(0), _measurementCount(0), _refStar(nullptr) {}
+            : BaseStar(baseStar), _indexInMatrix(0), _measurementCount(0), _refStar(nullptr), _fixed(false) {}
 
     //!
     FittedStar(const MeasuredStar& measuredStar);
@@ -69,6 +69,8 @@ public:
         _indexInMatrix = -1;
         _measurementCount = 0;
         _refStar = nullptr;
+        // A fixed star keeps the flux of the fit it comes from.
+        if (_fixed) return;
         _flux = 0;
         _fluxErr = 0;
         _mag = 0;
@@ -104,10 +106,24 @@ public:
     //! Get the astrometric reference star associated with this star.
     const RefStar* getRefStar() const { return _refStar; };
 
+    /**
+     * Whether this star comes from the solution of a previous fit and is held fixed.
+     *
+     * The fits do not change the position or flux of a fixed star (it gets no index in the matrix), the
+     * Associations do not recompute them from its MeasuredStars nor match it to a RefStar (the previous fit
+     * already accounted for the reference catalog), and it is kept whatever its number of measurements.
+     * See Associations::setFixedFittedStars().
+     */
+    ///@{
+    bool isFixed() const { return _fixed; }
+    void setFixed(bool fixed) { _fixed = fixed; }
+    ///@}
+
 private:
     Eigen::Index _indexInMatrix;
     int _measurementCount;
     const RefStar* _refStar;
+    bool _fixed;
 };
 
 /****** FittedStarList */
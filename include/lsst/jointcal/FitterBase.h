@@ -25,10 +25,17 @@
 #ifndef LSST_JOINTCAL_FITTER_BASE_H
 #define LSST_JOINTCAL_FITTER_BASE_H
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "lsst/log/Log.h"
 #include "lsst/jointcal/Associations.h"
+#include "lsst/jointcal/BlockArrowheadSolver.h"
 #include "lsst/jointcal/CcdImage.h"
 #include "lsst/jointcal/Chi2.h"
+#include "lsst/jointcal/Eigenstuff.h"
+#include "lsst/jointcal/Instrumentation.h"
 #include "lsst/jointcal/FittedStar.h"
 #include "lsst/jointcal/MeasuredStar.h"
 #include "lsst/jointcal/Tripletlist.h"
@@ -44,6 +51,34 @@ enum class MinimizeResult {
     NonFinite       // non-finite chi2 statistic
 };
 
+/// Summary of one call to minimize(), as recorded by iterate().
+struct FitIterationResult {
+    int step;                   // outer loop step number, starting at 0
+    MinimizeResult result;      // return code of this minimize() call
+    Chi2Statistic chi2;         // chi2 after this step (and after its outlier rejection)
+    std::size_t nMeasOutliers;  // number of MeasuredStar outliers rejected during this step
+    std::size_t nRefOutliers;   // number of RefStar outliers rejected during this step
+    double solveResidual;       // largest relative normal-equation residual of this step's solves
+
+    FitIterationResult()
+            : step(0),
+              result(MinimizeResult::Converged),
+              chi2(),
+              nMeasOutliers(0),
+              nRefOutliers(0),
+              solveResidual(0) {}
+};
+
+/// Return value of iterate()
+struct IterateResult {
+    MinimizeResult result;  // return code of the last minimize() call
+    Chi2Statistic chi2;     // chi2 at the end of the fit
+    bool modelValid;        // false if the model failed validation, which stops the iteration
+    std::vector<FitIterationResult> iterations;  // one entry per minimize() call, in order
+
+    IterateResult() : result(MinimizeResult::Converged), chi2(), modelValid(true) {}
+};
+
 /**
  * Base class for fitters.
  *
@@ -58,7 +93,9 @@ public:
               _lastNTrip(0),
               _nTotal(0),
               _nModelParams(0),
-              _nStarParams(0) {}
+              _nStarParams(0),
+              _useBlockSolver(false),
+              _keepFactorization(false) {}
 
     /// No copy or move: there is only ever one fitter of a given type.
     FitterBase(FitterBase const &) = delete;
@@ -74,7 +111,9 @@ public:
      *
      * It calls assignIndices, leastSquareDerivatives, solves the linear system and calls
      * offsetParams, then removes outliers in a loop if requested.
-     * Relies on sparse linear algebra via Eigen's CholmodSupport package.
+     * Relies on sparse linear algebra via Eigen's CholmodSupport package. Each solve is followed by
+     * iterative refinement against the current Hessian, so that the accuracy lost in rank updates
+     * is recovered without refactorizing.
      *
      * @param[in]  whatToFit  See child method assignIndices for valid string values.
      * @param[in]  nSigmaCut  How many sigma to reject outliers at. Outlier
@@ -90,15 +129,16 @@ public:
      *                           The line search is done in the domain [-1, 2], but if the scale factor
      *                           is far from 1.0, then the problem is likely in a significantly non-linear
      *                           regime.
-     * @param[in] dumpMatrixFile  Write the pre-fit Hessian matrix and gradient to the files with "-mat.txt"
-     *                            and "-grad.txt". Be aware, this requires a large increase in memory usage
-     *                            to create a dense matrix before writing it; the output file may be large.
-     *                            Writing the matrix can be helpful for debugging bad fits.
-     *                            Read it and compute the real eigenvalues (recall that the Hessian is
-     *                            symmetric by construction) with numpy:
+     * @param[in] dumpMatrixFile  Write the pre-fit Hessian matrix and gradient to dumpMatrixFile +
+     *                            "-hessian.bin", in a compact sparse binary format, and the map from
+     *                            matrix rows to the CcdImage models and FittedStars they belong to, to
+     *                            dumpMatrixFile + "-index.csv". Writing the matrix can be helpful for
+     *                            debugging bad fits. Read it and compute the smallest eigenvalues (recall
+     *                            that the Hessian is symmetric by construction) with scipy:
      *                            @code{.py}
-     *                             hessian = np.matrix(np.loadtxt("dumpMatrixFile-mat.txt"))
-     *                             values, vectors = np.linalg.eigh(hessian)
+     *                             hessian, grad, index = lsst.jointcal.hessianDump.readHessianDump(
+     *                                 "dumpMatrixFile")
+     *                             values, vectors = scipy.sparse.linalg.eigsh(hessian, which="SA")
      *                            @endcode
      *
      * @return  Return code describing success/failure of fit.
@@ -114,6 +154,50 @@ public:
                             double sigmaRelativeTolerance = 0, bool const doRankUpdate = true,
                             bool const doLineSearch = false, std::string const &dumpMatrixFile = "");
 
+    /**
+     * Run minimize() with outlier rejection until convergence, or at most maxSteps times.
+     *
+     * This is the outer fit loop: each step is a full minimize() call, after which the model is
+     * validated. If a step converges and doRankUpdate is set, one more minimize() is done in case accuracy
+     * was lost in the rank updates. The factorization is kept between steps, so that steps whose Hessian
+     * has an unchanged sparsity pattern only redo the numerical factorization, and the chi2 computed at
+     * the end of each minimize() is reused instead of being recomputed. Each step is logged at INFO level.
+     *
+     * @param[in]  whatToFit  See child method assignIndices for valid string values.
+     * @param[in]  nSigmaCut  How many sigma to reject outliers at.
+     * @param[in]  maxSteps  Maximum number of minimize() calls before declaring convergence failure.
+     * @param[in]  sigmaRelativeTolerance  See minimize().
+     * @param[in]  doRankUpdate  See minimize().
+     * @param[in]  doLineSearch  See minimize().
+     * @param[in]  dumpMatrixFile  See minimize(); only used for the first step.
+     * @param[in]  chi2BaseName  If not empty, write the chi2 contributions after each step via
+     *                           saveChi2Contributions, replacing "{iteration}" with the step number; if
+     *                           there is no "{iteration}", "-<step number>" is inserted before "{type}".
+     *                           Must also contain "{type}".
+     * @param[in]  refinementTolerance  Relative residual |grad - H*delta| / |grad| of the normal equations
+     *                                  that each solve is refined down to (see minimize()).
+     * @param[in]  checkpointFile  If not empty, write a checkpoint of the fit there every
+     *                             checkpointInterval steps, via writeCheckpoint(). A step that is not
+     *                             finite, leaves an invalid model or diverges is never checkpointed.
+     * @param[in]  checkpointInterval  The number of steps between checkpoints; 0 for none.
+     * @param[in]  refitOnlyIfInaccurate  With doRankUpdate, only do the extra minimize() after convergence
+     *                                    if a solve of the last step could not be refined below
+     *                                    refinementTolerance, instead of always.
+     *
+     * @return  The final chi2, the last return code, and the per-step history. If the return code is
+     *          NonFinite or Failed, or modelValid is false, the fit cannot continue and the caller
+     *          should raise.
+     *
+     * @throws lsst::pex::exceptions::RuntimeError  if the chi2 increases by more than a factor of 10
+     *         between two steps, as the fit will then almost certainly diverge.
+     */
+    IterateResult iterate(std::string const &whatToFit, double nSigmaCut, int maxSteps,
+                          double sigmaRelativeTolerance = 0, bool doRankUpdate = true,
+                          bool doLineSearch = false, std::string const &dumpMatrixFile = "",
+                          std::string const &chi2BaseName = "", double refinementTolerance = 1e-8,
+                          std::string const &checkpointFile = "", int checkpointInterval = 0,
+                          bool refitOnlyIfInaccurate = false);
+
     /**
      * Returns the chi2 for the current state.
      */
@@ -150,13 +234,55 @@ public:
     /**
      * Save the full chi2 term per star that was used in the minimization, for debugging.
      *
-     * Saves results to text files "baseName-meas.csv" and "baseName-ref.csv" for the
-     * MeasuredStar and RefStar contributions, respectively.
+     * Saves results to the binary column files (see ColumnTable) "baseName-meas.bin" and "baseName-ref.bin"
+     * for the MeasuredStar and RefStar contributions, respectively; read them with
+     * lsst.jointcal.chi2Contributions.readChi2Contributions in python.
      * This method is mostly useful for debugging: we will probably want to create a better persistence
      * system for jointcal's internal representations in the future (see DM-12446).
      */
     virtual void saveChi2Contributions(std::string const &baseName) const;
 
+    /**
+     * Write a Checkpoint of the associations and the current model parameters, from which the fit can be
+     * resumed.
+     *
+     * @param filename  The file to write; it is replaced atomically.
+     */
+    void writeCheckpoint(std::string const &filename);
+
+    /**
+     * Compute the covariance of the fitted parameters (the inverse of the Hessian) from a Cholesky
+     * factorization of the Hessian at the current parameter values.
+     *
+     * Only the "selected inverse" is computed: the elements of the covariance that lie within the sparsity
+     * pattern of the factor, which include the covariances between the parameters of each CcdImage's
+     * model and between the parameters of each FittedStar, without ever forming a dense matrix. The model
+     * covariance of each CcdImage is attached to the model (e.g. AstrometryModel::getCovariance) and the
+     * FittedStar errors are updated.
+     *
+     * @param whatToFit  See child method assignIndices for valid string values; normally the same as
+     *                   the final fit.
+     * @param diagonalOnly  Only keep the variances (the marginal errors of each parameter): the returned
+     *                      matrix and the model covariances are then diagonal, and the FittedStar
+     *                      position covariances (vxy) are zero. This saves the memory of the off-diagonal
+     *                      elements, whose number grows with the fill-in of the factor, but not the
+     *                      factorization or the recursion, which visit the whole pattern either way.
+     *
+     * @return The lower triangle of the selected covariance matrix.
+     *
+     * @throws lsst::pex::exceptions::RuntimeError  if the Hessian cannot be factorized.
+     */
+    SparseMatrixD computeCovariance(std::string const &whatToFit, bool diagonalOnly = false);
+
+    /**
+     * Return the timing and counters (triplets, Hessian and factor non-zeros, outliers) of each
+     * minimize() call, and of each of its outlier rejection iterations.
+     */
+    Instrumentation getInstrumentation() const { return _instrumentation; }
+
+    /// Forget the phases recorded so far, e.g. once they have been reported.
+    void resetInstrumentation() { _instrumentation.clear(); }
+
 protected:
     std::shared_ptr<Associations> _associations;
     std::string _whatToFit;
@@ -166,13 +292,37 @@ protected:
     Eigen::Index _nModelParams;  // Number of model parameters that are being fit.
     Eigen::Index _nStarParams;   // Number of star positions/fluxes that are being fit.
 
+    // Set by assignIndices() when the star parameters (which follow the model parameters) are expected to
+    // form a block diagonal Hessian, so that they can be eliminated with a BlockArrowheadSolver.
+    bool _useBlockSolver;
+
     // lsst.logging instance, to be created by subclass so that messages have consistent name while fitting.
     LOG_LOGGER _log;
 
-    /// Save a CSV file containing residuals of measurement terms.
+    /**
+     * Return true if the model being fit is "reasonable", see e.g. AstrometryModel::validate.
+     *
+     * @param ndof The number of degrees of freedom in the fit, e.g. from computeChi2().
+     */
+    virtual bool validateModel(int ndof) const = 0;
+
+    /**
+     * Attach the covariance computed by computeCovariance() to the model and the FittedStars.
+     *
+     * @param covariance The lower triangle of the selected covariance matrix.
+     */
+    virtual void assignCovariance(SparseMatrixD const &covariance) = 0;
+
+    /// Return the current parameters of the model being fit, as saved by writeCheckpoint().
+    virtual Eigen::VectorXd getModelParameters() const = 0;
+
+    /// Return the dense covariance matrix of the parameters at indices, from the lower triangle covariance.
+    static Eigen::MatrixXd getCovarianceBlock(SparseMatrixD const &covariance, IndexVector const &indices);
+
+    /// Save a column file containing residuals of measurement terms.
     virtual void saveChi2MeasContributions(std::string const &filename) const = 0;
 
-    /// Save a CSV file containing residuals of reference terms.
+    /// Save a column file containing residuals of reference terms.
     virtual void saveChi2RefContributions(std::string const &filename) const = 0;
 
     /**
@@ -211,6 +361,9 @@ protected:
     /// Set the indices of a measured star from the full matrix, for outlier removal.
     virtual void getIndicesOfMeasuredStar(MeasuredStar const &measuredStar, IndexVector &indices) const = 0;
 
+    /// Set the indices of the model parameters that ccdImage depends on, for the matrix dumps.
+    virtual void getIndicesOfCcdImage(CcdImage const &ccdImage, IndexVector &indices) const = 0;
+
     /// Compute the chi2 (per star or total, depending on which Chi2Accumulator is used) for measurements.
     virtual void accumulateStatImageList(CcdImageList const &ccdImageList, Chi2Accumulator &accum) const = 0;
 
@@ -231,6 +384,58 @@ protected:
                                                  TripletList &tripletList, Eigen::VectorXd &grad) const = 0;
 
 private:
+    // The factorization of the last Hessian and the sparsity pattern it was analyzed with, kept between
+    // minimize() calls while _keepFactorization is set (i.e. during iterate()).
+    std::unique_ptr<CholmodSimplicialLDLT2<SparseMatrixD>> _factorization;
+    std::vector<Eigen::Index> _factorizationOuterIndex;
+    std::vector<Eigen::Index> _factorizationInnerIndex;
+    // Replaces _factorization when the last _factorize() could eliminate the star parameters.
+    std::unique_ptr<BlockArrowheadSolver> _blockSolver;
+    bool _keepFactorization;
+
+    Instrumentation _instrumentation;
+
+    /// minimize(), also returning the final chi2 and the number of outliers that were rejected.
+    FitIterationResult _minimize(std::string const &whatToFit, double nSigmaCut,
+                                 double sigmaRelativeTolerance, bool doRankUpdate, bool doLineSearch,
+                                 std::string const &dumpMatrixFile, double refinementTolerance = 1e-8);
+
+    /**
+     * Solve hessian*delta = grad with the current factorization, then apply up to maxRefinementSteps
+     * steps of iterative refinement against hessian, which may have drifted from the factorization
+     * through rank updates.
+     *
+     * @param[in]  hessian  The Hessian the factorization is meant to represent.
+     * @param[in]  grad  The right-hand side.
+     * @param[in]  refinementTolerance  Stop refining once the relative residual is below this value.
+     * @param[out]  residual  The final relative residual |grad - hessian*delta| / |grad|.
+     *
+     * @return The (refined) solution delta.
+     */
+    Eigen::VectorXd _solve(SparseMatrixD const &hessian, Eigen::VectorXd const &grad,
+                           double refinementTolerance, double &residual) const;
+
+    /**
+     * Factorize hessian into _factorization, reusing the previous symbolic analysis if hessian has the
+     * same sparsity pattern as the previously factorized matrix.
+     *
+     * If _useBlockSolver is set and the star parameters of hessian are block diagonal, factorize it into
+     * _blockSolver instead, falling back to _factorization if that fails.
+     *
+     * @return True if the factorization succeeded.
+     */
+    bool _factorize(SparseMatrixD const &hessian);
+
+    /// Number of entries stored by the current factorization.
+    Eigen::Index _getFactorNonZeros() const;
+
+    /// Write hessian, grad and the parameter index map to files built from dumpFile; see minimize().
+    void _dumpMatrixAndGradient(SparseMatrixD const &hessian, Eigen::VectorXd const &grad,
+                                std::string const &dumpFile) const;
+
+    /// Free the factorization, if we are not keeping it for the next step.
+    void _releaseFactorization();
+
     /**
      * Performe a line search along vector delta, returning a scale factor for the minimum.
      *
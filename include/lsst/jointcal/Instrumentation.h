@@ -0,0 +1,104 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LSST_JOINTCAL_INSTRUMENTATION_H
+#define LSST_JOINTCAL_INSTRUMENTATION_H
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace lsst {
+namespace jointcal {
+
+/// Timing, memory and counters recorded for one phase (e.g. one minimize() call) of jointcal.
+struct PhaseStatistics {
+    std::string name;
+    double wallTime;                         // elapsed wall-clock time, in seconds
+    double cpuTime;                          // CPU time of the calling thread, in seconds (see Timer)
+    long peakMemoryIncrease;                 // growth of the peak resident set size, in bytes
+    int nThreads;                            // number of threads Eigen was allowed to use
+    std::map<std::string, double> counters;  // e.g. triplet counts, matrix sizes, outliers
+
+    PhaseStatistics(std::string const &name_)
+            : name(name_), wallTime(0), cpuTime(0), peakMemoryIncrease(0), nThreads(1) {}
+};
+
+std::ostream &operator<<(std::ostream &out, PhaseStatistics const &phase);
+
+/**
+ * Lightweight record of where jointcal spends its time, for tracking performance regressions.
+ *
+ * Phases are recorded in the order in which they start, so nested phases follow their parent.
+ */
+class Instrumentation {
+public:
+    /**
+     * Record the time spent between construction and stop() (or destruction) as a new phase.
+     *
+     * The CPU time is that of the thread which created the Timer, so phases timed concurrently in
+     * other threads do not inflate each other; work that the phase hands to other threads (Eigen's
+     * OpenMP threads, ParallelFor workers) is therefore not included in it.
+     */
+    class Timer {
+    public:
+        Timer(Instrumentation &instrumentation, std::string const &name);
+        ~Timer() { stop(); }
+
+        Timer(Timer const &) = delete;
+        Timer(Timer &&) = delete;
+        Timer &operator=(Timer const &) = delete;
+        Timer &operator=(Timer &&) = delete;
+
+        /// Add value to the named counter of this phase.
+        void addCounter(std::string const &counter, double value);
+
+        /// Finish timing this phase; further calls have no effect.
+        void stop();
+
+    private:
+        Instrumentation &_instrumentation;
+        std::size_t _index;  // of our phase in _instrumentation; an index stays valid if phases are added
+        std::chrono::steady_clock::time_point _wallStart;
+        double _cpuStart;  // thread CPU time, in seconds
+        long _peakMemoryStart;
+        bool _running;
+    };
+
+    /// Return all the phases recorded so far.
+    std::vector<PhaseStatistics> const &getPhases() const { return _phases; }
+
+    /// Forget all recorded phases.
+    void clear() { _phases.clear(); }
+
+private:
+    std::vector<PhaseStatistics> _phases;
+};
+
+}  // namespace jointcal
+}  // namespace lsst
+
+#endif  // LSST_JOINTCAL_INSTRUMENTATION_H
@@ -44,7 +44,11 @@ struct MatchConditions {
     double maxShiftX, maxShiftY;
     double sizeRatio, deltaSizeRatio, minMatchRatio;
     int printLevel;
+    // 1 and 2: old and new segment-pair histograms, quadratic in nStarsList*;
+    // 3: triangle hashing, linear in nStarsList*, which can then be much larger.
     int algorithm;
+    // Number of closest neighbours each star forms triangles with, for algorithm 3.
+    int nTriangleNeighbours;
 
     MatchConditions()
             : nStarsList1(70),
@@ -57,7 +61,8 @@ struct MatchConditions {
               deltaSizeRatio(0.1 * sizeRatio),
               minMatchRatio(1. / 3.),
               printLevel(0),
-              algorithm(2) {}
+              algorithm(2),
+              nTriangleNeighbours(6) {}
 
     double minSizeRatio() const { return sizeRatio - deltaSizeRatio; }
     double maxSizeRatio() const { return sizeRatio + deltaSizeRatio; }
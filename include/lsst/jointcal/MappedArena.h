@@ -0,0 +1,142 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LSST_JOINTCAL_MAPPED_ARENA_H
+#define LSST_JOINTCAL_MAPPED_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lsst {
+namespace jointcal {
+
+/**
+ * Memory allocated from a memory-mapped scratch file instead of the heap.
+ *
+ * Used to store the catalogs to fit (see Associations::setFitCatalogStorage): the pages of a
+ * memory-mapped file can be written back to the file and dropped by the operating system when memory is
+ * short, without going to swap. Consecutive allocations are contiguous, so that the stars of each
+ * CcdImage share pages that the fit loops read sequentially, and that are paged out together while
+ * other CcdImages (or the factorization) are in use.
+ *
+ * The file is unlinked as soon as it is created, so that it is removed even if the process dies; it grows
+ * one chunk at a time. Freed blocks are reused for allocations of the same size that they are aligned
+ * for, which is what repeatedly rebuilding the catalogs to fit needs; the file itself only shrinks when
+ * the arena is destroyed.
+ *
+ * All methods are thread safe.
+ */
+class MappedArena {
+public:
+    /**
+     * Create an empty arena.
+     *
+     * @param directory  The directory to create the scratch file in.
+     * @param chunkSize  The size by which to grow the file, in bytes; rounded up to whole pages.
+     *
+     * @throws lsst::pex::exceptions::IoError if the scratch file can not be created.
+     */
+    explicit MappedArena(std::string const &directory, std::size_t chunkSize = 64 << 20);
+
+    /// No copy or move: the allocated memory belongs to this arena.
+    MappedArena(MappedArena const &) = delete;
+    MappedArena(MappedArena &&) = delete;
+    MappedArena &operator=(MappedArena const &) = delete;
+    MappedArena &operator=(MappedArena &&) = delete;
+
+    /// Unmap and close the scratch file: all memory allocated from this arena becomes invalid.
+    ~MappedArena();
+
+    /**
+     * Allocate size bytes, aligned to alignment (at most the page size).
+     *
+     * @throws std::bad_alloc if the scratch file can not be grown or mapped.
+     */
+    void *allocate(std::size_t size, std::size_t alignment);
+
+    /// Return a block from allocate(size, ...) for reuse by a later allocation of the same size.
+    void deallocate(void *pointer, std::size_t size);
+
+    /// The size of the scratch file, in bytes.
+    std::size_t getMappedSize() const;
+
+private:
+    struct Chunk {
+        char *begin;
+        std::size_t size;
+    };
+
+    mutable std::mutex _mutex;
+    int _fd;
+    std::size_t _chunkSize;
+    std::size_t _fileSize;
+    std::vector<Chunk> _chunks;
+    // Next unallocated byte of the last chunk.
+    std::size_t _used;
+    std::unordered_map<std::size_t, std::vector<void *>> _freeBlocks;
+};
+
+/**
+ * A standard allocator for MappedArena, e.g. for std::allocate_shared.
+ *
+ * Each copy shares the arena, so that the arena outlives everything allocated with it.
+ */
+template <typename T>
+class MappedArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit MappedArenaAllocator(std::shared_ptr<MappedArena> arena) : _arena(std::move(arena)) {}
+
+    template <typename U>
+    MappedArenaAllocator(MappedArenaAllocator<U> const &other) : _arena(other.getArena()) {}
+
+    T *allocate(std::size_t n) { return static_cast<T *>(_arena->allocate(n * sizeof(T), alignof(T))); }
+
+    void deallocate(T *pointer, std::size_t n) { _arena->deallocate(pointer, n * sizeof(T)); }
+
+    std::shared_ptr<MappedArena> const &getArena() const { return _arena; }
+
+private:
+    std::shared_ptr<MappedArena> _arena;
+};
+
+template <typename T, typename U>
+bool operator==(MappedArenaAllocator<T> const &a, MappedArenaAllocator<U> const &b) {
+    return a.getArena() == b.getArena();
+}
+
+template <typename T, typename U>
+bool operator!=(MappedArenaAllocator<T> const &a, MappedArenaAllocator<U> const &b) {
+    return !(a == b);
+}
+
+}  // namespace jointcal
+}  // namespace lsst
+
+#endif  // LSST_JOINTCAL_MAPPED_ARENA_H
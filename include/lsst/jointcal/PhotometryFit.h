@@ -86,6 +86,17 @@ public:
     std::shared_ptr<PhotometryModel> getModel() const { return _photometryModel; }
 
 protected:
+    /// @copydoc FitterBase::validateModel
+    bool validateModel(int ndof) const override {
+        return _photometryModel->validate(_associations->getCcdImageList(), ndof);
+    }
+
+    /// @copydoc FitterBase::assignCovariance
+    void assignCovariance(SparseMatrixD const &covariance) override;
+
+    /// @copydoc FitterBase::getModelParameters
+    Eigen::VectorXd getModelParameters() const override { return _photometryModel->getParameters(); }
+
     /// @copydoc FitterBase::saveChi2MeasContributions
     void saveChi2MeasContributions(std::string const &filename) const override;
 
@@ -102,6 +113,8 @@ private:
 
     void getIndicesOfMeasuredStar(MeasuredStar const &measuredStar, IndexVector &indices) const override;
 
+    void getIndicesOfCcdImage(CcdImage const &ccdImage, IndexVector &indices) const override;
+
     void leastSquareDerivativesMeasurement(CcdImage const &ccdImage, TripletList &tripletList,
                                            Eigen::VectorXd &grad,
                                            MeasuredStarList const *measuredStarList = nullptr) const override;
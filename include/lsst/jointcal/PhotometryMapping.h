@@ -277,6 +277,24 @@ public:
     std::size_t getNParChip() const { return _nParChip; }
     std::size_t getNParVisit() const { return _nParVisit; }
 
+    /**
+     * @name Precomputed visit basis
+     *
+     * Equivalent to transform(), transformError() and computeParameterDerivatives(), given the basis of
+     * the visit transform at measuredStar's focal plane position, as computed by
+     * PhotometryTransformChebyshev::computeBasis(). The visit transform must be a
+     * PhotometryTransformChebyshev.
+     */
+    //@{
+    virtual double transformWithBasis(MeasuredStar const &measuredStar, double value,
+                                      Eigen::Ref<Eigen::VectorXd const> const &visitBasis) const = 0;
+    virtual double transformErrorWithBasis(MeasuredStar const &measuredStar, double value, double valueErr,
+                                           Eigen::Ref<Eigen::VectorXd const> const &visitBasis) const = 0;
+    virtual void computeParameterDerivativesWithBasis(MeasuredStar const &measuredStar, double value,
+                                                      Eigen::Ref<Eigen::VectorXd const> const &visitBasis,
+                                                      Eigen::Ref<Eigen::VectorXd> derivatives) const = 0;
+    //@}
+
 protected:
     // These are either transform.getNpar() or 0, depending on whether we are fitting that component or not.
     std::size_t _nParChip, _nParVisit;
@@ -298,6 +316,14 @@ public:
     /// @copydoc PhotometryMappingBase::computeParameterDerivatives
     void computeParameterDerivatives(MeasuredStar const &measuredStar, double value,
                                      Eigen::Ref<Eigen::VectorXd> derivatives) const override;
+
+    double transformWithBasis(MeasuredStar const &measuredStar, double value,
+                              Eigen::Ref<Eigen::VectorXd const> const &visitBasis) const override;
+    double transformErrorWithBasis(MeasuredStar const &measuredStar, double value, double valueErr,
+                                   Eigen::Ref<Eigen::VectorXd const> const &visitBasis) const override;
+    void computeParameterDerivativesWithBasis(MeasuredStar const &measuredStar, double value,
+                                              Eigen::Ref<Eigen::VectorXd const> const &visitBasis,
+                                              Eigen::Ref<Eigen::VectorXd> derivatives) const override;
 };
 
 class ChipVisitMagnitudeMapping : public ChipVisitPhotometryMapping {
@@ -317,6 +343,17 @@ public:
     /// @copydoc PhotometryMappingBase::computeParameterDerivatives
     void computeParameterDerivatives(MeasuredStar const &measuredStar, double value,
                                      Eigen::Ref<Eigen::VectorXd> derivatives) const override;
+
+    double transformWithBasis(MeasuredStar const &measuredStar, double value,
+                              Eigen::Ref<Eigen::VectorXd const> const &visitBasis) const override;
+    double transformErrorWithBasis(MeasuredStar const &measuredStar, double value, double valueErr,
+                                   Eigen::Ref<Eigen::VectorXd const> const &visitBasis) const override {
+        // the magnitude error does not depend on the position.
+        return transformError(measuredStar, value, valueErr);
+    }
+    void computeParameterDerivativesWithBasis(MeasuredStar const &measuredStar, double value,
+                                              Eigen::Ref<Eigen::VectorXd const> const &visitBasis,
+                                              Eigen::Ref<Eigen::VectorXd> derivatives) const override;
 };
 
 }  // namespace jointcal
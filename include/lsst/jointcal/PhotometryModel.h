@@ -26,6 +26,7 @@
 #define LSST_JOINTCAL_PHOTOMETRY_MODEL_H
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "lsst/afw/image/PhotoCalib.h"
@@ -33,6 +34,7 @@
 
 #include "lsst/jointcal/CcdImage.h"
 #include "lsst/jointcal/Eigenstuff.h"
+#include "lsst/jointcal/Instrumentation.h"
 #include "lsst/jointcal/PhotometryMapping.h"
 #include "lsst/jointcal/FittedStar.h"
 #include "lsst/jointcal/MeasuredStar.h"
@@ -76,6 +78,14 @@ public:
      */
     virtual void offsetFittedStar(FittedStar &fittedStar, double delta) const = 0;
 
+    /**
+     * Set the error on the appropriate flux or magnitude.
+     *
+     * @param fittedStar The star to update.
+     * @param error The error on the fitted flux or magnitude, e.g. from FitterBase::computeCovariance.
+     */
+    virtual void setFittedStarError(FittedStar &fittedStar, double error) const = 0;
+
     /**
      * Compute the residual between the model applied to a star and its associated fittedStar.
      *
@@ -149,6 +159,17 @@ public:
      */
     virtual std::shared_ptr<afw::image::PhotoCalib> toPhotoCalib(CcdImage const &ccdImage) const = 0;
 
+    /**
+     * Return the mapping of every exposure in ccdImageList represented as a PhotoCalib.
+     *
+     * The PhotoCalibs are made one after the other: most of the work is creating their AST objects,
+     * which must not be done from several threads.
+     *
+     * @param ccdImageList The exposures to create the PhotoCalib for.
+     */
+    std::unordered_map<CcdImageKey, std::shared_ptr<afw::image::PhotoCalib>> toPhotoCalibMap(
+            CcdImageList const &ccdImageList) const;
+
     /// Return the number of parameters in the mapping of CcdImage
     std::size_t getNpar(CcdImage const &ccdImage) const { return findMapping(ccdImage)->getNpar(); }
 
@@ -160,6 +181,71 @@ public:
     /// Return the total number of parameters in this model.
     virtual std::size_t getTotalParameters() const = 0;
 
+    /**
+     * Get the parameters of all the transforms of this model, each followed by those of its error
+     * transform, e.g. to checkpoint the fit.
+     *
+     * The order only depends on the CcdImages the model was constructed with, so the result can be given
+     * to setParameters() of a model constructed in the same way.
+     */
+    Eigen::VectorXd getParameters() const;
+
+    /**
+     * Set the parameters of all the transforms of this model and of their error transforms, as returned
+     * by getParameters().
+     *
+     * Call freezeErrorTransform() first if it had been called on the model the parameters come from.
+     *
+     * @throws lsst::pex::exceptions::LengthError if parameters does not have the size of getParameters().
+     */
+    void setParameters(Eigen::VectorXd const &parameters);
+
+    /// The parameters of each transform of a model, by the key described in getMappingParameters().
+    using MappingParameters = std::unordered_map<CcdImageKey, Eigen::VectorXd>;
+
+    /**
+     * Get the parameters of each transform of this model (without those of the error transforms), keyed
+     * by the ids of the CcdImages it applies to: (visit, ccd) for a transform of one CcdImage,
+     * (visit, -1) for a transform of a whole visit, and (-1, ccd) for a transform of one chip in all
+     * visits.
+     *
+     * Used to start a later fit of an overlapping set of CcdImages from this solution; see
+     * setMappingParameters().
+     */
+    MappingParameters getMappingParameters() const;
+
+    /**
+     * Start the transforms of this model from a previous solution, as returned by getMappingParameters()
+     * of a model of the same kind.
+     *
+     * The transforms whose key is not in parameters keep their initial values, as do those whose number
+     * of parameters differs (e.g. because the Chebyshev order changed), with a warning. Call before
+     * freezeErrorTransform(), so that the measurement errors are propagated with the new transforms.
+     *
+     * @return The number of transforms that were set.
+     */
+    std::size_t setMappingParameters(MappingParameters const &parameters);
+
+    /**
+     * Hold the transforms with the given keys (as in getMappingParameters()) fixed in the next fits, e.g.
+     * those started from the solution of a previous run, so that only the transforms of new chips and
+     * visits are fit. Keys of no transform of this model are ignored.
+     *
+     * The transforms this model always holds fixed (e.g. the chip that removes the degeneracy of
+     * ConstrainedPhotometryModel) are left as they are, here and by releaseMappings(). Call before
+     * assignIndices().
+     *
+     * @return The number of transforms that were fixed.
+     */
+    std::size_t fixMappings(std::vector<CcdImageKey> const &keys);
+
+    /**
+     * Fit the transforms held fixed by fixMappings() again. Call before assignIndices().
+     *
+     * @return The number of transforms that were released.
+     */
+    std::size_t releaseMappings();
+
     /**
      * Print a string representation of the contents of this mapping, for debugging.
      *
@@ -180,6 +266,26 @@ public:
      */
     bool validate(CcdImageList const &ccdImageList, int ndof) const;
 
+    /**
+     * Set the covariance of the fitted parameters of the mapping of ccdImage, ordered as in
+     * getMappingIndices; see FitterBase::computeCovariance.
+     */
+    void setCovariance(CcdImage const &ccdImage, Eigen::MatrixXd const &covariance) {
+        _covariances[ccdImage.getHashKey()] = covariance;
+    }
+
+    /// Return the covariance set by setCovariance, or an empty matrix if it has not been computed.
+    Eigen::MatrixXd getCovariance(CcdImage const &ccdImage) const {
+        auto found = _covariances.find(ccdImage.getHashKey());
+        return (found == _covariances.end()) ? Eigen::MatrixXd() : found->second;
+    }
+
+    /// Return the timing and counters of this model's construction.
+    Instrumentation getInstrumentation() const { return _instrumentation; }
+
+    /// Forget the phases recorded so far, e.g. once they have been reported.
+    void resetInstrumentation() { _instrumentation.clear(); }
+
     /**
      * Check that the model is positive on the ccdImage bbox.
      *
@@ -217,11 +323,26 @@ protected:
     /// Return a pointer to the mapping associated with this ccdImage.
     virtual PhotometryMappingBase *findMapping(CcdImage const &ccdImage) const = 0;
 
+    /// A mapping of this model, with the key described in getMappingParameters().
+    using KeyedMapping = std::pair<CcdImageKey, PhotometryMapping *>;
+
+    /// Return each PhotometryMapping of this model once, in an order that only depends on its CcdImages.
+    virtual std::vector<KeyedMapping> getAllMappings() const = 0;
+
     /// lsst.logging instance, to be created by a subclass so that messages have consistent name.
     LOG_LOGGER _log;
 
+    /// To be filled in by the subclass constructors.
+    Instrumentation _instrumentation;
+
     // Pedestal on flux/magnitude error (percent of flux or delta magnitude)
     double errorPedestal;
+
+private:
+    // Fitted parameter covariance of each CcdImage's mapping, if computed.
+    std::unordered_map<CcdImageKey, Eigen::MatrixXd> _covariances;
+    // The mappings held fixed by fixMappings().
+    std::vector<PhotometryMapping *> _fixedMappings;
 };
 }  // namespace jointcal
 }  // namespace lsst
@@ -102,6 +102,9 @@ public:
 
     /// Get a copy of the parameters of this model, in the same order as `offsetParams`.
     virtual Eigen::VectorXd getParameters() const = 0;
+
+    /// Set the parameters of this model, in the same order as `getParameters`.
+    virtual void setParameters(Eigen::VectorXd const &parameters) = 0;
 };
 
 /**
@@ -129,6 +132,9 @@ public:
         return parameters;
     }
 
+    /// @copydoc PhotometryTransform::setParameters
+    void setParameters(Eigen::VectorXd const &parameters) override { _value = parameters[0]; }
+
 protected:
     double getValue() const { return _value; }
 
@@ -230,13 +236,16 @@ public:
     PhotometryTransformChebyshev(size_t order, geom::Box2D const &bbox, bool identity);
 
     /**
-     * Create a Chebyshev transform with the specified coefficients.
+     * Create a Chebyshev transform with (a copy of) the specified coefficients.
      *
-     * The polynomial order is determined from the number of coefficients, taking only the
-     * anti-diagonal upper triangle portion of the passed-in coefficients
+     * The polynomial order is determined from the number of coefficients. Only the anti-diagonal upper
+     * triangle portion of the coefficients (i+j <= order) are terms of the transform.
      *
-     * @param      coefficients  The polynomial coefficients.
+     * @param      coefficients  The polynomial coefficients, a square array.
      * @param[in]  bbox          The bounding box it is valid within, to rescale it to [-1,1].
+     *
+     * @throws pex::exceptions::InvalidParameterError if coefficients is not square, or if a coefficient
+     *         outside of the upper triangle is not 0.
      */
     PhotometryTransformChebyshev(ndarray::Array<double, 2, 2> const &coefficients, geom::Box2D const &bbox);
 
@@ -258,6 +267,9 @@ public:
     /// @copydoc PhotometryTransform::getParameters
     Eigen::VectorXd getParameters() const override;
 
+    /// @copydoc PhotometryTransform::setParameters
+    void setParameters(Eigen::VectorXd const &parameters) override;
+
     ndarray::Size getOrder() const { return _order; }
 
     geom::Box2D getBBox() const { return _bbox; }
@@ -272,9 +284,38 @@ public:
     /// @overload integrate(geom::Box2D const &bbox) const;
     double integrate() const;
 
+    /**
+     * Return the values of this polynomial at many points at once (e.g. all the sources of a catalog).
+     *
+     * @param x The x coordinates of the points.
+     * @param y The y coordinates of the points; must be the same size as x.
+     *
+     * @throws pex::exceptions::LengthError if x and y have different sizes.
+     */
+    Eigen::ArrayXd computeChebyshev(Eigen::Ref<Eigen::ArrayXd const> const &x,
+                                    Eigen::Ref<Eigen::ArrayXd const> const &y) const;
+
+    /**
+     * Compute the basis of this polynomial at x,y: the products T_i(x)*T_j(y), in the same order as
+     * getParameters(). The basis only depends on the position, so it can be precomputed for points that
+     * do not move while the coefficients are fit.
+     *
+     * @param[in]  x      The x coordinate to compute at.
+     * @param[in]  y      The y coordinate to compute at.
+     * @param[out] basis  The computed basis, of size getNpar().
+     */
+    void computeBasis(double x, double y, Eigen::Ref<Eigen::VectorXd> basis) const {
+        computeChebyshevDerivatives(x, y, basis);
+    }
+
+    /// Return the value of this polynomial at the point where basis was computed by computeBasis().
+    double computeChebyshevFromBasis(Eigen::Ref<Eigen::VectorXd const> const &basis) const;
+
 protected:
     /**
      * Return the value of this polynomial at x,y. For use in the sublcass transform() methods.
+     *
+     * Only the terms with i+j <= order are used, as in getParameters().
      */
     double computeChebyshev(double x, double y) const;
 
@@ -67,6 +67,12 @@ public:
      */
     Point apply(Point star, double timeDeltaYears) const;
 
+    double getRa() const { return _ra; }
+    double getDec() const { return _dec; }
+    double getRaErr() const { return _raErr; }
+    double getDecErr() const { return _decErr; }
+    double getRaDecCov() const { return _raDecCov; }
+
     friend std::ostream &operator<<(std::ostream &stream, ProperMotion const &pm);
 
 private:
@@ -74,6 +74,9 @@ public:
      */
     Point applyProperMotion(Point star, double timeDeltaYears) const;
 
+    /// The proper motion of this star, or nullptr if it has none.
+    ProperMotion const *getProperMotion() const { return _properMotion.get(); }
+
 private:
     // RefStars are already PM corrected to a common epoch: this is to correct the associated FittedStar
     // to each MeasuredStar's epoch. Not all refcats have PM data: this will be nullptr if no PM data is
@@ -43,8 +43,7 @@ public:
     SimpleAstrometryMapping(AstrometryTransform const &astrometryTransform, bool toBeFit = true)
             : toBeFit(toBeFit),
               transform(astrometryTransform.clone()),
-              errorProp(transform),
-              lin(new AstrometryTransformLinear) {}
+              errorProp(transform) {}
 
     /// No copy or move: there is only ever one instance of a given mapping (i.e.. per ccd+visit)
     SimpleAstrometryMapping(SimpleAstrometryMapping const &) = delete;
@@ -92,6 +91,24 @@ public:
     //! Access to the (fitted) transform
     virtual AstrometryTransform const &getTransform() const { return *transform; }
 
+    /**
+     * Get the parameters of the transform, followed by those of the error transform (the same until
+     * freezeErrorTransform() is called), whether or not this mapping is fit.
+     */
+    Eigen::VectorXd getParameters() const;
+
+    /// Set the parameters of the transform and of the error transform, as returned by getParameters().
+    virtual void setParameters(Eigen::VectorXd const &parameters);
+
+    /// Get the parameters of the transform alone, whether or not this mapping is fit.
+    Eigen::VectorXd getTransformParameters() const;
+
+    /**
+     * Set the parameters of the transform alone, as returned by getTransformParameters(); the error
+     * transform is only changed if it is still the transform itself.
+     */
+    virtual void setTransformParameters(Eigen::VectorXd const &parameters);
+
     /// Get whether this mapping is fit as part of a Model.
     bool getToBeFit() const { return toBeFit; }
     /// Set whether this Mapping is to be fit as part of a Model.
@@ -108,9 +125,6 @@ protected:
     std::shared_ptr<AstrometryTransform> transform;
 
     std::shared_ptr<AstrometryTransform> errorProp;
-    /* to avoid allocation at every call of positionDerivative.
-       use a pointer for constness */
-    std::unique_ptr<AstrometryTransformLinear> lin;
 };
 
 //! Mapping implementation for a polynomial transformation.
@@ -145,8 +159,17 @@ public:
     /// @copydoc AstrometryMapping::transformPosAndErrors
     void transformPosAndErrors(FatPoint const &where, FatPoint &outPoint) const override;
 
+    /// @copydoc AstrometryMapping::offsetParams
+    void offsetParams(Eigen::VectorXd const &delta) override;
+
+    /// @copydoc SimpleAstrometryMapping::setParameters
+    void setParameters(Eigen::VectorXd const &parameters) override;
+
+    /// @copydoc SimpleAstrometryMapping::setTransformParameters
+    void setTransformParameters(Eigen::VectorXd const &parameters) override;
+
     /// @copydoc SimpleAstrometryMapping::getTransform
-    AstrometryTransform const &getTransform() const override;
+    AstrometryTransform const &getTransform() const override { return actualResult; }
 
 private:
     /* to better condition the 2nd derivative matrix, the
@@ -155,8 +178,11 @@ private:
     AstrometryTransformLinear _centerAndScale;
     Eigen::Matrix2d preDer;
 
-    /* Where we store the combination. */
-    mutable AstrometryTransformPolynomial actualResult;
+    /* Where we store the combination, kept up to date by offsetParams(), so that getTransform() does
+       not write anything and can be called concurrently. */
+    AstrometryTransformPolynomial actualResult;
+
+    void updateActualResult();
 };
 
 #ifdef STORAGE
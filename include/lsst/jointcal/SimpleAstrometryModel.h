@@ -103,14 +103,25 @@ public:
     /// @copydoc AstrometryModel::makeSkyWcs
     std::shared_ptr<afw::geom::SkyWcs> makeSkyWcs(CcdImage const &ccdImage) const override;
 
+    /// @copydoc AstrometryModel::makeSkyWcsMap
+    std::unordered_map<CcdImageKey, std::shared_ptr<afw::geom::SkyWcs>> makeSkyWcsMap(
+            CcdImageList const &ccdImageList, unsigned nThreads = 0) const override;
+
     ~SimpleAstrometryModel(){};
 
 private:
     std::unordered_map<CcdImageKey, std::unique_ptr<SimpleAstrometryMapping>> _myMap;
     const std::shared_ptr<ProjectionHandler const> _skyToTangentPlane;
 
+    /// The SkyWcs of ccdImage, whose pixels go to the tangent plane through pixelsToIwc.
+    std::shared_ptr<afw::geom::SkyWcs> makeSkyWcs(CcdImage const &ccdImage,
+                                                  ast::Mapping const &pixelsToIwc) const;
+
     /// @copydoc AstrometryModel::findMapping
     AstrometryMapping *findMapping(CcdImage const &ccdImage) const override;
+
+    /// @copydoc AstrometryModel::getAllMappings
+    std::vector<KeyedMapping> getAllMappings() const override;
 };
 }  // namespace jointcal
 }  // namespace lsst
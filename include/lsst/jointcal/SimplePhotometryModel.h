@@ -81,6 +81,9 @@ protected:
 
     /// Return the mapping associated with this ccdImage.
     PhotometryMappingBase *findMapping(CcdImage const &ccdImage) const override;
+
+    /// @copydoc PhotometryModel::getAllMappings
+    std::vector<KeyedMapping> getAllMappings() const override;
 };
 
 class SimpleFluxModel : public SimplePhotometryModel {
@@ -92,6 +95,11 @@ public:
         fittedStar.getFlux() -= delta;
     }
 
+    /// @copydoc PhotometryModel::setFittedStarError
+    void setFittedStarError(FittedStar &fittedStar, double error) const override {
+        fittedStar.setFluxErr(error);
+    }
+
     /// @copydoc PhotometryModel::computeResidual
     double computeResidual(CcdImage const &ccdImage, MeasuredStar const &measuredStar) const override;
 
@@ -129,6 +137,11 @@ public:
         fittedStar.getMag() -= delta;
     }
 
+    /// @copydoc PhotometryModel::setFittedStarError
+    void setFittedStarError(FittedStar &fittedStar, double error) const override {
+        fittedStar.setMagErr(error);
+    }
+
     /// @copydoc PhotometryModel::computeResidual
     double computeResidual(CcdImage const &ccdImage, MeasuredStar const &measuredStar) const override;
 
@@ -25,11 +25,15 @@ from .associations import *
 from .astrometryMappings import *
 from .astrometryModels import *
 from .ccdImage import *
+from .checkpoint import *
 from .chi2 import *
+from .columnTable import *
 from .fitter import *
+from .instrumentation import *
 from .astrometryTransform import *
 from .jointcal import *
 from .jointcalControl import *
+from .listMatch import *
 from .photometryMappings import *
 from .photometryModels import *
 from .photometryTransform import *
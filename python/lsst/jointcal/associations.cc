@@ -23,6 +23,7 @@
  */
 
 #include "pybind11/pybind11.h"
+#include "pybind11/eigen.h"
 #include "pybind11/stl.h"
 
 #include "lsst/jointcal/Associations.h"
@@ -45,16 +46,26 @@ void declareAssociations(py::module &mod) {
     cls.def("refStarListSize", &Associations::refStarListSize);
     cls.def("fittedStarListSize", &Associations::fittedStarListSize);
     cls.def("associateCatalogs", &Associations::associateCatalogs, "matchCutInArcsec"_a = 0,
-            "useFittedList"_a = false, "enlargeFittedList"_a = true);
+            "useFittedList"_a = false, "enlargeFittedList"_a = true,
+            py::call_guard<py::gil_scoped_release>());
+    cls.def("setReuseAssociation", &Associations::setReuseAssociation);
+    cls.def("getReuseAssociation", &Associations::getReuseAssociation);
+    cls.def("setFitCatalogStorage", &Associations::setFitCatalogStorage, "directory"_a);
+    cls.def("getFitCatalogMappedSize", &Associations::getFitCatalogMappedSize);
+    cls.def("getFitCatalogHeapSize", &Associations::getFitCatalogHeapSize);
+    cls.def("createFitView", &Associations::createFitView);
     cls.def("collectRefStars", &Associations::collectRefStars, "refCat"_a, "matchCut"_a, "fluxField"_a,
-            "refCoordinateErr"_a, "rejectBadFluxes"_a = false);
+            "refCoordinateErr"_a, "rejectBadFluxes"_a = false, py::call_guard<py::gil_scoped_release>());
     cls.def("deprojectFittedStars", &Associations::deprojectFittedStars);
+    cls.def("getFittedStarArray", &Associations::getFittedStarArray, "includeFixed"_a = true);
+    cls.def("setFixedFittedStars", &Associations::setFixedFittedStars, "stars"_a);
     cls.def("nCcdImagesValidForFit", &Associations::nCcdImagesValidForFit);
     cls.def("nFittedStarsWithAssociatedRefStar", &Associations::nFittedStarsWithAssociatedRefStar);
 
     cls.def("createCcdImage", &Associations::createCcdImage);
     cls.def("addCcdImage", &Associations::addCcdImage);
-    cls.def("prepareFittedStars", &Associations::prepareFittedStars);
+    cls.def("prepareFittedStars", &Associations::prepareFittedStars,
+            py::call_guard<py::gil_scoped_release>());
     cls.def("cleanFittedStars", &Associations::cleanFittedStars);
 
     cls.def("getCcdImageList", &Associations::getCcdImageList, py::return_value_policy::reference_internal);
@@ -66,14 +77,19 @@ void declareAssociations(py::module &mod) {
     cls.def("getCommonTangentPoint", &Associations::getCommonTangentPoint);
     cls.def("setCommonTangentPoint", &Associations::setCommonTangentPoint);
     cls.def("computeCommonTangentPoint", &Associations::computeCommonTangentPoint);
+    cls.def("setWcsSurrogate", &Associations::setWcsSurrogate, "maxErrorInArcsec"_a, "maxOrder"_a = 9);
 
     cls.def("getEpoch", &Associations::getEpoch);
     cls.def("setEpoch", &Associations::setEpoch);
+
+    cls.def("getInstrumentation", &Associations::getInstrumentation);
+    cls.def("resetInstrumentation", &Associations::resetInstrumentation);
 }
 
 PYBIND11_MODULE(associations, mod) {
     py::module::import("lsst.jointcal.ccdImage");
     py::module::import("lsst.sphgeom");
+    py::module::import("lsst.jointcal.instrumentation");
     declareAssociations(mod);
 }
 }  // namespace
@@ -44,6 +44,12 @@ namespace lsst {
 namespace jointcal {
 namespace {
 
+// The parameters of each transform of a model, keyed on (visit, ccd), which Python can hash.
+using PyMappingParameters = std::map<std::pair<VisitIdType, CcdIdType>, Eigen::VectorXd>;
+
+// The keys of transforms of a model, as (visit, ccd).
+using PyMappingKeys = std::vector<std::pair<VisitIdType, CcdIdType>>;
+
 void declareAstrometryModel(py::module &mod) {
     py::class_<AstrometryModel, std::shared_ptr<AstrometryModel>> cls(mod, "AstrometryModel");
 
@@ -51,10 +57,52 @@ void declareAstrometryModel(py::module &mod) {
     cls.def("getMapping", &AstrometryModel::getMapping, py::return_value_policy::reference_internal);
     cls.def("assignIndices", &AstrometryModel::assignIndices);
     cls.def("offsetParams", &AstrometryModel::offsetParams);
+    cls.def("getParameters", &AstrometryModel::getParameters);
+    cls.def("setParameters", &AstrometryModel::setParameters, "parameters"_a);
+    cls.def("getMappingParameters", [](AstrometryModel const &self) {
+        PyMappingParameters result;
+        for (auto const &i : self.getMappingParameters()) {
+            result.emplace(std::make_pair(i.first.visit, i.first.ccd), i.second);
+        }
+        return result;
+    });
+    cls.def("setMappingParameters", [](AstrometryModel &self, PyMappingParameters const &parameters) {
+        AstrometryModel::MappingParameters mappingParameters;
+        for (auto const &i : parameters) {
+            mappingParameters.emplace(CcdImageKey{i.first.first, i.first.second}, i.second);
+        }
+        return self.setMappingParameters(mappingParameters);
+    }, "parameters"_a);
+    cls.def("fixMappings", [](AstrometryModel &self, PyMappingKeys const &keys) {
+        std::vector<CcdImageKey> ccdImageKeys;
+        for (auto const &key : keys) ccdImageKeys.push_back(CcdImageKey{key.first, key.second});
+        return self.fixMappings(ccdImageKeys);
+    }, "keys"_a);
+    cls.def("releaseMappings", &AstrometryModel::releaseMappings);
     cls.def("getSkyToTangentPlane", &AstrometryModel::getSkyToTangentPlane);
     cls.def("makeSkyWcs", &AstrometryModel::makeSkyWcs);
+    cls.def(
+            "makeSkyWcsMap",
+            [](AstrometryModel const &self, CcdImageList const &ccdImageList, unsigned nThreads) {
+                std::unordered_map<CcdImageKey, std::shared_ptr<afw::geom::SkyWcs>> skyWcsMap;
+                {
+                    py::gil_scoped_release release;
+                    skyWcsMap = self.makeSkyWcsMap(ccdImageList, nThreads);
+                }
+                // Key on (visit, ccd), which Python can hash.
+                std::map<std::pair<VisitIdType, CcdIdType>, std::shared_ptr<afw::geom::SkyWcs>> result;
+                for (auto const &i : skyWcsMap) {
+                    result.emplace(std::make_pair(i.first.visit, i.first.ccd), i.second);
+                }
+                return result;
+            },
+            "ccdImageList"_a, "nThreads"_a = 0);
     cls.def("getTotalParameters", &AstrometryModel::getTotalParameters);
     cls.def("validate", &AstrometryModel::validate);
+    cls.def("setCovariance", &AstrometryModel::setCovariance, "ccdImage"_a, "covariance"_a);
+    cls.def("getCovariance", &AstrometryModel::getCovariance, "ccdImage"_a);
+    cls.def("getInstrumentation", &AstrometryModel::getInstrumentation);
+    cls.def("resetInstrumentation", &AstrometryModel::resetInstrumentation);
     utils::python::addOutputOp(cls, "__repr__");
     cls.def("__str__", [](AstrometryModel const &self) { return "AstrometryModel"; });
 }
@@ -90,6 +138,7 @@ PYBIND11_MODULE(astrometryModels, mod) {
     py::module::import("lsst.jointcal.ccdImage");
     py::module::import("lsst.jointcal.astrometryTransform");
     py::module::import("lsst.jointcal.astrometryMappings");
+    py::module::import("lsst.jointcal.instrumentation");
     declareAstrometryModel(mod);
     declareSimpleAstrometryModel(mod);
     declareConstrainedAstrometryModel(mod);
@@ -83,7 +83,8 @@ void declareAstrometryTransformPolynomial(py::module &mod) {
                                  double value) { self.getCoefficient(powX, powY, whichCoord) = value; });
     cls.def("determinant", &AstrometryTransformPolynomial::determinant);
     cls.def("getNpar", &AstrometryTransformPolynomial::getNpar);
-    cls.def("toAstMap", &AstrometryTransformPolynomial::toAstMap);
+    cls.def("toAstMap", py::overload_cast<jointcal::Frame const &>(&AstrometryTransformPolynomial::toAstMap,
+                                                                    py::const_));
     cls.def("write", [](AstrometryTransformPolynomial const &self) {
         std::stringstream result;
         self.write(result);
@@ -166,6 +167,15 @@ PYBIND11_MODULE(astrometryTransform, mod) {
     // utility functions
     mod.def("inversePolyTransform", &inversePolyTransform, "forward"_a, "domain"_a, "precision"_a,
             "maxOrder"_a = 9, "nSteps"_a = 50);
+    mod.def(
+            "fitPolynomialSurrogate",
+            [](AstrometryTransform const &transform, Frame const &domain, double maxError,
+               std::size_t maxOrder, std::size_t nSteps) {
+                double error;
+                auto surrogate = fitPolynomialSurrogate(transform, domain, maxError, maxOrder, nSteps, error);
+                return std::make_pair(surrogate, error);
+            },
+            "transform"_a, "domain"_a, "maxError"_a, "maxOrder"_a = 9, "nSteps"_a = 20);
 }
 }  // namespace
 }  // namespace jointcal
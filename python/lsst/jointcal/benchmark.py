@@ -0,0 +1,528 @@
+# This file is part of jointcal.
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+"""
+Generate synthetic tracts from a parameterized camera, dither pattern, star
+density and distortion, and time each stage of an astrometric jointcal fit on
+them, writing the results to a JSON file for tracking performance regressions.
+"""
+
+__all__ = ["CameraParameters", "TractParameters", "PRESETS", "SyntheticTract", "makeSyntheticTract",
+           "runBenchmark", "main"]
+
+import argparse
+import collections
+import dataclasses
+import json
+import math
+import platform
+import time
+
+import numpy as np
+import scipy.spatial
+
+import lsst.afw.cameraGeom
+import lsst.afw.cameraGeom.testUtils
+import lsst.afw.coord
+import lsst.afw.geom
+import lsst.afw.image
+import lsst.afw.table
+import lsst.daf.base
+import lsst.geom
+
+import lsst.jointcal
+
+FLUX_FIELD = "benchmarkFlux"
+REF_FLUX_FIELD = "benchmark_flux"
+
+
+@dataclasses.dataclass
+class CameraParameters:
+    """A focal plane made of a regular grid of identical detectors."""
+    nx: int = 2
+    """Number of detectors along the focal plane x axis."""
+    ny: int = 2
+    """Number of detectors along the focal plane y axis."""
+    width: int = 2048
+    """Detector width, in pixels."""
+    height: int = 4096
+    """Detector height, in pixels."""
+    pixelSize: float = 0.015
+    """Pixel size, in mm."""
+    gap: float = 1.0
+    """Gap between adjacent detectors, in mm."""
+    plateScale: float = 13.7
+    """Plate scale, in arcseconds per mm."""
+    radialDistortion: float = 0.0
+    """Radial distortion coefficient of the focal plane to field angle transform (see
+    `lsst.afw.cameraGeom.testUtils.DetectorWrapper`)."""
+
+
+@dataclasses.dataclass
+class TractParameters:
+    """The observations making up one synthetic tract."""
+    camera: CameraParameters = dataclasses.field(default_factory=CameraParameters)
+    nVisits: int = 4
+    """Number of visits."""
+    ditherPattern: str = "random"
+    """How to offset the visits from the tract center: "random" or "grid"."""
+    ditherSize: float = 0.1
+    """Largest dither offset (or grid spacing), in degrees."""
+    starDensity: float = 5000
+    """Number of stars per square degree."""
+    refFraction: float = 0.2
+    """Fraction of the stars that are in the reference catalog."""
+    centroidError: float = 0.02
+    """Centroid error of the measured stars, in pixels."""
+    outlierFraction: float = 0.005
+    """Fraction of the measured stars that are displaced by many sigma."""
+    wcsError: float = 0.3
+    """Scatter of the input WCS boresights around their true value, in arcseconds."""
+    seed: int = 1
+    """Seed for the random number generator."""
+
+
+PRESETS = {
+    "tiny": TractParameters(camera=CameraParameters(nx=1, ny=2), nVisits=3),
+    "small": TractParameters(),
+    "medium": TractParameters(camera=CameraParameters(nx=6, ny=6, radialDistortion=0.9), nVisits=8,
+                              starDensity=20000, ditherSize=0.2),
+    "large": TractParameters(camera=CameraParameters(nx=10, ny=10, width=4096, height=4096,
+                                                     plateScale=16.8, radialDistortion=0.9),
+                             nVisits=10, starDensity=40000, ditherSize=0.3),
+    # About a million stars.
+    "huge": TractParameters(camera=CameraParameters(nx=10, ny=10, width=4096, height=4096,
+                                                    plateScale=16.8, radialDistortion=0.9),
+                            nVisits=16, starDensity=150000, ditherSize=0.3),
+}
+
+# Where the tracts are centered on the sky, and where they are observed from.
+TRACT_CENTER = lsst.geom.SpherePoint(150, 2, lsst.geom.degrees)
+OBSERVATORY = lsst.afw.coord.Observatory(-70.7*lsst.geom.degrees, -30.2*lsst.geom.degrees, 2663)
+
+
+@dataclasses.dataclass
+class SyntheticTract:
+    """The catalogs and metadata of a synthetic tract, ready to be loaded
+    into `lsst.jointcal.Associations`."""
+    parameters: TractParameters
+    detectors: list
+    visits: list
+    """The `lsst.afw.image.VisitInfo` of each visit."""
+    catalogs: dict
+    """The `lsst.afw.table.SourceCatalog` for each (visit, ccd)."""
+    skyWcs: dict
+    """The (perturbed) input `lsst.afw.geom.SkyWcs` for each (visit, ccd)."""
+    refCat: lsst.afw.table.SimpleCatalog
+    photoCalib: lsst.afw.image.PhotoCalib
+    """The photometric calibration of every catalog."""
+    date: lsst.daf.base.DateTime
+    """The date of the first visit."""
+    nStars: int
+
+
+def makeDetectors(camera):
+    """Return the detectors of a grid camera, centered on the optical axis."""
+    bbox = lsst.geom.Box2I(lsst.geom.Point2I(0, 0), lsst.geom.Extent2I(camera.width, camera.height))
+    refPoint = lsst.geom.Point2D(camera.width/2 - 0.5, camera.height/2 - 0.5)
+    stepX = camera.width*camera.pixelSize + camera.gap
+    stepY = camera.height*camera.pixelSize + camera.gap
+    detectors = []
+    for j in range(camera.ny):
+        for i in range(camera.nx):
+            ccdId = j*camera.nx + i
+            fpPosition = lsst.geom.Point2D((i - (camera.nx - 1)/2)*stepX, (j - (camera.ny - 1)/2)*stepY)
+            orientation = lsst.afw.cameraGeom.Orientation(fpPosition, refPoint)
+            wrapper = lsst.afw.cameraGeom.testUtils.DetectorWrapper(
+                name=f"ccd{ccdId}", id=ccdId, bbox=bbox,
+                pixelSize=lsst.geom.Extent2D(camera.pixelSize, camera.pixelSize),
+                orientation=orientation, plateScale=camera.plateScale,
+                radialDistortion=camera.radialDistortion)
+            detectors.append(wrapper.detector)
+    return detectors
+
+
+def fieldRadius(camera, offsets):
+    """Return the radius (in degrees) of a circle around the tract center that
+    contains every observation of the tract."""
+    halfWidth = 0.5*camera.nx*(camera.width*camera.pixelSize + camera.gap)
+    halfHeight = 0.5*camera.ny*(camera.height*camera.pixelSize + camera.gap)
+    # Allow for the radial distortion, and for the dithers.
+    cameraRadius = 1.1*math.hypot(halfWidth, halfHeight)*camera.plateScale/3600
+    return cameraRadius + np.hypot(offsets[:, 0], offsets[:, 1]).max()
+
+
+def ditherOffsets(parameters, rng):
+    """Return the (x, y) offset of each visit from the tract center, in
+    degrees."""
+    if parameters.ditherPattern == "grid":
+        side = math.ceil(math.sqrt(parameters.nVisits))
+        steps = (np.arange(side) - (side - 1)/2)*parameters.ditherSize
+        grid = np.array([(x, y) for y in steps for x in steps])
+        return grid[:parameters.nVisits]
+    elif parameters.ditherPattern == "random":
+        return rng.uniform(-parameters.ditherSize, parameters.ditherSize, size=(parameters.nVisits, 2))
+    raise ValueError(f"Unknown dither pattern: {parameters.ditherPattern}")
+
+
+def offsetCoords(center, bearing, distance):
+    """Vectorized `lsst.geom.SpherePoint.offset`: return the ra, dec (in
+    radians) of the points at the given bearings (from east, through north)
+    and distances (in radians) from center."""
+    ra0 = center.getRa().asRadians()
+    dec0 = center.getDec().asRadians()
+    dec = np.arcsin(np.sin(dec0)*np.cos(distance) + np.cos(dec0)*np.sin(distance)*np.sin(bearing))
+    ra = ra0 + np.arctan2(np.cos(bearing)*np.sin(distance)*np.cos(dec0),
+                          np.cos(distance) - np.sin(dec0)*np.sin(dec))
+    return ra, dec
+
+
+def unitVectors(ra, dec):
+    return np.column_stack((np.cos(dec)*np.cos(ra), np.cos(dec)*np.sin(ra), np.sin(dec)))
+
+
+def makeSourceCatalog(x, y, xErr, yErr, instFlux, instFluxErr):
+    """Return a source catalog with the fields that `lsst.jointcal.CcdImage`
+    reads."""
+    schema = lsst.afw.table.SourceTable.makeMinimalSchema()
+    lsst.afw.table.Point2DKey.addFields(schema, "centroid", "centroid", "pixels")
+    schema.addField("centroid_xErr", type="F")
+    schema.addField("centroid_yErr", type="F")
+    lsst.afw.table.QuadrupoleKey.addFields(schema, "shape", "", lsst.afw.table.CoordinateType.PIXEL)
+    schema.addField(FLUX_FIELD + "_instFlux", type="D", doc="post-ISR instFlux")
+    schema.addField(FLUX_FIELD + "_instFluxErr", type="D", doc="post-ISR instFlux stddev")
+    table = lsst.afw.table.SourceTable.make(schema)
+    table.defineCentroid("centroid")
+    table.defineShape("shape")
+    catalog = lsst.afw.table.SourceCatalog(table)
+    catalog.reserve(len(x))
+    catalog.resize(len(x))
+    # A deep copy is guaranteed to be contiguous, so that we can assign whole columns.
+    catalog = catalog.copy(deep=True)
+    catalog["id"] = np.arange(len(x)) + 1
+    catalog["centroid_x"] = x
+    catalog["centroid_y"] = y
+    catalog["centroid_xErr"] = xErr
+    catalog["centroid_yErr"] = yErr
+    catalog["shape_xx"] = 1
+    catalog["shape_yy"] = 1
+    catalog["shape_xy"] = 0
+    catalog[FLUX_FIELD + "_instFlux"] = instFlux
+    catalog[FLUX_FIELD + "_instFluxErr"] = instFluxErr
+    return catalog
+
+
+def makeReferenceCatalog(ra, dec, flux):
+    """Return a reference catalog of the given stars (ra, dec in radians,
+    flux in nJy)."""
+    schema = lsst.afw.table.SimpleTable.makeMinimalSchema()
+    schema.addField(REF_FLUX_FIELD, type="D", doc="flux (nJy)")
+    schema.addField(REF_FLUX_FIELD + "Err", type="D", doc="flux stddev (nJy)")
+    catalog = lsst.afw.table.SimpleCatalog(schema)
+    catalog.reserve(len(ra))
+    catalog.resize(len(ra))
+    catalog = catalog.copy(deep=True)
+    catalog["id"] = np.arange(len(ra)) + 1
+    catalog["coord_ra"] = ra
+    catalog["coord_dec"] = dec
+    catalog[REF_FLUX_FIELD] = flux
+    catalog[REF_FLUX_FIELD + "Err"] = 0.01*flux
+    return catalog
+
+
+def makeSyntheticTract(parameters):
+    """Simulate the catalogs of every detector of every visit of a tract.
+
+    Parameters
+    ----------
+    parameters : `TractParameters`
+        Description of the camera and observations.
+
+    Returns
+    -------
+    tract : `SyntheticTract`
+        The simulated catalogs, input WCSs and reference catalog.
+    """
+    rng = np.random.default_rng(parameters.seed)
+    detectors = makeDetectors(parameters.camera)
+    offsets = ditherOffsets(parameters, rng)
+
+    # Stars uniformly distributed on the spherical cap that covers the tract.
+    radius = math.radians(fieldRadius(parameters.camera, offsets))
+    area = 2*math.pi*(1 - math.cos(radius))*(180/math.pi)**2
+    nStars = int(parameters.starDensity*area)
+    distance = np.arccos(1 - rng.uniform(size=nStars)*(1 - math.cos(radius)))
+    ra, dec = offsetCoords(TRACT_CENTER, rng.uniform(0, 2*math.pi, size=nStars), distance)
+    mag = rng.uniform(16, 23, size=nStars)
+    flux = 10**(-0.4*(mag - 31.4))  # nJy
+    tree = scipy.spatial.cKDTree(unitVectors(ra, dec))
+
+    refIndex = rng.uniform(size=nStars) < parameters.refFraction
+    refCat = makeReferenceCatalog(ra[refIndex], dec[refIndex], flux[refIndex])
+
+    visits = []
+    catalogs = {}
+    skyWcs = {}
+    photoCalib = lsst.afw.image.PhotoCalib(1.0)
+    startDate = lsst.daf.base.DateTime(59000.0, lsst.daf.base.DateTime.MJD, lsst.daf.base.DateTime.TAI)
+    for visit, (dx, dy) in enumerate(offsets):
+        boresight = TRACT_CENTER.offset(math.atan2(dy, dx)*lsst.geom.radians,
+                                        math.hypot(dx, dy)*lsst.geom.degrees)
+        date = lsst.daf.base.DateTime(59000.0 + visit*0.01, lsst.daf.base.DateTime.MJD,
+                                      lsst.daf.base.DateTime.TAI)
+        visitInfo = lsst.afw.image.VisitInfo(
+            exposureId=visit, exposureTime=30.0, darkTime=30.0, date=date,
+            ut1=date.get(lsst.daf.base.DateTime.MJD),
+            era=(visit*0.01*2*math.pi)*lsst.geom.radians + boresight.getRa(),
+            boresightRaDec=boresight,
+            boresightAzAlt=lsst.geom.SpherePoint(0, 80, lsst.geom.degrees),
+            boresightAirmass=1.02, boresightRotAngle=0*lsst.geom.degrees,
+            rotType=lsst.afw.image.RotType.SKY, observatory=OBSERVATORY)
+        visits.append(visitInfo)
+        # The input WCS is off by a random shift of the boresight.
+        wrongBoresight = boresight.offset(rng.uniform(0, 2*math.pi)*lsst.geom.radians,
+                                          abs(rng.normal(0, parameters.wcsError))*lsst.geom.arcseconds)
+        for detector in detectors:
+            pixelsToFieldAngle = detector.getTransform(lsst.afw.cameraGeom.PIXELS,
+                                                       lsst.afw.cameraGeom.FIELD_ANGLE)
+            trueWcs = lsst.afw.geom.makeSkyWcs(pixelsToFieldAngle, 0*lsst.geom.degrees, False, boresight)
+            bbox = lsst.geom.Box2D(detector.getBBox())
+            corners = [trueWcs.pixelToSky(corner) for corner in bbox.getCorners()]
+            center = trueWcs.pixelToSky(bbox.getCenter())
+            reach = max(center.separation(corner) for corner in corners).asRadians()
+            candidates = np.array(tree.query_ball_point(
+                unitVectors(center.getRa().asRadians(), center.getDec().asRadians())[0],
+                2*math.sin(0.5*reach)), dtype=int)
+            if len(candidates) == 0:
+                continue
+            xy = trueWcs.getTransform().applyInverse(np.array([ra[candidates], dec[candidates]]))
+            inside = ((xy[0] >= bbox.getMinX()) & (xy[0] <= bbox.getMaxX())
+                      & (xy[1] >= bbox.getMinY()) & (xy[1] <= bbox.getMaxY()))
+            nInside = inside.sum()
+            if nInside == 0:
+                continue
+            error = np.full(nInside, parameters.centroidError)
+            x = xy[0][inside] + rng.normal(0, parameters.centroidError, size=nInside)
+            y = xy[1][inside] + rng.normal(0, parameters.centroidError, size=nInside)
+            outliers = rng.uniform(size=nInside) < parameters.outlierFraction
+            x[outliers] += rng.normal(0, 50*parameters.centroidError, size=outliers.sum())
+            instFlux = flux[candidates][inside]
+            key = (visit, detector.getId())
+            catalogs[key] = makeSourceCatalog(x, y, error, error, instFlux, 0.02*instFlux)
+            skyWcs[key] = lsst.afw.geom.makeSkyWcs(pixelsToFieldAngle, 0*lsst.geom.degrees, False,
+                                                   wrongBoresight)
+    return SyntheticTract(parameters=parameters, detectors=detectors, visits=visits, catalogs=catalogs,
+                          skyWcs=skyWcs, refCat=refCat, photoCalib=photoCalib, date=startDate,
+                          nStars=nStars)
+
+
+class StageTimer:
+    """Time named stages with wall clock and process CPU time."""
+    def __init__(self):
+        self.stages = collections.OrderedDict()
+
+    def __call__(self, name):
+        return self._Stage(self, name)
+
+    class _Stage:
+        def __init__(self, timer, name):
+            self.timer = timer
+            self.name = name
+
+        def __enter__(self):
+            self.wallStart = time.perf_counter()
+            self.cpuStart = time.process_time()
+
+        def __exit__(self, *args):
+            self.timer.stages[self.name] = {"wallTime": time.perf_counter() - self.wallStart,
+                                            "cpuTime": time.process_time() - self.cpuStart}
+
+
+def collectPhases(component, source):
+    """Return the instrumented phases of one jointcal component as a list of
+    dicts, and reset them."""
+    phases = []
+    for phase in source.getInstrumentation().getPhases():
+        phases.append({"component": component,
+                       "name": phase.name,
+                       "wallTime": phase.wallTime,
+                       "cpuTime": phase.cpuTime,
+                       "peakMemoryIncrease": phase.peakMemoryIncrease,
+                       "nThreads": phase.nThreads,
+                       "counters": dict(phase.counters)})
+    source.resetInstrumentation()
+    return phases
+
+
+def summarizePhases(phases):
+    """Sum the wall and CPU time of the phases with the same name."""
+    summary = collections.OrderedDict()
+    for phase in phases:
+        entry = summary.setdefault(phase["name"], {"wallTime": 0.0, "cpuTime": 0.0, "count": 0})
+        entry["wallTime"] += phase["wallTime"]
+        entry["cpuTime"] += phase["cpuTime"]
+        entry["count"] += 1
+    return summary
+
+
+def runBenchmark(parameters, model="simple", order=3, visitOrder=5, nSigmaCut=5, maxSteps=20,
+                 outputThreads=0):
+    """Simulate one tract and time each stage of an astrometric fit of it.
+
+    Parameters
+    ----------
+    parameters : `TractParameters`
+        Description of the tract to simulate.
+    model : {"simple", "constrained"}
+        Astrometric model to fit.
+    order : `int`
+        Polynomial order of the simple model, or of the chip part of the
+        constrained model.
+    visitOrder : `int`
+        Polynomial order of the visit part of the constrained model.
+    nSigmaCut : `float`
+        Outlier rejection threshold.
+    maxSteps : `int`
+        Largest number of outlier rejection steps.
+    outputThreads : `int`
+        Number of threads to make the output WCSs with (0 means one per core).
+
+    Returns
+    -------
+    result : `dict`
+        The tract parameters and sizes, the wall and CPU time of each stage,
+        and the phases recorded by jointcal's instrumentation.
+    """
+    timer = StageTimer()
+    with timer("simulate"):
+        tract = makeSyntheticTract(parameters)
+
+    associations = lsst.jointcal.Associations()
+    control = lsst.jointcal.JointcalControl(FLUX_FIELD)
+    with timer("createCcdImages"):
+        for (visit, ccd), catalog in tract.catalogs.items():
+            detector = tract.detectors[ccd]
+            associations.createCcdImage(catalog, tract.skyWcs[(visit, ccd)], tract.visits[visit],
+                                        detector.getBBox(), "benchmark", tract.photoCalib, detector,
+                                        visit, ccd, control)
+
+    with timer("associate"):
+        associations.computeCommonTangentPoint()
+        associations.setEpoch(tract.date.get(lsst.daf.base.DateTime.EPOCH))
+        associations.associateCatalogs(1.0)
+        associations.collectRefStars(tract.refCat, 1.0*lsst.geom.arcseconds, REF_FLUX_FIELD,
+                                     refCoordinateErr=10)
+        associations.prepareFittedStars(2)
+        associations.deprojectFittedStars()
+
+    ccdImageList = associations.getCcdImageList()
+    with timer("model"):
+        projection = lsst.jointcal.OneTPPerVisitHandler(ccdImageList)
+        if model == "constrained":
+            astrometryModel = lsst.jointcal.ConstrainedAstrometryModel(ccdImageList, projection,
+                                                                       chipOrder=order,
+                                                                       visitOrder=visitOrder)
+        elif model == "simple":
+            astrometryModel = lsst.jointcal.SimpleAstrometryModel(ccdImageList, projection, True,
+                                                                  nNotFit=0, order=order)
+        else:
+            raise ValueError(f"Unknown astrometry model: {model}")
+        fit = lsst.jointcal.AstrometryFit(associations, astrometryModel, 0.0)
+
+    with timer("initialize"):
+        if model == "constrained":
+            fit.minimize("DistortionsVisit")
+        fit.minimize("Distortions")
+        fit.minimize("Positions")
+        fit.minimize("Distortions Positions")
+
+    with timer("iterate"):
+        iterateResult = fit.iterate("Distortions Positions", nSigmaCut, maxSteps)
+
+    with timer("output"):
+        output = astrometryModel.makeSkyWcsMap(ccdImageList, outputThreads)
+
+    phases = (collectPhases("associations", associations)
+              + collectPhases("model", astrometryModel)
+              + collectPhases("fit", fit))
+    nMeasuredStars = sum(len(catalog) for catalog in tract.catalogs.values())
+    return {"parameters": dataclasses.asdict(parameters),
+            "model": model,
+            "order": order,
+            "sizes": {"stars": tract.nStars,
+                      "ccdImages": len(ccdImageList),
+                      "measuredStars": nMeasuredStars,
+                      "fittedStars": associations.fittedStarListSize(),
+                      "refStars": associations.refStarListSize(),
+                      "outputWcs": len(output)},
+            "result": {"chi2": iterateResult.chi2.chi2,
+                       "ndof": iterateResult.chi2.ndof,
+                       "iterations": len(iterateResult.iterations),
+                       "modelValid": iterateResult.modelValid},
+            "stages": timer.stages,
+            "phaseSummary": summarizePhases(phases),
+            "phases": phases}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("presets", nargs="*", default=["small"], choices=list(PRESETS.keys()),
+                        help="Tract sizes to benchmark, in order (default: small).")
+    parser.add_argument("-o", "--output", default="jointcal_benchmark.json",
+                        help="JSON file to write the results to.")
+    parser.add_argument("--model", default="simple", choices=["simple", "constrained"],
+                        help="Astrometry model to fit.")
+    parser.add_argument("--order", type=int, default=3,
+                        help="Order of the simple model, or of the chip part of the constrained model.")
+    parser.add_argument("--visitOrder", type=int, default=5,
+                        help="Order of the visit part of the constrained model.")
+    parser.add_argument("--nVisits", type=int, help="Override the number of visits.")
+    parser.add_argument("--starDensity", type=float, help="Override the stars per square degree.")
+    parser.add_argument("--ditherPattern", choices=["random", "grid"], help="Override the dither pattern.")
+    parser.add_argument("--ditherSize", type=float, help="Override the dither size, in degrees.")
+    parser.add_argument("--radialDistortion", type=float, help="Override the camera radial distortion.")
+    parser.add_argument("--seed", type=int, help="Override the random seed.")
+    parser.add_argument("--outputThreads", type=int, default=0,
+                        help="Threads to make the output WCSs with (0 means one per core).")
+    args = parser.parse_args()
+
+    runs = []
+    for preset in args.presets:
+        parameters = dataclasses.replace(PRESETS[preset],
+                                         camera=dataclasses.replace(PRESETS[preset].camera))
+        for name in ("nVisits", "starDensity", "ditherPattern", "ditherSize", "seed"):
+            if getattr(args, name) is not None:
+                setattr(parameters, name, getattr(args, name))
+        if args.radialDistortion is not None:
+            parameters.camera.radialDistortion = args.radialDistortion
+        print(f"Running {preset}...")
+        result = runBenchmark(parameters, model=args.model, order=args.order, visitOrder=args.visitOrder,
+                              outputThreads=args.outputThreads)
+        result["preset"] = preset
+        runs.append(result)
+        stages = ", ".join(f"{name}={stage['wallTime']:.3g}s" for name, stage in result["stages"].items())
+        print(f"{preset}: {result['sizes']['measuredStars']} measured stars, {stages}")
+
+    with open(args.output, "w") as outfile:
+        json.dump({"host": platform.node(),
+                   "date": time.strftime("%Y-%m-%dT%H:%M:%S"),
+                   "runs": runs}, outfile, indent=1)
+    print(f"Wrote {args.output}")
@@ -49,6 +49,10 @@ void declareCcdImage(py::module &mod) {
     cls.def("countStars", &CcdImage::countStars);
 
     cls.def("resetCatalogForFit", &CcdImage::resetCatalogForFit);
+    cls.def("getCatalogForFit", [](CcdImage const &self) {
+        auto const &catalog = self.getCatalogForFit();
+        return std::vector<std::shared_ptr<MeasuredStar>>(catalog.begin(), catalog.end());
+    });
 
     cls.def("getBoresightRaDec", &CcdImage::getBoresightRaDec);
     cls.def_property_readonly("boresightRaDec", &CcdImage::getBoresightRaDec);
@@ -57,6 +61,7 @@ void declareCcdImage(py::module &mod) {
     cls.def_property_readonly("ccdId", &CcdImage::getCcdId);
 
     cls.def("getEpoch", &CcdImage::getEpoch);
+    cls.def("getFilter", &CcdImage::getFilter);
     cls.def_property_readonly("epoch", &CcdImage::getEpoch);
 
     cls.def("getImageFrame", &CcdImage::getImageFrame, py::return_value_policy::reference_internal);
@@ -79,10 +84,16 @@ void declareCcdImage(py::module &mod) {
 
     cls.def("getSkyToTangentPlane", &CcdImage::getSkyToTangentPlane,
             py::return_value_policy::reference_internal);
+    cls.def("getPixelToTangentPlane", &CcdImage::getPixelToTangentPlane);
+    cls.def("getPixelToCommonTangentPlane", &CcdImage::getPixelToCommonTangentPlane);
+    cls.def("useWcsSurrogate", &CcdImage::useWcsSurrogate, "maxError"_a, "maxOrder"_a = 9);
     cls.def("getReadWcs", &CcdImage::getReadWcs, py::return_value_policy::reference_internal);
 }
 
-PYBIND11_MODULE(ccdImage, mod) { declareCcdImage(mod); }
+PYBIND11_MODULE(ccdImage, mod) {
+    py::module::import("lsst.jointcal.star");
+    declareCcdImage(mod);
+}
 }  // namespace
 }  // namespace jointcal
 }  // namespace lsst
@@ -0,0 +1,57 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pybind11/pybind11.h"
+#include "pybind11/eigen.h"
+#include "pybind11/stl.h"
+
+#include "lsst/jointcal/Associations.h"
+#include "lsst/jointcal/Checkpoint.h"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace lsst {
+namespace jointcal {
+namespace {
+
+void declareCheckpoint(py::module &mod) {
+    py::class_<Checkpoint, std::shared_ptr<Checkpoint>> cls(mod, "Checkpoint");
+
+    cls.def(py::init<std::string const &, Checkpoint::DetectorMap const &>(), "filename"_a, "detectors"_a,
+            py::call_guard<py::gil_scoped_release>());
+    cls.def_static("write", &Checkpoint::write, "filename"_a, "associations"_a, "modelParameters"_a,
+                   py::call_guard<py::gil_scoped_release>());
+    cls.def("getAssociations", &Checkpoint::getAssociations);
+    cls.def("getModelParameters", &Checkpoint::getModelParameters);
+}
+
+PYBIND11_MODULE(checkpoint, mod) {
+    py::module::import("lsst.afw.cameraGeom");
+    py::module::import("lsst.jointcal.associations");
+    declareCheckpoint(mod);
+}
+}  // namespace
+}  // namespace jointcal
+}  // namespace lsst
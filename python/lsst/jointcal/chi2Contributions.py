@@ -0,0 +1,104 @@
+# This file is part of jointcal.
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+"""
+Read the chi2 contribution files written by jointcal when one of the
+``config.writeChi2Files*`` fields is set (see
+``FitterBase::saveChi2Contributions``).
+"""
+
+__all__ = ["readColumnFile", "readChi2Contributions"]
+
+import astropy.table
+import numpy as np
+
+# Column files are little-endian whatever the byte order of the host that wrote them.
+_columnTypes = {0: np.dtype("<f8"), 1: np.dtype("<i8")}
+_tag = b"JCCOLS02"
+
+
+def _readInt64(infile, count):
+    return np.frombuffer(infile.read(8*count), dtype="<i8", count=count)
+
+
+def _readString(infile):
+    length, = _readInt64(infile, 1)
+    return infile.read(length).decode()
+
+
+def readColumnFile(path):
+    """Read a binary column file written by ``ColumnTable::write``.
+
+    Parameters
+    ----------
+    path : `str`
+        The file to read.
+
+    Returns
+    -------
+    table : `astropy.table.Table`
+        The columns of the file, with their descriptions.
+
+    Raises
+    ------
+    ValueError
+        Raised if ``path`` is not a jointcal column file of the version
+        this reads.
+    """
+    with open(path, "rb") as infile:
+        tag = infile.read(8)
+        if tag != _tag:
+            raise ValueError(f"{path} is not a version {_tag[-2:].decode()} jointcal column file "
+                             f"(found tag {tag!r}).")
+        nColumns, nRows = _readInt64(infile, 2)
+        headers = []
+        for _ in range(nColumns):
+            columnType, = _readInt64(infile, 1)
+            name = _readString(infile)
+            description = _readString(infile)
+            headers.append((name, _columnTypes[columnType], description))
+        columns = []
+        for name, dtype, description in headers:
+            data = np.frombuffer(infile.read(nRows*dtype.itemsize), dtype=dtype, count=nRows)
+            # Return native-order arrays, which is what astropy and numpy users expect.
+            data = data.astype(dtype.newbyteorder("="))
+            columns.append(astropy.table.Column(data, name=name, description=description))
+    return astropy.table.Table(columns)
+
+
+def readChi2Contributions(baseName):
+    """Read the chi2 contributions of a fit written by jointcal.
+
+    Parameters
+    ----------
+    baseName : `str`
+        The name passed to ``FitterBase::saveChi2Contributions``, with
+        ``{type}`` removed, i.e. the filenames without the ``-meas.bin`` and
+        ``-ref.bin`` suffixes.
+
+    Returns
+    -------
+    meas : `astropy.table.Table`
+        The contribution of each valid MeasuredStar: its measured and fitted
+        positions or fluxes, its residual, its chi2 and its ccd and visit.
+    ref : `astropy.table.Table`
+        The contribution of each FittedStar that has a RefStar.
+    """
+    return readColumnFile(baseName + "-meas.bin"), readColumnFile(baseName + "-ref.bin")
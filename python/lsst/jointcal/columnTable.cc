@@ -0,0 +1,56 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
+
+#include "lsst/jointcal/ColumnTable.h"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace lsst {
+namespace jointcal {
+namespace {
+
+void declareColumnTable(py::module &mod) {
+    py::class_<ColumnTable, std::shared_ptr<ColumnTable>> cls(mod, "ColumnTable");
+
+    cls.def(py::init<>());
+    // The C++ methods return the column to fill; from python, take all its values at once.
+    cls.def("addFloatColumn",
+            [](ColumnTable &self, std::string const &name, std::string const &description,
+               ColumnTable::FloatColumn const &values) { self.addFloatColumn(name, description) = values; },
+            "name"_a, "description"_a, "values"_a);
+    cls.def("addIntColumn",
+            [](ColumnTable &self, std::string const &name, std::string const &description,
+               ColumnTable::IntColumn const &values) { self.addIntColumn(name, description) = values; },
+            "name"_a, "description"_a, "values"_a);
+    cls.def("write", &ColumnTable::write, "filename"_a);
+}
+
+PYBIND11_MODULE(columnTable, mod) { declareColumnTable(mod); }
+}  // namespace
+}  // namespace jointcal
+}  // namespace lsst
@@ -23,6 +23,8 @@
  */
 
 #include "pybind11/pybind11.h"
+#include "pybind11/eigen.h"
+#include "pybind11/stl.h"
 
 #include "lsst/jointcal/Associations.h"
 #include "lsst/jointcal/AstrometryFit.h"
@@ -39,14 +41,41 @@ namespace lsst {
 namespace jointcal {
 namespace {
 
+void declareIterateResult(py::module &mod) {
+    py::class_<FitIterationResult, std::shared_ptr<FitIterationResult>> clsIteration(mod,
+                                                                                    "FitIterationResult");
+    clsIteration.def_readonly("step", &FitIterationResult::step);
+    clsIteration.def_readonly("result", &FitIterationResult::result);
+    clsIteration.def_readonly("chi2", &FitIterationResult::chi2);
+    clsIteration.def_readonly("nMeasOutliers", &FitIterationResult::nMeasOutliers);
+    clsIteration.def_readonly("nRefOutliers", &FitIterationResult::nRefOutliers);
+    clsIteration.def_readonly("solveResidual", &FitIterationResult::solveResidual);
+
+    py::class_<IterateResult, std::shared_ptr<IterateResult>> cls(mod, "IterateResult");
+    cls.def_readonly("result", &IterateResult::result);
+    cls.def_readonly("chi2", &IterateResult::chi2);
+    cls.def_readonly("modelValid", &IterateResult::modelValid);
+    cls.def_readonly("iterations", &IterateResult::iterations);
+}
+
 void declareFitterBase(py::module &mod) {
     py::class_<FitterBase, std::shared_ptr<FitterBase>> cls(mod, "FitterBase");
 
     cls.def("minimize", &FitterBase::minimize, "whatToFit"_a, "nSigRejCut"_a = 0,
             "sigmaRelativeTolerance"_a = 0, "doRankUpdate"_a = true, "doLineSearch"_a = false,
-            "dumpMatrixFile"_a = "");
+            "dumpMatrixFile"_a = "", py::call_guard<py::gil_scoped_release>());
+    cls.def("iterate", &FitterBase::iterate, "whatToFit"_a, "nSigmaCut"_a, "maxSteps"_a,
+            "sigmaRelativeTolerance"_a = 0, "doRankUpdate"_a = true, "doLineSearch"_a = false,
+            "dumpMatrixFile"_a = "", "chi2BaseName"_a = "", "refinementTolerance"_a = 1e-8,
+            "checkpointFile"_a = "", "checkpointInterval"_a = 0, "refitOnlyIfInaccurate"_a = false,
+            py::call_guard<py::gil_scoped_release>());
     cls.def("computeChi2", &FitterBase::computeChi2);
     cls.def("saveChi2Contributions", &FitterBase::saveChi2Contributions);
+    cls.def("writeCheckpoint", &FitterBase::writeCheckpoint, "filename"_a,
+            py::call_guard<py::gil_scoped_release>());
+    cls.def("computeCovariance", &FitterBase::computeCovariance, "whatToFit"_a, "diagonalOnly"_a = false);
+    cls.def("getInstrumentation", &FitterBase::getInstrumentation);
+    cls.def("resetInstrumentation", &FitterBase::resetInstrumentation);
 }
 
 void declareAstrometryFit(py::module &mod) {
@@ -71,6 +100,7 @@ PYBIND11_MODULE(fitter, mod) {
     py::module::import("lsst.jointcal.associations");
     py::module::import("lsst.jointcal.astrometryModels");
     py::module::import("lsst.jointcal.chi2");
+    py::module::import("lsst.jointcal.instrumentation");
     py::module::import("lsst.jointcal.photometryModels");
     py::enum_<MinimizeResult>(mod, "MinimizeResult")
             .value("Converged", MinimizeResult::Converged)
@@ -78,6 +108,7 @@ PYBIND11_MODULE(fitter, mod) {
             .value("NonFinite", MinimizeResult::NonFinite)
             .value("Failed", MinimizeResult::Failed);
 
+    declareIterateResult(mod);
     declareFitterBase(mod);
     declareAstrometryFit(mod);
     declarePhotometryFit(mod);
@@ -0,0 +1,77 @@
+# This file is part of jointcal.
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+"""
+Read the Hessian, gradient and parameter index map written by jointcal when
+``config.writeInitMatrix`` is set (see ``FitterBase::minimize``).
+"""
+
+__all__ = ["readHessianDump"]
+
+import numpy as np
+import scipy.sparse
+
+
+def _readHessian(path):
+    """Read the lower triangle of the Hessian and the gradient from a
+    ``-hessian.bin`` file, returning the full symmetric matrix.
+    """
+    with open(path, "rb") as infile:
+        tag = infile.read(8)
+        if tag != b"JCHESS01":
+            raise ValueError(f"{path} is not a jointcal Hessian dump (found tag {tag!r}).")
+        # The dump is little-endian, whatever the machine that wrote it.
+        nRows, nCols, nNonZeros = np.fromfile(infile, dtype="<i8", count=3)
+        indptr = np.fromfile(infile, dtype="<i8", count=nCols + 1)
+        indices = np.fromfile(infile, dtype="<i8", count=nNonZeros)
+        data = np.fromfile(infile, dtype="<f8", count=nNonZeros)
+        gradSize, = np.fromfile(infile, dtype="<i8", count=1)
+        grad = np.fromfile(infile, dtype="<f8", count=gradSize)
+    lower = scipy.sparse.csc_matrix((data, indices, indptr), shape=(nRows, nCols))
+    hessian = lower + scipy.sparse.tril(lower, k=-1).T
+    return hessian.tocsc(), grad
+
+
+def readHessianDump(baseName):
+    """Read a Hessian matrix dump written by jointcal.
+
+    Parameters
+    ----------
+    baseName : `str`
+        The ``dumpMatrixFile`` passed to ``FitterBase::minimize``, i.e. the
+        filenames without the ``-hessian.bin`` and ``-index.csv`` suffixes.
+
+    Returns
+    -------
+    hessian : `scipy.sparse.csc_matrix`
+        The full (symmetric) Hessian matrix.
+    grad : `numpy.ndarray`
+        The gradient of the chi2.
+    index : `numpy.ndarray`
+        Structured array mapping the matrix rows to what they fit, with fields
+        ``index``, ``kind`` (``"model"`` or ``"fittedStar"``), ``visit`` and
+        ``ccd`` (for model parameters, one entry per CcdImage that uses that
+        parameter), and ``x``, ``y``, ``hasRefStar`` (0 or 1; for FittedStars).
+    """
+    hessian, grad = _readHessian(baseName + "-hessian.bin")
+    index = np.genfromtxt(baseName + "-index.csv", delimiter="\t", comments=None, skip_header=1,
+                          names=["index", "kind", "visit", "ccd", "x", "y", "hasRefStar"],
+                          dtype=[np.int64, "U10", np.int64, np.int64, np.float64, np.float64, np.int8])
+    return hessian, grad, np.atleast_1d(index)
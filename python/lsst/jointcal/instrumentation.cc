@@ -0,0 +1,66 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
+
+#include "lsst/utils/python.h"
+
+#include "lsst/jointcal/Instrumentation.h"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace lsst {
+namespace jointcal {
+namespace {
+
+void declarePhaseStatistics(py::module &mod) {
+    py::class_<PhaseStatistics, std::shared_ptr<PhaseStatistics>> cls(mod, "PhaseStatistics");
+
+    utils::python::addOutputOp(cls, "__str__");
+    utils::python::addOutputOp(cls, "__repr__");
+
+    cls.def_readonly("name", &PhaseStatistics::name);
+    cls.def_readonly("wallTime", &PhaseStatistics::wallTime);
+    cls.def_readonly("cpuTime", &PhaseStatistics::cpuTime);
+    cls.def_readonly("peakMemoryIncrease", &PhaseStatistics::peakMemoryIncrease);
+    cls.def_readonly("nThreads", &PhaseStatistics::nThreads);
+    cls.def_readonly("counters", &PhaseStatistics::counters);
+}
+
+void declareInstrumentation(py::module &mod) {
+    py::class_<Instrumentation, std::shared_ptr<Instrumentation>> cls(mod, "Instrumentation");
+
+    cls.def("getPhases", &Instrumentation::getPhases);
+    cls.def("clear", &Instrumentation::clear);
+}
+
+PYBIND11_MODULE(instrumentation, mod) {
+    declarePhaseStatistics(mod);
+    declareInstrumentation(mod);
+}
+}  // namespace
+}  // namespace jointcal
+}  // namespace lsst
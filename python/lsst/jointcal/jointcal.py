@@ -19,9 +19,11 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+import concurrent.futures
 import dataclasses
 import collections
 import os
+import threading
 
 import astropy.time
 import numpy as np
@@ -38,7 +40,7 @@ import lsst.afw.table
 import lsst.log
 from lsst.obs.base import Instrument
 from lsst.pipe.tasks.colorterms import ColortermLibrary
-from lsst.verify import Job, Measurement
+from lsst.verify import Job, Measurement, Metric
 
 from lsst.meas.algorithms import (LoadIndexedReferenceObjectsTask, ReferenceSourceSelectorTask,
                                   ReferenceObjectLoader)
@@ -343,6 +345,30 @@ class JointcalConfig(pipeBase.PipelineTaskConfig,
         dtype=float,
         default=3.0,
     )
+    reuseAssociation = pexConfig.Field(
+        doc="Associate the measured sources once, and start both the astrometric and photometric fits from "
+        "that association, instead of associating them again for each fit.",
+        dtype=bool,
+        default=True,
+    )
+    parallelFits = pexConfig.Field(
+        doc="Run the astrometric and photometric fits concurrently, in two threads, each on its own view of "
+        "one shared association (see `lsst.jointcal.Associations.createFitView`).",
+        dtype=bool,
+        default=False,
+    )
+    wcsSurrogateMaxError = pexConfig.Field(
+        doc="If >0, associate sources through a polynomial fit to each input WCS instead of the full WCS, "
+        "for speed. The polynomial's largest error over the detector must be within this (arcseconds); "
+        "detectors with no such polynomial use their full WCS. The full WCSs are still used for outputs.",
+        dtype=float,
+        default=0.0,
+    )
+    wcsSurrogateMaxOrder = pexConfig.Field(
+        doc="Highest polynomial order to try for the WCS surrogates (see wcsSurrogateMaxError).",
+        dtype=int,
+        default=9,
+    )
     minMeasurements = pexConfig.Field(
         doc="Minimum number of associated measured stars for a fitted star to be included in the fit",
         dtype=int,
@@ -419,6 +445,12 @@ class JointcalConfig(pipeBase.PipelineTaskConfig,
         dtype=int,
         default=7,
     )
+    photometryBasisCacheMaxMB = pexConfig.Field(
+        doc=("Memory budget (MB) for precomputing the constrained photometry model's visit polynomial basis "
+             "at each measurement; the basis is computed on the fly if it would need more than this."),
+        dtype=float,
+        default=1024,
+    )
     photometryDoRankUpdate = pexConfig.Field(
         doc=("Do the rank update step during minimization. "
              "Skipping this can help deal with models that are too non-linear."),
@@ -431,6 +463,19 @@ class JointcalConfig(pipeBase.PipelineTaskConfig,
         dtype=bool,
         default=True,
     )
+    refinementTolerance = pexConfig.Field(
+        doc=("Relative residual |grad - H*delta| / |grad| of the normal equations that the solve of each "
+             "minimization step is iteratively refined down to."),
+        dtype=float,
+        default=1e-8,
+    )
+    refitOnlyIfInaccurate = pexConfig.Field(
+        doc=("With the rank updates, only minimize once more after the fit has converged if a solve of "
+             "its last step could not be refined below `refinementTolerance`, instead of always doing so "
+             "in case the rank updates lost accuracy."),
+        dtype=bool,
+        default=False,
+    )
     outlierRejectSigma = pexConfig.Field(
         doc="How many sigma to reject outliers at during minimization.",
         dtype=float,
@@ -487,24 +532,26 @@ class JointcalConfig(pipeBase.PipelineTaskConfig,
     # configs for outputting debug information
     writeInitMatrix = pexConfig.Field(
         dtype=bool,
-        doc=("Write the pre/post-initialization Hessian and gradient to text files, for debugging. "
-             "Output files will be written to `config.debugOutputPath` and will "
-             "be of the form 'astrometry_[pre|post]init-TRACT-FILTER-mat.txt'. "
-             "Note that these files are the dense versions of the matrix, and so may be very large."),
+        doc=("Write the pre/post-initialization Hessian, gradient and parameter index map to files, for "
+             "debugging. Output files will be written to `config.debugOutputPath` and will "
+             "be of the form 'astrometry_[pre|post]init-TRACT-FILTER-[hessian.bin|index.csv]'. "
+             "Read them with `lsst.jointcal.hessianDump.readHessianDump`."),
         default=False
     )
     writeChi2FilesInitialFinal = pexConfig.Field(
         dtype=bool,
-        doc=("Write .csv files containing the contributions to chi2 for the initialization and final fit. "
-             "Output files will be written to `config.debugOutputPath` and will "
-             "be of the form `astrometry_[initial|final]_chi2-TRACT-FILTER."),
+        doc=("Write binary column files containing the contributions to chi2 for the initialization and "
+             "final fit. Output files will be written to `config.debugOutputPath` and will "
+             "be of the form `astrometry_[initial|final]_chi2-TRACT-FILTER-[meas|ref].bin`. "
+             "Read them with `lsst.jointcal.chi2Contributions.readChi2Contributions`."),
         default=False
     )
     writeChi2FilesOuterLoop = pexConfig.Field(
         dtype=bool,
-        doc=("Write .csv files containing the contributions to chi2 for the outer fit loop. "
+        doc=("Write binary column files containing the contributions to chi2 for the outer fit loop. "
              "Output files will be written to `config.debugOutputPath` and will "
-             "be of the form `astrometry_init-NN_chi2-TRACT-FILTER`."),
+             "be of the form `astrometry_init-NN_chi2-TRACT-FILTER-[meas|ref].bin`. "
+             "Read them with `lsst.jointcal.chi2Contributions.readChi2Contributions`."),
         default=False
     )
     writeInitialModel = pexConfig.Field(
@@ -520,11 +567,87 @@ class JointcalConfig(pipeBase.PipelineTaskConfig,
         doc=("Path to write debug output files to. Used by "
              "`writeInitialModel`, `writeChi2Files*`, `writeInitMatrix`.")
     )
+    covarianceMode = pexConfig.ChoiceField(
+        dtype=str,
+        default="none",
+        doc=("Compute the covariance of the fitted parameters from the final Hessian, and attach it to the "
+             "fitted models (see `AstrometryModel.getCovariance`) and FittedStars."),
+        allowed={
+            "none": "Do not compute the covariance.",
+            "full": "Compute the covariance of each mapping's parameters and of each FittedStar.",
+            "diagonal": ("Only compute the variance of each parameter; uses less memory than `full` "
+                         "for the same computation time."),
+        }
+    )
+    outputThreads = pexConfig.Field(
+        dtype=int,
+        default=0,
+        doc=("Number of threads used to fit the polynomial inverses of the output WCS; 0 means one per "
+             "available core. The WCS and PhotoCalibs themselves are made serially.")
+    )
     detailedProfile = pexConfig.Field(
         dtype=bool,
         default=False,
         doc="Output separate profiling information for different parts of jointcal, e.g. data read, fitting"
     )
+    fitCatalogStoragePath = pexConfig.Field(
+        dtype=str,
+        default="",
+        doc=("Directory in which to store the catalogs of the ccdImages in a memory-mapped scratch file, so "
+             "that the operating system can page them out while they are not in use; empty to keep them in "
+             "memory. "
+             "Useful for tracts whose catalogs do not fit in memory together with the fit's matrices.")
+    )
+    checkpointPath = pexConfig.Field(
+        dtype=str,
+        default="",
+        doc=("Path to write binary checkpoints of the fits to, from which a later run can resume them "
+             "(see `resumeFromCheckpoint`); empty to not write checkpoints. Each fit overwrites its "
+             "checkpoint, of the form `jointcal_astrometry_checkpoint-TRACT.bin`.")
+    )
+    checkpointPoints = pexConfig.ListField(
+        dtype=str,
+        default=["initialized", "final"],
+        doc=("When to write a checkpoint of each fit: after the initial minimizations (`initialized`) "
+             "and/or after outlier rejection has finished (`final`).")
+    )
+    checkpointInterval = pexConfig.Field(
+        dtype=int,
+        default=0,
+        doc="Also write a checkpoint every this many outlier rejection steps; 0 to not do so."
+    )
+    resumeFromCheckpoint = pexConfig.Field(
+        dtype=bool,
+        default=False,
+        doc=("Resume the fits from the checkpoints in `checkpointPath` instead of loading, associating and "
+             "initializing them, if there is a checkpoint for each configured fit.")
+    )
+    solutionPath = pexConfig.Field(
+        dtype=str,
+        default="",
+        doc=("Path to write the fitted parameters of each chip, visit or ccd transform to at the end of each "
+             "fit, from which a later run can start (see `hotStart`); empty to not write them. Each fit "
+             "overwrites its solution, of the form `jointcal_astrometry_solution-TRACT.npz`.")
+    )
+    hotStart = pexConfig.Field(
+        dtype=bool,
+        default=False,
+        doc=("Start the models from the solution in `solutionPath` of a previous run on the same tract, if "
+             "there is one and it was fit with the same model: the transforms of the chips and visits that "
+             "are in it start from their previous values, and those of new chips and visits are "
+             "initialized from the single frame calibrations as usual.")
+    )
+    incrementalUpdate = pexConfig.Field(
+        dtype=bool,
+        default=False,
+        doc=("With `hotStart`, only fit the visits that are not in the previous solution of the tract: the "
+             "visits in it are not loaded, the stars fit with them are restored from it and held fixed, as "
+             "are the transforms started from it, and only the transforms of the new chips and visits and "
+             "the new stars are fit. The written solution keeps the transforms and stars of the previous "
+             "visits. If every input visit is in the solution, they are all fit again. To fit all the "
+             "visits together, run with `hotStart` alone. Gen2 only: the Gen3 task must write the outputs of "
+             "every input visit, so it fits them all, as with `hotStart` alone.")
+    )
 
     def validate(self):
         super().validate()
@@ -535,6 +658,19 @@ class JointcalConfig(pipeBase.PipelineTaskConfig,
             msg = ("Only doing astrometry, but Colorterms are not applied for astrometry;"
                    "applyColorTerms=True will be ignored.")
             lsst.log.warn(msg)
+        unknownPoints = set(self.checkpointPoints) - {"initialized", "final"}
+        if unknownPoints:
+            msg = f"Unknown checkpoint points {sorted(unknownPoints)}: must be 'initialized' or 'final'."
+            raise pexConfig.FieldValidationError(JointcalConfig.checkpointPoints, self, msg)
+        if self.resumeFromCheckpoint and not self.checkpointPath:
+            msg = "resumeFromCheckpoint=True requires checkpointPath to be set."
+            raise pexConfig.FieldValidationError(JointcalConfig.resumeFromCheckpoint, self, msg)
+        if self.hotStart and not self.solutionPath:
+            msg = "hotStart=True requires solutionPath to be set."
+            raise pexConfig.FieldValidationError(JointcalConfig.hotStart, self, msg)
+        if self.incrementalUpdate and not self.hotStart:
+            msg = "incrementalUpdate=True requires hotStart=True."
+            raise pexConfig.FieldValidationError(JointcalConfig.incrementalUpdate, self, msg)
 
     def setDefaults(self):
         # Use science source selector which can filter on extendedness, SNR, and whether blended
@@ -634,6 +770,8 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
 
         # To hold various computed metrics for use by tests
         self.job = Job.load_metrics_package(subset='jointcal')
+        # The records deferred by the fit running in each thread; see `_defer_records`.
+        self._threadRecords = threading.local()
 
     def runQuantum(self, butlerQC, inputRefs, outputRefs):
         # We override runQuantum to set up the refObjLoaders and write the
@@ -731,41 +869,39 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
         sourceFluxField = "flux"
         jointcalControl = lsst.jointcal.JointcalControl(sourceFluxField)
         associations = lsst.jointcal.Associations()
+        associations.setFitCatalogStorage(self.config.fitCatalogStoragePath)
         self.focalPlaneBBox = inputCamera.getFpBBox()
-        oldWcsList, bands = self._load_data(inputSourceTableVisit,
-                                            inputVisitSummary,
-                                            associations,
-                                            jointcalControl,
-                                            inputCamera)
-
-        boundingCircle, center, radius, defaultFilter, epoch = self._prep_sky(associations, bands)
-
+        checkpoints = self._find_checkpoints(tract)
+        if checkpoints:
+            detectors = {detector.getId(): detector for detector in inputCamera}
+            fits = self._resume_fits(checkpoints, detectors, tract)
+        else:
+            if self.config.incrementalUpdate:
+                # runQuantum must write every output, and the visits an
+                # incremental update leaves out would have none.
+                self.log.warn("incrementalUpdate is not supported by the Gen3 middleware: fitting every "
+                              "input visit, starting from the previous solution.")
+            oldWcsList, bands = self._load_data(inputSourceTableVisit,
+                                                inputVisitSummary,
+                                                associations,
+                                                jointcalControl,
+                                                inputCamera)
+
+            boundingCircle, center, radius, defaultFilter, epoch = self._prep_sky(associations, bands, tract)
+
+            fits = self._do_fits(associations, defaultFilter, center, radius, tract, epoch)
         if self.config.doAstrometry:
-            astrometry = self._do_load_refcat_and_fit(associations, defaultFilter, center, radius,
-                                                      name="astrometry",
-                                                      refObjLoader=self.astrometryRefObjLoader,
-                                                      referenceSelector=self.astrometryReferenceSelector,
-                                                      fit_function=self._fit_astrometry,
-                                                      tract=tract,
-                                                      epoch=epoch)
-            astrometry_output = self._make_output(associations.getCcdImageList(),
-                                                  astrometry.model,
-                                                  "makeSkyWcs")
+            astrometry_output = self._make_output(fits.astrometryAssociations.getCcdImageList(),
+                                                  fits.astrometry.model,
+                                                  "makeSkyWcsMap",
+                                                  nThreads=self.config.outputThreads)
         else:
             astrometry_output = None
 
         if self.config.doPhotometry:
-            photometry = self._do_load_refcat_and_fit(associations, defaultFilter, center, radius,
-                                                      name="photometry",
-                                                      refObjLoader=self.photometryRefObjLoader,
-                                                      referenceSelector=self.photometryReferenceSelector,
-                                                      fit_function=self._fit_photometry,
-                                                      tract=tract,
-                                                      epoch=epoch,
-                                                      reject_bad_fluxes=True)
-            photometry_output = self._make_output(associations.getCcdImageList(),
-                                                  photometry.model,
-                                                  "toPhotoCalib")
+            photometry_output = self._make_output(fits.photometryAssociations.getCcdImageList(),
+                                                  fits.photometry.model,
+                                                  "toPhotoCalibMap")
         else:
             photometry_output = None
 
@@ -1005,8 +1141,9 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
                                  bbox=butler.get('calexp_bbox', dataId=dataId),
                                  filter=butler.get('calexp_filterLabel', dataId=dataId))
 
-    def loadData(self, dataRefs, associations, jointcalControl):
-        """Read the data that jointcal needs to run. (Gen2 version)"""
+    def loadData(self, dataRefs, associations, jointcalControl, skipVisits=()):
+        """Read the data that jointcal needs to run, except that of
+        ``skipVisits``. (Gen2 version)"""
         visit_ccd_to_dataRef = {}
         oldWcsList = []
         filters = []
@@ -1016,6 +1153,8 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
             camera = dataRefs[0].get('camera', immediate=True)
             self.focalPlaneBBox = camera.getFpBBox()
             for dataRef in dataRefs:
+                if dataRef.dataId.get("visit") in skipVisits:
+                    continue
                 data = self._readDataId(dataRef.getButler(), dataRef.dataId)
                 result = self._build_ccdImage(data, associations, jointcalControl)
                 if result is None:
@@ -1034,11 +1173,229 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
         """
         return os.path.join(self.config.debugOutputPath, filename)
 
-    def _prep_sky(self, associations, filters):
+    def _getCheckpointFile(self, name, tract):
+        """Return the checkpoint file of the ``name`` fit of a tract, or
+        an empty string if checkpoints are not configured.
+        """
+        if not self.config.checkpointPath:
+            return ""
+        return os.path.join(self.config.checkpointPath, f"jointcal_{name}_checkpoint-{tract}.bin")
+
+    def _getSolutionFile(self, name, tract):
+        """Return the solution file of the ``name`` fit of a tract, or an
+        empty string if solutions are not configured.
+        """
+        if not self.config.solutionPath:
+            return ""
+        return os.path.join(self.config.solutionPath, f"jointcal_{name}_solution-{tract}.npz")
+
+    def _getModelName(self, name):
+        """Return the configured ``name`` model, which a solution must have
+        been fit with to start from it.
+        """
+        return self.config.astrometryModel if name == "astrometry" else self.config.photometryModel
+
+    def _read_solution(self, name, filename):
+        """Read the solution of a previous ``name`` fit, written by
+        `_write_solution`.
+
+        Parameters
+        ----------
+        name : {'astrometry' or 'photometry'}
+            What type of model was fit.
+        filename : `str`
+            The solution file.
+
+        Returns
+        -------
+        solution : `lsst.pipe.base.Struct` or `None`
+            ``parameters``
+                The parameters of each transform, keyed by (visit, ccd)
+                (`dict` [`tuple`, `numpy.ndarray`]).
+            ``stars``
+                The fitted stars, as returned by
+                `lsst.jointcal.Associations.getFittedStarArray`
+                (`numpy.ndarray`).
+            ``visits``
+                The visits that were fit (`set` [`int`]).
+            ``tangentPoint``
+                The common tangent point of the fit, in degrees
+                (`numpy.ndarray`), or `None` if it was not recorded.
+            `None` if there is no solution, or it was fit with another
+            model than the configured one.
+        """
+        if not filename or not os.path.exists(filename):
+            return None
+        with np.load(filename) as solution:
+            if str(solution["model"]) != self._getModelName(name):
+                self.log.warn("Not using the %s solution %s: it was fit with model %s, not %s.",
+                              name, filename, solution["model"], self._getModelName(name))
+                return None
+            offsets = np.concatenate([[0], np.cumsum(solution["size"])])
+            parameters = {(int(visit), int(ccd)): solution["parameters"][start:end]
+                          for visit, ccd, start, end in zip(solution["visit"], solution["ccd"],
+                                                           offsets[:-1], offsets[1:])}
+            stars = solution["stars"]
+            tangentPoint = solution["tangentPoint"] if "tangentPoint" in solution.files else None
+        # The chip transforms of the constrained models have no visit.
+        visits = {visit for visit, _ in parameters if visit != -1}
+        return pipeBase.Struct(parameters=parameters, stars=stars, visits=visits, tangentPoint=tangentPoint)
+
+    def _is_incremental(self, solution, associations):
+        """Return whether ``associations`` is an incremental update of a
+        previous ``solution``, i.e. some of the visits of the solution were
+        left out of it.
+        """
+        if not self.config.incrementalUpdate or solution is None:
+            return False
+        visits = {ccdImage.visit for ccdImage in associations.getCcdImageList()}
+        return not solution.visits <= visits
+
+    def _find_previous_visits(self, visits, tract):
+        """Return the visits to leave out of an incremental update: those in
+        the previous solution of every configured fit.
+
+        Parameters
+        ----------
+        visits : `list` [`int`]
+            The input visits.
+        tract : `str`
+            Name of tract currently being fit.
+
+        Returns
+        -------
+        previous : `set` [`int`]
+            The visits not to load; empty without
+            ``config.incrementalUpdate``, or if every input visit is in the
+            previous solutions, in which case they are all fit again.
+        """
+        if not self.config.incrementalUpdate:
+            return set()
+        visits = set(visits)
+        previous = visits
+        for name, doFit in (("astrometry", self.config.doAstrometry),
+                            ("photometry", self.config.doPhotometry)):
+            if not doFit:
+                continue
+            solution = self._read_solution(name, self._getSolutionFile(name, tract))
+            if solution is None:
+                return set()
+            previous = previous & solution.visits
+        if previous == visits:
+            self.log.info("No new visits to add to the previous solution: fitting all %d again.",
+                          len(visits))
+            return set()
+        self.log.info("Incremental update: not loading the %d visits of the previous solution.",
+                      len(previous))
+        return previous
+
+    def _write_solution(self, model, associations, name, filename):
+        """Write the parameters of each transform of a fitted model, the
+        fitted stars and the common tangent point, for `_hot_start` and
+        incremental updates to start a later fit from.
+
+        The transforms of the visits that an incremental update left out are
+        kept from the previous solution; their stars were restored from it.
+
+        Parameters
+        ----------
+        model : `lsst.jointcal.AstrometryModel` or `lsst.jointcal.PhotometryModel`
+            The fitted model.
+        associations : `lsst.jointcal.Associations`
+            The star/reference star associations that were fit.
+        name : {'astrometry' or 'photometry'}
+            What type of model it is.
+        filename : `str`
+            The file to write; nothing is written if empty.
+        """
+        if not filename:
+            return
+        parameters = model.getMappingParameters()
+        previous = self._read_solution(name, filename) if self.config.incrementalUpdate else None
+        if self._is_incremental(previous, associations):
+            parameters = {**previous.parameters, **parameters}
+        keys = sorted(parameters)
+        tangentPoint = associations.getCommonTangentPoint()
+        np.savez(filename,
+                 model=np.array(self._getModelName(name)),
+                 visit=np.array([visit for visit, _ in keys], dtype=np.int64),
+                 ccd=np.array([ccd for _, ccd in keys], dtype=np.int64),
+                 size=np.array([len(parameters[key]) for key in keys], dtype=np.int64),
+                 parameters=np.concatenate([parameters[key] for key in keys]) if keys else np.zeros(0),
+                 stars=associations.getFittedStarArray(),
+                 tangentPoint=np.array([tangentPoint.x, tangentPoint.y]))
+        self.log.info("Wrote %s solution: %s", name, filename)
+
+    def _hot_start(self, model, name, filename, tangentPoint=None):
+        """Start the transforms of a model from the solution of a previous
+        run, if configured and there is one for the same model.
+
+        The astrometry transforms map to the common tangent plane, so they
+        are only started from a solution fit with the same tangent point;
+        `_prep_sky` reuses that of the solution for this.
+
+        With ``config.incrementalUpdate``, the transforms that were started
+        are then held fixed, unless that is all of them.
+
+        Parameters
+        ----------
+        model : `lsst.jointcal.AstrometryModel` or `lsst.jointcal.PhotometryModel`
+            The model to start, before any fitting.
+        name : {'astrometry' or 'photometry'}
+            What type of model it is.
+        filename : `str`
+            The solution written by `_write_solution`.
+        tangentPoint : `lsst.jointcal.Point`, optional
+            The common tangent point of the fit, which must be that of the
+            solution; `None` if the model does not depend on it.
+
+        Returns
+        -------
+        complete : `bool`
+            True if every transform of ``model`` was started from the
+            previous solution.
+        """
+        if not self.config.hotStart:
+            return False
+        solution = self._read_solution(name, filename)
+        if solution is None:
+            return False
+        if tangentPoint is not None and (solution.tangentPoint is None
+                                         or tuple(solution.tangentPoint) != (tangentPoint.x, tangentPoint.y)):
+            self.log.warn("Not using the %s solution %s: it was fit with common tangent point %s, not %s.",
+                          name, filename, solution.tangentPoint, (tangentPoint.x, tangentPoint.y))
+            return False
+        parameters = solution.parameters
+        self.log.info("====== Starting %s from the previous solution %s...", name, filename)
+        nSet = model.setMappingParameters(parameters)
+        current = model.getMappingParameters()
+        complete = nSet == len(current)
+        if self.config.incrementalUpdate and complete:
+            self.log.info("No new transforms in the %s fit: fitting all of them.", name)
+        elif self.config.incrementalUpdate:
+            # Those that setMappingParameters() skipped were not started.
+            started = [key for key, values in parameters.items()
+                       if key in current and len(current[key]) == len(values)]
+            model.fixMappings(started)
+        return complete
+
+    def _prep_sky(self, associations, filters, tract):
         """Prepare on-sky and other data that must be computed after data has
         been read.
         """
-        associations.computeCommonTangentPoint()
+        if self.config.wcsSurrogateMaxError > 0:
+            associations.setWcsSurrogate(self.config.wcsSurrogateMaxError, self.config.wcsSurrogateMaxOrder)
+        associations.setReuseAssociation(self.config.reuseAssociation)
+        solution = None
+        if self.config.doAstrometry and self.config.hotStart:
+            solution = self._read_solution("astrometry", self._getSolutionFile("astrometry", tract))
+        if solution is not None and solution.tangentPoint is not None:
+            # The transforms to start from map to the tangent plane of the previous solution.
+            associations.setCommonTangentPoint(lsst.geom.Point2D(*solution.tangentPoint))
+            self.log.info("Using the common tangent point of the previous astrometry solution: %s",
+                          solution.tangentPoint)
+        else:
+            associations.computeCommonTangentPoint()
 
         boundingCircle = associations.computeBoundingCircle()
         center = lsst.geom.SpherePoint(boundingCircle.getCenter())
@@ -1088,37 +1445,38 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
         sourceFluxField = "slot_%sFlux" % (self.config.sourceFluxType,)
         jointcalControl = lsst.jointcal.JointcalControl(sourceFluxField)
         associations = lsst.jointcal.Associations()
+        associations.setFitCatalogStorage(self.config.fitCatalogStoragePath)
 
+        tract = dataRefs[0].dataId['tract']
+        # Not all instruments have `visit` in their dataIds: those are always loaded.
+        skipVisits = self._find_previous_visits([dataRef.dataId["visit"] for dataRef in dataRefs
+                                                 if "visit" in dataRef.dataId], tract)
         oldWcsList, filters, visit_ccd_to_dataRef = self.loadData(dataRefs,
                                                                   associations,
-                                                                  jointcalControl)
-
-        boundingCircle, center, radius, defaultFilter, epoch = self._prep_sky(associations, filters)
+                                                                  jointcalControl,
+                                                                  skipVisits=skipVisits)
 
-        tract = dataRefs[0].dataId['tract']
+        boundingCircle, center, radius, defaultFilter, epoch = self._prep_sky(associations, filters, tract)
 
+        checkpoints = self._find_checkpoints(tract)
+        if checkpoints:
+            # The data was still loaded above, for the output dataRefs.
+            detectors = {ccdImage.getCcdId(): ccdImage.getDetector()
+                         for ccdImage in associations.getCcdImageList()}
+            fits = self._resume_fits(checkpoints, detectors, tract)
+        else:
+            fits = self._do_fits(associations, defaultFilter, center, radius, tract, epoch)
         if self.config.doAstrometry:
-            astrometry = self._do_load_refcat_and_fit(associations, defaultFilter, center, radius,
-                                                      name="astrometry",
-                                                      refObjLoader=self.astrometryRefObjLoader,
-                                                      referenceSelector=self.astrometryReferenceSelector,
-                                                      fit_function=self._fit_astrometry,
-                                                      tract=tract,
-                                                      epoch=epoch)
-            self._write_astrometry_results(associations, astrometry.model, visit_ccd_to_dataRef)
+            astrometry = fits.astrometry
+            self._write_astrometry_results(fits.astrometryAssociations, astrometry.model,
+                                           visit_ccd_to_dataRef)
         else:
             astrometry = Astrometry(None, None, None)
 
         if self.config.doPhotometry:
-            photometry = self._do_load_refcat_and_fit(associations, defaultFilter, center, radius,
-                                                      name="photometry",
-                                                      refObjLoader=self.photometryRefObjLoader,
-                                                      referenceSelector=self.photometryReferenceSelector,
-                                                      fit_function=self._fit_photometry,
-                                                      tract=tract,
-                                                      epoch=epoch,
-                                                      reject_bad_fluxes=True)
-            self._write_photometry_results(associations, photometry.model, visit_ccd_to_dataRef)
+            photometry = fits.photometry
+            self._write_photometry_results(fits.photometryAssociations, photometry.model,
+                                           visit_ccd_to_dataRef)
         else:
             photometry = Photometry(None, None)
 
@@ -1195,6 +1553,156 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
                                  format="jyear",
                                  scale="tai")
 
+    def _do_fits(self, associations, defaultFilter, center, radius, tract, epoch):
+        """Run the configured astrometric and photometric fits, concurrently
+        if ``config.parallelFits`` is set.
+
+        Parameters
+        ----------
+        associations : `lsst.jointcal.Associations`
+            The star/reference star associations to fit.
+        defaultFilter : `lsst.afw.image.FilterLabel`
+            filter to load from reference catalog.
+        center : `lsst.geom.SpherePoint`
+            ICRS center of field to load from reference catalog.
+        radius : `lsst.geom.Angle`
+            On-sky radius to load from reference catalog.
+        tract : `str`
+            Name of tract currently being fit.
+        epoch : `astropy.time.Time`
+            Epoch to which to correct refcat proper motion and parallax,
+            or `None` to not apply such corrections.
+
+        Returns
+        -------
+        result : `lsst.pipe.base.Struct`
+            ``astrometry`` and ``photometry`` results of
+            `_do_load_refcat_and_fit` (`None` if not run), and the
+            ``astrometryAssociations`` and ``photometryAssociations`` they
+            were fit on.
+        """
+        fits = {}
+        if self.config.doAstrometry:
+            fits["astrometry"] = dict(refObjLoader=self.astrometryRefObjLoader,
+                                      referenceSelector=self.astrometryReferenceSelector,
+                                      fit_function=self._fit_astrometry)
+        if self.config.doPhotometry:
+            fits["photometry"] = dict(refObjLoader=self.photometryRefObjLoader,
+                                      referenceSelector=self.photometryReferenceSelector,
+                                      fit_function=self._fit_photometry,
+                                      reject_bad_fluxes=True)
+
+        match_cut = 3.0
+        if self.config.parallelFits and len(fits) > 1:
+            # Associate once; each fit then works on its own view of that association, so that they share no
+            # state that either changes, and can run in separate threads (the C++ releases the GIL).
+            associations.setReuseAssociation(True)
+            associations.associateCatalogs(match_cut)
+            self._record_instrumentation("shared", "associations", associations)
+            views = {name: associations.createFitView() for name in fits}
+            self.log.info("Running the %s fits concurrently.", " and ".join(fits))
+            with concurrent.futures.ThreadPoolExecutor(max_workers=len(fits)) as executor:
+                futures = {name: executor.submit(self._defer_records, self._do_load_refcat_and_fit,
+                                                 views[name], defaultFilter, center, radius, name=name,
+                                                 tract=tract, match_cut=match_cut, epoch=epoch, **kwargs)
+                           for name, kwargs in fits.items()}
+                deferred = {name: future.result() for name, future in futures.items()}
+            # Record each fit's measurements from this thread, in a fixed order.
+            results = {}
+            for name, (result, records) in deferred.items():
+                self._apply_records(records)
+                results[name] = result
+        else:
+            views = {name: associations for name in fits}
+            results = {name: self._do_load_refcat_and_fit(associations, defaultFilter, center, radius,
+                                                          name=name, tract=tract, match_cut=match_cut,
+                                                          epoch=epoch, **kwargs)
+                       for name, kwargs in fits.items()}
+
+        return pipeBase.Struct(astrometry=results.get("astrometry"),
+                               astrometryAssociations=views.get("astrometry"),
+                               photometry=results.get("photometry"),
+                               photometryAssociations=views.get("photometry"))
+
+    def _find_checkpoints(self, tract):
+        """Return the checkpoint to resume each configured fit from.
+
+        Parameters
+        ----------
+        tract : `str`
+            Name of tract currently being fit.
+
+        Returns
+        -------
+        checkpoints : `dict` [`str`, `str`]
+            The checkpoint file of each fit, keyed by "astrometry" and/or
+            "photometry"; empty if ``config.resumeFromCheckpoint`` is not set
+            or any of the checkpoints is missing, in which case the fits
+            start from the beginning.
+        """
+        if not self.config.resumeFromCheckpoint:
+            return {}
+        names = [name for name, doFit in (("astrometry", self.config.doAstrometry),
+                                           ("photometry", self.config.doPhotometry)) if doFit]
+        checkpoints = {name: self._getCheckpointFile(name, tract) for name in names}
+        missing = [filename for filename in checkpoints.values() if not os.path.exists(filename)]
+        if missing:
+            self.log.warn("Missing checkpoints %s: running the fits from the beginning.", missing)
+            return {}
+        return checkpoints
+
+    def _resume_fits(self, checkpoints, detectors, tract):
+        """Resume the configured fits from their checkpoints, concurrently
+        if ``config.parallelFits`` is set.
+
+        Parameters
+        ----------
+        checkpoints : `dict` [`str`, `str`]
+            The checkpoint file of each fit, from `_find_checkpoints`.
+        detectors : `dict` [`int`, `lsst.afw.cameraGeom.Detector`]
+            The detector of each ccd, by id.
+        tract : `str`
+            Name of tract currently being fit.
+
+        Returns
+        -------
+        result : `lsst.pipe.base.Struct`
+            As returned by `_do_fits`.
+        """
+        fit_functions = {"astrometry": self._fit_astrometry, "photometry": self._fit_photometry}
+
+        def resume(name, filename):
+            self.log.info("====== Resuming %s from checkpoint %s...", name, filename)
+            checkpoint = lsst.jointcal.Checkpoint(filename, detectors)
+            associations = checkpoint.getAssociations()
+            bands = collections.Counter(ccdImage.getFilter() for ccdImage in associations.getCcdImageList())
+            dataName = "{}_{}".format(tract, bands.most_common(1)[0][0])
+            result = fit_functions[name](associations, dataName, checkpointFile=filename,
+                                         checkpoint=checkpoint,
+                                         solutionFile=self._getSolutionFile(name, tract))
+            self._record_instrumentation(name, "model", result.model)
+            self._record_instrumentation(name, "fit", result.fit)
+            return result, associations
+
+        if self.config.parallelFits and len(checkpoints) > 1:
+            with concurrent.futures.ThreadPoolExecutor(max_workers=len(checkpoints)) as executor:
+                futures = {name: executor.submit(self._defer_records, resume, name, filename)
+                           for name, filename in checkpoints.items()}
+                deferred = {name: future.result() for name, future in futures.items()}
+            resumed = {}
+            for name, (result, records) in deferred.items():
+                self._apply_records(records)
+                resumed[name] = result
+        else:
+            resumed = {name: resume(name, filename) for name, filename in checkpoints.items()}
+
+        results = {name: result for name, (result, _) in resumed.items()}
+        views = {name: associations for name, (_, associations) in resumed.items()}
+        return pipeBase.Struct(astrometry=results.get("astrometry"),
+                               astrometryAssociations=views.get("astrometry"),
+                               photometry=results.get("photometry"),
+                               photometryAssociations=views.get("photometry"))
+
     def _do_load_refcat_and_fit(self, associations, defaultFilter, center, radius,
                                 tract="", match_cut=3.0,
                                 reject_bad_fluxes=False, *,
@@ -1239,9 +1747,16 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
         self.log.info("====== Now processing %s...", name)
         # TODO: this should not print "trying to invert a singular transformation:"
         # if it does that, something's not right about the WCS...
-        associations.associateCatalogs(match_cut)
-        add_measurement(self.job, 'jointcal.associated_%s_fittedStars' % name,
-                        associations.fittedStarListSize())
+        solutionFile = self._getSolutionFile(name, tract)
+        solution = self._read_solution(name, solutionFile) if self.config.incrementalUpdate else None
+        if self._is_incremental(solution, associations):
+            # The stars fit with the visits left out constrain the new visits, as they did the old ones.
+            associations.setFixedFittedStars(solution.stars)
+            associations.associateCatalogs(match_cut, useFittedList=True)
+        else:
+            associations.associateCatalogs(match_cut)
+        self._add_measurement('jointcal.associated_%s_fittedStars' % name,
+                              associations.fittedStarListSize())
 
         applyColorterms = False if name.lower() == "astrometry" else self.config.applyColorTerms
         refCat, fluxField = self._load_reference_catalog(refObjLoader, referenceSelector,
@@ -1255,23 +1770,25 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
                                      fluxField,
                                      refCoordinateErr=refCoordErr,
                                      rejectBadFluxes=reject_bad_fluxes)
-        add_measurement(self.job, 'jointcal.collected_%s_refStars' % name,
-                        associations.refStarListSize())
+        self._add_measurement('jointcal.collected_%s_refStars' % name,
+                              associations.refStarListSize())
 
         associations.prepareFittedStars(self.config.minMeasurements)
 
         self._check_star_lists(associations, name)
-        add_measurement(self.job, 'jointcal.selected_%s_refStars' % name,
-                        associations.nFittedStarsWithAssociatedRefStar())
-        add_measurement(self.job, 'jointcal.selected_%s_fittedStars' % name,
-                        associations.fittedStarListSize())
-        add_measurement(self.job, 'jointcal.selected_%s_ccdImages' % name,
-                        associations.nCcdImagesValidForFit())
+        self._add_measurement('jointcal.selected_%s_refStars' % name,
+                              associations.nFittedStarsWithAssociatedRefStar())
+        self._add_measurement('jointcal.selected_%s_fittedStars' % name,
+                              associations.fittedStarListSize())
+        self._add_measurement('jointcal.selected_%s_ccdImages' % name,
+                              associations.nCcdImagesValidForFit())
 
         load_cat_prof_file = 'jointcal_fit_%s.prof'%name if self.config.detailedProfile else ''
         dataName = "{}_{}".format(tract, defaultFilter.physicalLabel)
         with pipeBase.cmdLineTask.profile(load_cat_prof_file):
-            result = fit_function(associations, dataName)
+            result = fit_function(associations, dataName,
+                                  checkpointFile=self._getCheckpointFile(name, tract),
+                                  solutionFile=solutionFile)
         # TODO DM-12446: turn this into a "butler save" somehow.
         # Save reference and measurement chi2 contributions for this data
         if self.config.writeChi2FilesInitialFinal:
@@ -1279,8 +1796,97 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
             result.fit.saveChi2Contributions(baseName+"{type}")
             self.log.info("Wrote chi2 contributions files: %s", baseName)
 
+        self._record_instrumentation(name, "associations", associations)
+        self._record_instrumentation(name, "model", result.model)
+        self._record_instrumentation(name, "fit", result.fit)
+
         return result
 
+    def _record_instrumentation(self, name, component, source):
+        """Log the timed phases of one jointcal component and record them as
+        measurements in the job, then reset them for the next fit.
+
+        The measurements of the ``i``th phase are named
+        ``jointcal.{name}_{component}_{i}_{quantity}``, for the quantities
+        ``wallTime``, ``cpuTime``, ``peakMemoryIncrease``, ``nThreads`` and
+        each of the phase's counters; their metrics are defined here, with
+        the name of the phase in their description.
+
+        Parameters
+        ----------
+        name : {'photometry' or 'astrometry'}
+            What type of data was fit.
+        component : `str`
+            The component that was timed (e.g. "associations", "fit").
+        source : `lsst.jointcal.Associations`, `lsst.jointcal.FitterBase`, or model
+            The component whose timed phases to record and reset.
+        """
+        measurements = []
+        for i, phase in enumerate(source.getInstrumentation().getPhases()):
+            self.log.debug("%s %s: %s", name, component, phase)
+            quantities = {"wallTime": phase.wallTime*u.s,
+                          "cpuTime": phase.cpuTime*u.s,
+                          "peakMemoryIncrease": phase.peakMemoryIncrease*u.byte,
+                          "nThreads": phase.nThreads*u.dimensionless_unscaled}
+            quantities.update({counter: value*u.dimensionless_unscaled
+                               for counter, value in phase.counters.items()})
+            for quantity, value in quantities.items():
+                metric = Metric(f"jointcal.{name}_{component}_{i}_{quantity}",
+                                f"{quantity} of the '{phase.name}' phase of the {name} {component}.",
+                                value.unit)
+                measurements.append(Measurement(metric, value))
+        source.resetInstrumentation()
+        self._record(self._add_instrumentation, measurements)
+
+    def _add_instrumentation(self, measurements):
+        """Add the ``measurements`` of `_record_instrumentation`, and
+        their metrics, to the job.
+        """
+        for measurement in measurements:
+            self.job.metrics.insert(measurement.metric)
+            self.job.measurements.insert(measurement)
+
+    def _add_measurement(self, name, value):
+        """Add a measurement of the ``name`` metric to the job; deferred
+        like the other records of a fit running in a worker thread.
+        """
+        self._record(add_measurement, self.job, name, value)
+
+    def _record(self, function, *args):
+        """Call ``function(*args)`` to record a result in the task's job,
+        which is not thread safe; defer the call if this thread is
+        collecting its records (see `_defer_records`).
+        """
+        records = getattr(self._threadRecords, "records", None)
+        if records is None:
+            function(*args)
+        else:
+            records.append((function, args))
+
+    def _defer_records(self, function, *args, **kwargs):
+        """Call ``function`` in a worker thread, collecting the measurements
+        it records instead of adding them to the job from that thread.
+
+        Returns
+        -------
+        result
+            What ``function(*args, **kwargs)`` returned.
+        records : `list` [`tuple`]
+            The deferred records, to pass to `_apply_records` from the
+            calling thread once the worker has finished.
+        """
+        self._threadRecords.records = []
+        try:
+            return function(*args, **kwargs), self._threadRecords.records
+        finally:
+            self._threadRecords.records = None
+
+    @staticmethod
+    def _apply_records(records):
+        """Make the records deferred by `_defer_records`, in order."""
+        for function, args in records:
+            function(*args)
+
     def _load_reference_catalog(self, refObjLoader, referenceSelector, center, radius, filterLabel,
                                 applyColorterms=False, epoch=None):
         """Load the necessary reference catalog sources, convert fluxes to
@@ -1390,7 +1996,8 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
             raise ValueError("Model is not valid: check log messages for warnings.")
         return chi2
 
-    def _fit_photometry(self, associations, dataName=None):
+    def _fit_photometry(self, associations, dataName=None, checkpointFile="", checkpoint=None,
+                     solutionFile=""):
         """
         Fit the photometric data.
 
@@ -1401,6 +2008,14 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
         dataName : `str`
             Name of the data being processed (e.g. "1234_HSC-Y"), for
             identifying debugging files.
+        checkpointFile : `str`, optional
+            File to write checkpoints of the fit to; empty for none.
+        checkpoint : `lsst.jointcal.Checkpoint`, optional
+            Checkpoint to resume the fit from, skipping its initialization;
+            ``associations`` must be the checkpoint's.
+        solutionFile : `str`, optional
+            File to write the fitted transforms to, and to start them from
+            if ``config.hotStart`` is set; empty for none.
 
         Returns
         -------
@@ -1436,52 +2051,63 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
                                                        errorPedestal=self.config.photometryErrorPedestal)
             doLineSearch = False  # purely linear in model parameters, so no line search needed
 
+        if isinstance(model, lsst.jointcal.ConstrainedPhotometryModel):
+            model.makeBasisCache(associations.getCcdImageList(),
+                                 int(self.config.photometryBasisCacheMaxMB * 2**20))
+
         fit = lsst.jointcal.PhotometryFit(associations, model)
-        # TODO DM-12446: turn this into a "butler save" somehow.
-        # Save reference and measurement chi2 contributions for this data
-        if self.config.writeChi2FilesInitialFinal:
-            baseName = f"photometry_initial_chi2-{dataName}"
+        if checkpoint is not None:
+            model.freezeErrorTransform()
+            model.setParameters(checkpoint.getModelParameters())
+            self._logChi2AndValidate(associations, fit, model, "Resumed")
         else:
-            baseName = None
-        if self.config.writeInitialModel:
-            fullpath = self._getDebugPath(f"initial_photometry_model-{dataName}.txt")
-            writeModel(model, fullpath, self.log)
-        self._logChi2AndValidate(associations, fit, model, "Initialized", writeChi2Name=baseName)
-
-        def getChi2Name(whatToFit):
-            if self.config.writeChi2FilesOuterLoop:
-                return f"photometry_init-%s_chi2-{dataName}" % whatToFit
+            # TODO DM-12446: turn this into a "butler save" somehow.
+            # Save reference and measurement chi2 contributions for this data
+            if self.config.writeChi2FilesInitialFinal:
+                baseName = f"photometry_initial_chi2-{dataName}"
             else:
-                return None
-
-        # The constrained model needs the visit transform fit first; the chip
-        # transform is initialized from the singleFrame PhotoCalib, so it's close.
-        if self.config.writeInitMatrix:
-            dumpMatrixFile = self._getDebugPath(f"photometry_preinit-{dataName}")
-        else:
-            dumpMatrixFile = ""
-        if self.config.photometryModel.startswith("constrained"):
-            # no line search: should be purely (or nearly) linear,
-            # and we want a large step size to initialize with.
-            fit.minimize("ModelVisit", dumpMatrixFile=dumpMatrixFile)
-            self._logChi2AndValidate(associations, fit, model, "Initialize ModelVisit",
-                                     writeChi2Name=getChi2Name("ModelVisit"))
-            dumpMatrixFile = ""  # so we don't redo the output on the next step
-
-        fit.minimize("Model", doLineSearch=doLineSearch, dumpMatrixFile=dumpMatrixFile)
-        self._logChi2AndValidate(associations, fit, model, "Initialize Model",
-                                 writeChi2Name=getChi2Name("Model"))
-
-        fit.minimize("Fluxes")  # no line search: always purely linear.
-        self._logChi2AndValidate(associations, fit, model, "Initialize Fluxes",
-                                 writeChi2Name=getChi2Name("Fluxes"))
-
-        fit.minimize("Model Fluxes", doLineSearch=doLineSearch)
-        self._logChi2AndValidate(associations, fit, model, "Initialize ModelFluxes",
-                                 writeChi2Name=getChi2Name("ModelFluxes"))
-
-        model.freezeErrorTransform()
-        self.log.debug("Photometry error scales are frozen.")
+                baseName = None
+            hotStarted = self._hot_start(model, "photometry", solutionFile)
+            if self.config.writeInitialModel:
+                fullpath = self._getDebugPath(f"initial_photometry_model-{dataName}.txt")
+                writeModel(model, fullpath, self.log)
+            self._logChi2AndValidate(associations, fit, model, "Initialized", writeChi2Name=baseName)
+
+            def getChi2Name(whatToFit):
+                if self.config.writeChi2FilesOuterLoop:
+                    return f"photometry_init-%s_chi2-{dataName}" % whatToFit
+                else:
+                    return None
+
+            # The constrained model needs the visit transform fit first; the chip
+            # transform is initialized from the singleFrame PhotoCalib, so it's close.
+            # Not needed if all the transforms start from a previous solution.
+            if self.config.writeInitMatrix:
+                dumpMatrixFile = self._getDebugPath(f"photometry_preinit-{dataName}")
+            else:
+                dumpMatrixFile = ""
+            if self.config.photometryModel.startswith("constrained") and not hotStarted:
+                # no line search: should be purely (or nearly) linear,
+                # and we want a large step size to initialize with.
+                fit.minimize("ModelVisit", dumpMatrixFile=dumpMatrixFile)
+                self._logChi2AndValidate(associations, fit, model, "Initialize ModelVisit",
+                                         writeChi2Name=getChi2Name("ModelVisit"))
+                dumpMatrixFile = ""  # so we don't redo the output on the next step
+
+            fit.minimize("Model", doLineSearch=doLineSearch, dumpMatrixFile=dumpMatrixFile)
+            self._logChi2AndValidate(associations, fit, model, "Initialize Model",
+                                     writeChi2Name=getChi2Name("Model"))
+
+            fit.minimize("Fluxes")  # no line search: always purely linear.
+            self._logChi2AndValidate(associations, fit, model, "Initialize Fluxes",
+                                     writeChi2Name=getChi2Name("Fluxes"))
+
+            fit.minimize("Model Fluxes", doLineSearch=doLineSearch)
+            self._logChi2AndValidate(associations, fit, model, "Initialize ModelFluxes",
+                                     writeChi2Name=getChi2Name("ModelFluxes"))
+
+            model.freezeErrorTransform()
+            self.log.debug("Photometry error scales are frozen.")
 
         chi2 = self._iterate_fit(associations,
                                  fit,
@@ -1490,13 +2116,17 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
                                  "Model Fluxes",
                                  doRankUpdate=self.config.photometryDoRankUpdate,
                                  doLineSearch=doLineSearch,
-                                 dataName=dataName)
+                                 dataName=dataName,
+                                 checkpointFile=checkpointFile)
 
-        add_measurement(self.job, 'jointcal.photometry_final_chi2', chi2.chi2)
-        add_measurement(self.job, 'jointcal.photometry_final_ndof', chi2.ndof)
+        self._add_measurement('jointcal.photometry_final_chi2', chi2.chi2)
+        self._add_measurement('jointcal.photometry_final_ndof', chi2.ndof)
+        self._compute_covariance(fit, "Model Fluxes")
+        self._write_solution(model, associations, "photometry", solutionFile)
         return Photometry(fit, model)
 
-    def _fit_astrometry(self, associations, dataName=None):
+    def _fit_astrometry(self, associations, dataName=None, checkpointFile="", checkpoint=None,
+                      solutionFile=""):
         """
         Fit the astrometric data.
 
@@ -1507,6 +2137,14 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
         dataName : `str`
             Name of the data being processed (e.g. "1234_HSC-Y"), for
             identifying debugging files.
+        checkpointFile : `str`, optional
+            File to write checkpoints of the fit to; empty for none.
+        checkpoint : `lsst.jointcal.Checkpoint`, optional
+            Checkpoint to resume the fit from, skipping its initialization;
+            ``associations`` must be the checkpoint's.
+        solutionFile : `str`, optional
+            File to write the fitted transforms to, and to start them from
+            if ``config.hotStart`` is set; empty for none.
 
         Returns
         -------
@@ -1521,7 +2159,8 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
 
         self.log.info("=== Starting astrometric fitting...")
 
-        associations.deprojectFittedStars()
+        if checkpoint is None:
+            associations.deprojectFittedStars()
 
         # NOTE: need to return sky_to_tan_projection so that it doesn't get garbage collected.
         # TODO: could we package sky_to_tan_projection and model together so we don't have to manage
@@ -1541,46 +2180,53 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
                                                         order=self.config.astrometrySimpleOrder)
 
         fit = lsst.jointcal.AstrometryFit(associations, model, self.config.positionErrorPedestal)
-        # TODO DM-12446: turn this into a "butler save" somehow.
-        # Save reference and measurement chi2 contributions for this data
-        if self.config.writeChi2FilesInitialFinal:
-            baseName = f"astrometry_initial_chi2-{dataName}"
+        if checkpoint is not None:
+            model.setParameters(checkpoint.getModelParameters())
+            self._logChi2AndValidate(associations, fit, model, "Resumed")
         else:
-            baseName = None
-        if self.config.writeInitialModel:
-            fullpath = self._getDebugPath(f"initial_astrometry_model-{dataName}.txt")
-            writeModel(model, fullpath, self.log)
-        self._logChi2AndValidate(associations, fit, model, "Initial", writeChi2Name=baseName)
-
-        def getChi2Name(whatToFit):
-            if self.config.writeChi2FilesOuterLoop:
-                return f"astrometry_init-%s_chi2-{dataName}" % whatToFit
+            # TODO DM-12446: turn this into a "butler save" somehow.
+            # Save reference and measurement chi2 contributions for this data
+            if self.config.writeChi2FilesInitialFinal:
+                baseName = f"astrometry_initial_chi2-{dataName}"
             else:
-                return None
-
-        if self.config.writeInitMatrix:
-            dumpMatrixFile = self._getDebugPath(f"astrometry_preinit-{dataName}")
-        else:
-            dumpMatrixFile = ""
-        # The constrained model needs the visit transform fit first; the chip
-        # transform is initialized from the detector's cameraGeom, so it's close.
-        if self.config.astrometryModel == "constrained":
-            fit.minimize("DistortionsVisit", dumpMatrixFile=dumpMatrixFile)
-            self._logChi2AndValidate(associations, fit, model, "Initialize DistortionsVisit",
-                                     writeChi2Name=getChi2Name("DistortionsVisit"))
-            dumpMatrixFile = ""  # so we don't redo the output on the next step
-
-        fit.minimize("Distortions", dumpMatrixFile=dumpMatrixFile)
-        self._logChi2AndValidate(associations, fit, model, "Initialize Distortions",
-                                 writeChi2Name=getChi2Name("Distortions"))
-
-        fit.minimize("Positions")
-        self._logChi2AndValidate(associations, fit, model, "Initialize Positions",
-                                 writeChi2Name=getChi2Name("Positions"))
-
-        fit.minimize("Distortions Positions")
-        self._logChi2AndValidate(associations, fit, model, "Initialize DistortionsPositions",
-                                 writeChi2Name=getChi2Name("DistortionsPositions"))
+                baseName = None
+            hotStarted = self._hot_start(model, "astrometry", solutionFile,
+                                         tangentPoint=associations.getCommonTangentPoint())
+            if self.config.writeInitialModel:
+                fullpath = self._getDebugPath(f"initial_astrometry_model-{dataName}.txt")
+                writeModel(model, fullpath, self.log)
+            self._logChi2AndValidate(associations, fit, model, "Initial", writeChi2Name=baseName)
+
+            def getChi2Name(whatToFit):
+                if self.config.writeChi2FilesOuterLoop:
+                    return f"astrometry_init-%s_chi2-{dataName}" % whatToFit
+                else:
+                    return None
+
+            if self.config.writeInitMatrix:
+                dumpMatrixFile = self._getDebugPath(f"astrometry_preinit-{dataName}")
+            else:
+                dumpMatrixFile = ""
+            # The constrained model needs the visit transform fit first; the chip
+            # transform is initialized from the detector's cameraGeom, so it's close.
+            # Not needed if all the transforms start from a previous solution.
+            if self.config.astrometryModel == "constrained" and not hotStarted:
+                fit.minimize("DistortionsVisit", dumpMatrixFile=dumpMatrixFile)
+                self._logChi2AndValidate(associations, fit, model, "Initialize DistortionsVisit",
+                                         writeChi2Name=getChi2Name("DistortionsVisit"))
+                dumpMatrixFile = ""  # so we don't redo the output on the next step
+
+            fit.minimize("Distortions", dumpMatrixFile=dumpMatrixFile)
+            self._logChi2AndValidate(associations, fit, model, "Initialize Distortions",
+                                     writeChi2Name=getChi2Name("Distortions"))
+
+            fit.minimize("Positions")
+            self._logChi2AndValidate(associations, fit, model, "Initialize Positions",
+                                     writeChi2Name=getChi2Name("Positions"))
+
+            fit.minimize("Distortions Positions")
+            self._logChi2AndValidate(associations, fit, model, "Initialize DistortionsPositions",
+                                     writeChi2Name=getChi2Name("DistortionsPositions"))
 
         chi2 = self._iterate_fit(associations,
                                  fit,
@@ -1589,10 +2235,13 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
                                  "Distortions Positions",
                                  sigmaRelativeTolerance=self.config.astrometryOutlierRelativeTolerance,
                                  doRankUpdate=self.config.astrometryDoRankUpdate,
-                                 dataName=dataName)
+                                 dataName=dataName,
+                                 checkpointFile=checkpointFile)
 
-        add_measurement(self.job, 'jointcal.astrometry_final_chi2', chi2.chi2)
-        add_measurement(self.job, 'jointcal.astrometry_final_ndof', chi2.ndof)
+        self._add_measurement('jointcal.astrometry_final_chi2', chi2.chi2)
+        self._add_measurement('jointcal.astrometry_final_ndof', chi2.ndof)
+        self._compute_covariance(fit, "Distortions Positions")
+        self._write_solution(model, associations, "astrometry", solutionFile)
 
         return Astrometry(fit, model, sky_to_tan_projection)
 
@@ -1609,12 +2258,31 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
                 self.log.warn("ccdImage %s has only %s RefStars (desired %s)",
                               ccdImage.getName(), nRefStars, self.config.minRefStarsPerCcd)
 
+    def _compute_covariance(self, fit, whatToFit):
+        """Compute the parameter covariance of a converged fit, if
+        configured, attaching it to the fitted model and stars.
+
+        Parameters
+        ----------
+        fit : `lsst.jointcal.FitterBase`
+            The fitter to compute the covariance of.
+        whatToFit : `str`
+            The parameters to compute the covariance of; the same as the
+            final fit.
+        """
+        if self.config.covarianceMode == "none":
+            return
+        self.log.info("Computing the %s covariance of %s.", self.config.covarianceMode, whatToFit)
+        fit.computeCovariance(whatToFit, diagonalOnly=(self.config.covarianceMode == "diagonal"))
+
     def _iterate_fit(self, associations, fitter, max_steps, name, whatToFit,
                      dataName="",
                      sigmaRelativeTolerance=0,
                      doRankUpdate=True,
-                     doLineSearch=False):
-        """Run fitter.minimize up to max_steps times, returning the final chi2.
+                     doLineSearch=False,
+                     checkpointFile=""):
+        """Run fitter.iterate to minimize up to max_steps times, returning
+        the final chi2.
 
         Parameters
         ----------
@@ -1628,7 +2296,7 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
         name : {'photometry' or 'astrometry'}
             What type of data are we fitting (for logs and debugging files).
         whatToFit : `str`
-            Passed to ``fitter.minimize()`` to define the parameters to fit.
+            Passed to ``fitter.iterate()`` to define the parameters to fit.
         dataName : `str`, optional
             Descriptive name for this dataset (e.g. tract and filter),
             for debugging.
@@ -1641,6 +2309,10 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
             matrix and gradient?
         doLineSearch : `bool`, optional
             Do a line search for the optimum step during minimization?
+        checkpointFile : `str`, optional
+            File to write checkpoints of the fit to, at the configured
+            ``config.checkpointPoints`` and ``config.checkpointInterval``;
+            empty for none.
 
         Returns
         -------
@@ -1654,76 +2326,50 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
         RuntimeError
             Raised if the fitter fails for some other reason;
             log messages will provide further details.
+        ValueError
+            Raised if the model is not valid.
         """
         if self.config.writeInitMatrix:
             dumpMatrixFile = self._getDebugPath(f"{name}_postinit-{dataName}")
         else:
             dumpMatrixFile = ""
-        oldChi2 = lsst.jointcal.Chi2Statistic()
-        oldChi2.chi2 = float("inf")
-        for i in range(max_steps):
-            if self.config.writeChi2FilesOuterLoop:
-                writeChi2Name = f"{name}_iterate_{i}_chi2-{dataName}"
-            else:
-                writeChi2Name = None
-            result = fitter.minimize(whatToFit,
-                                     self.config.outlierRejectSigma,
-                                     sigmaRelativeTolerance=sigmaRelativeTolerance,
-                                     doRankUpdate=doRankUpdate,
-                                     doLineSearch=doLineSearch,
-                                     dumpMatrixFile=dumpMatrixFile)
-            dumpMatrixFile = ""  # clear it so we don't write the matrix again.
-            chi2 = self._logChi2AndValidate(associations, fitter, fitter.getModel(),
-                                            f"Fit iteration {i}", writeChi2Name=writeChi2Name)
-
-            if result == MinimizeResult.Converged:
-                if doRankUpdate:
-                    self.log.debug("fit has converged - no more outliers - redo minimization "
-                                   "one more time in case we have lost accuracy in rank update.")
-                    # Redo minimization one more time in case we have lost accuracy in rank update
-                    result = fitter.minimize(whatToFit, self.config.outlierRejectSigma,
-                                             sigmaRelativeTolerance=sigmaRelativeTolerance)
-                    chi2 = self._logChi2AndValidate(associations, fitter, fitter.getModel(), "Fit completed")
-
-                # log a message for a large final chi2, TODO: DM-15247 for something better
-                if chi2.chi2/chi2.ndof >= 4.0:
-                    self.log.error("Potentially bad fit: High chi-squared/ndof.")
-
-                break
-            elif result == MinimizeResult.Chi2Increased:
-                self.log.warn("Still some outliers remaining but chi2 increased - retry")
-                # Check whether the increase was large enough to cause trouble.
-                chi2Ratio = chi2.chi2 / oldChi2.chi2
-                if chi2Ratio > 1.5:
-                    self.log.warn('Significant chi2 increase by a factor of %.4g / %.4g = %.4g',
-                                  chi2.chi2, oldChi2.chi2, chi2Ratio)
-                # Based on a variety of HSC jointcal logs (see DM-25779), it
-                # appears that chi2 increases more than a factor of ~2 always
-                # result in the fit diverging rapidly and ending at chi2 > 1e10.
-                # Using 10 as the "failure" threshold gives some room between
-                # leaving a warning and bailing early.
-                if chi2Ratio > 10:
-                    msg = ("Large chi2 increase between steps: fit likely cannot converge."
-                           " Try setting one or more of the `writeChi2*` config fields and looking"
-                           " at how individual star chi2-values evolve during the fit.")
-                    raise RuntimeError(msg)
-                oldChi2 = chi2
-            elif result == MinimizeResult.NonFinite:
-                filename = self._getDebugPath("{}_failure-nonfinite_chi2-{}.csv".format(name, dataName))
-                # TODO DM-12446: turn this into a "butler save" somehow.
-                fitter.saveChi2Contributions(filename+"{type}")
-                msg = "Nonfinite value in chi2 minimization, cannot complete fit. Dumped star tables to: {}"
-                raise FloatingPointError(msg.format(filename))
-            elif result == MinimizeResult.Failed:
-                raise RuntimeError("Chi2 minimization failure, cannot complete fit.")
-            else:
-                raise RuntimeError("Unxepected return code from minimize().")
+        if self.config.writeChi2FilesOuterLoop:
+            chi2BaseName = self._getDebugPath(f"{name}_iterate_{{iteration}}_chi2-{dataName}") + "{type}"
         else:
-            self.log.error("%s failed to converge after %d steps"%(name, max_steps))
+            chi2BaseName = ""
+        if checkpointFile and "initialized" in self.config.checkpointPoints:
+            fitter.writeCheckpoint(checkpointFile)
+        result = fitter.iterate(whatToFit,
+                                self.config.outlierRejectSigma,
+                                max_steps,
+                                sigmaRelativeTolerance=sigmaRelativeTolerance,
+                                doRankUpdate=doRankUpdate,
+                                doLineSearch=doLineSearch,
+                                dumpMatrixFile=dumpMatrixFile,
+                                chi2BaseName=chi2BaseName,
+                                refinementTolerance=self.config.refinementTolerance,
+                                checkpointFile=checkpointFile,
+                                checkpointInterval=self.config.checkpointInterval,
+                                refitOnlyIfInaccurate=self.config.refitOnlyIfInaccurate)
+        chi2 = result.chi2
+        self._check_stars(associations)
+
+        if result.result == MinimizeResult.NonFinite:
+            filename = self._getDebugPath("{}_failure-nonfinite_chi2-{}".format(name, dataName))
+            # TODO DM-12446: turn this into a "butler save" somehow.
+            fitter.saveChi2Contributions(filename+"{type}")
+            msg = "Nonfinite value in chi2 minimization, cannot complete fit. Dumped star tables to: {}"
+            raise FloatingPointError(msg.format(filename))
+        elif result.result == MinimizeResult.Failed:
+            raise RuntimeError("Chi2 minimization failure, cannot complete fit.")
+        if not result.modelValid:
+            raise ValueError("Model is not valid: check log messages for warnings.")
 
+        if checkpointFile and "final" in self.config.checkpointPoints:
+            fitter.writeCheckpoint(checkpointFile)
         return chi2
 
-    def _make_output(self, ccdImageList, model, func):
+    def _make_output(self, ccdImageList, model, func, **kwargs):
         """Return the internal jointcal models converted to the afw
         structures that will be saved to disk.
 
@@ -1735,21 +2381,19 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
             The internal jointcal model to convert for each `lsst.jointcal.CcdImage`.
         func : `str`
             The name of the function to call on ``model`` to get the converted
-            structure. Must accept an `lsst.jointcal.CcdImage`.
+            structures. Must accept an `lsst.jointcal.CcdImageList`, and
+            return a `dict` keyed on (visit, detector).
+        **kwargs
+            Other arguments to pass to ``func``.
 
         Returns
         -------
-        output : `dict` [`tuple`, `lsst.jointcal.AstrometryModel`] or
-                 `dict` [`tuple`, `lsst.jointcal.PhotometryModel`]
+        output : `dict` [`tuple`, `lsst.afw.geom.SkyWcs`] or
+                 `dict` [`tuple`, `lsst.afw.image.PhotoCalib`]
             The data to be saved, keyed on (visit, detector).
         """
-        output = {}
-        for ccdImage in ccdImageList:
-            ccd = ccdImage.ccdId
-            visit = ccdImage.visit
-            self.log.debug("%s for visit: %d, ccd: %d", func, visit, ccd)
-            output[(visit, ccd)] = getattr(model, func)(ccdImage)
-        return output
+        self.log.debug("%s for %d ccdImages", func, len(ccdImageList))
+        return getattr(model, func)(ccdImageList, **kwargs)
 
     def _write_astrometry_results(self, associations, model, visit_ccd_to_dataRef):
         """
@@ -1765,7 +2409,7 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
             Dict of ccdImage identifiers to dataRefs that were fit.
         """
         ccdImageList = associations.getCcdImageList()
-        output = self._make_output(ccdImageList, model, "makeSkyWcs")
+        output = self._make_output(ccdImageList, model, "makeSkyWcsMap", nThreads=self.config.outputThreads)
         for key, skyWcs in output.items():
             dataRef = visit_ccd_to_dataRef[key]
             try:
@@ -1789,7 +2433,7 @@ class JointcalTask(pipeBase.PipelineTask, pipeBase.CmdLineTask):
         """
 
         ccdImageList = associations.getCcdImageList()
-        output = self._make_output(ccdImageList, model, "toPhotoCalib")
+        output = self._make_output(ccdImageList, model, "toPhotoCalibMap")
         for key, photoCalib in output.items():
             dataRef = visit_ccd_to_dataRef[key]
             try:
@@ -0,0 +1,83 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
+
+#include <memory>
+#include <vector>
+
+#include "lsst/jointcal/AstrometryTransform.h"
+#include "lsst/jointcal/BaseStar.h"
+#include "lsst/jointcal/ListMatch.h"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace lsst {
+namespace jointcal {
+namespace {
+
+void declareMatchConditions(py::module &mod) {
+    py::class_<MatchConditions, std::shared_ptr<MatchConditions>> cls(mod, "MatchConditions");
+
+    cls.def(py::init<>());
+
+    cls.def_readwrite("nStarsList1", &MatchConditions::nStarsList1);
+    cls.def_readwrite("nStarsList2", &MatchConditions::nStarsList2);
+    cls.def_readwrite("maxTrialCount", &MatchConditions::maxTrialCount);
+    cls.def_readwrite("nSigmas", &MatchConditions::nSigmas);
+    cls.def_readwrite("maxShiftX", &MatchConditions::maxShiftX);
+    cls.def_readwrite("maxShiftY", &MatchConditions::maxShiftY);
+    cls.def_readwrite("sizeRatio", &MatchConditions::sizeRatio);
+    cls.def_readwrite("deltaSizeRatio", &MatchConditions::deltaSizeRatio);
+    cls.def_readwrite("minMatchRatio", &MatchConditions::minMatchRatio);
+    cls.def_readwrite("printLevel", &MatchConditions::printLevel);
+    cls.def_readwrite("algorithm", &MatchConditions::algorithm);
+    cls.def_readwrite("nTriangleNeighbours", &MatchConditions::nTriangleNeighbours);
+}
+
+void declareListMatch(py::module &mod) {
+    // BaseStarList is not bound: take python lists of stars, and return None if no transform was found.
+    mod.def("listMatchCombinatorial",
+            [](std::vector<std::shared_ptr<BaseStar>> const &stars1,
+               std::vector<std::shared_ptr<BaseStar>> const &stars2, MatchConditions const &conditions) {
+                BaseStarList list1, list2;
+                list1.insert(list1.end(), stars1.begin(), stars1.end());
+                list2.insert(list2.end(), stars2.begin(), stars2.end());
+                return std::shared_ptr<AstrometryTransform>(listMatchCombinatorial(list1, list2, conditions));
+            },
+            "list1"_a, "list2"_a, "conditions"_a = MatchConditions(),
+            py::call_guard<py::gil_scoped_release>());
+}
+
+PYBIND11_MODULE(listMatch, mod) {
+    py::module::import("lsst.jointcal.astrometryTransform");
+    py::module::import("lsst.jointcal.star");
+    declareMatchConditions(mod);
+    declareListMatch(mod);
+}
+}  // namespace
+}  // namespace jointcal
+}  // namespace lsst
@@ -44,6 +44,12 @@ namespace lsst {
 namespace jointcal {
 namespace {
 
+// The parameters of each transform of a model, keyed on (visit, ccd), which Python can hash.
+using PyMappingParameters = std::map<std::pair<VisitIdType, CcdIdType>, Eigen::VectorXd>;
+
+// The keys of transforms of a model, as (visit, ccd).
+using PyMappingKeys = std::vector<std::pair<VisitIdType, CcdIdType>>;
+
 void declarePhotometryModel(py::module &mod) {
     py::class_<PhotometryModel, std::shared_ptr<PhotometryModel>> cls(mod, "PhotometryModel");
 
@@ -51,6 +57,28 @@ void declarePhotometryModel(py::module &mod) {
     cls.def("freezeErrorTransform", &PhotometryModel::freezeErrorTransform);
 
     cls.def("offsetParams", &PhotometryModel::offsetParams);
+    cls.def("getParameters", &PhotometryModel::getParameters);
+    cls.def("setParameters", &PhotometryModel::setParameters, "parameters"_a);
+    cls.def("getMappingParameters", [](PhotometryModel const &self) {
+        PyMappingParameters result;
+        for (auto const &i : self.getMappingParameters()) {
+            result.emplace(std::make_pair(i.first.visit, i.first.ccd), i.second);
+        }
+        return result;
+    });
+    cls.def("setMappingParameters", [](PhotometryModel &self, PyMappingParameters const &parameters) {
+        PhotometryModel::MappingParameters mappingParameters;
+        for (auto const &i : parameters) {
+            mappingParameters.emplace(CcdImageKey{i.first.first, i.first.second}, i.second);
+        }
+        return self.setMappingParameters(mappingParameters);
+    }, "parameters"_a);
+    cls.def("fixMappings", [](PhotometryModel &self, PyMappingKeys const &keys) {
+        std::vector<CcdImageKey> ccdImageKeys;
+        for (auto const &key : keys) ccdImageKeys.push_back(CcdImageKey{key.first, key.second});
+        return self.fixMappings(ccdImageKeys);
+    }, "keys"_a);
+    cls.def("releaseMappings", &PhotometryModel::releaseMappings);
     cls.def("offsetFittedStar", &PhotometryModel::offsetFittedStar);
 
     cls.def("transform", &PhotometryModel::transform);
@@ -62,6 +90,10 @@ void declarePhotometryModel(py::module &mod) {
 
     cls.def("checkPositiveOnBBox", &PhotometryModel::checkPositiveOnBBox);
     cls.def("validate", &PhotometryModel::validate);
+    cls.def("setCovariance", &PhotometryModel::setCovariance, "ccdImage"_a, "covariance"_a);
+    cls.def("getCovariance", &PhotometryModel::getCovariance, "ccdImage"_a);
+    cls.def("getInstrumentation", &PhotometryModel::getInstrumentation);
+    cls.def("resetInstrumentation", &PhotometryModel::resetInstrumentation);
 
     cls.def("getMappingIndices", &PhotometryModel::getMappingIndices);
     cls.def("computeParameterDerivatives",
@@ -73,6 +105,22 @@ void declarePhotometryModel(py::module &mod) {
 
     cls.def("getNpar", &PhotometryModel::getNpar);
     cls.def("toPhotoCalib", &PhotometryModel::toPhotoCalib);
+    cls.def(
+            "toPhotoCalibMap",
+            [](PhotometryModel const &self, CcdImageList const &ccdImageList) {
+                std::unordered_map<CcdImageKey, std::shared_ptr<afw::image::PhotoCalib>> photoCalibMap;
+                {
+                    py::gil_scoped_release release;
+                    photoCalibMap = self.toPhotoCalibMap(ccdImageList);
+                }
+                // Key on (visit, ccd), which Python can hash.
+                std::map<std::pair<VisitIdType, CcdIdType>, std::shared_ptr<afw::image::PhotoCalib>> result;
+                for (auto const &i : photoCalibMap) {
+                    result.emplace(std::make_pair(i.first.visit, i.first.ccd), i.second);
+                }
+                return result;
+            },
+            "ccdImageList"_a);
     cls.def("getMapping", &PhotometryModel::getMapping, py::return_value_policy::reference_internal);
     cls.def("getTotalParameters", &PhotometryModel::getTotalParameters);
 
@@ -106,20 +154,25 @@ void declareSimpleMagnitudeModel(py::module &mod) {
 void declareConstrainedPhotometryModel(py::module &mod) {
     py::class_<ConstrainedPhotometryModel, std::shared_ptr<ConstrainedPhotometryModel>, PhotometryModel> cls(
             mod, "ConstrainedPhotometryModel");
+    cls.def("makeBasisCache", &ConstrainedPhotometryModel::makeBasisCache, "ccdImageList"_a, "maxBytes"_a);
+    cls.def("clearBasisCache", &ConstrainedPhotometryModel::clearBasisCache);
+    cls.def("getBasisCacheSize", &ConstrainedPhotometryModel::getBasisCacheSize);
     cls.def("__str__", [](ConstrainedPhotometryModel const &self) { return "ConstrainedPhotometryModel"; });
 }
 
 void declareConstrainedFluxModel(py::module &mod) {
-    py::class_<ConstrainedFluxModel, std::shared_ptr<ConstrainedFluxModel>, PhotometryModel> cls(
-            mod, "ConstrainedFluxModel");
+    py::class_<ConstrainedFluxModel, std::shared_ptr<ConstrainedFluxModel>, ConstrainedPhotometryModel,
+               PhotometryModel>
+            cls(mod, "ConstrainedFluxModel");
     cls.def(py::init<CcdImageList const &, lsst::geom::Box2D const &, int, double>(), "CcdImageList"_a,
             "bbox"_a, "visitOrder"_a = 7, "errorPedestal"_a = 0);
     cls.def("__str__", [](ConstrainedFluxModel const &self) { return "ConstrainedFluxModel"; });
 }
 
 void declareConstrainedMagnitudeModel(py::module &mod) {
-    py::class_<ConstrainedMagnitudeModel, std::shared_ptr<ConstrainedMagnitudeModel>, PhotometryModel> cls(
-            mod, "ConstrainedMagnitudeModel");
+    py::class_<ConstrainedMagnitudeModel, std::shared_ptr<ConstrainedMagnitudeModel>,
+               ConstrainedPhotometryModel, PhotometryModel>
+            cls(mod, "ConstrainedMagnitudeModel");
     cls.def(py::init<CcdImageList const &, lsst::geom::Box2D const &, int, double>(), "CcdImageList"_a,
             "bbox"_a, "visitOrder"_a = 7, "errorPedestal"_a = 0);
     cls.def("__str__", [](ConstrainedMagnitudeModel const &self) { return "ConstrainedMagnitudeModel"; });
@@ -129,6 +182,7 @@ PYBIND11_MODULE(photometryModels, mod) {
     py::module::import("lsst.jointcal.ccdImage");
     py::module::import("lsst.jointcal.photometryTransform");
     py::module::import("lsst.jointcal.star");
+    py::module::import("lsst.jointcal.instrumentation");
     declarePhotometryModel(mod);
     declareSimplePhotometryModel(mod);
     declareSimpleFluxModel(mod);
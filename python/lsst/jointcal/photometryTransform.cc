@@ -53,6 +53,7 @@ void declarePhotometryTransform(py::module &mod) {
     cls.def("clone", &PhotometryTransform::clone);
     cls.def("getNpar", &PhotometryTransform::getNpar);
     cls.def("getParameters", &PhotometryTransform::getParameters);
+    cls.def("setParameters", &PhotometryTransform::setParameters, "parameters"_a);
     cls.def("computeParameterDerivatives",
             [](PhotometryTransform const &self, double x, double y, double instFlux) {
                 Eigen::VectorXd derivatives(self.getNpar());
@@ -98,6 +99,11 @@ void declarePhotometryTransformChebyshev(py::module &mod) {
     cls.def("integrate",
             py::overload_cast<geom::Box2D const &>(&PhotometryTransformChebyshev::integrate, py::const_),
             "box"_a);
+    using ArrayRef = Eigen::Ref<Eigen::ArrayXd const>;
+    cls.def("computeChebyshev",
+            py::overload_cast<ArrayRef const &, ArrayRef const &>(
+                    &PhotometryTransformChebyshev::computeChebyshev, py::const_),
+            "x"_a, "y"_a);
 }
 
 void declareFluxTransformChebyshev(py::module &mod) {
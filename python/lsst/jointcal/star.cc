@@ -32,6 +32,7 @@
 #include "lsst/jointcal/Point.h"
 #include "lsst/jointcal/FatPoint.h"
 #include "lsst/jointcal/BaseStar.h"
+#include "lsst/jointcal/CcdImage.h"
 #include "lsst/jointcal/FittedStar.h"
 #include "lsst/jointcal/MeasuredStar.h"
 #include "lsst/jointcal/RefStar.h"
@@ -91,6 +92,9 @@ void declareFittedStar(py::module &mod) {
 
     cls.def(py::init<>());
     cls.def(py::init<BaseStar const &>(), "baseStar"_a);
+
+    cls.def("isFixed", &FittedStar::isFixed);
+    cls.def("setFixed", &FittedStar::setFixed, "fixed"_a);
 }
 
 void declareMeasuredStar(py::module &mod) {
@@ -101,6 +105,7 @@ void declareMeasuredStar(py::module &mod) {
 
     cls.def("getFittedStar", &MeasuredStar::getFittedStar);
     cls.def("setFittedStar", &MeasuredStar::setFittedStar);
+    cls.def("getCcdImage", &MeasuredStar::getCcdImage, py::return_value_policy::reference);
 
     cls.def("getInstFlux", &MeasuredStar::getInstFlux);
     cls.def("setInstFluxAndErr", &MeasuredStar::setInstFluxAndErr);
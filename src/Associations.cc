@@ -26,6 +26,7 @@
 #include <iostream>
 #include <limits>
 #include <sstream>
+#include <unordered_map>
 
 #include "lsst/log/Log.h"
 #include "lsst/jointcal/Associations.h"
@@ -54,6 +55,9 @@ namespace jointcal = lsst::jointcal;
 
 namespace {
 LOG_LOGGER _log = LOG_GET("jointcal.Associations");
+
+// ra, dec, vx, vy, vxy, flux, fluxErr, mag, magErr: see Associations::getFittedStarArray().
+Eigen::Index const nFittedStarColumns = 9;
 }
 
 namespace lsst {
@@ -68,7 +72,20 @@ void Associations::createCcdImage(afw::table::SourceCatalog &catalog,
                                   lsst::jointcal::JointcalControl const &control) {
     auto ccdImage = std::make_shared<CcdImage>(catalog, wcs, visitInfo, bbox, filter, photoCalib, detector,
                                                visit, ccd, control.sourceFluxField);
+    if (_fitCatalogArena != nullptr) ccdImage->setFitCatalogArena(_fitCatalogArena);
     ccdImageList.push_back(ccdImage);
+    _snapshot.reset();
+}
+
+void Associations::setFitCatalogStorage(std::string const &directory) {
+    _fitCatalogArena = directory.empty() ? nullptr : std::make_shared<MappedArena>(directory);
+    for (auto &ccdImage : ccdImageList) ccdImage->setFitCatalogArena(_fitCatalogArena);
+}
+
+std::size_t Associations::getFitCatalogHeapSize() const {
+    std::size_t size = 0;
+    for (auto const &ccdImage : ccdImageList) size += ccdImage->getCatalogHeapSize();
+    return size;
 }
 
 void Associations::computeCommonTangentPoint() {
@@ -84,7 +101,26 @@ void Associations::computeCommonTangentPoint() {
 
 void Associations::setCommonTangentPoint(lsst::geom::Point2D const &commonTangentPoint) {
     _commonTangentPoint = Point(commonTangentPoint.getX(), commonTangentPoint.getY());  // a jointcal::Point
+    _snapshot.reset();
     for (auto &ccdImage : ccdImageList) ccdImage->setCommonTangentPoint(_commonTangentPoint);
+    if (_wcsSurrogateMaxError <= 0) return;
+
+    Instrumentation::Timer timer(_instrumentation, "wcsSurrogates");
+    std::size_t nExact = 0;
+    for (auto &ccdImage : ccdImageList) {
+        std::size_t order = ccdImage->useWcsSurrogate(_wcsSurrogateMaxError / 3600., _wcsSurrogateMaxOrder);
+        if (order == 0) {
+            nExact++;
+        } else {
+            timer.addCounter("order" + std::to_string(order), 1);
+        }
+    }
+    timer.addCounter("exact", nExact);
+    if (nExact > 0) {
+        LOGLS_WARN(_log, nExact << " of " << ccdImageList.size()
+                                << " ccdImages have no polynomial WCS surrogate within "
+                                << _wcsSurrogateMaxError << " arcsec; using their exact WCS.");
+    }
 }
 
 lsst::sphgeom::Circle Associations::computeBoundingCircle() const {
@@ -118,6 +154,20 @@ lsst::sphgeom::Circle Associations::computeBoundingCircle() const {
 
 void Associations::associateCatalogs(const double matchCutInArcSec, const bool useFittedList,
                                      const bool enlargeFittedList) {
+    Instrumentation::Timer timer(_instrumentation, "associateCatalogs");
+    // Only a from-scratch association can be recorded or restored.
+    bool const canReuse = _reuseAssociation && !useFittedList && enlargeFittedList;
+    if (canReuse && _snapshot != nullptr && _snapshot->matchCutInArcsec == matchCutInArcSec) {
+        restoreAssociation();
+        LOGLS_INFO(_log, "Restored the association of " << fittedStarList.size() << " fitted stars");
+        timer.addCounter("restored", 1);
+        timer.addCounter("ccdImages", ccdImageList.size());
+        timer.addCounter("fittedStars", fittedStarList.size());
+        timer.addCounter("fitCatalogMappedBytes", getFitCatalogMappedSize());
+        timer.addCounter("fitCatalogHeapBytes", getFitCatalogHeapSize());
+        return;
+    }
+
     // clear reference stars
     refStarList.clear();
 
@@ -126,7 +176,10 @@ void Associations::associateCatalogs(const double matchCutInArcSec, const bool u
         item->clearBeforeAssoc();
     }
     // clear fitted stars
-    if (!useFittedList) fittedStarList.clear();
+    if (!useFittedList) {
+        fittedStarList.clear();
+        fittedStarList.inTangentPlaneCoordinates = true;
+    }
 
     for (auto &ccdImage : ccdImageList) {
         std::shared_ptr<AstrometryTransform> toCommonTangentPlane = ccdImage->getPixelToCommonTangentPlane();
@@ -174,6 +227,7 @@ void Associations::associateCatalogs(const double matchCutInArcSec, const bool u
             matchedCount++;
         }
         LOGLS_INFO(_log, "Matched " << matchedCount << " objects in " << ccdImage->getName());
+        timer.addCounter("matched", matchedCount);
 
         // add unmatched objets to FittedStarList
         int unMatchedCount = 0;
@@ -190,7 +244,13 @@ void Associations::associateCatalogs(const double matchCutInArcSec, const bool u
             unMatchedCount++;
         }
         LOGLS_INFO(_log, "Unmatched objects: " << unMatchedCount);
+        timer.addCounter("unmatched", unMatchedCount);
     }  // end of loop on CcdImages
+    timer.addCounter("ccdImages", ccdImageList.size());
+    timer.addCounter("fittedStars", fittedStarList.size());
+    timer.addCounter("fitCatalogMappedBytes", getFitCatalogMappedSize());
+    timer.addCounter("fitCatalogHeapBytes", getFitCatalogHeapSize());
+    if (canReuse) snapshotAssociation(matchCutInArcSec);
 
     // !!!!!!!!!!!!!!!!!
     // TODO: DO WE REALLY NEED THIS???
@@ -200,9 +260,71 @@ void Associations::associateCatalogs(const double matchCutInArcSec, const bool u
     // assignMags();
 }
 
+void Associations::snapshotAssociation(double matchCutInArcsec) {
+    auto snapshot = std::make_unique<AssociationSnapshot>();
+    snapshot->matchCutInArcsec = matchCutInArcsec;
+    std::unordered_map<FittedStar const *, std::size_t> indices;
+    snapshot->fittedStars.reserve(fittedStarList.size());
+    for (auto const &fittedStar : fittedStarList) {
+        indices[fittedStar.get()] = snapshot->fittedStars.size();
+        snapshot->fittedStars.push_back(std::make_shared<FittedStar const>(*fittedStar));
+    }
+    snapshot->fittedStarIndices.reserve(ccdImageList.size());
+    for (auto const &ccdImage : ccdImageList) {
+        snapshot->fittedStarIndices.emplace_back();
+        auto &ccdIndices = snapshot->fittedStarIndices.back();
+        ccdIndices.reserve(ccdImage->getCatalogForFit().size());
+        for (auto const &measuredStar : ccdImage->getCatalogForFit()) {
+            ccdIndices.push_back(indices.at(measuredStar->getFittedStar().get()));
+        }
+    }
+    _snapshot = std::move(snapshot);
+}
+
+std::shared_ptr<Associations> Associations::createFitView() const {
+    if (_snapshot == nullptr) {
+        throw LSST_EXCEPT(pex::exceptions::LogicError,
+                          "No association to view: call setReuseAssociation(true) and associateCatalogs().");
+    }
+    auto view = std::make_shared<Associations>(CcdImageList(), _epoch);
+    for (auto const &ccdImage : ccdImageList) view->ccdImageList.push_back(ccdImage->makeFitView());
+    view->_commonTangentPoint = _commonTangentPoint;
+    view->_wcsSurrogateMaxError = _wcsSurrogateMaxError;
+    view->_wcsSurrogateMaxOrder = _wcsSurrogateMaxOrder;
+    view->_reuseAssociation = true;
+    view->_snapshot = _snapshot;
+    return view;
+}
+
+void Associations::restoreAssociation() {
+    refStarList.clear();
+    fittedStarList.clear();
+    // The snapshot was taken before any fit deprojected the fitted stars.
+    fittedStarList.inTangentPlaneCoordinates = true;
+    std::vector<std::shared_ptr<FittedStar>> fittedStars;
+    fittedStars.reserve(_snapshot->fittedStars.size());
+    for (auto const &fittedStar : _snapshot->fittedStars) {
+        fittedStars.push_back(std::make_shared<FittedStar>(*fittedStar));
+        // setFittedStar() below counts the measurements again.
+        fittedStars.back()->getMeasurementCount() = 0;
+        fittedStarList.push_back(fittedStars.back());
+    }
+    auto ccdIndices = _snapshot->fittedStarIndices.begin();
+    for (auto &ccdImage : ccdImageList) {
+        ccdImage->resetCatalogForFit();
+        auto index = ccdIndices->begin();
+        for (auto &measuredStar : ccdImage->getCatalogForFit()) {
+            measuredStar->setFittedStar(fittedStars[*index]);
+            ++index;
+        }
+        ++ccdIndices;
+    }
+}
+
 void Associations::collectRefStars(afw::table::SimpleCatalog &refCat, geom::Angle matchCut,
                                    std::string const &fluxField, float refCoordinateErr,
                                    bool rejectBadFluxes) {
+    Instrumentation::Timer timer(_instrumentation, "collectRefStars");
     if (refCat.size() == 0) {
         throw(LSST_EXCEPT(pex::exceptions::InvalidParameterError,
                           " reference catalog is empty : stop here "));
@@ -305,12 +427,20 @@ void Associations::collectRefStars(afw::table::SimpleCatalog &refCat, geom::Angl
     TanRaDecToPixel raDecToCommonTangentPlane(identity, _commonTangentPoint);
 
     associateRefStars(matchCut.asArcseconds(), &raDecToCommonTangentPlane);
+    timer.addCounter("refCatSize", refCat.size());
+    timer.addCounter("refStars", refStarList.size());
+    timer.addCounter("fittedStarsWithRefStar", nFittedStarsWithAssociatedRefStar());
 }
 
 void Associations::associateRefStars(double matchCutInArcSec, const AstrometryTransform *transform) {
-    // associate with FittedStars
+    // associate with FittedStars, except the fixed ones: their previous fit already used the reference
+    // catalog.
+    FittedStarList toMatch;
+    for (auto const &fittedStar : fittedStarList) {
+        if (!fittedStar->isFixed()) toMatch.push_back(fittedStar);
+    }
     // 3600 because coordinates are in degrees (in CTP).
-    auto starMatchList = listMatchCollect(Ref2Base(refStarList), Fitted2Base(fittedStarList), transform,
+    auto starMatchList = listMatchCollect(Ref2Base(refStarList), Fitted2Base(toMatch), transform,
                                           matchCutInArcSec / 3600.);
 
     LOGLS_DEBUG(_log, "Refcat matches before removing ambiguities " << starMatchList->size());
@@ -359,8 +489,9 @@ void Associations::selectFittedStars(int minMeasurements) {
             }
 
             // keep FittedStars which either have a minimum number of
-            // measurements, or are matched to a RefStar
-            if (!fittedStar->getRefStar() && fittedStar->getMeasurementCount() < minMeasurements) {
+            // measurements, or are matched to a RefStar, or are fixed
+            if (!fittedStar->getRefStar() && !fittedStar->isFixed() &&
+                fittedStar->getMeasurementCount() < minMeasurements) {
                 fittedStar->getMeasurementCount()--;
                 mi = catalog.erase(mi);  // mi now points to the next measuredStar.
             } else {
@@ -384,8 +515,9 @@ void Associations::selectFittedStars(int minMeasurements) {
 }
 
 void Associations::normalizeFittedStars() {
-    // Clear positions in order to take the average of the measuredStars.
+    // Clear positions in order to take the average of the measuredStars; fixed stars keep theirs.
     for (auto &fittedStar : fittedStarList) {
+        if (fittedStar->isFixed()) continue;
         fittedStar->x = 0.0;
         fittedStar->y = 0.0;
         fittedStar->setFlux(0.0);
@@ -402,6 +534,7 @@ void Associations::normalizeFittedStars() {
                 throw(LSST_EXCEPT(
                         pex::exceptions::RuntimeError,
                         "All measuredStars must have a fittedStar: did you call selectFittedStars()?"));
+            if (fittedStar->isFixed()) continue;
             auto point = toCommonTangentPlane->apply(*mi);
             fittedStar->x += point.x;
             fittedStar->y += point.y;
@@ -413,6 +546,7 @@ void Associations::normalizeFittedStars() {
     for (auto &fi : fittedStarList) {
         auto measurementCount = fi->getMeasurementCount();
         _maxMeasuredStars += measurementCount;
+        if (fi->isFixed()) continue;
         fi->x /= measurementCount;
         fi->y /= measurementCount;
         fi->getFlux() /= measurementCount;
@@ -464,6 +598,48 @@ void Associations::deprojectFittedStars() {
     fittedStarList.inTangentPlaneCoordinates = false;
 }
 
+Eigen::MatrixXd Associations::getFittedStarArray(bool includeFixed) const {
+    TanPixelToRaDec ctp2Sky(AstrometryTransformLinear(), getCommonTangentPoint());
+    Eigen::MatrixXd stars(fittedStarList.size(), nFittedStarColumns);
+    Eigen::Index row = 0;
+    for (auto const &fittedStar : fittedStarList) {
+        if (!includeFixed && fittedStar->isFixed()) continue;
+        FatPoint onSky = *fittedStar;
+        if (fittedStarList.inTangentPlaneCoordinates) ctp2Sky.transformPosAndErrors(*fittedStar, onSky);
+        stars.row(row++) << onSky.x, onSky.y, onSky.vx, onSky.vy, onSky.vxy, fittedStar->getFlux(),
+                fittedStar->getFluxErr(), fittedStar->getMag(), fittedStar->getMagErr();
+    }
+    stars.conservativeResize(row, Eigen::NoChange);
+    return stars;
+}
+
+void Associations::setFixedFittedStars(Eigen::MatrixXd const &stars) {
+    if (stars.cols() != nFittedStarColumns) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          "Fixed FittedStars need " + std::to_string(nFittedStarColumns) + " columns, not " +
+                                  std::to_string(stars.cols()));
+    }
+    if (std::isnan(_commonTangentPoint.x)) {
+        throw LSST_EXCEPT(pex::exceptions::LogicError,
+                          "Set the common tangent point before adding fixed FittedStars.");
+    }
+    TanRaDecToPixel sky2Ctp(AstrometryTransformLinear(), getCommonTangentPoint());
+    fittedStarList.clear();
+    fittedStarList.inTangentPlaneCoordinates = true;
+    for (Eigen::Index i = 0; i < stars.rows(); ++i) {
+        FatPoint onSky(stars(i, 0), stars(i, 1), stars(i, 2), stars(i, 3), stars(i, 4));
+        auto fittedStar = std::make_shared<FittedStar>();
+        sky2Ctp.transformPosAndErrors(onSky, *fittedStar);
+        fittedStar->setFlux(stars(i, 5));
+        fittedStar->setFluxErr(stars(i, 6));
+        fittedStar->getMag() = stars(i, 7);
+        fittedStar->setMagErr(stars(i, 8));
+        fittedStar->setFixed(true);
+        fittedStarList.push_back(std::move(fittedStar));
+    }
+    LOGLS_INFO(_log, "Added " << fittedStarList.size() << " fixed fitted stars");
+}
+
 int Associations::nCcdImagesValidForFit() const {
     return std::count_if(ccdImageList.begin(), ccdImageList.end(), [](std::shared_ptr<CcdImage> const &item) {
         return item->getCatalogForFit().size() > 0;
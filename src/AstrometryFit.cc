@@ -34,6 +34,7 @@
 #include "lsst/jointcal/AstrometryFit.h"
 #include "lsst/jointcal/Associations.h"
 #include "lsst/jointcal/Chi2.h"
+#include "lsst/jointcal/ColumnTable.h"
 #include "lsst/jointcal/Eigenstuff.h"
 #include "lsst/jointcal/FitterBase.h"
 #include "lsst/jointcal/AstrometryMapping.h"
@@ -91,12 +92,9 @@ Point AstrometryFit::transformFittedStar(FittedStar const &fittedStar, Astrometr
   certainly have to upgrade it. MeasuredStar provides the mag in case
   we need it.  */
 static void tweakAstromMeasurementErrors(FatPoint &P, MeasuredStar const &Ms, double error) {
-    static bool called = false;
-    static double increment = 0;
-    if (!called) {
-        increment = std::pow(error, 2);  // was in Preferences
-        called = true;
-    }
+    // Computed at each call: caching it in a static would tie every fit in the process to the first
+    // error it saw, and would not be thread safe.
+    double increment = std::pow(error, 2);  // was in Preferences
     P.vx += increment;
     P.vy += increment;
 }
@@ -185,7 +183,12 @@ void AstrometryFit::leastSquareDerivativesMeasurement(CcdImage const &ccdImage,
         Point fittedStarInTP = transformFittedStar(*fs, *sky2TP, deltaYears);
 
         // compute derivative of TP position w.r.t sky position ....
-        if (npar_pos > 0)  // ... if actually fitting FittedStar position
+        if (npar_pos > 0 && fs->isFixed()) {
+            // A fixed FittedStar has no parameters: leave its derivatives at 0, and skip them below.
+            indices[npar_mapping] = -1;
+            indices.at(npar_mapping + 1) = -1;
+            ipar += npar_pos;
+        } else if (npar_pos > 0)  // ... if actually fitting FittedStar position
         {
             sky2TP->computeDerivative(*fs, dypdy, 1e-3);
             // sign checked
@@ -220,6 +223,7 @@ void AstrometryFit::leastSquareDerivativesMeasurement(CcdImage const &ccdImage,
         grad = HW * res;
         // now feed in triplets and fullGrad
         for (std::size_t ipar = 0; ipar < npar_tot; ++ipar) {
+            if (indices[ipar] < 0) continue;
             for (std::size_t ic = 0; ic < 2; ++ic) {
                 double val = halpha(ipar, ic);
                 if (val == 0) continue;
@@ -407,7 +411,7 @@ void AstrometryFit::getIndicesOfMeasuredStar(MeasuredStar const &measuredStar, I
     }
     std::shared_ptr<FittedStar const> const fs = measuredStar.getFittedStar();
     Eigen::Index fsIndex = fs->getIndexInMatrix();
-    if (_fittingPos) {
+    if (_fittingPos && !fs->isFixed()) {
         indices.push_back(fsIndex);
         indices.push_back(fsIndex + 1);
     }
@@ -419,6 +423,31 @@ void AstrometryFit::getIndicesOfMeasuredStar(MeasuredStar const &measuredStar, I
        able to remove more than 1 star at a time. */
 }
 
+void AstrometryFit::getIndicesOfCcdImage(CcdImage const &ccdImage, IndexVector &indices) const {
+    if (_fittingDistortions) {
+        _astrometryModel->getMapping(ccdImage)->getMappingIndices(indices);
+    }
+}
+
+void AstrometryFit::assignCovariance(SparseMatrixD const &covariance) {
+    if (_fittingDistortions) {
+        for (auto const &ccdImage : _associations->getCcdImageList()) {
+            IndexVector indices;
+            getIndicesOfCcdImage(*ccdImage, indices);
+            _astrometryModel->setCovariance(*ccdImage, getCovarianceBlock(covariance, indices));
+        }
+    }
+    if (_fittingPos) {
+        for (auto const &fittedStar : _associations->fittedStarList) {
+            if (fittedStar->isFixed()) continue;
+            Eigen::Index index = fittedStar->getIndexInMatrix();
+            fittedStar->vx = covariance.coeff(index, index);
+            fittedStar->vy = covariance.coeff(index + 1, index + 1);
+            fittedStar->vxy = covariance.coeff(index + 1, index);
+        }
+    }
+}
+
 void AstrometryFit::assignIndices(std::string const &whatToFit) {
     _whatToFit = whatToFit;
     LOGLS_INFO(_log, "assignIndices: Now fitting " << whatToFit);
@@ -438,6 +467,11 @@ void AstrometryFit::assignIndices(std::string const &whatToFit) {
             // - when filling the derivatives
             // - when updating (offsetParams())
             // - in GetMeasuredStarIndices
+            // Fixed stars have no parameters.
+            if (fittedStar->isFixed()) {
+                fittedStar->setIndexInMatrix(-1);
+                continue;
+            }
             fittedStar->setIndexInMatrix(ipar);
             ipar += 2;
             // TODO: left as reference for when we implement PM fitting
@@ -446,6 +480,8 @@ void AstrometryFit::assignIndices(std::string const &whatToFit) {
     }
     _nStarParams = ipar - _nModelParams;
     _nTotal = ipar;
+    // Each FittedStar only couples to itself and to the mappings, so the stars can be eliminated.
+    _useBlockSolver = _fittingDistortions && _fittingPos;
     LOGLS_DEBUG(_log, "nParameters total: " << _nTotal << " model: " << _nModelParams
                                             << " values: " << _nStarParams);
 }
@@ -461,6 +497,7 @@ void AstrometryFit::offsetParams(Eigen::VectorXd const &delta) {
         FittedStarList &fittedStarList = _associations->fittedStarList;
         for (auto const &i : fittedStarList) {
             FittedStar &fs = *i;
+            if (fs.isFixed()) continue;
             // the parameter layout here is used also
             // - when filling the derivatives
             // - when assigning indices (assignIndices())
@@ -493,96 +530,100 @@ void AstrometryFit::checkStuff() {
 }
 
 void AstrometryFit::saveChi2MeasContributions(std::string const &filename) const {
-    std::ofstream ofile(filename.c_str());
-    std::string separator = "\t";
-
-    ofile << "#id" << separator << "xccd" << separator << "yccd " << separator;
-    ofile << "rx" << separator << "ry" << separator;
-    ofile << "xtp" << separator << "ytp" << separator;
-    ofile << "mag" << separator << "deltaYears" << separator;
-    ofile << "xErr" << separator << "yErr" << separator << "xyCov" << separator;
-    ofile << "xtpi" << separator << "ytpi" << separator;
-    ofile << "rxi" << separator << "ryi" << separator;
-    ofile << "fsindex" << separator;
-    ofile << "ra" << separator << "dec" << separator;
-    ofile << "chi2" << separator << "nm" << separator;
-    ofile << "chip" << separator << "visit" << std::endl;
-
-    ofile << "#id in source catalog" << separator << "coordinates in CCD (pixels)" << separator << separator;
-    ofile << "residual on TP (degrees)" << separator << separator;
-    ofile << "transformed coordinate in TP (degrees)" << separator << separator;
-    ofile << "rough magnitude" << separator << "Julian epoch year delta from fit epoch" << separator;
-    ofile << "transformed measurement uncertainty (degrees)" << separator << separator << separator;
-    ofile << "as-read position on TP (degrees)" << separator << separator;
-    ofile << "as-read residual on TP (degrees)" << separator << separator;
-    ofile << "unique index of the fittedStar" << separator;
-    ofile << "on sky position of fittedStar" << separator << separator;
-    ofile << "contribution to Chi2 (2D dofs)" << separator << "number of measurements of this fittedStar"
-          << separator;
-    ofile << "chip id" << separator << "visit id" << std::endl;
+    ColumnTable table;
+    auto &id = table.addIntColumn("id", "id in source catalog");
+    auto &xccd = table.addFloatColumn("xccd", "x coordinate in CCD (pixels)");
+    auto &yccd = table.addFloatColumn("yccd", "y coordinate in CCD (pixels)");
+    auto &rx = table.addFloatColumn("rx", "x residual on TP (degrees)");
+    auto &ry = table.addFloatColumn("ry", "y residual on TP (degrees)");
+    auto &xtp = table.addFloatColumn("xtp", "transformed x coordinate in TP (degrees)");
+    auto &ytp = table.addFloatColumn("ytp", "transformed y coordinate in TP (degrees)");
+    auto &mag = table.addFloatColumn("mag", "rough magnitude");
+    auto &deltaYears = table.addFloatColumn("deltaYears", "Julian epoch year delta from fit epoch");
+    auto &xErr = table.addFloatColumn("xErr", "transformed measurement x variance (degrees^2)");
+    auto &yErr = table.addFloatColumn("yErr", "transformed measurement y variance (degrees^2)");
+    auto &xyCov = table.addFloatColumn("xyCov", "transformed measurement xy covariance (degrees^2)");
+    auto &xtpi = table.addFloatColumn("xtpi", "as-read x position on TP (degrees)");
+    auto &ytpi = table.addFloatColumn("ytpi", "as-read y position on TP (degrees)");
+    auto &rxi = table.addFloatColumn("rxi", "as-read x residual on TP (degrees)");
+    auto &ryi = table.addFloatColumn("ryi", "as-read y residual on TP (degrees)");
+    auto &fsindex = table.addIntColumn("fsindex", "unique index of the fittedStar");
+    auto &ra = table.addFloatColumn("ra", "on sky ra of fittedStar (degrees)");
+    auto &dec = table.addFloatColumn("dec", "on sky dec of fittedStar (degrees)");
+    auto &chi2 = table.addFloatColumn("chi2", "contribution to Chi2 (2D dofs)");
+    auto &nm = table.addIntColumn("nm", "number of measurements of this fittedStar");
+    auto &chip = table.addIntColumn("chip", "chip id");
+    auto &visit = table.addIntColumn("visit", "visit id");
+    table.reserve(_associations->getMaxMeasuredStars());
 
     const CcdImageList &ccdImageList = _associations->getCcdImageList();
     for (auto const &ccdImage : ccdImageList) {
         const MeasuredStarList &cat = ccdImage->getCatalogForFit();
         const AstrometryMapping *mapping = _astrometryModel->getMapping(*ccdImage);
-        const auto readTransform = ccdImage->getReadWcs();
+        auto sky2TP = _astrometryModel->getSkyToTangentPlane(*ccdImage);
+        const std::unique_ptr<AstrometryTransform> readPixToTangentPlane =
+                compose(*sky2TP, *ccdImage->getReadWcs());
         // FittedStar is "observed" epoch, MeasuredStar is "baseline"
-        double deltaYears = _epoch - ccdImage->getEpoch();
+        double ccdDeltaYears = _epoch - ccdImage->getEpoch();
         for (auto const &ms : cat) {
             if (!ms->isValid()) continue;
             FatPoint tpPos;
             FatPoint inPos = *ms;
             tweakAstromMeasurementErrors(inPos, *ms, _posError);
             mapping->transformPosAndErrors(inPos, tpPos);
-            auto sky2TP = _astrometryModel->getSkyToTangentPlane(*ccdImage);
-            const std::unique_ptr<AstrometryTransform> readPixToTangentPlane =
-                    compose(*sky2TP, *readTransform);
             FatPoint inputTpPos = readPixToTangentPlane->apply(inPos);
             std::shared_ptr<FittedStar const> const fs = ms->getFittedStar();
 
-            Point fittedStarInTP = transformFittedStar(*fs, *sky2TP, deltaYears);
+            Point fittedStarInTP = transformFittedStar(*fs, *sky2TP, ccdDeltaYears);
             Point res = tpPos - fittedStarInTP;
             Point inputRes = inputTpPos - fittedStarInTP;
             double det = tpPos.vx * tpPos.vy - std::pow(tpPos.vxy, 2);
             double wxx = tpPos.vy / det;
             double wyy = tpPos.vx / det;
             double wxy = -tpPos.vxy / det;
-            double chi2 = wxx * res.x * res.x + wyy * res.y * res.y + 2 * wxy * res.x * res.y;
-
-            ofile << std::setprecision(9);
-            ofile << ms->getId() << separator << ms->x << separator << ms->y << separator;
-            ofile << res.x << separator << res.y << separator;
-            ofile << tpPos.x << separator << tpPos.y << separator;
-            ofile << fs->getMag() << separator << deltaYears << separator;
-            ofile << tpPos.vx << separator << tpPos.vy << separator << tpPos.vxy << separator;
-            ofile << inputTpPos.x << separator << inputTpPos.y << separator;
-            ofile << inputRes.x << separator << inputRes.y << separator;
-            ofile << fs->getIndexInMatrix() << separator;
-            ofile << fs->x << separator << fs->y << separator;
-            ofile << chi2 << separator << fs->getMeasurementCount() << separator;
-            ofile << ccdImage->getCcdId() << separator << ccdImage->getVisit() << std::endl;
+
+            id.push_back(ms->getId());
+            xccd.push_back(ms->x);
+            yccd.push_back(ms->y);
+            rx.push_back(res.x);
+            ry.push_back(res.y);
+            xtp.push_back(tpPos.x);
+            ytp.push_back(tpPos.y);
+            mag.push_back(fs->getMag());
+            deltaYears.push_back(ccdDeltaYears);
+            xErr.push_back(tpPos.vx);
+            yErr.push_back(tpPos.vy);
+            xyCov.push_back(tpPos.vxy);
+            xtpi.push_back(inputTpPos.x);
+            ytpi.push_back(inputTpPos.y);
+            rxi.push_back(inputRes.x);
+            ryi.push_back(inputRes.y);
+            fsindex.push_back(fs->getIndexInMatrix());
+            ra.push_back(fs->x);
+            dec.push_back(fs->y);
+            chi2.push_back(wxx * res.x * res.x + wyy * res.y * res.y + 2 * wxy * res.x * res.y);
+            nm.push_back(fs->getMeasurementCount());
+            chip.push_back(ccdImage->getCcdId());
+            visit.push_back(ccdImage->getVisit());
         }  // loop on measurements in image
     }      // loop on images
+    table.write(filename);
 }
 
 void AstrometryFit::saveChi2RefContributions(std::string const &filename) const {
-    std::ofstream ofile(filename.c_str());
-    std::string separator = "\t";
-
-    ofile << "#ra" << separator << "dec " << separator;
-    ofile << "rx" << separator << "ry" << separator;
-    ofile << "mag" << separator;
-    ofile << "xErr" << separator << "yErr" << separator << "xyCov" << separator;
-    ofile << "fsindex" << separator;
-    ofile << "chi2" << separator << "nm" << std::endl;
-
-    ofile << "#coordinates of fittedStar (degrees)" << separator << separator;
-    ofile << "residual on TP (degrees)" << separator << separator;
-    ofile << "magnitude" << separator;
-    ofile << "refStar transformed measurement uncertainty (degrees)" << separator << separator << separator;
-    ofile << "unique index of the fittedStar" << separator;
-    ofile << "refStar contribution to Chi2 (2D dofs)" << separator
-          << "number of measurements of this FittedStar" << std::endl;
+    ColumnTable table;
+    auto &ra = table.addFloatColumn("ra", "ra of fittedStar (degrees)");
+    auto &dec = table.addFloatColumn("dec", "dec of fittedStar (degrees)");
+    auto &rx = table.addFloatColumn("rx", "x residual on TP (degrees)");
+    auto &ry = table.addFloatColumn("ry", "y residual on TP (degrees)");
+    auto &mag = table.addFloatColumn("mag", "magnitude");
+    auto &xErr = table.addFloatColumn("xErr", "refStar transformed measurement x variance (degrees^2)");
+    auto &yErr = table.addFloatColumn("yErr", "refStar transformed measurement y variance (degrees^2)");
+    auto &xyCov = table.addFloatColumn("xyCov", "refStar transformed measurement xy covariance (degrees^2)");
+    auto &fsindex = table.addIntColumn("fsindex", "unique index of the fittedStar");
+    auto &chi2 = table.addFloatColumn("chi2", "refStar contribution to Chi2 (2D dofs)");
+    auto &nm = table.addIntColumn("nm", "number of measurements of this FittedStar");
+    table.reserve(_associations->fittedStarList.size());
 
     // The following loop is heavily inspired from AstrometryFit::computeChi2()
     const FittedStarList &fittedStarList = _associations->fittedStarList;
@@ -595,16 +636,20 @@ void AstrometryFit::saveChi2RefContributions(std::string const &filename) const
         // fs projects to (0,0), no need to compute its transform.
         FatPoint rsProj;
         proj.transformPosAndErrors(*rs, rsProj);
-        double chi2 = computeProjectedRefStarChi2(rsProj);
 
-        ofile << std::setprecision(9);
-        ofile << fs.x << separator << fs.y << separator;
-        ofile << rsProj.x << separator << rsProj.y << separator;
-        ofile << fs.getMag() << separator;
-        ofile << rsProj.vx << separator << rsProj.vy << separator << rsProj.vxy << separator;
-        ofile << fs.getIndexInMatrix() << separator;
-        ofile << chi2 << separator << fs.getMeasurementCount() << std::endl;
+        ra.push_back(fs.x);
+        dec.push_back(fs.y);
+        rx.push_back(rsProj.x);
+        ry.push_back(rsProj.y);
+        mag.push_back(fs.getMag());
+        xErr.push_back(rsProj.vx);
+        yErr.push_back(rsProj.vy);
+        xyCov.push_back(rsProj.vxy);
+        fsindex.push_back(fs.getIndexInMatrix());
+        chi2.push_back(computeProjectedRefStarChi2(rsProj));
+        nm.push_back(fs.getMeasurementCount());
     }  // loop on FittedStars
+    table.write(filename);
 }
 }  // namespace jointcal
 }  // namespace lsst
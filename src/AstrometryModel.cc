@@ -22,7 +22,12 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <unordered_set>
+
+#include "lsst/pex/exceptions.h"
+
 #include "lsst/jointcal/AstrometryModel.h"
+#include "lsst/jointcal/SimpleAstrometryMapping.h"
 
 namespace lsst {
 namespace jointcal {
@@ -39,6 +44,102 @@ bool AstrometryModel::validate(CcdImageList const &ccdImageList, int ndof) const
     return check;
 }
 
+Eigen::VectorXd AstrometryModel::getParameters() const {
+    std::vector<Eigen::VectorXd> parameters;
+    Eigen::Index total = 0;
+    for (auto const &keyedMapping : getAllMappings()) {
+        parameters.push_back(keyedMapping.second->getParameters());
+        total += parameters.back().size();
+    }
+    Eigen::VectorXd result(total);
+    Eigen::Index index = 0;
+    for (auto const &vector : parameters) {
+        result.segment(index, vector.size()) = vector;
+        index += vector.size();
+    }
+    return result;
+}
+
+void AstrometryModel::setParameters(Eigen::VectorXd const &parameters) {
+    auto mappings = getAllMappings();
+    Eigen::Index total = 0;
+    for (auto const &keyedMapping : mappings) total += keyedMapping.second->getParameters().size();
+    if (parameters.size() != total) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          "Got " + std::to_string(parameters.size()) + " parameters for a model with " +
+                                  std::to_string(total) + ": was it constructed in the same way?");
+    }
+    Eigen::Index index = 0;
+    for (auto const &keyedMapping : mappings) {
+        Eigen::Index npar = keyedMapping.second->getParameters().size();
+        keyedMapping.second->setParameters(parameters.segment(index, npar));
+        index += npar;
+    }
+}
+
+AstrometryModel::MappingParameters AstrometryModel::getMappingParameters() const {
+    MappingParameters result;
+    for (auto const &keyedMapping : getAllMappings()) {
+        result.emplace(keyedMapping.first, keyedMapping.second->getTransformParameters());
+    }
+    return result;
+}
+
+std::size_t AstrometryModel::setMappingParameters(MappingParameters const &parameters) {
+    auto mappings = getAllMappings();
+    std::size_t nSet = 0;
+    for (auto const &keyedMapping : mappings) {
+        auto previous = parameters.find(keyedMapping.first);
+        if (previous == parameters.end()) continue;
+        Eigen::Index npar = keyedMapping.second->getTransformParameters().size();
+        if (previous->second.size() != npar) {
+            LOGLS_WARN(_log, "Not starting the transform of "
+                                     << keyedMapping.first << " from the previous solution: it has "
+                                     << previous->second.size() << " parameters, not "
+                                                              << npar);
+            continue;
+        }
+        keyedMapping.second->setTransformParameters(previous->second);
+        ++nSet;
+    }
+    LOGLS_INFO(_log, "Started " << nSet << " of " << mappings.size()
+                                << " transforms from the previous solution");
+    return nSet;
+}
+
+std::size_t AstrometryModel::fixMappings(std::vector<CcdImageKey> const &keys) {
+    std::unordered_set<CcdImageKey> toFix(keys.begin(), keys.end());
+    std::size_t nFixed = 0;
+    for (auto const &keyedMapping : getAllMappings()) {
+        auto *mapping = keyedMapping.second;
+        if (toFix.count(keyedMapping.first) == 0 || !mapping->getToBeFit()) continue;
+        mapping->setToBeFit(false);
+        _fixedMappings.push_back(mapping);
+        ++nFixed;
+    }
+    LOGLS_INFO(_log, "Holding " << nFixed << " transforms fixed (" << getTotalParameters()
+                                << " parameters left to fit).");
+    return nFixed;
+}
+
+std::size_t AstrometryModel::releaseMappings() {
+    std::size_t nReleased = _fixedMappings.size();
+    for (auto *mapping : _fixedMappings) mapping->setToBeFit(true);
+    _fixedMappings.clear();
+    LOGLS_INFO(_log, "Released " << nReleased << " fixed transforms (" << getTotalParameters()
+                                 << " parameters to fit).");
+    return nReleased;
+}
+
+std::unordered_map<CcdImageKey, std::shared_ptr<afw::geom::SkyWcs>> AstrometryModel::makeSkyWcsMap(
+        CcdImageList const &ccdImageList, unsigned) const {
+    std::unordered_map<CcdImageKey, std::shared_ptr<afw::geom::SkyWcs>> result;
+    for (auto const &ccdImage : ccdImageList) {
+        result.emplace(ccdImage->getHashKey(), makeSkyWcs(*ccdImage));
+    }
+    return result;
+}
+
 std::ostream &operator<<(std::ostream &stream, AstrometryModel const &model) {
     model.print(stream);
     return stream;
@@ -24,6 +24,7 @@
 
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include <iterator> /* for ostream_iterator */
 #include <limits>
 #include <cmath>
@@ -91,6 +92,11 @@ Frame AstrometryTransform::apply(Frame const &inputframe, bool inscribed) const
     return fr1 + fr2;
 }
 
+void AstrometryTransform::apply(std::vector<Point> const &in, std::vector<Point> &out) const {
+    out.resize(in.size());
+    for (std::size_t i = 0; i < in.size(); ++i) apply(in[i].x, in[i].y, out[i].x, out[i].y);
+}
+
 std::unique_ptr<AstrometryTransform> AstrometryTransform::composeAndReduce(
         AstrometryTransform const &) const {  // by default no way to compose
     return std::unique_ptr<AstrometryTransform>(nullptr);
@@ -260,24 +266,170 @@ void AstrometryTransform::write(ostream &stream) const {
             "derived class ");
 }
 
+namespace {
+/* Sample transform on an nSteps x nSteps grid spanning domain (corners included), and at the centers of
+   its cells, as (in, out) pairs, or (out, in) pairs if inverse. */
+void sampleTransform(AstrometryTransform const &transform, Frame const &domain, std::size_t nSteps,
+                     bool inverse, StarMatchList &grid, StarMatchList &centers) {
+    double xStep = domain.getWidth() / (nSteps - 1);
+    double yStep = domain.getHeight() / (nSteps - 1);
+    auto addPair = [&transform, inverse](StarMatchList &pairs, Point const &in) {
+        Point out = transform.apply(in);
+        if (inverse) {
+            pairs.emplace_back(out, in, nullptr, nullptr);
+        } else {
+            pairs.emplace_back(in, out, nullptr, nullptr);
+        }
+    };
+    for (std::size_t i = 0; i < nSteps; ++i) {
+        for (std::size_t j = 0; j < nSteps; ++j) {
+            Point in(domain.xMin + i * xStep, domain.yMin + j * yStep);
+            addPair(grid, in);
+            if (i + 1 < nSteps && j + 1 < nSteps) {
+                addPair(centers, Point(in.x + 0.5 * xStep, in.y + 0.5 * yStep));
+            }
+        }
+    }
+}
+
+/* Fit polynomials of increasing order to grid, up to the first whose largest error over grid and centers
+   is within maxError. Return the one with the smallest such error (nullptr if no fit succeeded), and that
+   error. */
+std::shared_ptr<AstrometryTransformPolynomial> fitBestPolynomial(StarMatchList const &grid,
+                                                                 StarMatchList const &centers,
+                                                                 double maxError, std::size_t maxOrder,
+                                                                 double &error) {
+    // The orthogonal basis keeps the high orders well conditioned down to the small errors we want.
+    AstrometryTransformPolynomialFitter fitter(grid, maxOrder, true);
+    std::shared_ptr<AstrometryTransformPolynomial> best;
+    error = std::numeric_limits<double>::infinity();
+    for (std::size_t order = 1; order <= maxOrder; ++order) {
+        auto poly = std::make_shared<AstrometryTransformPolynomial>(order);
+        double chi2;
+        if (!fitter.fit(order, *poly, chi2)) break;
+        double maxDist2 = 0;
+        for (auto const *points : {&grid, &centers}) {
+            for (auto const &starMatch : *points) {
+                maxDist2 = std::max(maxDist2, starMatch.point2.computeDist2(poly->apply(starMatch.point1)));
+            }
+        }
+        LOGLS_TRACE(_log, "fitBestPolynomial order " << order << ": max error " << std::sqrt(maxDist2));
+        if (std::sqrt(maxDist2) < error) {
+            error = std::sqrt(maxDist2);
+            best = poly;
+        }
+        if (error <= maxError) break;
+    }
+    return best;
+}
+
+// Points at which the direct transform is sampled to tell whether it has changed since an inverse was fit.
+std::vector<Point> probePoints(Frame const &region) {
+    return {Point(region.xMin, region.yMin), Point(region.xMax, region.yMin),
+            Point(region.xMin, region.yMax), Point(region.xMax, region.yMax), region.getCenter()};
+}
+
+// Size of the polynomial grid and highest order used to fit inverses.
+std::size_t const INVERSE_N_STEPS = 20;
+std::size_t const INVERSE_MAX_ORDER = 9;
+// How many inverses to keep per transform: usually one (precision, region) is used over and over.
+std::size_t const INVERSE_CACHE_SIZE = 4;
+}  // namespace
+
 /******************* GTransformInverse ****************/
-/* inverse transformation, solved by iterations. Before using
-   it (probably via AstrometryTransform::inverseTransform), consider
-   seriously StarMatchList::inverseTransform */
+
+struct AstrometryTransform::PolynomialInverse {
+    double precision;
+    Frame region;
+    // The direct transform at probePoints(region) when this was fit.
+    std::vector<Point> probes;
+    // The polynomial fit to the inverse, or a linear approximation if no polynomial could be fit.
+    std::shared_ptr<AstrometryTransform const> guess;
+    // Whether guess is within precision everywhere its output is within region.
+    bool accurate;
+    // Largest squared distance, on the input side of the inverse, between an input point and the direct
+    // transform of its inverse that guarantees the inverse is within precision.
+    double inputTolerance2;
+};
+
+std::shared_ptr<AstrometryTransform::PolynomialInverse const> AstrometryTransform::getPolynomialInverse(
+        double precision, Frame const &region) const {
+    std::vector<Point> probes = probePoints(region);
+    std::vector<Point> current;
+    apply(probes, current);
+    {
+        std::lock_guard<std::mutex> lock(_inverseCache.mutex);
+        auto &inverses = _inverseCache.inverses;
+        for (auto it = inverses.begin(); it != inverses.end(); ++it) {
+            auto const &cached = **it;
+            if (cached.precision != precision || cached.region != region) continue;
+            if (std::equal(current.begin(), current.end(), cached.probes.begin(),
+                           [](Point const &a, Point const &b) { return a.x == b.x && a.y == b.y; })) {
+                auto found = *it;
+                inverses.erase(it);
+                inverses.push_back(found);
+                return found;
+            }
+            // This transform has changed since: the cached inverse is stale.
+            inverses.erase(it);
+            break;
+        }
+    }
+
+    // Fit without holding the lock; concurrent callers may fit the same inverse, and keep the last one.
+    auto inverse = std::make_shared<PolynomialInverse>();
+    inverse->precision = precision;
+    inverse->region = region;
+    inverse->probes = std::move(current);
+    double error = std::numeric_limits<double>::infinity();
+    if (region.getArea() > 0) {
+        StarMatchList grid, centers;
+        sampleTransform(*this, region, INVERSE_N_STEPS, true, grid, centers);
+        inverse->guess = fitBestPolynomial(grid, centers, precision, INVERSE_MAX_ORDER, error);
+    }
+    inverse->accurate = error <= precision;
+    if (inverse->guess == nullptr) inverse->guess = roughInverse(region);
+    // An input residual r moves the inverse by about J^-1 r, and |J^-1 r| <= |J^-1|_F |r|.
+    inverse->inputTolerance2 = 0;
+    if (region.getArea() > 0) {
+        AstrometryTransformLinear der;
+        computeDerivative(region.getCenter(), der, std::sqrt(region.getArea()) / 5.);
+        double det = der.determinant();
+        double norm2 = (der.A11() * der.A11() + der.A12() * der.A12() + der.A21() * der.A21() +
+                        der.A22() * der.A22()) /
+                       (det * det);
+        if (std::isfinite(norm2) && norm2 > 0) inverse->inputTolerance2 = precision * precision / norm2;
+    }
+    LOGLS_TRACE(_log, "Fit an inverse with max error " << error << " for precision " << precision);
+
+    std::lock_guard<std::mutex> lock(_inverseCache.mutex);
+    auto &inverses = _inverseCache.inverses;
+    if (inverses.size() >= INVERSE_CACHE_SIZE) inverses.erase(inverses.begin());
+    inverses.push_back(inverse);
+    return inverse;
+}
+
+/* inverse transformation: a polynomial fit over the region of interest, refined by (Gauss-Newton)
+   iterations where it may not be accurate enough. Before using it (probably via
+   AstrometryTransform::inverseTransform), consider seriously StarMatchList::inverseTransform */
 class AstrometryTransformInverse : public AstrometryTransform {
 private:
     std::unique_ptr<AstrometryTransform> _direct;
-    std::unique_ptr<AstrometryTransform> _roughInverse;
+    std::shared_ptr<PolynomialInverse const> _inverse;
     double precision2;
 
 public:
     AstrometryTransformInverse(const AstrometryTransform *direct, const double precision,
                                const Frame &region);
 
-    //! implements an iterative (Gauss-Newton) solver. It resorts to the Derivative function: 4 calls to the
+    //! Applies the polynomial inverse, and checks it with one call to the direct transform. Where its
+    //! output is not within region, that check fails, or that polynomial is not within precision, refines
+    //! it with an iterative (Gauss-Newton) solver. That resorts to the Derivative function: 4 calls to the
     //! direct transform per iteration.
     void apply(const double xIn, const double yIn, double &xOut, double &yOut) const;
 
+    void apply(std::vector<Point> const &in, std::vector<Point> &out) const;
+
     void print(ostream &out) const;
 
     double fit(StarMatchList const &starMatchList);
@@ -298,6 +450,9 @@ public:
 
 private:
     void operator=(AstrometryTransformInverse const &);
+
+    // Refine the guess outGuess of the inverse of in.
+    void refine(Point const &in, Point &outGuess) const;
 };
 
 std::unique_ptr<AstrometryTransform> AstrometryTransform::inverseTransform(const double precision,
@@ -308,14 +463,14 @@ std::unique_ptr<AstrometryTransform> AstrometryTransform::inverseTransform(const
 AstrometryTransformInverse::AstrometryTransformInverse(const AstrometryTransform *direct,
                                                        const double precision, const Frame &region) {
     _direct = direct->clone();
-    _roughInverse = _direct->roughInverse(region);
+    _inverse = direct->getPolynomialInverse(precision, region);
     precision2 = precision * precision;
 }
 
 AstrometryTransformInverse::AstrometryTransformInverse(AstrometryTransformInverse const &model)
         : AstrometryTransform() {
     _direct = model._direct->clone();
-    _roughInverse = model._roughInverse->clone();
+    _inverse = model._inverse;
     precision2 = model.precision2;
 }
 
@@ -323,13 +478,34 @@ AstrometryTransformInverse::~AstrometryTransformInverse() {}
 
 void AstrometryTransformInverse::operator=(AstrometryTransformInverse const &model) {
     _direct = model._direct->clone();
-    _roughInverse = model._roughInverse->clone();
+    _inverse = model._inverse;
     precision2 = model.precision2;
 }
 
 void AstrometryTransformInverse::apply(const double xIn, const double yIn, double &xOut, double &yOut) const {
     Point in(xIn, yIn);
-    Point outGuess = _roughInverse->apply(in);
+    Point out = _inverse->guess->apply(in);
+    if (!_inverse->accurate || !_inverse->region.inFrame(out) ||
+        _direct->apply(out).computeDist2(in) > _inverse->inputTolerance2) {
+        refine(in, out);
+    }
+    xOut = out.x;
+    yOut = out.y;
+}
+
+void AstrometryTransformInverse::apply(std::vector<Point> const &in, std::vector<Point> &out) const {
+    _inverse->guess->apply(in, out);
+    std::vector<Point> check;
+    _direct->apply(out, check);
+    for (std::size_t i = 0; i < in.size(); ++i) {
+        if (!_inverse->accurate || !_inverse->region.inFrame(out[i]) ||
+            check[i].computeDist2(in[i]) > _inverse->inputTolerance2) {
+            refine(in[i], out[i]);
+        }
+    }
+}
+
+void AstrometryTransformInverse::refine(Point const &in, Point &outGuess) const {
     AstrometryTransformLinear directDer, reverseDer;
     int loop = 0;
     int maxloop = 20;
@@ -340,14 +516,12 @@ void AstrometryTransformInverse::apply(const double xIn, const double yIn, doubl
         _direct->computeDerivative(outGuess, directDer);
         reverseDer = directDer.inverted();
         double xShift, yShift;
-        reverseDer.apply(xIn - inGuess.x, yIn - inGuess.y, xShift, yShift);
+        reverseDer.apply(in.x - inGuess.x, in.y - inGuess.y, xShift, yShift);
         outGuess.x += xShift;
         outGuess.y += yShift;
         move2 = xShift * xShift + yShift * yShift;
     } while ((move2 > precision2) && (loop < maxloop));
     if (loop == maxloop) LOGLS_WARN(_log, "Problems applying AstrometryTransformInverse at " << in);
-    xOut = outGuess.x;
-    yOut = outGuess.y;
 }
 
 void AstrometryTransformInverse::print(ostream &stream) const {
@@ -942,6 +1116,248 @@ double AstrometryTransformPolynomial::fit(StarMatchList const &starMatchList) {
     return chi2;
 }
 
+AstrometryTransformPolynomialFitter::AstrometryTransformPolynomialFitter(
+        StarMatchList const &starMatchList, std::size_t maxOrder, bool orthogonal)
+        : _maxOrder(maxOrder), _orthogonal(orthogonal), _conditioner(shiftAndNormalize(starMatchList)) {
+    setMatches(starMatchList, nullptr);
+}
+
+AstrometryTransformPolynomialFitter::AstrometryTransformPolynomialFitter(StarMatchList const &starMatchList,
+                                                                         AstrometryTransform const &guess,
+                                                                         std::size_t maxOrder,
+                                                                         bool orthogonal)
+        : _maxOrder(maxOrder), _orthogonal(orthogonal), _conditioner(shiftAndNormalize(starMatchList)) {
+    setMatches(starMatchList, &guess);
+}
+
+void AstrometryTransformPolynomialFitter::setMatches(StarMatchList const &starMatchList,
+                                                     AstrometryTransform const *guess) {
+    AstrometryTransformPolynomial poly(_maxOrder);
+    std::size_t nTerms = poly._nterms;
+    _rowsPerMatch = (guess == nullptr) ? 1 : 2;
+    _design.resize(_rowsPerMatch * starMatchList.size(), _rowsPerMatch * nTerms);
+    _targets.resize(_rowsPerMatch * starMatchList.size(), (guess == nullptr) ? 2 : 1);
+    std::vector<double> monomials(nTerms);
+    std::size_t i = 0;
+    for (auto const &starMatch : starMatchList) {
+        Point point1 = _conditioner.apply(starMatch.point1);
+        poly.computeMonomials(point1.x, point1.y, monomials.data());
+        if (guess == nullptr) {
+            for (std::size_t k = 0; k < nTerms; ++k) _design(i, k) = monomials[k];
+            _targets(i, 0) = starMatch.point2.x;
+            _targets(i, 1) = starMatch.point2.y;
+            ++i;
+            continue;
+        }
+        // With covariance = L L^T, the chi2 of a residual r is |L^-1 r|^2: whiten the rows with L^-1.
+        FatPoint transformed;
+        guess->transformPosAndErrors(starMatch.point1, transformed);
+        FatPoint const &point2 = starMatch.point2;
+        Eigen::Matrix2d covariance;
+        covariance << transformed.vx + point2.vx, transformed.vxy + point2.vxy,
+                transformed.vxy + point2.vxy, transformed.vy + point2.vy;
+        Eigen::LLT<Eigen::Matrix2d> factor(covariance);
+        if (factor.info() != Eigen::Success || !covariance.allFinite()) {
+            throw LSST_EXCEPT(pexExcept::InvalidParameterError,
+                              "AstrometryTransformPolynomialFitter: the covariance of match " +
+                                      std::to_string(i / 2) + " is not positive definite");
+        }
+        Eigen::Matrix2d whitening = factor.matrixL().solve(Eigen::Matrix2d::Identity());
+        Eigen::Vector2d target = whitening * Eigen::Vector2d(point2.x, point2.y);
+        for (std::size_t a = 0; a < 2; ++a, ++i) {
+            for (std::size_t k = 0; k < nTerms; ++k) {
+                _design(i, 2 * k) = whitening(a, 0) * monomials[k];
+                _design(i, 2 * k + 1) = whitening(a, 1) * monomials[k];
+            }
+            _targets(i, 0) = target(a);
+        }
+    }
+    // the residuals of an exact fit are rounding errors relative to the targets
+    _roundOff2 = _targets.size() == 0 ? 0 : sq(1e-12 * _targets.cwiseAbs().maxCoeff());
+    reset();
+}
+
+void AstrometryTransformPolynomialFitter::reset() {
+    _nUsed = _design.rows() / _rowsPerMatch;
+    _used.assign(_nUsed, true);
+    accumulate();
+}
+
+void AstrometryTransformPolynomialFitter::accumulate() {
+    _factorValid = _qrValid = false;
+    if (_orthogonal) return;  // factored in solve(), once all removals are known
+    _normal = Eigen::MatrixXd::Zero(_design.cols(), _design.cols());
+    _rhs = Eigen::MatrixXd::Zero(_design.cols(), _targets.cols());
+    for (Eigen::Index i = 0; i < _design.rows(); ++i) {
+        if (!_used[i / _rowsPerMatch]) continue;
+        _normal.selfadjointView<Eigen::Lower>().rankUpdate(_design.row(i).transpose());
+        _rhs += _design.row(i).transpose() * _targets.row(i);
+    }
+    _normal.triangularView<Eigen::StrictlyUpper>() = _normal.transpose();
+    _factor.compute(_normal);
+    _factorValid = (_factor.info() == Eigen::Success);
+}
+
+void AstrometryTransformPolynomialFitter::remove(std::size_t index) {
+    if (!_used.at(index)) return;
+    _used[index] = false;
+    --_nUsed;
+    if (_orthogonal) {
+        _qrValid = false;
+        return;
+    }
+    for (std::size_t i = _rowsPerMatch * index; i < _rowsPerMatch * (index + 1); ++i) {
+        Eigen::VectorXd row = _design.row(i).transpose();
+        _normal -= row * row.transpose();
+        _rhs -= row * _targets.row(i);
+        if (_factorValid) {
+            _factor.rankUpdate(row, -1);
+            _factorValid = (_factor.info() == Eigen::Success);
+        }
+    }
+}
+
+bool AstrometryTransformPolynomialFitter::solve(std::size_t order, Eigen::MatrixXd &solution) {
+    if (order > _maxOrder) {
+        throw LSST_EXCEPT(pexExcept::InvalidParameterError,
+                          "AstrometryTransformPolynomialFitter: cannot fit order " + std::to_string(order) +
+                                  " with maxOrder " + std::to_string(_maxOrder));
+    }
+    Eigen::Index nTerms = (order + 1) * (order + 2) / 2;
+    Eigen::Index nUnknowns = _rowsPerMatch * nTerms;  // per target column
+    if (Eigen::Index(_nUsed) < nTerms) {
+        LOGLS_ERROR(_log, "AstrometryTransformPolynomialFitter: cannot fit order "
+                                  << order << " with only " << _nUsed << " matches.");
+        return false;
+    }
+
+    if (_orthogonal) {
+        if (!_qrValid) {
+            Eigen::MatrixXd design(_rowsPerMatch * _nUsed, _design.cols());
+            Eigen::MatrixXd targets(_rowsPerMatch * _nUsed, _targets.cols());
+            for (Eigen::Index i = 0, k = 0; i < _design.rows(); ++i) {
+                if (!_used[i / _rowsPerMatch]) continue;
+                design.row(k) = _design.row(i);
+                targets.row(k++) = _targets.row(i);
+            }
+            _qr.compute(design);
+            _qTargets = _qr.householderQ().adjoint() * targets;
+            _qrValid = true;
+        }
+        auto r = _qr.matrixQR().topLeftCorner(nUnknowns, nUnknowns).triangularView<Eigen::Upper>();
+        solution = r.solve(_qTargets.topRows(nUnknowns));
+    } else {
+        // The leading block of the Cholesky factor of the normal matrix is the factor of its leading block.
+        if (!_factorValid) {
+            // e.g. maxOrder has more terms than there are matches, or a downdate lost definiteness.
+            Eigen::LLT<Eigen::MatrixXd> factor(_normal.topLeftCorner(nUnknowns, nUnknowns));
+            if (factor.info() != Eigen::Success) {
+                LOGL_ERROR(_log, "AstrometryTransformPolynomialFitter::fit could not factorize");
+                return false;
+            }
+            solution = factor.solve(_rhs.topRows(nUnknowns));
+        } else {
+            auto lower = _factor.matrixLLT().topLeftCorner(nUnknowns, nUnknowns);
+            solution = lower.triangularView<Eigen::Lower>().solve(_rhs.topRows(nUnknowns));
+            lower.transpose().triangularView<Eigen::Upper>().solveInPlace(solution);
+        }
+    }
+    return solution.allFinite();
+}
+
+Eigen::VectorXd AstrometryTransformPolynomialFitter::computeResiduals2(
+        Eigen::MatrixXd const &solution) const {
+    Eigen::VectorXd rows = (_targets - _design.leftCols(solution.rows()) * solution).rowwise().squaredNorm();
+    if (_rowsPerMatch == 1) return rows;
+    // sum the whitened x and y rows of each match
+    return Eigen::Map<Eigen::MatrixXd const>(rows.data(), _rowsPerMatch, rows.size() / _rowsPerMatch)
+            .colwise()
+            .sum()
+            .transpose();
+}
+
+double AstrometryTransformPolynomialFitter::computeChi2(Eigen::MatrixXd const &solution,
+                                                        Eigen::VectorXd const &residuals2) const {
+    // Summing the residuals, rather than subtracting the explained part from the sum of the squared
+    // targets, cannot cancel to a negative value.
+    if (Eigen::Index(_rowsPerMatch * _nUsed) == solution.rows()) return 0;
+    double chi2 = 0;
+    for (Eigen::Index i = 0; i < residuals2.size(); ++i) {
+        if (_used[i]) chi2 += residuals2[i];
+    }
+    return chi2;
+}
+
+void AstrometryTransformPolynomialFitter::toPolynomial(std::size_t order, Eigen::MatrixXd const &solution,
+                                                       AstrometryTransformPolynomial &result) const {
+    AstrometryTransformPolynomial poly(order);
+    for (std::size_t k = 0; k < poly._nterms; ++k) {
+        if (_rowsPerMatch == 1) {
+            poly._coeffs[k] = solution(k, 0);
+            poly._coeffs[k + poly._nterms] = solution(k, 1);
+        } else {
+            poly._coeffs[k] = solution(2 * k, 0);
+            poly._coeffs[k + poly._nterms] = solution(2 * k + 1, 0);
+        }
+    }
+    result = poly * _conditioner;
+}
+
+bool AstrometryTransformPolynomialFitter::fit(std::size_t order, AstrometryTransformPolynomial &result,
+                                              double &chi2) {
+    Eigen::MatrixXd solution;
+    if (!solve(order, solution)) return false;
+    chi2 = computeChi2(solution, computeResiduals2(solution));
+    toPolynomial(order, solution, result);
+    return true;
+}
+
+bool AstrometryTransformPolynomialFitter::fitWithClipping(std::size_t order, double nSigmas,
+                                                          AstrometryTransformPolynomial &result,
+                                                          double &chi2) {
+    Eigen::MatrixXd solution;
+    Eigen::VectorXd residuals2;
+    std::size_t nRemoved;
+    do {
+        if (!solve(order, solution)) return false;
+        residuals2 = computeResiduals2(solution);
+        if (computeChi2(solution, residuals2) == 0) break;  // nothing to clip in an exact fit
+
+        std::vector<double> used;
+        used.reserve(_nUsed);
+        for (Eigen::Index i = 0; i < residuals2.size(); ++i) {
+            if (_used[i]) used.push_back(residuals2[i]);
+        }
+        std::size_t n = used.size();
+        std::sort(used.begin(), used.end());
+        double median = (n & 1) ? used[n / 2] : (used[n / 2 - 1] + used[n / 2]) * 0.5;
+
+        // discard outliers : the cut is understood as a "distance" cut
+        double cut = std::max(sq(nSigmas) * median, _roundOff2);
+        nRemoved = 0;
+        for (Eigen::Index i = 0; i < residuals2.size(); ++i) {
+            if (_used[i] && residuals2[i] > cut) {
+                remove(i);
+                ++nRemoved;
+            }
+        }
+    } while (nRemoved);
+    chi2 = computeChi2(solution, residuals2);
+    toPolynomial(order, solution, result);
+    return true;
+}
+
+std::shared_ptr<AstrometryTransformPolynomial> fitPolynomialSurrogate(AstrometryTransform const &transform,
+                                                                      Frame const &domain, double maxError,
+                                                                      std::size_t maxOrder,
+                                                                      std::size_t nSteps, double &error) {
+    StarMatchList grid, centers;
+    sampleTransform(transform, domain, nSteps, false, grid, centers);
+    auto poly = fitBestPolynomial(grid, centers, maxError, maxOrder, error);
+    if (error > maxError) return nullptr;
+    return poly;
+}
+
 std::unique_ptr<AstrometryTransform> AstrometryTransformPolynomial::composeAndReduce(
         AstrometryTransformPolynomial const &right) const {
     if (getOrder() == 1 && right.getOrder() == 1)
@@ -1098,8 +1514,17 @@ AstrometryTransformPolynomial AstrometryTransformPolynomial::operator-(
 }
 
 std::shared_ptr<ast::Mapping> AstrometryTransformPolynomial::toAstMap(jointcal::Frame const &domain) const {
-    auto inverse = inversePolyTransform(*this, domain, 1e-7, _order + 2, 100);
-    return std::make_shared<ast::PolyMap>(toAstPolyMapCoefficients(), inverse->toAstPolyMapCoefficients());
+    return toAstMap(*fitAstMapInverse(domain));
+}
+
+std::shared_ptr<AstrometryTransformPolynomial> AstrometryTransformPolynomial::fitAstMapInverse(
+        jointcal::Frame const &domain) const {
+    return inversePolyTransform(*this, domain, 1e-7, _order + 2, 100);
+}
+
+std::shared_ptr<ast::Mapping> AstrometryTransformPolynomial::toAstMap(
+        AstrometryTransformPolynomial const &inverse) const {
+    return std::make_shared<ast::PolyMap>(toAstPolyMapCoefficients(), inverse.toAstPolyMapCoefficients());
 }
 
 void AstrometryTransformPolynomial::write(ostream &s) const {
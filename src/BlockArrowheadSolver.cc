@@ -0,0 +1,163 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "Eigen/Cholesky"
+#include "Eigen/Core"
+#include "Eigen/Sparse"
+
+#include "lsst/jointcal/BlockArrowheadSolver.h"
+#include "lsst/jointcal/Eigenstuff.h"
+
+namespace lsst {
+namespace jointcal {
+
+BlockArrowheadSolver::BlockArrowheadSolver() : _nModel(0) {}
+
+BlockArrowheadSolver::~BlockArrowheadSolver() = default;
+
+bool BlockArrowheadSolver::findStarBlocks(SparseMatrixD const &hessian, Eigen::Index nModel,
+                                          std::vector<Eigen::Index> &blockStarts, Eigen::Index maxBlockSize) {
+    blockStarts.clear();
+    Eigen::Index const size = hessian.cols();
+    if (nModel >= size) return false;
+    // The current block is [start, end): a column past end starts a new block, and any star-star entry
+    // below the diagonal extends it. An entry above start couples two blocks.
+    Eigen::Index start = nModel;
+    Eigen::Index end = nModel;
+    for (Eigen::Index col = nModel; col < size; ++col) {
+        if (col >= end) {
+            start = col;
+            end = col + 1;
+            blockStarts.push_back(start);
+        }
+        for (SparseMatrixD::InnerIterator it(hessian, col); it; ++it) {
+            Eigen::Index const row = it.row();
+            if (row < nModel) continue;
+            if (row < start) return false;
+            end = std::max(end, row + 1);
+        }
+        if (end - start > maxBlockSize) return false;
+    }
+    blockStarts.push_back(size);
+    return true;
+}
+
+bool BlockArrowheadSolver::compute(SparseMatrixD const &hessian, Eigen::Index nModel,
+                                   std::vector<Eigen::Index> blockStarts) {
+    Eigen::Index const nStar = hessian.cols() - nModel;
+    _nModel = nModel;
+    _blockStarts = std::move(blockStarts);
+
+    // Invert each star block, and assemble C^-1 as a (block diagonal) sparse matrix.
+    _starInverses.clear();
+    std::vector<Eigen::Triplet<double, Eigen::Index>> triplets;
+    Eigen::MatrixXd block;
+    for (std::size_t b = 0; b + 1 < _blockStarts.size(); ++b) {
+        Eigen::Index const start = _blockStarts[b];
+        Eigen::Index const blockSize = _blockStarts[b + 1] - start;
+        block.setZero(blockSize, blockSize);
+        for (Eigen::Index j = 0; j < blockSize; ++j) {
+            for (SparseMatrixD::InnerIterator it(hessian, start + j); it; ++it) {
+                if (it.row() >= start) block(it.row() - start, j) = it.value();
+            }
+        }
+        Eigen::LLT<Eigen::MatrixXd> llt(block);
+        if (llt.info() != Eigen::Success) return false;
+        Eigen::MatrixXd inverse = llt.solve(Eigen::MatrixXd::Identity(blockSize, blockSize));
+        _starInverses.insert(_starInverses.end(), inverse.data(), inverse.data() + inverse.size());
+        for (Eigen::Index j = 0; j < blockSize; ++j) {
+            for (Eigen::Index i = 0; i < blockSize; ++i) {
+                triplets.emplace_back(start - nModel + i, start - nModel + j, inverse(i, j));
+            }
+        }
+    }
+    SparseMatrixD starInverse(nStar, nStar);
+    starInverse.setFromTriplets(triplets.begin(), triplets.end());
+
+    SparseMatrixD coupling = hessian.topRightCorner(nModel, nStar);
+    _couplingTimesInverse = coupling * starInverse;
+    if (nModel == 0) return true;
+    SparseMatrixD schur = SparseMatrixD(hessian.topLeftCorner(nModel, nModel)) -
+                          SparseMatrixD(_couplingTimesInverse * coupling.transpose());
+
+    // As in FitterBase::_factorize, only redo the symbolic analysis if the pattern has changed.
+    Eigen::Index const *outer = schur.outerIndexPtr();
+    Eigen::Index const *inner = schur.innerIndexPtr();
+    bool samePattern = _schurFactorization != nullptr &&
+                       _schurOuterIndex.size() == static_cast<std::size_t>(schur.outerSize() + 1) &&
+                       _schurInnerIndex.size() == static_cast<std::size_t>(schur.nonZeros()) &&
+                       std::equal(_schurOuterIndex.begin(), _schurOuterIndex.end(), outer) &&
+                       std::equal(_schurInnerIndex.begin(), _schurInnerIndex.end(), inner);
+    if (samePattern) {
+        _schurFactorization->factorize(schur);
+    } else {
+        if (_schurFactorization == nullptr) {
+            _schurFactorization = std::make_unique<CholmodSimplicialLDLT2<SparseMatrixD>>();
+        }
+        _schurFactorization->compute(schur);
+        _schurOuterIndex.assign(outer, outer + schur.outerSize() + 1);
+        _schurInnerIndex.assign(inner, inner + schur.nonZeros());
+    }
+    return _schurFactorization->info() == Eigen::Success;
+}
+
+Eigen::VectorXd BlockArrowheadSolver::solve(Eigen::VectorXd const &rhs) const {
+    Eigen::Index const nStar = rhs.size() - _nModel;
+    Eigen::VectorXd result(rhs.size());
+    // Eliminate the stars: S x_model = g_model - B C^-1 g_star, then x_star = C^-1 (g_star - B^T x_model).
+    if (_nModel > 0) {
+        Eigen::VectorXd reducedRhs = rhs.head(_nModel) - _couplingTimesInverse * rhs.tail(nStar);
+        result.head(_nModel) = _schurFactorization->solve(reducedRhs);
+    }
+    result.tail(nStar) = rhs.tail(nStar);
+    applyStarInverse(result.tail(nStar));
+    if (_nModel > 0) {
+        result.tail(nStar) -= _couplingTimesInverse.transpose() * result.head(_nModel);
+    }
+    return result;
+}
+
+Eigen::Index BlockArrowheadSolver::getFactorNonZeros() const {
+    Eigen::Index nonZeros = _starInverses.size() + _couplingTimesInverse.nonZeros();
+    if (_schurFactorization != nullptr) nonZeros += _schurFactorization->getFactorNonZeros();
+    return nonZeros;
+}
+
+void BlockArrowheadSolver::applyStarInverse(Eigen::Ref<Eigen::VectorXd> x) const {
+    double const *inverse = _starInverses.data();
+    for (std::size_t b = 0; b + 1 < _blockStarts.size(); ++b) {
+        Eigen::Index const start = _blockStarts[b] - _nModel;
+        Eigen::Index const blockSize = _blockStarts[b + 1] - _blockStarts[b];
+        Eigen::Map<Eigen::MatrixXd const> block(inverse, blockSize, blockSize);
+        x.segment(start, blockSize) = block * x.segment(start, blockSize);
+        inverse += blockSize * blockSize;
+    }
+}
+
+}  // namespace jointcal
+}  // namespace lsst
@@ -171,6 +171,40 @@ std::pair<int, int> CcdImage::countStars() const {
     return std::make_pair(measuredStars, refStars);
 }
 
+void CcdImage::resetCatalogForFit() {
+    _catalogForFit.clear();
+    // Allocated in catalog order, so that the fit loops read the arena sequentially.
+    for (auto const &measuredStar : _wholeCatalog) _catalogForFit.push_back(copyStar(*measuredStar));
+    // The whole catalog of a fit view is that of the CcdImage it was made from.
+    _catalogForFit.setCcdImage(this);
+    _catalogForFitOnHeap = (_fitCatalogArena == nullptr);
+}
+
+void CcdImage::setFitCatalogArena(std::shared_ptr<MappedArena> arena) {
+    if (arena == _fitCatalogArena) return;
+    _fitCatalogArena = std::move(arena);
+    MeasuredStarList wholeCatalog;
+    for (auto const &measuredStar : _wholeCatalog) wholeCatalog.push_back(copyStar(*measuredStar));
+    _wholeCatalog.swap(wholeCatalog);
+}
+
+std::size_t CcdImage::getCatalogHeapSize() const {
+    std::size_t nStars = (_fitCatalogArena == nullptr) ? _wholeCatalog.size() : 0;
+    if (_catalogForFitOnHeap) nStars += _catalogForFit.size();
+    return nStars * sizeof(MeasuredStar);
+}
+
+std::shared_ptr<MeasuredStar> CcdImage::copyStar(MeasuredStar const &star) const {
+    if (_fitCatalogArena == nullptr) return std::make_shared<MeasuredStar>(star);
+    return std::allocate_shared<MeasuredStar>(MappedArenaAllocator<MeasuredStar>(_fitCatalogArena), star);
+}
+
+std::shared_ptr<CcdImage> CcdImage::makeFitView() const {
+    std::shared_ptr<CcdImage> view(new CcdImage(*this));
+    view->_catalogForFit.clear();
+    return view;
+}
+
 void CcdImage::setCommonTangentPoint(Point const &commonTangentPoint) {
     _commonTangentPoint = commonTangentPoint;
 
@@ -195,5 +229,23 @@ void CcdImage::setCommonTangentPoint(Point const &commonTangentPoint) {
     // this one is needed for matches :
     _pixelToCommonTangentPlane = compose(raDecToCommonTangentPlane, *_readWcs);
 }
+
+std::size_t CcdImage::useWcsSurrogate(double maxError, std::size_t maxOrder) {
+    double error;
+    std::size_t const nSteps = 20;
+    auto surrogate =
+            fitPolynomialSurrogate(*_pixelToTangentPlane, _imageFrame, maxError, maxOrder, nSteps, error);
+    if (surrogate == nullptr) {
+        LOGLS_DEBUG(_log, "No WCS surrogate up to order " << maxOrder << " for " << _name
+                                                          << ": best max error " << error * 3600
+                                                          << " arcsec");
+        return 0;
+    }
+    LOGLS_TRACE(_log, "WCS surrogate of order " << surrogate->getOrder() << " for " << _name
+                                                << ": max error " << error * 3600 << " arcsec");
+    _pixelToTangentPlane = surrogate;
+    _pixelToCommonTangentPlane = compose(*_tangentPlaneToCommonTangentPlane, *surrogate);
+    return surrogate->getOrder();
+}
 }  // namespace jointcal
 }  // namespace lsst
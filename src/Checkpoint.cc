@@ -0,0 +1,540 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "lsst/log/Log.h"
+#include "lsst/pex/exceptions.h"
+#include "lsst/afw/geom/SkyWcs.h"
+#include "lsst/afw/image/PhotoCalib.h"
+#include "lsst/geom/Point.h"
+#include "lsst/geom/SpherePoint.h"
+
+#include "lsst/jointcal/AstrometryTransform.h"
+#include "lsst/jointcal/Checkpoint.h"
+#include "lsst/jointcal/FittedStar.h"
+#include "lsst/jointcal/MeasuredStar.h"
+#include "lsst/jointcal/ProperMotion.h"
+#include "lsst/jointcal/RefStar.h"
+
+namespace lsst {
+namespace jointcal {
+
+namespace {
+LOG_LOGGER _log = LOG_GET("jointcal.Checkpoint");
+
+// Bump on any change to the records below.
+std::int64_t const checkpointVersion = 2;
+// Written as is, to detect a checkpoint written with another byte order.
+std::int64_t const byteOrderMark = 0x0102030405060708;
+char const checkpointMagic[8] = "JCLCKPT";
+
+struct Header {
+    char magic[8];
+    std::int64_t version;
+    std::int64_t byteOrder;
+    std::int64_t nCcdImages;
+    std::int64_t nRefStars;
+    std::int64_t nFittedStars;
+    std::int64_t nWholeCatalog;
+    std::int64_t nCatalogForFit;
+    std::int64_t nModelParameters;
+    std::int64_t maxMeasuredStars;
+    std::int64_t wcsSurrogateMaxOrder;
+    std::int64_t fittedStarsInTangentPlane;
+    double commonTangentPoint[2];
+    double epoch;
+    double wcsSurrogateMaxError;
+};
+
+struct CcdImageRecord {
+    std::int64_t visit;
+    std::int64_t ccd;
+    std::int64_t nWholeCatalog;
+    std::int64_t nCatalogForFit;
+    double imageFrame[4];      // xMin, yMin, xMax, yMax
+    double boresightRaDec[2];  // radians
+    double airMass;
+    double epoch;
+    double sinEta;
+    double cosEta;
+    double tanZ;
+    double lstObs;
+    double hourAngle;
+    double calibrationMean;
+    double calibrationErr;
+};
+
+struct StarRecord {
+    double x, y, vx, vy, vxy;
+    double flux, fluxErr, mag, magErr;
+};
+
+struct RefStarRecord {
+    StarRecord star;
+    double properMotion[5];  // ra, dec, raErr, decErr, raDecCov
+    std::int64_t hasProperMotion;
+};
+
+struct FittedStarRecord {
+    StarRecord star;
+    std::int64_t indexInMatrix;
+    std::int64_t refStar;  // index in the RefStar records, -1 for none
+    std::int64_t measurementCount;
+    // 0 for a FittedStar that is no longer in the fittedStarList, but still has MeasuredStars (outliers).
+    std::int64_t inList;
+    std::int64_t fixed;
+};
+
+struct MeasuredStarRecord {
+    StarRecord star;
+    double instFlux, instFluxErr;
+    double xFocal, yFocal;
+    std::int64_t id;
+    std::int64_t fittedStar;  // index in the FittedStar records, -1 for none
+    std::int64_t valid;
+};
+
+static_assert(std::is_trivially_copyable<Header>::value,
+              "Checkpoint records are written as raw bytes");
+static_assert(std::is_trivially_copyable<CcdImageRecord>::value,
+              "Checkpoint records are written as raw bytes");
+static_assert(std::is_trivially_copyable<RefStarRecord>::value,
+              "Checkpoint records are written as raw bytes");
+static_assert(std::is_trivially_copyable<FittedStarRecord>::value,
+              "Checkpoint records are written as raw bytes");
+static_assert(std::is_trivially_copyable<MeasuredStarRecord>::value,
+              "Checkpoint records are written as raw bytes");
+
+StarRecord makeStarRecord(BaseStar const &star) {
+    return StarRecord{star.x,       star.y,           star.vx,        star.vy,          star.vxy,
+                      star.getFlux(), star.getFluxErr(), star.getMag(), star.getMagErr()};
+}
+
+void restoreStar(StarRecord const &record, BaseStar &star) {
+    star.x = record.x;
+    star.y = record.y;
+    star.vx = record.vx;
+    star.vy = record.vy;
+    star.vxy = record.vxy;
+    star.setFlux(record.flux);
+    star.setFluxErr(record.fluxErr);
+    star.getMag() = record.mag;
+    star.setMagErr(record.magErr);
+}
+
+using FittedStarIndex = std::unordered_map<FittedStar const *, std::int64_t>;
+
+MeasuredStarRecord makeMeasuredStarRecord(MeasuredStar &star, FittedStarIndex const &fittedIndex) {
+    MeasuredStarRecord record;
+    record.star = makeStarRecord(star);
+    record.instFlux = star.getInstFlux();
+    record.instFluxErr = star.getInstFluxErr();
+    record.xFocal = star.getXFocal();
+    record.yFocal = star.getYFocal();
+    record.id = star.getId();
+    record.fittedStar = star.getFittedStar() ? fittedIndex.at(star.getFittedStar().get()) : -1;
+    record.valid = star.isValid();
+    return record;
+}
+
+/// Write the raw bytes of arrays of records, throwing on the first failure.
+class Writer {
+public:
+    explicit Writer(std::string const &filename) : _filename(filename), _out(filename, std::ios::binary) {
+        if (!_out) {
+            throw LSST_EXCEPT(pex::exceptions::IoError, "Could not open checkpoint " + _filename);
+        }
+    }
+
+    template <typename T>
+    void write(T const *data, std::size_t count) {
+        _out.write(reinterpret_cast<char const *>(data), count * sizeof(T));
+        if (!_out) {
+            throw LSST_EXCEPT(pex::exceptions::IoError, "Could not write checkpoint " + _filename);
+        }
+    }
+
+    template <typename T>
+    void write(std::vector<T> const &records) {
+        write(records.data(), records.size());
+    }
+
+    void write(std::string const &string) {
+        std::uint64_t size = string.size();
+        write(&size, 1);
+        write(string.data(), string.size());
+    }
+
+    void close() {
+        _out.close();
+        if (!_out) {
+            throw LSST_EXCEPT(pex::exceptions::IoError, "Could not write checkpoint " + _filename);
+        }
+    }
+
+private:
+    std::string _filename;
+    std::ofstream _out;
+};
+
+/// Read the raw bytes of arrays of records, throwing if the file is shorter than expected.
+class Reader {
+public:
+    explicit Reader(std::string const &filename) : _filename(filename), _in(filename, std::ios::binary) {
+        if (!_in) {
+            throw LSST_EXCEPT(pex::exceptions::IoError, "Could not open checkpoint " + _filename);
+        }
+    }
+
+    template <typename T>
+    void read(T *data, std::size_t count) {
+        _in.read(reinterpret_cast<char *>(data), count * sizeof(T));
+        if (!_in) {
+            throw LSST_EXCEPT(pex::exceptions::IoError, "Checkpoint " + _filename + " is truncated");
+        }
+    }
+
+    template <typename T>
+    std::vector<T> read(std::int64_t count) {
+        if (count < 0) {
+            throw LSST_EXCEPT(pex::exceptions::IoError, "Checkpoint " + _filename + " is corrupted");
+        }
+        std::vector<T> records(count);
+        read(records.data(), records.size());
+        return records;
+    }
+
+    std::string readString() {
+        std::uint64_t size;
+        read(&size, 1);
+        std::string string(size, '\0');
+        read(&string[0], size);
+        return string;
+    }
+
+private:
+    std::string _filename;
+    std::ifstream _in;
+};
+
+}  // namespace
+
+void Checkpoint::write(std::string const &filename, Associations const &associations,
+                       Eigen::VectorXd const &modelParameters) {
+    // Index the stars, so that the links between them can be written as indices.
+    std::unordered_map<RefStar const *, std::int64_t> refIndex;
+    std::vector<RefStarRecord> refStars;
+    refStars.reserve(associations.refStarList.size());
+    for (auto const &refStar : associations.refStarList) {
+        refIndex.emplace(refStar.get(), refStars.size());
+        RefStarRecord record{makeStarRecord(*refStar), {0, 0, 0, 0, 0}, 0};
+        if (auto properMotion = refStar->getProperMotion()) {
+            record.properMotion[0] = properMotion->getRa();
+            record.properMotion[1] = properMotion->getDec();
+            record.properMotion[2] = properMotion->getRaErr();
+            record.properMotion[3] = properMotion->getDecErr();
+            record.properMotion[4] = properMotion->getRaDecCov();
+            record.hasProperMotion = 1;
+        }
+        refStars.push_back(record);
+    }
+
+    FittedStarIndex fittedIndex;
+    std::vector<FittedStar const *> fittedStars;
+    auto addFittedStar = [&fittedIndex, &fittedStars](FittedStar const *fittedStar) {
+        if (fittedIndex.emplace(fittedStar, fittedStars.size()).second) fittedStars.push_back(fittedStar);
+    };
+    for (auto const &fittedStar : associations.fittedStarList) addFittedStar(fittedStar.get());
+    std::size_t nInList = fittedStars.size();
+    for (auto const &ccdImage : associations.ccdImageList) {
+        for (auto const &catalog : {&ccdImage->_wholeCatalog, &ccdImage->_catalogForFit}) {
+            for (auto const &measuredStar : *catalog) {
+                if (measuredStar->getFittedStar()) addFittedStar(measuredStar->getFittedStar().get());
+            }
+        }
+    }
+
+    std::size_t nOrphanRefStars = 0;
+    std::vector<FittedStarRecord> fittedRecords;
+    fittedRecords.reserve(fittedStars.size());
+    for (std::size_t i = 0; i < fittedStars.size(); ++i) {
+        FittedStar const &fittedStar = *fittedStars[i];
+        std::int64_t refStar = -1;
+        if (fittedStar.getRefStar() != nullptr) {
+            auto found = refIndex.find(fittedStar.getRefStar());
+            if (found != refIndex.end()) {
+                refStar = found->second;
+            } else {
+                nOrphanRefStars++;
+            }
+        }
+        fittedRecords.push_back(FittedStarRecord{makeStarRecord(fittedStar), fittedStar.getIndexInMatrix(),
+                                                 refStar, fittedStar.getMeasurementCount(), i < nInList,
+                                                 fittedStar.isFixed()});
+    }
+    if (nOrphanRefStars > 0) {
+        LOGLS_WARN(_log, nOrphanRefStars << " FittedStars are associated with a RefStar that is not in the "
+                                            "refStarList: their association is not checkpointed.");
+    }
+
+    std::vector<CcdImageRecord> ccdImages;
+    std::vector<MeasuredStarRecord> wholeCatalog;
+    std::vector<MeasuredStarRecord> catalogForFit;
+    ccdImages.reserve(associations.ccdImageList.size());
+    wholeCatalog.reserve(associations.getMaxMeasuredStars());
+    catalogForFit.reserve(associations.getMaxMeasuredStars());
+    for (auto const &ccdImage : associations.ccdImageList) {
+        Frame const &frame = ccdImage->_imageFrame;
+        auto photoCalib = ccdImage->_photoCalib;
+        ccdImages.push_back(CcdImageRecord{
+                ccdImage->_visit,
+                ccdImage->_ccdId,
+                static_cast<std::int64_t>(ccdImage->_wholeCatalog.size()),
+                static_cast<std::int64_t>(ccdImage->_catalogForFit.size()),
+                {frame.xMin, frame.yMin, frame.xMax, frame.yMax},
+                {ccdImage->_boresightRaDec.getLongitude().asRadians(),
+                 ccdImage->_boresightRaDec.getLatitude().asRadians()},
+                ccdImage->_airMass,
+                ccdImage->_epoch,
+                ccdImage->_sinEta,
+                ccdImage->_cosEta,
+                ccdImage->_tanZ,
+                ccdImage->_lstObs,
+                ccdImage->_hourAngle,
+                photoCalib ? photoCalib->getCalibrationMean() : std::numeric_limits<double>::quiet_NaN(),
+                photoCalib ? photoCalib->getCalibrationErr() : std::numeric_limits<double>::quiet_NaN()});
+        for (auto const &measuredStar : ccdImage->_wholeCatalog) {
+            wholeCatalog.push_back(makeMeasuredStarRecord(*measuredStar, fittedIndex));
+        }
+        for (auto const &measuredStar : ccdImage->_catalogForFit) {
+            catalogForFit.push_back(makeMeasuredStarRecord(*measuredStar, fittedIndex));
+        }
+    }
+
+    Header header;
+    std::memcpy(header.magic, checkpointMagic, sizeof(header.magic));
+    header.version = checkpointVersion;
+    header.byteOrder = byteOrderMark;
+    header.nCcdImages = ccdImages.size();
+    header.nRefStars = refStars.size();
+    header.nFittedStars = fittedRecords.size();
+    header.nWholeCatalog = wholeCatalog.size();
+    header.nCatalogForFit = catalogForFit.size();
+    header.nModelParameters = modelParameters.size();
+    header.maxMeasuredStars = associations._maxMeasuredStars;
+    header.wcsSurrogateMaxOrder = associations._wcsSurrogateMaxOrder;
+    header.fittedStarsInTangentPlane = associations.fittedStarList.inTangentPlaneCoordinates;
+    header.commonTangentPoint[0] = associations._commonTangentPoint.x;
+    header.commonTangentPoint[1] = associations._commonTangentPoint.y;
+    header.epoch = associations._epoch;
+    header.wcsSurrogateMaxError = associations._wcsSurrogateMaxError;
+
+    // Write next to filename and rename, so that an interrupted write does not destroy the previous one.
+    std::string tmpFilename = filename + ".tmp";
+    try {
+        Writer writer(tmpFilename);
+        writer.write(&header, 1);
+        writer.write(ccdImages);
+        for (auto const &ccdImage : associations.ccdImageList) {
+            writer.write(ccdImage->_name);
+            writer.write(ccdImage->_filter);
+            writer.write(ccdImage->_readWcs->getSkyWcs()->writeString());
+        }
+        writer.write(refStars);
+        writer.write(fittedRecords);
+        writer.write(wholeCatalog);
+        writer.write(catalogForFit);
+        writer.write(modelParameters.data(), modelParameters.size());
+        writer.close();
+    } catch (pex::exceptions::IoError &) {
+        std::remove(tmpFilename.c_str());
+        throw;
+    }
+    if (std::rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+        std::remove(tmpFilename.c_str());
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Could not rename checkpoint to " + filename);
+    }
+    LOGLS_DEBUG(_log, "Wrote checkpoint " << filename << " of " << ccdImages.size() << " ccdImages, "
+                                          << fittedRecords.size() << " fittedStars and "
+                                          << modelParameters.size() << " model parameters.");
+}
+
+Checkpoint::Checkpoint(std::string const &filename, DetectorMap const &detectors) {
+    Reader reader(filename);
+    Header header;
+    reader.read(&header, 1);
+    if (std::memcmp(header.magic, checkpointMagic, sizeof(header.magic)) != 0) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, filename + " is not a jointcal checkpoint");
+    }
+    if (header.byteOrder != byteOrderMark) {
+        throw LSST_EXCEPT(pex::exceptions::IoError,
+                          "Checkpoint " + filename + " was written on a machine with another byte order");
+    }
+    if (header.version != checkpointVersion) {
+        throw LSST_EXCEPT(pex::exceptions::IoError,
+                          "Checkpoint " + filename + " has version " + std::to_string(header.version) +
+                                  ", but this version of jointcal reads version " +
+                                  std::to_string(checkpointVersion));
+    }
+
+    auto ccdRecords = reader.read<CcdImageRecord>(header.nCcdImages);
+    CcdImageList ccdImageList;
+    for (auto const &record : ccdRecords) {
+        // CcdImage's only constructor needs a SourceCatalog: rebuild its state directly instead.
+        std::shared_ptr<CcdImage> ccdImage(new CcdImage());
+        ccdImage->_name = reader.readString();
+        ccdImage->_filter = reader.readString();
+        std::string wcsString = reader.readString();
+        ccdImage->_readWcs =
+                std::make_shared<AstrometryTransformSkyWcs>(afw::geom::SkyWcs::readString(wcsString));
+        ccdImage->_visit = record.visit;
+        ccdImage->_ccdId = record.ccd;
+        ccdImage->_imageFrame =
+                Frame(record.imageFrame[0], record.imageFrame[1], record.imageFrame[2], record.imageFrame[3]);
+        ccdImage->_boresightRaDec = geom::SpherePoint(record.boresightRaDec[0], record.boresightRaDec[1],
+                                                      geom::radians);
+        ccdImage->_airMass = record.airMass;
+        ccdImage->_epoch = record.epoch;
+        ccdImage->_sinEta = record.sinEta;
+        ccdImage->_cosEta = record.cosEta;
+        ccdImage->_tanZ = record.tanZ;
+        ccdImage->_lstObs = record.lstObs;
+        ccdImage->_hourAngle = record.hourAngle;
+        if (!std::isnan(record.calibrationMean)) {
+            ccdImage->_photoCalib =
+                    std::make_shared<afw::image::PhotoCalib>(record.calibrationMean, record.calibrationErr);
+        }
+        auto detector = detectors.find(record.ccd);
+        if (detector == detectors.end()) {
+            throw LSST_EXCEPT(pex::exceptions::NotFoundError,
+                              "No detector for ccd " + std::to_string(record.ccd) + " of checkpoint " +
+                                      filename);
+        }
+        ccdImage->_detector = detector->second;
+        ccdImageList.push_back(ccdImage);
+    }
+
+    auto refRecords = reader.read<RefStarRecord>(header.nRefStars);
+    std::vector<RefStar const *> refStars;
+    refStars.reserve(refRecords.size());
+    RefStarList refStarList;
+    for (auto const &record : refRecords) {
+        auto refStar = std::make_shared<RefStar>(record.star.x, record.star.y, record.star.flux,
+                                                 record.star.fluxErr);
+        restoreStar(record.star, *refStar);
+        if (record.hasProperMotion) {
+            auto const &pm = record.properMotion;
+            refStar->setProperMotion(std::make_unique<ProperMotion const>(pm[0], pm[1], pm[2], pm[3], pm[4]));
+        }
+        refStars.push_back(refStar.get());
+        refStarList.push_back(std::move(refStar));
+    }
+
+    auto fittedRecords = reader.read<FittedStarRecord>(header.nFittedStars);
+    std::vector<std::shared_ptr<FittedStar>> fittedStars;
+    fittedStars.reserve(fittedRecords.size());
+    FittedStarList fittedStarList;
+    for (auto const &record : fittedRecords) {
+        auto fittedStar = std::make_shared<FittedStar>();
+        restoreStar(record.star, *fittedStar);
+        fittedStar->setIndexInMatrix(record.indexInMatrix);
+        fittedStar->setFixed(record.fixed);
+        if (record.refStar >= 0) {
+            if (record.refStar >= static_cast<std::int64_t>(refStars.size())) {
+                throw LSST_EXCEPT(pex::exceptions::IoError, "Checkpoint " + filename + " is corrupted");
+            }
+            fittedStar->setRefStar(refStars[record.refStar]);
+        }
+        fittedStars.push_back(fittedStar);
+        if (record.inList) fittedStarList.push_back(std::move(fittedStar));
+    }
+    fittedStarList.inTangentPlaneCoordinates = header.fittedStarsInTangentPlane;
+
+    auto restoreCatalog = [&](std::vector<MeasuredStarRecord> const &records, std::size_t &next,
+                              std::int64_t count, CcdImage const *ccdImage, MeasuredStarList &catalog) {
+        if (next + count > records.size()) {
+            throw LSST_EXCEPT(pex::exceptions::IoError, "Checkpoint " + filename + " is corrupted");
+        }
+        for (std::size_t end = next + count; next < end; ++next) {
+            auto const &record = records[next];
+            auto measuredStar = std::make_shared<MeasuredStar>();
+            restoreStar(record.star, *measuredStar);
+            measuredStar->setInstFluxAndErr(record.instFlux, record.instFluxErr);
+            measuredStar->setXFocal(record.xFocal);
+            measuredStar->setYFocal(record.yFocal);
+            measuredStar->setId(record.id);
+            measuredStar->setValid(record.valid);
+            measuredStar->setCcdImage(ccdImage);
+            if (record.fittedStar >= static_cast<std::int64_t>(fittedStars.size())) {
+                throw LSST_EXCEPT(pex::exceptions::IoError, "Checkpoint " + filename + " is corrupted");
+            }
+            if (record.fittedStar >= 0) measuredStar->setFittedStar(fittedStars[record.fittedStar]);
+            catalog.push_back(std::move(measuredStar));
+        }
+    };
+    auto wholeCatalog = reader.read<MeasuredStarRecord>(header.nWholeCatalog);
+    auto catalogForFit = reader.read<MeasuredStarRecord>(header.nCatalogForFit);
+    std::size_t nextWhole = 0;
+    std::size_t nextForFit = 0;
+    auto ccdRecord = ccdRecords.begin();
+    for (auto const &ccdImage : ccdImageList) {
+        restoreCatalog(wholeCatalog, nextWhole, ccdRecord->nWholeCatalog, ccdImage.get(),
+                       ccdImage->_wholeCatalog);
+        restoreCatalog(catalogForFit, nextForFit, ccdRecord->nCatalogForFit, ccdImage.get(),
+                       ccdImage->_catalogForFit);
+        ++ccdRecord;
+    }
+    // setFittedStar() counted every link, invalid MeasuredStars included: restore the counts as they were.
+    for (std::size_t i = 0; i < fittedStars.size(); ++i) {
+        fittedStars[i]->getMeasurementCount() = fittedRecords[i].measurementCount;
+    }
+
+    _modelParameters.resize(header.nModelParameters);
+    reader.read(_modelParameters.data(), _modelParameters.size());
+
+    _associations = std::make_shared<Associations>(ccdImageList, header.epoch);
+    _associations->refStarList = std::move(refStarList);
+    _associations->fittedStarList = std::move(fittedStarList);
+    _associations->_maxMeasuredStars = header.maxMeasuredStars;
+    _associations->setWcsSurrogate(header.wcsSurrogateMaxError, header.wcsSurrogateMaxOrder);
+    if (!std::isnan(header.commonTangentPoint[0])) {
+        _associations->setCommonTangentPoint(
+                geom::Point2D(header.commonTangentPoint[0], header.commonTangentPoint[1]));
+    }
+    LOGLS_INFO(_log, "Read checkpoint " << filename << " of " << ccdImageList.size() << " ccdImages, "
+                                        << fittedStars.size() << " fittedStars and "
+                                        << _modelParameters.size() << " model parameters.");
+}
+
+}  // namespace jointcal
+}  // namespace lsst
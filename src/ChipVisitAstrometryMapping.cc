@@ -33,10 +33,6 @@ namespace jointcal {
 ChipVisitAstrometryMapping::ChipVisitAstrometryMapping(std::shared_ptr<SimpleAstrometryMapping> chipMapping,
                                                        std::shared_ptr<SimpleAstrometryMapping> visitMapping)
         : _m1(chipMapping), _m2(visitMapping) {
-    /* Allocate the record of temporary variables, so that they are not
-       allocated at every call. This is hidden behind a pointer in order
-       to be allowed to alter them in a const routine. */
-    tmp = std::unique_ptr<tmpVars>(new tmpVars);
     setWhatToFit(true, true);
 }
 
@@ -67,34 +63,38 @@ void ChipVisitAstrometryMapping::computeTransformAndDerivatives(FatPoint const &
     FatPoint pMid;
     // don't need errors there but no Mapping::Transform() routine.
 
+    /* The scratch matrices are per thread, so that this routine can be called concurrently (e.g. on
+       the same mapping from several fits) without allocating at every call: resize() only reallocates
+       when the number of parameters changes. */
+    thread_local Eigen::MatrixX2d h1, h2;
+    Eigen::Matrix2d dt2dx;
     if (_nPar1) {
-        _m1->computeTransformAndDerivatives(where, pMid, tmp->h1);
+        h1.resize(_nPar1, 2);
+        _m1->computeTransformAndDerivatives(where, pMid, h1);
         // the last argument is epsilon and is not used for polynomials
-        _m2->positionDerivative(pMid, tmp->dt2dx, 1e-4);
-        H.block(0, 0, _nPar1, 2) = tmp->h1 * tmp->dt2dx;
+        _m2->positionDerivative(pMid, dt2dx, 1e-4);
+        H.block(0, 0, _nPar1, 2) = h1 * dt2dx;
     } else
         _m1->transformPosAndErrors(where, pMid);
     if (_nPar2) {
-        _m2->computeTransformAndDerivatives(pMid, outPoint, tmp->h2);
-        H.block(_nPar1, 0, _nPar2, 2) = tmp->h2;
+        h2.resize(_nPar2, 2);
+        _m2->computeTransformAndDerivatives(pMid, outPoint, h2);
+        H.block(_nPar1, 0, _nPar2, 2) = h2;
     } else
         _m2->transformPosAndErrors(pMid, outPoint);
 }
 
-/*! Sets the _nPar{1,2} and allocates H matrices accordingly, to
-   avoid allocation at every call. If we did not care about dynamic
+/*! Sets the _nPar{1,2}. If we did not care about dynamic
    allocation, we could just put the information of what moves and
    what doesn't into the SimpleAstrometryMapping. */
 void ChipVisitAstrometryMapping::setWhatToFit(const bool fittingT1, const bool fittingT2) {
-    if (fittingT1) {
+    if (fittingT1)
         _nPar1 = _m1->getNpar();
-        tmp->h1 = Eigen::MatrixX2d(_nPar1, 2);
-    } else
+    else
         _nPar1 = 0;
-    if (fittingT2) {
+    if (fittingT2)
         _nPar2 = _m2->getNpar();
-        tmp->h2 = Eigen::MatrixX2d(_nPar2, 2);
-    } else
+    else
         _nPar2 = 0;
 }
 
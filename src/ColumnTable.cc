@@ -0,0 +1,125 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "lsst/pex/exceptions.h"
+
+#include "lsst/jointcal/ColumnTable.h"
+
+namespace lsst {
+namespace jointcal {
+
+namespace {
+static_assert(sizeof(double) == 8, "Column files store doubles as 8 bytes");
+
+bool isLittleEndian() {
+    std::uint16_t const probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+/// Write each of the count 8-byte values at data in little-endian order, whatever the host order.
+void writeLittleEndian(std::ofstream &ofile, void const *data, std::size_t count) {
+    if (isLittleEndian()) {
+        ofile.write(static_cast<char const *>(data), count * 8);
+        return;
+    }
+    auto bytes = static_cast<char const *>(data);
+    char swapped[8];
+    for (std::size_t i = 0; i < count; ++i, bytes += 8) {
+        std::reverse_copy(bytes, bytes + 8, swapped);
+        ofile.write(swapped, 8);
+    }
+}
+
+void writeInt64(std::ofstream &ofile, std::int64_t value) { writeLittleEndian(ofile, &value, 1); }
+
+void writeString(std::ofstream &ofile, std::string const &value) {
+    writeInt64(ofile, value.size());
+    ofile.write(value.data(), value.size());
+}
+}  // namespace
+
+ColumnTable::FloatColumn &ColumnTable::addFloatColumn(std::string const &name,
+                                                      std::string const &description) {
+    _columns.push_back(std::make_unique<Column>(Column{name, description, false, {}, {}}));
+    return _columns.back()->floats;
+}
+
+ColumnTable::IntColumn &ColumnTable::addIntColumn(std::string const &name, std::string const &description) {
+    _columns.push_back(std::make_unique<Column>(Column{name, description, true, {}, {}}));
+    return _columns.back()->ints;
+}
+
+void ColumnTable::reserve(std::size_t nRows) {
+    for (auto &column : _columns) {
+        if (column->isInt) {
+            column->ints.reserve(nRows);
+        } else {
+            column->floats.reserve(nRows);
+        }
+    }
+}
+
+void ColumnTable::write(std::string const &filename) const {
+    auto size = [](Column const &column) { return column.isInt ? column.ints.size() : column.floats.size(); };
+    std::size_t nRows = _columns.empty() ? 0 : size(*_columns.front());
+    for (auto const &column : _columns) {
+        if (size(*column) != nRows) {
+            throw LSST_EXCEPT(pex::exceptions::LengthError,
+                              "Column " + column->name + " has " + std::to_string(size(*column)) +
+                                      " rows instead of " + std::to_string(nRows));
+        }
+    }
+
+    std::ofstream ofile(filename, std::ios::binary);
+    if (!ofile) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Cannot open column file for writing: " + filename);
+    }
+    ofile.write("JCCOLS02", 8);
+    writeInt64(ofile, _columns.size());
+    writeInt64(ofile, nRows);
+    for (auto const &column : _columns) {
+        writeInt64(ofile, column->isInt ? 1 : 0);
+        writeString(ofile, column->name);
+        writeString(ofile, column->description);
+    }
+    for (auto const &column : _columns) {
+        if (column->isInt) {
+            writeLittleEndian(ofile, column->ints.data(), nRows);
+        } else {
+            writeLittleEndian(ofile, column->floats.data(), nRows);
+        }
+    }
+    if (!ofile) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Failed to write column file: " + filename);
+    }
+}
+
+}  // namespace jointcal
+}  // namespace lsst
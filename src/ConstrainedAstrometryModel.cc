@@ -31,12 +31,14 @@
 #include "lsst/jointcal/CcdImage.h"
 #include "lsst/jointcal/AstrometryModel.h"
 #include "lsst/jointcal/AstrometryTransform.h"
+#include "lsst/jointcal/ParallelFor.h"
 #include "lsst/jointcal/ProjectionHandler.h"
 #include "lsst/jointcal/StarMatch.h"
 
 #include "lsst/pex/exceptions.h"
 namespace pexExcept = lsst::pex::exceptions;
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <iostream>
@@ -56,6 +58,22 @@ void outputMapKeys(std::map<KeyType, ValueType> const &map, std::ostream &os) {
     }
     os << "]";
 }
+
+/*
+ * Fit the AST inverse of each transform over its domain, in parallel.
+ * Each fit only reads its own forward transform, so the fits are independent of each other.
+ */
+std::vector<std::shared_ptr<lsst::jointcal::AstrometryTransformPolynomial>> fitAstMapInverses(
+        std::vector<std::pair<lsst::jointcal::AstrometryTransformPolynomial, lsst::jointcal::Frame>> const
+                &transforms,
+        unsigned nThreads) {
+    std::vector<std::shared_ptr<lsst::jointcal::AstrometryTransformPolynomial>> inverses(transforms.size());
+    lsst::jointcal::parallelFor(
+            transforms.size(),
+            [&](std::size_t i) { inverses[i] = transforms[i].first.fitAstMapInverse(transforms[i].second); },
+            nThreads);
+    return inverses;
+}
 }  // namespace
 
 namespace lsst {
@@ -66,6 +84,7 @@ ConstrainedAstrometryModel::ConstrainedAstrometryModel(
         int chipOrder, int visitOrder)
         : AstrometryModel(LOG_GET("jointcal.ConstrainedAstrometryModel")),
           _skyToTangentPlane(projectionHandler) {
+    Instrumentation::Timer timer(_instrumentation, "ConstrainedAstrometryModel");
     // keep track of which chip we want to hold fixed (the one closest to the middle of the focal plane)
     double minRadius2 = std::numeric_limits<double>::infinity();
     CcdIdType constrainedChip = -1;
@@ -92,6 +111,7 @@ ConstrainedAstrometryModel::ConstrainedAstrometryModel(
             auto pixelsToFocal =
                     im.getDetector()->getTransform(afw::cameraGeom::PIXELS, afw::cameraGeom::FOCAL_PLANE);
             Frame const &frame = im.getImageFrame();
+            _chipFrames.emplace(chip, frame);
             // construct the chip transform by approximating the pixel->Focal afw::geom::Transform.
             AstrometryTransformPolynomial pol =
                     AstrometryTransformPolynomial(pixelsToFocal, frame, chipOrder);
@@ -115,6 +135,7 @@ ConstrainedAstrometryModel::ConstrainedAstrometryModel(
         if (_chipMap.find(chip) == _chipMap.end()) {
             LOGLS_WARN(_log, "Chip " << chip << " is missing in the reference exposure, expect troubles.");
             AstrometryTransformLinear norm = normalizeCoordinatesTransform(im.getImageFrame());
+            _chipFrames.emplace(chip, im.getImageFrame());
             _chipMap[chip] =
                     std::make_shared<SimplePolyMapping>(norm, AstrometryTransformPolynomial(chipOrder));
         }
@@ -127,6 +148,8 @@ ConstrainedAstrometryModel::ConstrainedAstrometryModel(
     LOGLS_DEBUG(_log, "CcdImage map has " << _mappings.size() << " mappings, with "
                                           << _mappings.bucket_count() << " buckets and a load factor of "
                                           << _mappings.load_factor());
+    timer.addCounter("mappings", _chipMap.size() + _visitMap.size());
+    timer.addCounter("parameters", getTotalParameters());
 }
 
 const AstrometryMapping *ConstrainedAstrometryModel::getMapping(CcdImage const &ccdImage) const {
@@ -169,6 +192,7 @@ Eigen::Index ConstrainedAstrometryModel::assignIndices(std::string const &whatTo
 }
 
 void ConstrainedAstrometryModel::offsetParams(Eigen::VectorXd const &delta) {
+    clearAstMaps();
     if (_fittingChips)
         for (auto &i : _chipMap) {
             auto mapping = i.second.get();
@@ -181,6 +205,31 @@ void ConstrainedAstrometryModel::offsetParams(Eigen::VectorXd const &delta) {
         }
 }
 
+void ConstrainedAstrometryModel::setParameters(Eigen::VectorXd const &parameters) {
+    clearAstMaps();
+    AstrometryModel::setParameters(parameters);
+}
+
+std::size_t ConstrainedAstrometryModel::setMappingParameters(
+        MappingParameters const &parameters) {
+    clearAstMaps();
+    return AstrometryModel::setMappingParameters(parameters);
+}
+
+void ConstrainedAstrometryModel::clearAstMaps() const {
+    std::lock_guard<std::mutex> lock(_astMapsMutex);
+    _chipAstMaps.clear();
+    _visitAstMaps.clear();
+}
+
+std::vector<AstrometryModel::KeyedMapping> ConstrainedAstrometryModel::getAllMappings() const {
+    std::vector<KeyedMapping> mappings;
+    mappings.reserve(_chipMap.size() + _visitMap.size());
+    for (auto const &i : _chipMap) mappings.emplace_back(CcdImageKey{-1, i.first}, i.second.get());
+    for (auto const &i : _visitMap) mappings.emplace_back(CcdImageKey{i.first, -1}, i.second.get());
+    return mappings;
+}
+
 void ConstrainedAstrometryModel::freezeErrorTransform() {
     for (auto i = _visitMap.begin(); i != _visitMap.end(); ++i) i->second->freezeErrorTransform();
     for (auto i = _chipMap.begin(); i != _chipMap.end(); ++i) i->second->freezeErrorTransform();
@@ -233,10 +282,13 @@ std::shared_ptr<afw::geom::SkyWcs> ConstrainedAstrometryModel::makeSkyWcs(CcdIma
     auto proj = std::dynamic_pointer_cast<const TanRaDecToPixel>(getSkyToTangentPlane(ccdImage));
     jointcal::Point tangentPoint(proj->getTangentPoint());
 
-    auto imageFrame = ccdImage.getImageFrame();
-    auto pixelsToFocal = getChipTransform(ccdImage.getCcdId()).toAstMap(imageFrame);
-    jointcal::Frame focalBox = getChipTransform(ccdImage.getCcdId()).apply(imageFrame, false);
-    auto focalToIwc = getVisitTransform(ccdImage.getVisit()).toAstMap(focalBox);
+    std::shared_ptr<ast::Mapping> pixelsToFocal, focalToIwc;
+    {
+        std::lock_guard<std::mutex> lock(_astMapsMutex);
+        if (_chipAstMaps.empty()) computeAstMaps();
+        pixelsToFocal = _chipAstMaps.at(ccdImage.getCcdId());
+        focalToIwc = _visitAstMaps.at(ccdImage.getHashKey());
+    }
 
     ast::Frame pixelFrame(2, "Domain=PIXELS");
     ast::Frame focalFrame(2, "Domain=FOCAL");
@@ -256,6 +308,52 @@ std::shared_ptr<afw::geom::SkyWcs> ConstrainedAstrometryModel::makeSkyWcs(CcdIma
     return std::make_shared<afw::geom::SkyWcs>(frameDict);
 }
 
+std::unordered_map<CcdImageKey, std::shared_ptr<afw::geom::SkyWcs>> ConstrainedAstrometryModel::makeSkyWcsMap(
+        CcdImageList const &ccdImageList, unsigned nThreads) const {
+    {
+        std::lock_guard<std::mutex> lock(_astMapsMutex);
+        if (_chipAstMaps.empty()) computeAstMaps(nThreads);
+    }
+    return AstrometryModel::makeSkyWcsMap(ccdImageList, nThreads);
+}
+
+void ConstrainedAstrometryModel::computeAstMaps(unsigned nThreads) const {
+    // Collect copies of the transforms here, so that fitting their inverses in parallel does not depend
+    // on the mappings staying unchanged meanwhile.
+    std::vector<std::pair<AstrometryTransformPolynomial, Frame>> transforms;
+    std::vector<CcdIdType> chips;
+    std::vector<CcdImageKey> ccdImageKeys;
+    transforms.reserve(_chipMap.size() + _mappings.size());
+
+    std::map<CcdIdType, Frame> focalBoxes;
+    for (auto const &i : _chipMap) {
+        auto const &transform = dynamic_cast<AstrometryTransformPolynomial const &>(i.second->getTransform());
+        Frame const &imageFrame = _chipFrames.at(i.first);
+        chips.push_back(i.first);
+        transforms.emplace_back(transform, imageFrame);
+        focalBoxes[i.first] = transform.apply(imageFrame, false);
+    }
+    for (auto const &i : _mappings) {
+        auto const &transform = dynamic_cast<AstrometryTransformPolynomial const &>(
+                _visitMap.at(i.first.visit)->getTransform());
+        ccdImageKeys.push_back(i.first);
+        transforms.emplace_back(transform, focalBoxes.at(i.first.ccd));
+    }
+
+    auto inverses = fitAstMapInverses(transforms, nThreads);
+
+    // Creating the AST objects is cheap; keep it serial.
+    for (std::size_t i = 0; i < chips.size(); ++i) {
+        _chipAstMaps[chips[i]] = transforms[i].first.toAstMap(*inverses[i]);
+    }
+    for (std::size_t i = 0; i < ccdImageKeys.size(); ++i) {
+        std::size_t k = chips.size() + i;
+        _visitAstMaps[ccdImageKeys[i]] = transforms[k].first.toAstMap(*inverses[k]);
+    }
+    LOGLS_DEBUG(_log, "Computed AST mappings for " << chips.size() << " chips and " << ccdImageKeys.size()
+                                                   << " visit/chip pairs.");
+}
+
 void ConstrainedAstrometryModel::print(std::ostream &out) const {
     out << "Constrained Astrometry Model (" << _mappings.size() << " composite mappings; " << _chipMap.size()
         << " sensor mappings, " << _visitMap.size() << " visit mappings):" << std::endl;
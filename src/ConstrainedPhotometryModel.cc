@@ -70,6 +70,7 @@ Eigen::Index ConstrainedPhotometryModel::assignIndices(std::string const &whatTo
     if (_fittingVisits) {
         for (auto &idMapping : _visitMap) {
             auto mapping = idMapping.second.get();
+            if (mapping->isFixed()) continue;
             mapping->setIndex(index);
             index += mapping->getNpar();
         }
@@ -92,6 +93,7 @@ void ConstrainedPhotometryModel::offsetParams(Eigen::VectorXd const &delta) {
     if (_fittingVisits) {
         for (auto &idMapping : _visitMap) {
             auto mapping = idMapping.second.get();
+            if (mapping->isFixed()) continue;
             mapping->offsetParams(delta.segment(mapping->getIndex(), mapping->getNpar()));
         }
     }
@@ -122,11 +124,85 @@ std::size_t ConstrainedPhotometryModel::getTotalParameters() const {
     return total;
 }
 
+std::vector<PhotometryModel::KeyedMapping> ConstrainedPhotometryModel::getAllMappings() const {
+    std::vector<KeyedMapping> mappings;
+    mappings.reserve(_chipMap.size() + _visitMap.size());
+    for (auto const &idMapping : _chipMap) {
+        mappings.emplace_back(CcdImageKey{-1, idMapping.first}, idMapping.second.get());
+    }
+    for (auto const &idMapping : _visitMap) {
+        mappings.emplace_back(CcdImageKey{idMapping.first, -1}, idMapping.second.get());
+    }
+    return mappings;
+}
+
 void ConstrainedPhotometryModel::computeParameterDerivatives(MeasuredStar const &measuredStar,
                                                              CcdImage const &ccdImage,
                                                              Eigen::VectorXd &derivatives) const {
     auto mapping = findMapping(ccdImage);
-    mapping->computeParameterDerivatives(measuredStar, measuredStar.getInstFlux(), derivatives);
+    Eigen::Index basis = findBasis(measuredStar);
+    if (basis >= 0) {
+        mapping->computeParameterDerivativesWithBasis(measuredStar, measuredStar.getInstFlux(),
+                                                      _basisCache.col(basis), derivatives);
+    } else {
+        mapping->computeParameterDerivatives(measuredStar, measuredStar.getInstFlux(), derivatives);
+    }
+}
+
+std::size_t ConstrainedPhotometryModel::makeBasisCache(CcdImageList const &ccdImageList,
+                                                       std::size_t maxBytes) {
+    Instrumentation::Timer timer(_instrumentation, "basisCache");
+    clearBasisCache();
+    if (_visitMap.empty()) return 0;
+    // All the visit polynomials have the same order.
+    Eigen::Index nPar = _visitMap.begin()->second->getTransform()->getNpar();
+
+    std::size_t nStars = 0;
+    for (auto const &ccdImage : ccdImageList) {
+        nStars += ccdImage->getCatalogForFit().size();
+    }
+    // The basis itself, plus the index map and the shared_ptrs that keep the measurements alive.
+    std::size_t bytes = nStars * (nPar * sizeof(double) + sizeof(decltype(_basisIndex)::value_type) +
+                                  2 * sizeof(void *) + sizeof(decltype(_basisStars)::value_type));
+    if (bytes > maxBytes) {
+        LOGLS_WARN(_log, "Not caching the visit basis of " << nStars << " measurements: it would need "
+                                                           << bytes / 1048576.0 << " MB, above the "
+                                                           << maxBytes / 1048576.0 << " MB budget.");
+        return 0;
+    }
+
+    _basisCache.resize(nPar, nStars);
+    _basisIndex.reserve(nStars);
+    _basisStars.reserve(nStars);
+    for (auto const &ccdImage : ccdImageList) {
+        auto const &visitTransform = dynamic_cast<PhotometryTransformChebyshev const &>(
+                *findMapping(*ccdImage)->getVisitMapping()->getTransform());
+        for (auto const &measuredStar : ccdImage->getCatalogForFit()) {
+            Eigen::Index column = _basisStars.size();
+            visitTransform.computeBasis(measuredStar->getXFocal(), measuredStar->getYFocal(),
+                                        _basisCache.col(column));
+            _basisIndex.emplace(measuredStar.get(), column);
+            _basisStars.push_back(measuredStar);
+        }
+    }
+    LOGLS_INFO(_log, "Cached the visit basis of " << nStars << " measurements (" << nPar
+                                                  << " terms each), using " << bytes / 1048576.0 << " MB.");
+    timer.addCounter("measurements", nStars);
+    timer.addCounter("bytes", bytes);
+    return bytes;
+}
+
+void ConstrainedPhotometryModel::clearBasisCache() {
+    _basisCache.resize(0, 0);
+    decltype(_basisIndex)().swap(_basisIndex);
+    decltype(_basisStars)().swap(_basisStars);
+}
+
+std::size_t ConstrainedPhotometryModel::getBasisCacheSize() const {
+    return _basisCache.size() * sizeof(double) +
+           _basisIndex.size() * (sizeof(decltype(_basisIndex)::value_type) + sizeof(void *)) +
+           _basisIndex.bucket_count() * sizeof(void *) +
+           _basisStars.capacity() * sizeof(decltype(_basisStars)::value_type);
 }
 
 namespace {
@@ -165,7 +241,7 @@ void ConstrainedPhotometryModel::print(std::ostream &out) const {
     }
 }
 
-PhotometryMappingBase *ConstrainedPhotometryModel::findMapping(CcdImage const &ccdImage) const {
+ChipVisitPhotometryMapping *ConstrainedPhotometryModel::findMapping(CcdImage const &ccdImage) const {
     auto idMapping = _chipVisitMap.find(ccdImage.getHashKey());
     if (idMapping == _chipVisitMap.end())
         throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
@@ -176,6 +252,7 @@ PhotometryMappingBase *ConstrainedPhotometryModel::findMapping(CcdImage const &c
 template <class ChipTransform, class VisitTransform, class ChipVisitMapping>
 void ConstrainedPhotometryModel::initialize(CcdImageList const &ccdImageList,
                                             geom::Box2D const &focalPlaneBBox, int visitOrder) {
+    Instrumentation::Timer timer(_instrumentation, "ConstrainedPhotometryModel");
     // keep track of which chip we want to constrain (the one closest to the middle of the focal plane)
     double minRadius2 = std::numeric_limits<double>::infinity();
     CcdIdType constrainedChip = -1;
@@ -223,6 +300,8 @@ void ConstrainedPhotometryModel::initialize(CcdImageList const &ccdImageList,
     LOGLS_DEBUG(_log, "CcdImage map has " << _chipVisitMap.size() << " mappings, with "
                                           << _chipVisitMap.bucket_count() << " buckets and a load factor of "
                                           << _chipVisitMap.load_factor());
+    timer.addCounter("mappings", _chipMap.size() + _visitMap.size());
+    timer.addCounter("parameters", getTotalParameters());
 }
 
 ConstrainedPhotometryModel::PrepPhotoCalib ConstrainedPhotometryModel::prepPhotoCalib(
@@ -271,6 +350,10 @@ double ConstrainedFluxModel::computeResidual(CcdImage const &ccdImage,
 
 double ConstrainedFluxModel::transform(CcdImage const &ccdImage, MeasuredStar const &measuredStar) const {
     auto mapping = findMapping(ccdImage);
+    Eigen::Index basis = findBasis(measuredStar);
+    if (basis >= 0) {
+        return mapping->transformWithBasis(measuredStar, measuredStar.getInstFlux(), _basisCache.col(basis));
+    }
     return mapping->transform(measuredStar, measuredStar.getInstFlux());
 }
 
@@ -278,6 +361,11 @@ double ConstrainedFluxModel::transformError(CcdImage const &ccdImage,
                                             MeasuredStar const &measuredStar) const {
     auto mapping = findMapping(ccdImage);
     double tempErr = tweakFluxError(measuredStar);
+    Eigen::Index basis = findBasis(measuredStar);
+    if (basis >= 0) {
+        return mapping->transformErrorWithBasis(measuredStar, measuredStar.getInstFlux(), tempErr,
+                                                _basisCache.col(basis));
+    }
     return mapping->transformError(measuredStar, measuredStar.getInstFlux(), tempErr);
 }
 
@@ -315,6 +403,10 @@ double ConstrainedMagnitudeModel::computeResidual(CcdImage const &ccdImage,
 double ConstrainedMagnitudeModel::transform(CcdImage const &ccdImage,
                                             MeasuredStar const &measuredStar) const {
     auto mapping = findMapping(ccdImage);
+    Eigen::Index basis = findBasis(measuredStar);
+    if (basis >= 0) {
+        return mapping->transformWithBasis(measuredStar, measuredStar.getInstMag(), _basisCache.col(basis));
+    }
     return mapping->transform(measuredStar, measuredStar.getInstMag());
 }
 
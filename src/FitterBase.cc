@@ -22,13 +22,22 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
 #include <vector>
 #include "Eigen/Core"
 
 #include <boost/math/tools/minima.hpp>
 
 #include "lsst/log/Log.h"
+#include "lsst/pex/exceptions.h"
 
+#include "lsst/jointcal/BlockArrowheadSolver.h"
+#include "lsst/jointcal/Checkpoint.h"
 #include "lsst/jointcal/Chi2.h"
 #include "lsst/jointcal/CcdImage.h"
 #include "lsst/jointcal/Eigenstuff.h"
@@ -110,7 +119,9 @@ std::size_t FitterBase::findOutliers(double nSigmaCut, MeasuredStarList &msOutli
         } else {
             // it is a measurement outlier
             auto tempFittedStar = measuredStar->getFittedStar();
-            if (tempFittedStar->getMeasurementCount() == 1 && tempFittedStar->getRefStar() == nullptr) {
+            // A fixed FittedStar remains constrained by its previous fit.
+            if (tempFittedStar->getMeasurementCount() == 1 && tempFittedStar->getRefStar() == nullptr &&
+                !tempFittedStar->isFixed()) {
                 LOGLS_WARN(_log, "FittedStar with 1 measuredStar and no refStar found as an outlier: "
                                          << *tempFittedStar);
                 continue;
@@ -153,6 +164,19 @@ std::size_t FitterBase::findOutliers(double nSigmaCut, MeasuredStarList &msOutli
 }
 
 namespace {
+/// The chi2 contribution file name of one iterate() step; see the chi2BaseName argument of iterate().
+std::string makeStepBaseName(std::string const &chi2BaseName, int stepNumber) {
+    std::string baseName(chi2BaseName);
+    std::string const iterationStr = "{iteration}";
+    auto pos = baseName.find(iterationStr);
+    if (pos != std::string::npos) {
+        return baseName.replace(pos, iterationStr.size(), std::to_string(stepNumber));
+    }
+    pos = baseName.find("{type}");
+    return baseName.insert((pos == std::string::npos) ? baseName.size() : pos,
+                           "-" + std::to_string(stepNumber));
+}
+
 /// Return a Hessian matrix filled from tripletList of size nParTot x nParTot.
 SparseMatrixD createHessian(std::size_t nParTot, TripletList const &tripletList) {
     SparseMatrixD jacobian(nParTot, tripletList.getNextFreeIndex());
@@ -160,27 +184,88 @@ SparseMatrixD createHessian(std::size_t nParTot, TripletList const &tripletList)
     return jacobian * jacobian.transpose();
 }
 
-/// Write matrix and gradient to files built from dumpFile, and log their names.
-void dumpMatrixAndGradient(SparseMatrixD const &matrix, Eigen::VectorXd const &grad,
-                           std::string const &dumpFile, LOG_LOGGER _log) {
-    std::string ext = ".txt";
-    Eigen::MatrixXd matrixDense(matrix);
-    std::string dumpMatrixPath = dumpFile + "-mat" + ext;
-    std::ofstream matfile(dumpMatrixPath);
-    matfile << matrixDense << std::endl;
-    std::string dumpGradPath = dumpFile + "-grad" + ext;
-    std::ofstream gradfile(dumpGradPath);
-    gradfile << grad << std::endl;
-    LOGLS_INFO(_log, "Dumped Hessian, gradient to: '" << dumpMatrixPath << "', '" << dumpGradPath << "'");
+/**
+ * Write count values from data to ofile as little-endian Out (int64 or float64) whatever the byte order
+ * of the host, converting from e.g. Eigen's index type if necessary.
+ */
+template <typename Out, typename T>
+void writeLittleEndian(std::ofstream &ofile, T const *data, std::size_t count) {
+    static_assert(sizeof(Out) == sizeof(std::uint64_t), "Only 8 byte values are written");
+    std::vector<unsigned char> buffer(count * sizeof(Out));
+    for (std::size_t i = 0; i < count; ++i) {
+        Out const value = data[i];
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (std::size_t byte = 0; byte < sizeof(bits); ++byte) {
+            buffer[i * sizeof(bits) + byte] = static_cast<unsigned char>(bits >> (8 * byte));
+        }
+    }
+    ofile.write(reinterpret_cast<char const *>(buffer.data()), buffer.size());
+}
+
+/**
+ * Write the lower triangle of the (symmetric) Hessian in compressed sparse column format, followed by
+ * the gradient, to a binary file.
+ *
+ * The layout, in little-endian byte order, is: the 8 character tag "JCHESS01"; int64 nRows, nCols, nNonZeros;
+ * int64 column pointers[nCols+1]; int64 row indices[nNonZeros]; float64 values[nNonZeros];
+ * int64 gradient size; float64 gradient[size].
+ */
+void writeHessianAndGradient(SparseMatrixD const &hessian, Eigen::VectorXd const &grad,
+                             std::string const &path) {
+    SparseMatrixD lower = hessian.triangularView<Eigen::Lower>();
+    lower.makeCompressed();
+    std::ofstream ofile(path, std::ios::binary);
+    if (!ofile) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Cannot open Hessian dump file for writing: " + path);
+    }
+    ofile.write("JCHESS01", 8);
+    std::int64_t const header[3] = {lower.rows(), lower.cols(), lower.nonZeros()};
+    writeLittleEndian<std::int64_t>(ofile, header, 3);
+    writeLittleEndian<std::int64_t>(ofile, lower.outerIndexPtr(), lower.outerSize() + 1);
+    writeLittleEndian<std::int64_t>(ofile, lower.innerIndexPtr(), lower.nonZeros());
+    writeLittleEndian<double>(ofile, lower.valuePtr(), lower.nonZeros());
+    std::int64_t const gradSize = grad.size();
+    writeLittleEndian<std::int64_t>(ofile, &gradSize, 1);
+    writeLittleEndian<double>(ofile, grad.data(), grad.size());
+}
+
+/// Maximum number of correction solves applied by iterative refinement.
+int const maxRefinementSteps = 2;
+
+/// Return the name of a MinimizeResult, for logging.
+std::string toString(MinimizeResult result) {
+    switch (result) {
+        case MinimizeResult::Converged:
+            return "Converged";
+        case MinimizeResult::Chi2Increased:
+            return "Chi2Increased";
+        case MinimizeResult::Failed:
+            return "Failed";
+        case MinimizeResult::NonFinite:
+            return "NonFinite";
+    }
+    return "Unknown";
 }
 }  // namespace
 
 MinimizeResult FitterBase::minimize(std::string const &whatToFit, double nSigmaCut,
                                     double sigmaRelativeTolerance, bool doRankUpdate, bool const doLineSearch,
                                     std::string const &dumpMatrixFile) {
+    return _minimize(whatToFit, nSigmaCut, sigmaRelativeTolerance, doRankUpdate, doLineSearch,
+                     dumpMatrixFile)
+            .result;
+}
+
+FitIterationResult FitterBase::_minimize(std::string const &whatToFit, double nSigmaCut,
+                                         double sigmaRelativeTolerance, bool doRankUpdate,
+                                         bool const doLineSearch, std::string const &dumpMatrixFile,
+                                         double refinementTolerance) {
+    Instrumentation::Timer timer(_instrumentation, "minimize " + whatToFit);
     assignIndices(whatToFit);
 
-    MinimizeResult returnCode = MinimizeResult::Converged;
+    FitIterationResult returnValue;
+    returnValue.result = MinimizeResult::Converged;
 
     // For the initial vector size, use all measured stars + all fitted stars, which should give the
     // maximum possible number of triplets.
@@ -193,32 +278,34 @@ MinimizeResult FitterBase::minimize(std::string const &whatToFit, double nSigmaC
     double scale = 1.0;
 
     // Fill the triplets
+    Instrumentation::Timer derivativesTimer(_instrumentation, "derivatives");
     leastSquareDerivatives(tripletList, grad);
     _lastNTrip = tripletList.size();
+    timer.addCounter("triplets", tripletList.size());
 
     LOGLS_DEBUG(_log, "End of triplet filling, ntrip = " << tripletList.size());
 
     SparseMatrixD hessian = createHessian(_nTotal, tripletList);
     tripletList.clear();  // we don't need it any more after we have the hessian.
+    derivativesTimer.stop();
+    timer.addCounter("hessianNonZeros", hessian.nonZeros());
 
     LOGLS_DEBUG(_log, "Starting factorization, hessian: dim="
                               << hessian.rows() << " non-zeros=" << hessian.nonZeros()
                               << " filling-frac = " << hessian.nonZeros() / std::pow(hessian.rows(), 2));
 
     if (dumpMatrixFile != "") {
-        if (hessian.rows() * hessian.cols() > 2e8) {
-            LOGLS_WARN(_log, "Hessian matrix is too big to dump to file, with rows, columns: "
-                                     << hessian.rows() << ", " << hessian.cols());
-        } else {
-            dumpMatrixAndGradient(hessian, grad, dumpMatrixFile, _log);
-        }
+        _dumpMatrixAndGradient(hessian, grad, dumpMatrixFile);
     }
 
-    CholmodSimplicialLDLT2<SparseMatrixD> chol(hessian);
-    if (chol.info() != Eigen::Success) {
+    if (!_factorize(hessian)) {
         LOGLS_ERROR(_log, "minimize: factorization failed ");
-        return MinimizeResult::Failed;
+        _releaseFactorization();
+        returnValue.result = MinimizeResult::Failed;
+        return returnValue;
     }
+    timer.addCounter("factorNonZeros", _getFactorNonZeros());
+    double residual;
 
     std::size_t totalMeasOutliers = 0;
     std::size_t totalRefOutliers = 0;
@@ -227,26 +314,30 @@ MinimizeResult FitterBase::minimize(std::string const &whatToFit, double nSigmaC
     double sigmaCut;
 
     while (true) {
-        Eigen::VectorXd delta = chol.solve(grad);
+        Instrumentation::Timer iterationTimer(_instrumentation, "minimize iteration");
+        Eigen::VectorXd delta = _solve(hessian, grad, refinementTolerance, residual);
+        returnValue.solveResidual = std::max(returnValue.solveResidual, residual);
         if (doLineSearch) {
             scale = _lineSearch(delta);
         }
         offsetParams(scale * delta);
         Chi2Statistic currentChi2(computeChi2());
+        returnValue.chi2 = currentChi2;
         LOGLS_DEBUG(_log, currentChi2);
         if (!isfinite(currentChi2.chi2)) {
             LOGL_ERROR(_log, "chi2 is not finite. Aborting outlier rejection.");
-            returnCode = MinimizeResult::NonFinite;
+            returnValue.result = MinimizeResult::NonFinite;
             break;
         }
         if (currentChi2.chi2 > oldChi2 && totalMeasOutliers + totalRefOutliers != 0) {
             LOGL_WARN(_log, "chi2 went up, skipping outlier rejection loop");
-            returnCode = MinimizeResult::Chi2Increased;
+            returnValue.result = MinimizeResult::Chi2Increased;
             break;
         }
         oldChi2 = currentChi2.chi2;
 
         if (nSigmaCut == 0) break;  // no rejection step to perform
+        Instrumentation::Timer outliersTimer(_instrumentation, "outliers");
         MeasuredStarList msOutliers;
         FittedStarList fsOutliers;
         // keep nOutliers so we don't have to sum msOutliers.size()+fsOutliers.size() twice below.
@@ -262,6 +353,8 @@ MinimizeResult FitterBase::minimize(std::string const &whatToFit, double nSigmaC
         }
         totalMeasOutliers += msOutliers.size();
         totalRefOutliers += fsOutliers.size();
+        iterationTimer.addCounter("measOutliers", msOutliers.size());
+        iterationTimer.addCounter("refOutliers", fsOutliers.size());
         oldSigmaCut = sigmaCut;
         if (nOutliers == 0) break;
         TripletList outlierTriplets(nOutliers);
@@ -271,16 +364,30 @@ MinimizeResult FitterBase::minimize(std::string const &whatToFit, double nSigmaC
         // Remove significant outliers
         removeMeasOutliers(msOutliers);
         removeRefOutliers(fsOutliers);
+        outliersTimer.stop();
         if (doRankUpdate) {
             // convert triplet list to eigen internal format
             SparseMatrixD H(_nTotal, outlierTriplets.getNextFreeIndex());
             H.setFromTriplets(outlierTriplets.begin(), outlierTriplets.end());
-            chol.update(H, false /* means downdate */);
+            // keep the Hessian in step with the factor, for the refinement in the next solve.
+            hessian -= SparseMatrixD(H * H.transpose());
+            if (_blockSolver != nullptr) {
+                // The block solver has no rank update, but refactorizing only costs the Schur complement.
+                if (!_factorize(hessian)) {
+                    LOGLS_ERROR(_log, "minimize: factorization failed ");
+                    _releaseFactorization();
+                    returnValue.result = MinimizeResult::Failed;
+                    return returnValue;
+                }
+            } else {
+                _factorization->update(H, false /* means downdate */);
+            }
             // The contribution of outliers to the gradient is the opposite
             // of the contribution of all other terms, because they add up to 0
             grad *= -1;
         } else {
             // don't reuse tripletList because we want a new nextFreeIndex.
+            Instrumentation::Timer derivativesTimer(_instrumentation, "derivatives");
             TripletList nextTripletList(_lastNTrip);
             grad.setZero();
             // Rebuild the matrix and gradient
@@ -290,16 +397,20 @@ MinimizeResult FitterBase::minimize(std::string const &whatToFit, double nSigmaC
 
             hessian = createHessian(_nTotal, nextTripletList);
             nextTripletList.clear();  // we don't need it any more after we have the hessian.
+            derivativesTimer.stop();
+            iterationTimer.addCounter("hessianNonZeros", hessian.nonZeros());
 
             LOGLS_DEBUG(_log,
                         "Restarting factorization, hessian: dim="
                                 << hessian.rows() << " non-zeros=" << hessian.nonZeros()
                                 << " filling-frac = " << hessian.nonZeros() / std::pow(hessian.rows(), 2));
-            chol.compute(hessian);
-            if (chol.info() != Eigen::Success) {
+            if (!_factorize(hessian)) {
                 LOGLS_ERROR(_log, "minimize: factorization failed ");
-                return MinimizeResult::Failed;
+                _releaseFactorization();
+                returnValue.result = MinimizeResult::Failed;
+                return returnValue;
             }
+            iterationTimer.addCounter("factorNonZeros", _getFactorNonZeros());
         }
     }
 
@@ -313,7 +424,240 @@ MinimizeResult FitterBase::minimize(std::string const &whatToFit, double nSigmaC
                                  << totalMeasOutliers << " + " << totalRefOutliers << " = "
                                  << totalMeasOutliers + totalRefOutliers);
     }
-    return returnCode;
+    returnValue.nMeasOutliers = totalMeasOutliers;
+    returnValue.nRefOutliers = totalRefOutliers;
+    timer.addCounter("measOutliers", totalMeasOutliers);
+    timer.addCounter("refOutliers", totalRefOutliers);
+    _releaseFactorization();
+    return returnValue;
+}
+
+Eigen::VectorXd FitterBase::_solve(SparseMatrixD const &hessian, Eigen::VectorXd const &grad,
+                                   double refinementTolerance, double &residual) const {
+    auto solveFactorized = [this](Eigen::VectorXd const &rhs) -> Eigen::VectorXd {
+        if (_blockSolver != nullptr) return _blockSolver->solve(rhs);
+        return _factorization->solve(rhs);
+    };
+    Eigen::VectorXd delta = solveFactorized(grad);
+    double gradNorm = grad.norm();
+    if (gradNorm == 0) {
+        residual = 0;
+        return delta;
+    }
+    Eigen::VectorXd r = grad - hessian * delta;
+    residual = r.norm() / gradNorm;
+    LOGLS_DEBUG(_log, "Normal equations relative residual: " << residual);
+    for (int i = 0; i < maxRefinementSteps && residual > refinementTolerance; ++i) {
+        delta += solveFactorized(r);
+        r = grad - hessian * delta;
+        residual = r.norm() / gradNorm;
+        LOGLS_DEBUG(_log, "Relative residual after refinement step " << i + 1 << ": " << residual);
+    }
+    if (residual > refinementTolerance) {
+        LOGLS_DEBUG(_log, "Could not refine solution below tolerance " << refinementTolerance);
+    }
+    return delta;
+}
+
+IterateResult FitterBase::iterate(std::string const &whatToFit, double nSigmaCut, int maxSteps,
+                                  double sigmaRelativeTolerance, bool doRankUpdate, bool doLineSearch,
+                                  std::string const &dumpMatrixFile, std::string const &chi2BaseName,
+                                  double refinementTolerance, std::string const &checkpointFile,
+                                  int checkpointInterval, bool refitOnlyIfInaccurate) {
+    IterateResult iterateResult;
+    _keepFactorization = true;
+    double oldChi2 = std::numeric_limits<double>::infinity();
+
+    // Run one minimize() step, log it, save it in the history, and validate the model.
+    auto step = [&](int stepNumber, bool lineSearch, std::string const &dumpFile) {
+        FitIterationResult stepResult = _minimize(whatToFit, nSigmaCut, sigmaRelativeTolerance,
+                                                  doRankUpdate, lineSearch, dumpFile, refinementTolerance);
+        stepResult.step = stepNumber;
+        LOGLS_INFO(_log, "iterate: step=" << stepNumber << " result=" << toString(stepResult.result)
+                                          << " chi2=" << stepResult.chi2.chi2
+                                          << " ndof=" << stepResult.chi2.ndof << " chi2/ndof="
+                                          << stepResult.chi2.chi2 / stepResult.chi2.ndof
+                                          << " measOutliers=" << stepResult.nMeasOutliers
+                                          << " refOutliers=" << stepResult.nRefOutliers
+                                          << " solveResidual=" << stepResult.solveResidual);
+        if (chi2BaseName != "") {
+            std::string baseName = makeStepBaseName(chi2BaseName, stepNumber);
+            saveChi2Contributions(baseName);
+            LOGLS_INFO(_log, "Wrote chi2 contributions files: " << baseName);
+        }
+        iterateResult.iterations.push_back(stepResult);
+        iterateResult.result = stepResult.result;
+        iterateResult.chi2 = stepResult.chi2;
+        bool finite =
+                stepResult.result != MinimizeResult::NonFinite && stepResult.result != MinimizeResult::Failed;
+        if (finite) {
+            iterateResult.modelValid = validateModel(stepResult.chi2.ndof);
+        }
+        // Only checkpoint a state the fit goes on from: not a failed or invalid step, nor one whose chi2
+        // increase makes the loop below give up.
+        bool diverged = stepResult.result == MinimizeResult::Chi2Increased &&
+                        stepResult.chi2.chi2 > 10 * oldChi2;
+        if (finite && iterateResult.modelValid && !diverged && checkpointFile != "" &&
+            checkpointInterval > 0 && (stepNumber + 1) % checkpointInterval == 0) {
+            writeCheckpoint(checkpointFile);
+        }
+        return stepResult;
+    };
+
+    int i = 0;
+    for (; i < maxSteps; ++i) {
+        FitIterationResult stepResult = step(i, doLineSearch, (i == 0) ? dumpMatrixFile : "");
+        if (!iterateResult.modelValid) break;
+
+        if (stepResult.result == MinimizeResult::Converged) {
+            // Iterative refinement normally recovers the accuracy lost in the rank updates: if asked to,
+            // only refactorize from scratch if it could not.
+            bool inaccurate = stepResult.solveResidual > refinementTolerance;
+            if (doRankUpdate && (!refitOnlyIfInaccurate || inaccurate)) {
+                LOGLS_DEBUG(_log,
+                            "fit has converged - no more outliers - redo minimization one more time in case "
+                            "we have lost accuracy in rank update: solve residual="
+                                    << stepResult.solveResidual);
+                step(i + 1, false, "");
+            }
+            // TODO: DM-15247 for something better than a message for a large final chi2.
+            if (iterateResult.chi2.chi2 / iterateResult.chi2.ndof >= 4.0) {
+                LOGL_ERROR(_log, "Potentially bad fit: High chi-squared/ndof.");
+            }
+            break;
+        } else if (stepResult.result == MinimizeResult::Chi2Increased) {
+            LOGL_WARN(_log, "Still some outliers remaining but chi2 increased - retry");
+            // Check whether the increase was large enough to cause trouble.
+            double chi2Ratio = stepResult.chi2.chi2 / oldChi2;
+            if (chi2Ratio > 1.5) {
+                LOGLS_WARN(_log, "Significant chi2 increase by a factor of " << stepResult.chi2.chi2 << " / "
+                                                                             << oldChi2 << " = "
+                                                                             << chi2Ratio);
+            }
+            // Based on a variety of HSC jointcal logs (see DM-25779), it appears that chi2 increases more
+            // than a factor of ~2 always result in the fit diverging rapidly and ending at chi2 > 1e10.
+            // Using 10 as the "failure" threshold gives some room between leaving a warning and bailing.
+            if (chi2Ratio > 10) {
+                _keepFactorization = false;
+                _releaseFactorization();
+                throw LSST_EXCEPT(pex::exceptions::RuntimeError,
+                                  "Large chi2 increase between steps: fit likely cannot converge. Try setting "
+                                  "one or more of the `writeChi2*` config fields and looking at how individual "
+                                  "star chi2-values evolve during the fit.");
+            }
+            oldChi2 = stepResult.chi2.chi2;
+        } else {
+            // NonFinite or Failed: the caller decides how to report these.
+            break;
+        }
+    }
+    if (i == maxSteps) {
+        LOGLS_ERROR(_log, "Fit failed to converge after " << maxSteps << " steps");
+    }
+
+    _keepFactorization = false;
+    _releaseFactorization();
+    return iterateResult;
+}
+
+bool FitterBase::_factorize(SparseMatrixD const &hessian) {
+    Instrumentation::Timer timer(_instrumentation, "factorize");
+    if (_useBlockSolver) {
+        std::vector<Eigen::Index> blockStarts;
+        if (BlockArrowheadSolver::findStarBlocks(hessian, _nModelParams, blockStarts)) {
+            if (_blockSolver == nullptr) _blockSolver = std::make_unique<BlockArrowheadSolver>();
+            if (_blockSolver->compute(hessian, _nModelParams, std::move(blockStarts))) {
+                LOGLS_DEBUG(_log, "Factorized the Hessian by eliminating " << _nStarParams
+                                                                           << " star parameters.");
+                return true;
+            }
+            LOGL_DEBUG(_log, "Block factorization failed: falling back to the full factorization.");
+        } else {
+            LOGL_DEBUG(_log, "Star parameters are not block diagonal: using the full factorization.");
+        }
+    }
+    _blockSolver.reset();
+    // hessian comes from a sparse product, so it is always in compressed mode.
+    Eigen::Index const *outer = hessian.outerIndexPtr();
+    Eigen::Index const *inner = hessian.innerIndexPtr();
+    bool samePattern = _factorization != nullptr &&
+                       _factorizationOuterIndex.size() == static_cast<std::size_t>(hessian.outerSize() + 1) &&
+                       _factorizationInnerIndex.size() == static_cast<std::size_t>(hessian.nonZeros()) &&
+                       std::equal(_factorizationOuterIndex.begin(), _factorizationOuterIndex.end(), outer) &&
+                       std::equal(_factorizationInnerIndex.begin(), _factorizationInnerIndex.end(), inner);
+    if (samePattern) {
+        LOGL_DEBUG(_log, "Sparsity pattern unchanged: reusing the symbolic factorization.");
+        _factorization->factorize(hessian);
+    } else {
+        if (_factorization == nullptr) {
+            _factorization = std::make_unique<CholmodSimplicialLDLT2<SparseMatrixD>>();
+        }
+        _factorization->compute(hessian);
+        _factorizationOuterIndex.assign(outer, outer + hessian.outerSize() + 1);
+        _factorizationInnerIndex.assign(inner, inner + hessian.nonZeros());
+    }
+    return _factorization->info() == Eigen::Success;
+}
+
+Eigen::Index FitterBase::_getFactorNonZeros() const {
+    if (_blockSolver != nullptr) return _blockSolver->getFactorNonZeros();
+    return _factorization->getFactorNonZeros();
+}
+
+void FitterBase::_releaseFactorization() {
+    if (_keepFactorization) return;
+    _blockSolver.reset();
+    _factorization.reset();
+    _factorizationOuterIndex.clear();
+    _factorizationOuterIndex.shrink_to_fit();
+    _factorizationInnerIndex.clear();
+    _factorizationInnerIndex.shrink_to_fit();
+}
+
+void FitterBase::_dumpMatrixAndGradient(SparseMatrixD const &hessian, Eigen::VectorXd const &grad,
+                                        std::string const &dumpFile) const {
+    std::string matrixPath = dumpFile + "-hessian.bin";
+    writeHessianAndGradient(hessian, grad, matrixPath);
+
+    // Map each row of the matrix to the CcdImages whose model parameters it holds, or to its FittedStar.
+    std::string indexPath = dumpFile + "-index.csv";
+    std::ofstream ofile(indexPath);
+    std::string separator = "\t";
+    ofile << "#index" << separator << "kind" << separator << "visit" << separator << "ccd" << separator
+          << "x" << separator << "y" << separator << "hasRefStar" << std::endl;
+    if (_nModelParams > 0) {
+        for (auto const &ccdImage : _associations->getCcdImageList()) {
+            IndexVector indices;
+            getIndicesOfCcdImage(*ccdImage, indices);
+            for (auto const &index : indices) {
+                ofile << index << separator << "model" << separator << ccdImage->getVisit() << separator
+                      << ccdImage->getCcdId() << separator << "nan" << separator << "nan" << separator << 0
+                      << std::endl;
+            }
+        }
+    }
+    auto const &fittedStarList = _associations->fittedStarList;
+    std::size_t nFitStars = std::count_if(fittedStarList.begin(), fittedStarList.end(),
+                                          [](auto const &fittedStar) { return !fittedStar->isFixed(); });
+    if (_nStarParams > 0 && nFitStars > 0) {
+        // every FittedStar that is not fixed gets the same number of consecutive parameters.
+        if (_nStarParams % nFitStars != 0) {
+            throw LSST_EXCEPT(pex::exceptions::LogicError,
+                              "Cannot map " + std::to_string(_nStarParams) + " star parameters to " +
+                                      std::to_string(nFitStars) + " fitted stars");
+        }
+        std::size_t nParamsPerStar = _nStarParams / nFitStars;
+        for (auto const &fittedStar : fittedStarList) {
+            if (fittedStar->isFixed()) continue;
+            for (std::size_t k = 0; k < nParamsPerStar; ++k) {
+                ofile << fittedStar->getIndexInMatrix() + k << separator << "fittedStar" << separator << -1
+                      << separator << -1 << separator << fittedStar->x << separator << fittedStar->y
+                      << separator << (fittedStar->getRefStar() != nullptr) << std::endl;
+            }
+        }
+    }
+    LOGLS_INFO(_log, "Dumped Hessian, gradient and parameter indices to: '" << matrixPath << "', '"
+                                                                            << indexPath << "'");
 }
 
 void FitterBase::outliersContributions(MeasuredStarList &msOutliers, FittedStarList &fsOutliers,
@@ -349,17 +693,59 @@ void FitterBase::leastSquareDerivatives(TripletList &tripletList, Eigen::VectorX
     leastSquareDerivativesReference(_associations->fittedStarList, tripletList, grad);
 }
 
+void FitterBase::writeCheckpoint(std::string const &filename) {
+    Instrumentation::Timer timer(_instrumentation, "writeCheckpoint");
+    Checkpoint::write(filename, *_associations, getModelParameters());
+    LOGLS_INFO(_log, "Wrote checkpoint: " << filename);
+}
+
 void FitterBase::saveChi2Contributions(std::string const &baseName) const {
     std::string replaceStr = "{type}";
     auto pos = baseName.find(replaceStr);
     std::string measFilename(baseName);
-    measFilename.replace(pos, replaceStr.size(), "-meas.csv");
+    measFilename.replace(pos, replaceStr.size(), "-meas.bin");
     std::string refFilename(baseName);
-    refFilename.replace(pos, replaceStr.size(), "-ref.csv");
+    refFilename.replace(pos, replaceStr.size(), "-ref.bin");
     saveChi2MeasContributions(measFilename);
     saveChi2RefContributions(refFilename);
 }
 
+SparseMatrixD FitterBase::computeCovariance(std::string const &whatToFit, bool diagonalOnly) {
+    assignIndices(whatToFit);
+
+    std::size_t nTrip = (_lastNTrip)
+                                ? _lastNTrip
+                                : _associations->getMaxMeasuredStars() + _associations->fittedStarList.size();
+    TripletList tripletList(nTrip);
+    Eigen::VectorXd grad(_nTotal);
+    grad.setZero();
+    leastSquareDerivatives(tripletList, grad);
+    SparseMatrixD hessian = createHessian(_nTotal, tripletList);
+    tripletList.clear();  // we don't need it any more after we have the hessian.
+
+    CholmodSimplicialLDLT2<SparseMatrixD> chol(hessian);
+    if (chol.info() != Eigen::Success) {
+        throw LSST_EXCEPT(pex::exceptions::RuntimeError, "computeCovariance: factorization failed");
+    }
+    SparseMatrixD covariance = chol.selectedInverse(diagonalOnly);
+    LOGLS_DEBUG(_log, "computeCovariance: " << covariance.nonZeros() << " covariance elements for "
+                                            << _nTotal << " parameters");
+    assignCovariance(covariance);
+    return covariance;
+}
+
+Eigen::MatrixXd FitterBase::getCovarianceBlock(SparseMatrixD const &covariance, IndexVector const &indices) {
+    Eigen::Index const size = indices.size();
+    Eigen::MatrixXd block(size, size);
+    for (Eigen::Index i = 0; i < size; ++i) {
+        for (Eigen::Index j = 0; j <= i; ++j) {
+            block(i, j) = block(j, i) = covariance.coeff(std::max(indices[i], indices[j]),
+                                                         std::min(indices[i], indices[j]));
+        }
+    }
+    return block;
+}
+
 double FitterBase::_lineSearch(Eigen::VectorXd const &delta) {
     auto func = [this, &delta](double scale) {
         auto offset = scale * delta;
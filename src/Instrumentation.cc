@@ -0,0 +1,89 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sys/resource.h>
+#include <time.h>
+
+#include "Eigen/Core"
+
+#include "lsst/jointcal/Instrumentation.h"
+
+namespace lsst {
+namespace jointcal {
+
+namespace {
+/// Return the peak resident set size of this process so far, in bytes.
+long getPeakMemory() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss;  // already in bytes on macOS
+#else
+    return usage.ru_maxrss * 1024;
+#endif
+}
+
+/// Return the CPU time consumed so far by the calling thread, in seconds.
+double getThreadCpuTime() {
+    struct timespec now;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) return 0;
+    return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+}  // namespace
+
+std::ostream &operator<<(std::ostream &out, PhaseStatistics const &phase) {
+    out << phase.name << ": wall=" << phase.wallTime << "s cpu=" << phase.cpuTime
+        << "s peakMemoryIncrease=" << phase.peakMemoryIncrease << " nThreads=" << phase.nThreads;
+    for (auto const &counter : phase.counters) {
+        out << " " << counter.first << "=" << counter.second;
+    }
+    return out;
+}
+
+Instrumentation::Timer::Timer(Instrumentation &instrumentation, std::string const &name)
+        : _instrumentation(instrumentation),
+          _index(instrumentation._phases.size()),
+          _wallStart(std::chrono::steady_clock::now()),
+          _cpuStart(getThreadCpuTime()),
+          _peakMemoryStart(getPeakMemory()),
+          _running(true) {
+    _instrumentation._phases.emplace_back(name);
+    _instrumentation._phases[_index].nThreads = Eigen::nbThreads();
+}
+
+void Instrumentation::Timer::addCounter(std::string const &counter, double value) {
+    _instrumentation._phases[_index].counters[counter] += value;
+}
+
+void Instrumentation::Timer::stop() {
+    if (!_running) return;
+    _running = false;
+    PhaseStatistics &phase = _instrumentation._phases[_index];
+    phase.wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - _wallStart).count();
+    phase.cpuTime = getThreadCpuTime() - _cpuStart;
+    phase.peakMemoryIncrease = getPeakMemory() - _peakMemoryStart;
+}
+
+}  // namespace jointcal
+}  // namespace lsst
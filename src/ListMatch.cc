@@ -27,6 +27,11 @@
 #include <list>
 #include <memory>
 #include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <unordered_set>
+#include <vector>
 #ifndef M_PI
 #define M_PI 3.14159265358979323846 /* pi */
 #endif
@@ -36,7 +41,6 @@
 #include "lsst/jointcal/StarMatch.h"
 #include "lsst/jointcal/AstrometryTransform.h"
 #include "lsst/jointcal/Histo2d.h"
-#include "lsst/jointcal/Histo4d.h"
 #include "lsst/jointcal/FastFinder.h"
 #include "lsst/jointcal/ListMatch.h"
 
@@ -273,6 +277,102 @@ static std::unique_ptr<StarMatchList> ListMatchupRotShift_Old(BaseStarList &list
     object indices of the combination:
 */
 
+/* Sort the solutions by decreasing quality, and return the best one. */
+static std::unique_ptr<StarMatchList> bestSolution(SolList &Solutions, const MatchConditions &conditions) {
+    Solutions.sort(DecreasingQuality);
+    std::unique_ptr<StarMatchList> best;
+    best.swap(*Solutions.begin());
+    /* remove the first one from the list */
+    Solutions.pop_front();
+    if (conditions.printLevel >= 1) {
+        LOGLS_INFO(_log, "Best solution " << best->computeResidual() << " npairs " << best->size());
+        LOGLS_INFO(_log, *(best->getTransform()));
+        LOGLS_INFO(_log, "Chi2 " << best->getChi2() << ", Number of solutions " << Solutions.size());
+    }
+    return best;
+}
+
+/*
+ * Votes of pairs of list 1 and list 2 items (segments or triangles) in (length ratio, relative angle,
+ * anchor star in list 1, anchor star in list 2) bins, for the combinatorial matchers. Only the occupied
+ * bins are stored, in an open-addressed hash table, and each bin keeps the chain of the pairs that voted
+ * for it, so that the matches of a bin can be recovered without recomputing ratios and angles.
+ */
+class PairVotes {
+public:
+    struct Bin {
+        std::int64_t code;
+        int count;
+        int firstPair;  // index in _pairs of the first vote, in filling order
+        int lastPair;
+    };
+
+    PairVotes(std::size_t expectedEntries) {
+        std::size_t size = 16;
+        while (size < 2 * expectedEntries) size *= 2;
+        _table.assign(size, -1);
+    }
+
+    void fill(std::int64_t code, int item1, int item2) {
+        int pairIndex = _pairs.size();
+        _pairs.push_back({item1, item2, -1});
+        std::size_t slot = find(code);
+        if (_table[slot] < 0) {
+            _table[slot] = _bins.size();
+            _bins.push_back({code, 1, pairIndex, pairIndex});
+            if (2 * _bins.size() > _table.size()) grow();
+        } else {
+            Bin &bin = _bins[_table[slot]];
+            bin.count++;
+            _pairs[bin.lastPair].next = pairIndex;
+            bin.lastPair = pairIndex;
+        }
+    }
+
+    /*
+     * The occupied bins by decreasing count. Ties are ordered by increasing code, which is the order in
+     * which repeated SparseHisto4d::maxBin()/zeroBin() calls used to return them.
+     */
+    std::vector<Bin> sortedBins() const {
+        std::vector<Bin> bins(_bins);
+        std::sort(bins.begin(), bins.end(), [](Bin const &a, Bin const &b) {
+            return (a.count != b.count) ? (a.count > b.count) : (a.code < b.code);
+        });
+        return bins;
+    }
+
+    /// Call function(item1, item2) for every vote of bin, in filling order.
+    template <typename Function>
+    void forEachPair(Bin const &bin, Function function) const {
+        for (int i = bin.firstPair; i >= 0; i = _pairs[i].next) {
+            function(_pairs[i].item1, _pairs[i].item2);
+        }
+    }
+
+private:
+    struct Pair {
+        int item1, item2;
+        int next;  // next vote for the same bin, or -1
+    };
+
+    std::vector<int> _table;  // index in _bins, or -1 for an empty slot; the size is a power of 2
+    std::vector<Bin> _bins;
+    std::vector<Pair> _pairs;
+
+    std::size_t find(std::int64_t code) const {
+        std::size_t mask = _table.size() - 1;
+        // Fibonacci hashing spreads the consecutive codes of neighbouring bins over the table.
+        std::size_t slot = (std::uint64_t(code) * 0x9E3779B97F4A7C15ULL) & mask;
+        while (_table[slot] >= 0 && _bins[_table[slot]].code != code) slot = (slot + 1) & mask;
+        return slot;
+    }
+
+    void grow() {
+        _table.assign(2 * _table.size(), -1);
+        for (std::size_t i = 0; i < _bins.size(); ++i) _table[find(_bins[i].code)] = i;
+    }
+};
+
 static std::unique_ptr<StarMatchList> ListMatchupRotShift_New(BaseStarList &list1, BaseStarList &list2,
                                                               const AstrometryTransform &transform,
                                                               const MatchConditions &conditions) {
@@ -294,52 +394,71 @@ static std::unique_ptr<StarMatchList> ListMatchupRotShift_New(BaseStarList &list
     double angleOffset = M_PI / nBinsAngle;
     double minRatio = conditions.minSizeRatio();
     double maxRatio = conditions.maxSizeRatio();
-    SparseHisto4d histo(nBinsR, minRatio, maxRatio, nBinsAngle, -M_PI - angleOffset, M_PI - angleOffset,
-                        conditions.nStarsList1, 0., conditions.nStarsList1, conditions.nStarsList2, 0.,
-                        conditions.nStarsList2, sList1.size() * sList2.size());
-
-    SegmentIterator segi1, segi2;
-    Segment *seg1, *seg2;
-    double ratio, angle;
+    double minAngle = -M_PI - angleOffset;
+    double ratioScale = nBinsR / (maxRatio - minRatio);
+    double angleScale = nBinsAngle / (2 * M_PI);
+    std::int64_t nRank1 = conditions.nStarsList1;
+    std::int64_t nRank2 = conditions.nStarsList2;
+
+    // Contiguous copies of the segments (sorted by decreasing length), so the inner loops vectorize.
+    std::vector<Segment const *> segments1, segments2;
+    for (auto const &segment : sList1) segments1.push_back(&segment);
+    for (auto const &segment : sList2) segments2.push_back(&segment);
+    std::size_t n2 = segments2.size();
+    std::vector<double> dx2(n2), dy2(n2), r2(n2);
+    for (std::size_t j = 0; j < n2; ++j) {
+        dx2[j] = segments2[j]->dx;
+        dy2[j] = segments2[j]->dy;
+        r2[j] = segments2[j]->r;
+    }
 
-    for (segi1 = sList1.begin(); segi1 != sList1.end(); ++segi1) {
-        seg1 = &(*segi1);
-        if (seg1->r == 0) continue;
-        for (segi2 = sList2.begin(); segi2 != sList2.end(); ++segi2) {
-            seg2 = &(*segi2);
-            /* if one considers the 2 segments as complex numbers z1 and z2, ratio=mod(z1/z2) and angle =
-             * arg(z1/z2) */
-            /* I did not put a member function in Segment to compute both because we apply a cut on ratio
-               before actually
-               computing the angle (which involves a call to atan2 (expensive)) */
-            ratio = seg2->r / seg1->r;
-            if (ratio > maxRatio) continue;
-            if (ratio < minRatio) break; /* use th fact that segment lists are sorted by decresing length */
-            angle = seg1->relativeAngle(seg2);
-            if (angle > M_PI - angleOffset) angle -= 2. * M_PI;
-            histo.fill(ratio, angle, seg1->s1rank + 0.5, seg2->s1rank + 0.5);
+    PairVotes votes(sList1.size() * sList2.size() / nBinsR);
+    std::vector<double> ratios(n2), angles(n2);
+    for (std::size_t i = 0; i < segments1.size(); ++i) {
+        Segment const &seg1 = *segments1[i];
+        if (seg1.r == 0) continue;
+        /* if one considers the 2 segments as complex numbers z1 and z2, ratio=mod(z1/z2) and angle =
+         * arg(z1/z2). The list 2 segments are sorted by decreasing length, so the ones with
+         * minRatio <= ratio <= maxRatio are a contiguous range. */
+        auto begin = std::lower_bound(r2.begin(), r2.end(), maxRatio * seg1.r * (1 + 1e-12),
+                                      std::greater<double>());
+        auto end = std::upper_bound(begin, r2.end(), minRatio * seg1.r * (1 - 1e-12), std::greater<double>());
+        std::size_t jBegin = begin - r2.begin(), jEnd = end - r2.begin();
+        for (std::size_t j = jBegin; j < jEnd; ++j) {
+            ratios[j] = r2[j] / seg1.r;
+            angles[j] = std::atan2(dx2[j] * seg1.dy - seg1.dx * dy2[j], seg1.dx * dx2[j] + seg1.dy * dy2[j]);
+        }
+        for (std::size_t j = jBegin; j < jEnd; ++j) {
+            // apply the exact cuts: the bisection above is slightly looser, to be safe against rounding
+            if (ratios[j] > maxRatio || ratios[j] < minRatio) continue;
+            double angle = (angles[j] > M_PI - angleOffset) ? angles[j] - 2. * M_PI : angles[j];
+            int ratioBin = std::floor((ratios[j] - minRatio) * ratioScale);
+            int angleBin = std::floor((angle - minAngle) * angleScale);
+            if (ratioBin < 0 || ratioBin >= nBinsR || angleBin < 0 || angleBin >= nBinsAngle) continue;
+            std::int64_t code =
+                    ((std::int64_t(ratioBin) * nBinsAngle + angleBin) * nRank1 + seg1.s1rank) * nRank2 +
+                    segments2[j]->s1rank;
+            votes.fill(code, i, j);
         }
     }
 
     SolList Solutions;
-    /* now we find the highest bins of the histogram, and recover the original objects.
-       This involves actually re-looping on the combinations, but it is much
-       faster that the original histogram filling loop, since we only compute
-       angle and ratio for Segments that have the right first object
-    */
+    /* now we take the bins by decreasing content, and recover the original objects from the segment
+       pairs that voted for each of them. */
 
     int oldMaxContent = 0;
+    auto bins = votes.sortedBins();
 
-    for (int i = 0; i < 4 * conditions.maxTrialCount;
+    for (int i = 0; i < 4 * conditions.maxTrialCount && i < int(bins.size());
          ++i)  // leave a limit to make avoid (almost)  infinite loops
     {
-        double pars[4];
-        int maxContent = histo.maxBin(pars);
-        if (maxContent == 0) break;
+        int maxContent = bins[i].count;
         if (conditions.printLevel >= 1) {
-            LOGLS_DEBUG(_log, "ValMax " << maxContent << " ratio " << pars[0] << " angle " << pars[1]);
+            std::int64_t ratioBin = bins[i].code / (nBinsAngle * nRank1 * nRank2);
+            std::int64_t angleBin = (bins[i].code / (nRank1 * nRank2)) % nBinsAngle;
+            LOGLS_DEBUG(_log, "ValMax " << maxContent << " ratio " << minRatio + (ratioBin + 0.5) / ratioScale
+                                        << " angle " << minAngle + (angleBin + 0.5) / angleScale);
         }
-        histo.zeroBin(pars);
         if (i > 0) { /* the match possibilities come out in a random order when they have the same content.
                         so, we stop investigating guesses when the content goes down AND the requested search
                         depth
@@ -347,70 +466,279 @@ static std::unique_ptr<StarMatchList> ListMatchupRotShift_New(BaseStarList &list
             if (maxContent < oldMaxContent && i >= conditions.maxTrialCount) break;
         }
         oldMaxContent = maxContent;
-        /* reloop on segment pairs to select the ones in this specific bin */
-        int rank1L1 = int(pars[2]);
-        int rank1L2 = int(pars[3]);
-        double minAngle, maxAngle;
-        histo.binLimits(pars, 0, minRatio, maxRatio);
-        histo.binLimits(pars, 1, minAngle, maxAngle);
 
         std::unique_ptr<StarMatchList> a_list(new StarMatchList);
+        votes.forEachPair(bins[i], [&](int segment1, int segment2) {
+            Segment const &seg1 = *segments1[segment1];
+            Segment const &seg2 = *segments2[segment2];
+            // push in the list the match corresponding to end number 1 of segments
+            if (a_list->size() == 0) a_list->push_back(StarMatch(*(seg1.s1), *(seg2.s1), seg1.s1, seg2.s1));
+            /* here we have 2 segments which have the right
+               - length ratio
+               - relative angle
+               - first objects (objects on the end number 1).
+               The objects on the end number 2 are the actual matches : */
+            a_list->push_back(StarMatch(*(seg1.s2), *(seg2.s2), seg1.s2, seg2.s2));
+        });
+        a_list->refineTransform(conditions.nSigmas);
+        Solutions.push_back(std::move(a_list));
+    }
 
-        for (segi1 = sList1.begin(); segi1 != sList1.end(); ++segi1) {
-            seg1 = &(*segi1);
-            if (seg1->s1rank != rank1L1) continue;
-            if (seg1->r == 0) continue;
-            for (segi2 = sList2.begin(); segi2 != sList2.end(); ++segi2) {
-                seg2 = &(*segi2);
-                if (seg2->s1rank != rank1L2) continue;
-                // push in the list the match corresponding to end number 1 of segments
-                if (a_list->size() == 0)
-                    a_list->push_back(StarMatch(*(seg1->s1), *(seg2->s1), seg1->s1, seg2->s1));
-                ratio = seg2->r / seg1->r;
-                if (ratio > maxRatio) continue;
-                if (ratio < minRatio)
-                    break; /* use the fact that segment lists are sorted by decresing length */
-                angle = seg1->relativeAngle(seg2);
-                if (angle > M_PI - angleOffset) angle -= 2. * M_PI;
-                if (angle < minAngle || angle > maxAngle) continue;
-                /* here we have 2 segments which have the right
-                   - length ratio
-                   - relative angle
-                   - first objects (objects on the end number 1).
-                   The objects on the end number 2 are the actual matches : */
-                a_list->push_back(StarMatch(*(seg1->s2), *(seg2->s2), seg1->s2, seg2->s2));
+    if (Solutions.size() == 0) {
+        LOGLS_ERROR(_log, "Error In ListMatchup : not a single pair match.");
+        LOGLS_ERROR(_log, "Probably, the relative scale of lists is not within bounds.");
+        LOGLS_ERROR(_log, "min/max ratios: " << minRatio << ' ' << maxRatio);
+        return nullptr;
+    }
+    return bestSolution(Solutions, conditions);
+}
+
+/* A 2-d tree over a fixed set of points, for the range and nearest neighbour searches of the triangle
+   matcher. */
+class KdTree2d {
+public:
+    explicit KdTree2d(std::vector<Point> const &points) : _points(points), _index(points.size()) {
+        for (std::size_t i = 0; i < _index.size(); ++i) _index[i] = i;
+        build(0, _index.size(), 0);
+    }
+
+    //! Call function(i) for every point i in [x - dx, x + dx] x [y - dy, y + dy].
+    template <typename Function>
+    void forEachInBox(double x, double y, double dx, double dy, Function function) const {
+        searchBox(0, _index.size(), 0, x - dx, x + dx, y - dy, y + dy, function);
+    }
+
+    //! The (at most) k points closest to point i, excluding i itself.
+    std::vector<int> nearest(int i, std::size_t k) const {
+        std::vector<std::pair<double, int>> heap;  // max-heap on the squared distance
+        searchNearest(0, _index.size(), 0, i, k, heap);
+        std::vector<int> result;
+        for (auto const &entry : heap) result.push_back(entry.second);
+        return result;
+    }
+
+private:
+    std::vector<Point> const &_points;
+    std::vector<int> _index;  // median-split ordering of the points
+
+    static double coord(Point const &point, int depth) { return (depth % 2 == 0) ? point.x : point.y; }
+
+    void build(std::size_t begin, std::size_t end, int depth) {
+        if (end - begin <= 1) return;
+        std::size_t mid = (begin + end) / 2;
+        std::nth_element(_index.begin() + begin, _index.begin() + mid, _index.begin() + end,
+                         [&](int a, int b) { return coord(_points[a], depth) < coord(_points[b], depth); });
+        build(begin, mid, depth + 1);
+        build(mid + 1, end, depth + 1);
+    }
+
+    template <typename Function>
+    void searchBox(std::size_t begin, std::size_t end, int depth, double xMin, double xMax, double yMin,
+                   double yMax, Function &function) const {
+        if (begin >= end) return;
+        std::size_t mid = (begin + end) / 2;
+        Point const &point = _points[_index[mid]];
+        if (point.x >= xMin && point.x <= xMax && point.y >= yMin && point.y <= yMax) function(_index[mid]);
+        double split = coord(point, depth);
+        if (((depth % 2 == 0) ? xMin : yMin) <= split)
+            searchBox(begin, mid, depth + 1, xMin, xMax, yMin, yMax, function);
+        if (((depth % 2 == 0) ? xMax : yMax) >= split)
+            searchBox(mid + 1, end, depth + 1, xMin, xMax, yMin, yMax, function);
+    }
+
+    void searchNearest(std::size_t begin, std::size_t end, int depth, int target, std::size_t k,
+                       std::vector<std::pair<double, int>> &heap) const {
+        if (begin >= end) return;
+        std::size_t mid = (begin + end) / 2;
+        Point const &point = _points[_index[mid]];
+        Point const &center = _points[target];
+        if (_index[mid] != target) {
+            double dist2 = point.computeDist2(center);
+            if (heap.size() < k) {
+                heap.emplace_back(dist2, _index[mid]);
+                std::push_heap(heap.begin(), heap.end());
+            } else if (k > 0 && dist2 < heap.front().first) {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = std::make_pair(dist2, _index[mid]);
+                std::push_heap(heap.begin(), heap.end());
             }
         }
+        double diff = coord(center, depth) - coord(point, depth);
+        bool lowFirst = (diff < 0);
+        // visit the side containing the target first, and the other one only if it may hold closer points
+        if (lowFirst)
+            searchNearest(begin, mid, depth + 1, target, k, heap);
+        else
+            searchNearest(mid + 1, end, depth + 1, target, k, heap);
+        if (heap.size() < k || diff * diff < heap.front().first) {
+            if (lowFirst)
+                searchNearest(mid + 1, end, depth + 1, target, k, heap);
+            else
+                searchNearest(begin, mid, depth + 1, target, k, heap);
+        }
+    }
+};
 
-        // a basic check for sanity of the algorithm :
+/* A triangle of stars from the same list, described by similarity-invariant codes: the middle and
+   shortest sides relative to the longest one. */
+struct Triangle {
+    int vertices[3];  // star indices, ordered as the opposite sides: longest, middle, shortest
+    double code[2];   // middle/longest and shortest/longest side lengths
+    double dx, dy;    // the longest side, as a vector from vertices[1] to vertices[2]
+    double r;         // the length of the longest side
+    bool clockwise;   // orientation of the vertices, which distinguishes the mirror images
+};
 
-        if (int(a_list->size()) != maxContent + 1) {
-            LOGLS_ERROR(_log, "There is an internal inconsistency in ListMatchupRotShift.");
-            LOGLS_ERROR(_log, "maxContent  = " << maxContent);
-            LOGLS_ERROR(_log, "matches->size() = " << a_list->size());
+/* Build triangles out of each star and pairs of its nNeighbours closest neighbours, so that the number of
+   triangles grows linearly with the number of stars. Triangles which have two sides of almost equal
+   length are skipped, because their vertices cannot be labelled reliably. */
+static std::vector<Triangle> makeTriangles(std::vector<Point> const &positions, int nNeighbours,
+                                           double tolerance) {
+    KdTree2d tree(positions);
+    std::vector<Triangle> triangles;
+    std::unordered_set<std::int64_t> seen;
+    std::int64_t n = positions.size();
+    for (std::int64_t i = 0; i < n; ++i) {
+        auto neighbours = tree.nearest(i, nNeighbours);
+        for (std::size_t j = 0; j < neighbours.size(); ++j) {
+            for (std::size_t k = j + 1; k < neighbours.size(); ++k) {
+                std::int64_t ids[3] = {i, neighbours[j], neighbours[k]};
+                std::sort(ids, ids + 3);
+                if (!seen.insert((ids[0] * n + ids[1]) * n + ids[2]).second) continue;
+
+                // sides[m] is the length of the side opposite to ids[m]
+                std::pair<double, int> sides[3];
+                for (int m = 0; m < 3; ++m) {
+                    Point const &end1 = positions[ids[(m + 1) % 3]];
+                    Point const &end2 = positions[ids[(m + 2) % 3]];
+                    sides[m] = {std::sqrt(end1.computeDist2(end2)), int(ids[m])};
+                }
+                std::sort(sides, sides + 3, std::greater<std::pair<double, int>>());
+                double a = sides[0].first, b = sides[1].first, c = sides[2].first;
+                if (c <= 0 || (a - b) < tolerance * a || (b - c) < tolerance * a) continue;
+
+                Triangle triangle;
+                for (int m = 0; m < 3; ++m) triangle.vertices[m] = sides[m].second;
+                triangle.code[0] = b / a;
+                triangle.code[1] = c / a;
+                Point const &p0 = positions[triangle.vertices[0]];
+                Point const &p1 = positions[triangle.vertices[1]];
+                Point const &p2 = positions[triangle.vertices[2]];
+                triangle.dx = p2.x - p1.x;
+                triangle.dy = p2.y - p1.y;
+                triangle.r = a;
+                triangle.clockwise = ((p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x)) < 0;
+                triangles.push_back(triangle);
+            }
         }
+    }
+    return triangles;
+}
+
+/* This one searches a general transformation by geometric hashing of triangles built from each star and
+its closest neighbours. Similar triangles of the 2 lists are found with a 2-d tree on their codes, and each
+such pair votes for its length ratio, relative angle and vertex correspondences. Since the number of
+triangles is linear in the number of stars, this can use many more stars than the segment matchers. */
+static std::unique_ptr<StarMatchList> ListMatchupTriangles(BaseStarList &list1, BaseStarList &list2,
+                                                           const AstrometryTransform &transform,
+                                                           const MatchConditions &conditions) {
+    if (list1.size() <= 4 || list2.size() <= 4) {
+        LOGL_FATAL(_log, "ListMatchupTriangles : (at least) one of the lists is too short.");
+        return nullptr;
+    }
+
+    // the lists are sorted by decreasing flux: keep the brightest stars.
+    std::vector<std::shared_ptr<const BaseStar>> stars1, stars2;
+    std::vector<Point> positions1, positions2;
+    for (auto const &star : list1) {
+        if (int(stars1.size()) >= conditions.nStarsList1) break;
+        stars1.push_back(star);
+        positions1.push_back(transform.apply(*star));
+    }
+    for (auto const &star : list2) {
+        if (int(stars2.size()) >= conditions.nStarsList2) break;
+        stars2.push_back(star);
+        positions2.push_back(*star);
+    }
+
+    // tolerance on the triangle codes, and on the distinguishability of their sides.
+    double const codeTolerance = 0.01;
+    auto triangles1 = makeTriangles(positions1, conditions.nTriangleNeighbours, codeTolerance);
+    auto triangles2 = makeTriangles(positions2, conditions.nTriangleNeighbours, codeTolerance);
+    std::vector<Point> codes2;
+    codes2.reserve(triangles2.size());
+    for (auto const &triangle : triangles2) codes2.emplace_back(triangle.code[0], triangle.code[1]);
+    KdTree2d codeTree(codes2);
+
+    // same binning as ListMatchupRotShift_New
+    int nBinsR = 21;
+    int nBinsAngle = 180;
+    double angleOffset = M_PI / nBinsAngle;
+    double minRatio = conditions.minSizeRatio();
+    double maxRatio = conditions.maxSizeRatio();
+    double minAngle = -M_PI - angleOffset;
+    double ratioScale = nBinsR / (maxRatio - minRatio);
+    double angleScale = nBinsAngle / (2 * M_PI);
+    std::int64_t n1 = stars1.size();
+    std::int64_t n2 = stars2.size();
+
+    PairVotes votes(3 * triangles1.size());
+    for (std::size_t i = 0; i < triangles1.size(); ++i) {
+        Triangle const &tri1 = triangles1[i];
+        codeTree.forEachInBox(tri1.code[0], tri1.code[1], codeTolerance, codeTolerance, [&](int j) {
+            Triangle const &tri2 = triangles2[j];
+            if (tri1.clockwise != tri2.clockwise) return;
+            double ratio = tri2.r / tri1.r;
+            if (ratio > maxRatio || ratio < minRatio) return;
+            double angle =
+                    std::atan2(tri2.dx * tri1.dy - tri1.dx * tri2.dy, tri1.dx * tri2.dx + tri1.dy * tri2.dy);
+            if (angle > M_PI - angleOffset) angle -= 2. * M_PI;
+            int ratioBin = std::floor((ratio - minRatio) * ratioScale);
+            int angleBin = std::floor((angle - minAngle) * angleScale);
+            if (ratioBin < 0 || ratioBin >= nBinsR || angleBin < 0 || angleBin >= nBinsAngle) return;
+            // each vertex correspondence anchors a vote, as the first star of the segments does.
+            for (int m = 0; m < 3; ++m) {
+                std::int64_t code =
+                        ((std::int64_t(ratioBin) * nBinsAngle + angleBin) * n1 + tri1.vertices[m]) * n2 +
+                        tri2.vertices[m];
+                votes.fill(code, i, j);
+            }
+        });
+    }
+
+    SolList Solutions;
+    int oldMaxContent = 0;
+    auto bins = votes.sortedBins();
+    for (int i = 0; i < 4 * conditions.maxTrialCount && i < int(bins.size()); ++i) {
+        int maxContent = bins[i].count;
+        if (i > 0 && maxContent < oldMaxContent && i >= conditions.maxTrialCount) break;
+        oldMaxContent = maxContent;
+
+        // the anchor first, then every other vertex correspondence of the voting triangles, once.
+        int anchor1 = (bins[i].code / n2) % n1;
+        int anchor2 = bins[i].code % n2;
+        std::unique_ptr<StarMatchList> a_list(new StarMatchList);
+        a_list->push_back(StarMatch(*stars1[anchor1], *stars2[anchor2], stars1[anchor1], stars2[anchor2]));
+        std::set<std::pair<int, int>> used = {{anchor1, anchor2}};
+        votes.forEachPair(bins[i], [&](int triangle1, int triangle2) {
+            for (int m = 0; m < 3; ++m) {
+                int star1 = triangles1[triangle1].vertices[m];
+                int star2 = triangles2[triangle2].vertices[m];
+                if (!used.emplace(star1, star2).second) continue;
+                a_list->push_back(StarMatch(*stars1[star1], *stars2[star2], stars1[star1], stars2[star2]));
+            }
+        });
         a_list->refineTransform(conditions.nSigmas);
         Solutions.push_back(std::move(a_list));
     }
 
     if (Solutions.size() == 0) {
-        LOGLS_ERROR(_log, "Error In ListMatchup : not a single pair match.");
+        LOGLS_ERROR(_log, "Error In ListMatchupTriangles : not a single triangle match.");
         LOGLS_ERROR(_log, "Probably, the relative scale of lists is not within bounds.");
         LOGLS_ERROR(_log, "min/max ratios: " << minRatio << ' ' << maxRatio);
         return nullptr;
     }
-
-    Solutions.sort(DecreasingQuality);
-    std::unique_ptr<StarMatchList> best;
-    best.swap(*Solutions.begin());
-    /* remove the first one from the list */
-    Solutions.pop_front();
-    if (conditions.printLevel >= 1) {
-        LOGLS_INFO(_log, "Best solution " << best->computeResidual() << " npairs " << best->size());
-        LOGLS_INFO(_log, *(best->getTransform()));
-        LOGLS_INFO(_log, "Chi2 " << best->getChi2() << ", Number of solutions " << Solutions.size());
-    }
-    return best;
+    return bestSolution(Solutions, conditions);
 }
 
 static std::unique_ptr<StarMatchList> ListMatchupRotShift(BaseStarList &list1, BaseStarList &list2,
@@ -418,6 +746,8 @@ static std::unique_ptr<StarMatchList> ListMatchupRotShift(BaseStarList &list1, B
                                                           const MatchConditions &conditions) {
     if (conditions.algorithm == 1)
         return ListMatchupRotShift_Old(list1, list2, transform, conditions);
+    else if (conditions.algorithm == 3)
+        return ListMatchupTriangles(list1, list2, transform, conditions);
     else
         return ListMatchupRotShift_New(list1, list2, transform, conditions);
 }
@@ -634,6 +964,7 @@ std::unique_ptr<StarMatchList> listMatchCollect(const BaseStarList &list1, const
 }
 
 static bool is_transform_ok(const StarMatchList *match, double pixSizeRatio2, const size_t nmin) {
+    if (!match) return false;
     if ((fabs(fabs(std::dynamic_pointer_cast<const AstrometryTransformLinear>(match->getTransform())
                            ->determinant()) -
               pixSizeRatio2) /
@@ -753,8 +1084,18 @@ std::unique_ptr<AstrometryTransform> listMatchRefine(const BaseStarList &List1,
         unsigned iter = 0;
         double transDiff;
         do {  // loop on transform diff only on bright stars
-            brightMatch->setTransformOrder(order);
-            brightMatch->refineTransform(nSigmas);
+            // Clip and refit on one accumulation of the matches, rather than refitting from scratch,
+            // weighting them with their errors propagated through the current transform.
+            brightMatch->removeAmbiguities(*curTransform);
+            AstrometryTransformPolynomialFitter fitter(*brightMatch, *curTransform, order);
+            AstrometryTransformPolynomial poly(order);
+            double chi2;
+            if (!fitter.fitWithClipping(order, nSigmas, poly, chi2)) break;
+            if (order == 1) {
+                brightMatch->setTransform(AstrometryTransformLinear(poly));
+            } else {
+                brightMatch->setTransform(poly);
+            }
             transDiff = transform_diff(list1, brightMatch->getTransform().get(), curTransform.get());
             curTransform = brightMatch->getTransform()->clone();
             brightMatch = listMatchCollect(list1, list2, curTransform.get(), brightDist);
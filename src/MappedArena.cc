@@ -0,0 +1,125 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "lsst/log/Log.h"
+#include "lsst/pex/exceptions.h"
+
+#include "lsst/jointcal/MappedArena.h"
+
+namespace lsst {
+namespace jointcal {
+
+namespace {
+LOG_LOGGER _log = LOG_GET("jointcal.MappedArena");
+
+std::size_t roundUp(std::size_t size, std::size_t multiple) {
+    return (size + multiple - 1) / multiple * multiple;
+}
+
+std::size_t const pageSize = sysconf(_SC_PAGESIZE);
+}  // namespace
+
+MappedArena::MappedArena(std::string const &directory, std::size_t chunkSize)
+        : _fd(-1),
+          _chunkSize(roundUp(std::max<std::size_t>(chunkSize, 1), pageSize)),
+          _fileSize(0),
+          _used(0) {
+    std::string pattern = directory + "/jointcal-catalog-XXXXXX";
+    std::vector<char> filename(pattern.begin(), pattern.end());
+    filename.push_back('\0');
+    _fd = mkstemp(filename.data());
+    if (_fd < 0) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Could not create a scratch file in " + directory +
+                                                            ": " + std::strerror(errno));
+    }
+    // Only the mapping refers to the file from now on, so that it goes away with this process.
+    unlink(filename.data());
+    LOGLS_DEBUG(_log, "Mapping catalogs to a scratch file in " << directory);
+}
+
+MappedArena::~MappedArena() {
+    for (auto const &chunk : _chunks) munmap(chunk.begin, chunk.size);
+    if (_fd >= 0) close(_fd);
+}
+
+void *MappedArena::allocate(std::size_t size, std::size_t alignment) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto freeBlocks = _freeBlocks.find(size);
+    if (freeBlocks != _freeBlocks.end()) {
+        // A block of the same size may have been allocated with a weaker alignment: skip it then.
+        auto &blocks = freeBlocks->second;
+        auto aligned = std::find_if(blocks.rbegin(), blocks.rend(), [alignment](void *pointer) {
+            return reinterpret_cast<std::uintptr_t>(pointer) % alignment == 0;
+        });
+        if (aligned != blocks.rend()) {
+            void *pointer = *aligned;
+            *aligned = blocks.back();
+            blocks.pop_back();
+            return pointer;
+        }
+    }
+
+    std::size_t offset = roundUp(_used, alignment);
+    if (_chunks.empty() || offset + size > _chunks.back().size) {
+        std::size_t newSize = std::max(_chunkSize, roundUp(size, pageSize));
+        if (ftruncate(_fd, _fileSize + newSize) != 0) {
+            LOGLS_ERROR(_log, "Could not grow the catalog scratch file: " << std::strerror(errno));
+            throw std::bad_alloc();
+        }
+        void *begin = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, _fileSize);
+        if (begin == MAP_FAILED) {
+            LOGLS_ERROR(_log, "Could not map the catalog scratch file: " << std::strerror(errno));
+            throw std::bad_alloc();
+        }
+        _chunks.push_back(Chunk{static_cast<char *>(begin), newSize});
+        _fileSize += newSize;
+        offset = 0;
+    }
+    _used = offset + size;
+    return _chunks.back().begin + offset;
+}
+
+void MappedArena::deallocate(void *pointer, std::size_t size) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _freeBlocks[size].push_back(pointer);
+}
+
+std::size_t MappedArena::getMappedSize() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _fileSize;
+}
+
+}  // namespace jointcal
+}  // namespace lsst
@@ -35,6 +35,7 @@
 #include "lsst/jointcal/PhotometryFit.h"
 #include "lsst/jointcal/Associations.h"
 #include "lsst/jointcal/Chi2.h"
+#include "lsst/jointcal/ColumnTable.h"
 #include "lsst/jointcal/Eigenstuff.h"
 #include "lsst/jointcal/AstrometryTransform.h"
 #include "lsst/jointcal/Tripletlist.h"
@@ -82,7 +83,8 @@ void PhotometryFit::leastSquareDerivativesMeasurement(CcdImage const &ccdImage,
                 grad[l] += H[k] * W * residual;
             }
         }
-        if (_fittingFluxes) {
+        // A fixed FittedStar has no flux parameter.
+        if (_fittingFluxes && !measuredStar->getFittedStar()->isFixed()) {
             Eigen::Index index = measuredStar->getFittedStar()->getIndexInMatrix();
             // Note: H = dR/dFittedStarFlux == -1
             tripletList.addTriplet(index, kTriplets, -1.0 * inverseSigma);
@@ -175,13 +177,36 @@ void PhotometryFit::getIndicesOfMeasuredStar(MeasuredStar const &measuredStar, I
     if (_fittingModel) {
         _photometryModel->getMappingIndices(measuredStar.getCcdImage(), indices);
     }
-    if (_fittingFluxes) {
-        std::shared_ptr<FittedStar const> const fs = measuredStar.getFittedStar();
+    std::shared_ptr<FittedStar const> const fs = measuredStar.getFittedStar();
+    if (_fittingFluxes && !fs->isFixed()) {
         Eigen::Index fsIndex = fs->getIndexInMatrix();
         indices.push_back(fsIndex);
     }
 }
 
+void PhotometryFit::getIndicesOfCcdImage(CcdImage const &ccdImage, IndexVector &indices) const {
+    if (_fittingModel) {
+        _photometryModel->getMappingIndices(ccdImage, indices);
+    }
+}
+
+void PhotometryFit::assignCovariance(SparseMatrixD const &covariance) {
+    if (_fittingModel) {
+        for (auto const &ccdImage : _associations->getCcdImageList()) {
+            IndexVector indices;
+            getIndicesOfCcdImage(*ccdImage, indices);
+            _photometryModel->setCovariance(*ccdImage, getCovarianceBlock(covariance, indices));
+        }
+    }
+    if (_fittingFluxes) {
+        for (auto const &fittedStar : _associations->fittedStarList) {
+            if (fittedStar->isFixed()) continue;
+            Eigen::Index index = fittedStar->getIndexInMatrix();
+            _photometryModel->setFittedStarError(*fittedStar, std::sqrt(covariance.coeff(index, index)));
+        }
+    }
+}
+
 void PhotometryFit::assignIndices(std::string const &whatToFit) {
     _whatToFit = whatToFit;
     LOGLS_INFO(_log, "assignIndices: now fitting: " << whatToFit);
@@ -198,6 +223,11 @@ void PhotometryFit::assignIndices(std::string const &whatToFit) {
             // - when filling the derivatives
             // - when updating (offsetParams())
             // - in getIndicesOfMeasuredStar
+            // Fixed stars have no parameters.
+            if (fittedStar->isFixed()) {
+                fittedStar->setIndexInMatrix(-1);
+                continue;
+            }
             fittedStar->setIndexInMatrix(ipar);
             ipar += 1;
         }
@@ -217,6 +247,7 @@ void PhotometryFit::offsetParams(Eigen::VectorXd const &delta) {
 
     if (_fittingFluxes) {
         for (auto &fittedStar : _associations->fittedStarList) {
+            if (fittedStar->isFixed()) continue;
             // the parameter layout here is used also
             // - when filling the derivatives
             // - when assigning indices (assignIndices())
@@ -227,34 +258,29 @@ void PhotometryFit::offsetParams(Eigen::VectorXd const &delta) {
 }
 
 void PhotometryFit::saveChi2MeasContributions(std::string const &filename) const {
-    std::ofstream ofile(filename.c_str());
-    std::string separator = "\t";
-
-    ofile << "#id" << separator << "xccd" << separator << "yccd" << separator;
-    ofile << "mag" << separator << "instMag" << separator << "instMagErr" << separator;
-    ofile << "instFlux" << separator << "instFluxErr" << separator;
-    ofile << "inputFlux" << separator << "inputFluxErr" << separator;
-    ofile << "transformedFlux" << separator << "transformedFluxErr" << separator;
-    ofile << "fittedFlux" << separator;
-    ofile << "epoch" << separator;
-    ofile << "fsindex" << separator;
-    ofile << "ra" << separator << "dec" << separator;
-    ofile << "chi2" << separator << "nm" << separator;
-    ofile << "chip" << separator << "visit" << separator << std::endl;
-
-    ofile << "#id in source catalog" << separator << "coordinates in CCD" << separator << separator;
-    ofile << "fitted magnitude" << separator << "measured magnitude" << separator
-          << "measured magnitude error" << separator;
-    ofile << "measured instrumental flux (ADU)" << separator << "measured instrument flux error" << separator;
-    ofile << "measured flux (nJy)" << separator << "measured flux error" << separator;
-    ofile << separator << separator;
-    ofile << "fitted flux (nJy)" << separator;
-    ofile << "Julian Epoch Year of the measurement" << separator;
-    ofile << "unique index of the fittedStar" << separator;
-    ofile << "on-sky position of fitted star" << separator << separator;
-    ofile << "contribution to Chi2 (1 dof)" << separator << "number of measurements of this FittedStar"
-          << separator;
-    ofile << "chip id" << separator << "visit id" << std::endl;
+    ColumnTable table;
+    auto &id = table.addIntColumn("id", "id in source catalog");
+    auto &xccd = table.addFloatColumn("xccd", "x coordinate in CCD");
+    auto &yccd = table.addFloatColumn("yccd", "y coordinate in CCD");
+    auto &mag = table.addFloatColumn("mag", "fitted magnitude");
+    auto &instMag = table.addFloatColumn("instMag", "measured magnitude");
+    auto &instMagErr = table.addFloatColumn("instMagErr", "measured magnitude error");
+    auto &instFlux = table.addFloatColumn("instFlux", "measured instrumental flux (ADU)");
+    auto &instFluxErr = table.addFloatColumn("instFluxErr", "measured instrument flux error");
+    auto &inputFlux = table.addFloatColumn("inputFlux", "measured flux (nJy)");
+    auto &inputFluxErr = table.addFloatColumn("inputFluxErr", "measured flux error");
+    auto &transformedFlux = table.addFloatColumn("transformedFlux", "transformed flux (nJy)");
+    auto &transformedFluxErr = table.addFloatColumn("transformedFluxErr", "transformed flux error");
+    auto &fittedFlux = table.addFloatColumn("fittedFlux", "fitted flux (nJy)");
+    auto &epoch = table.addFloatColumn("epoch", "Julian Epoch Year of the measurement");
+    auto &fsindex = table.addIntColumn("fsindex", "unique index of the fittedStar");
+    auto &ra = table.addFloatColumn("ra", "on-sky ra of fitted star");
+    auto &dec = table.addFloatColumn("dec", "on-sky dec of fitted star");
+    auto &chi2 = table.addFloatColumn("chi2", "contribution to Chi2 (1 dof)");
+    auto &nm = table.addIntColumn("nm", "number of measurements of this FittedStar");
+    auto &chip = table.addIntColumn("chip", "chip id");
+    auto &visit = table.addIntColumn("visit", "visit id");
+    table.reserve(_associations->getMaxMeasuredStars());
 
     const CcdImageList &ccdImageList = _associations->getCcdImageList();
     for (auto const &ccdImage : ccdImageList) {
@@ -262,46 +288,49 @@ void PhotometryFit::saveChi2MeasContributions(std::string const &filename) const
         for (auto const &measuredStar : cat) {
             if (!measuredStar->isValid()) continue;
 
-            double instFluxErr = _photometryModel->tweakFluxError(*measuredStar);
-            double flux = _photometryModel->transform(*ccdImage, *measuredStar);
             double fluxErr = _photometryModel->transformError(*ccdImage, *measuredStar);
             std::shared_ptr<FittedStar const> const fittedStar = measuredStar->getFittedStar();
             double residual = _photometryModel->computeResidual(*ccdImage, *measuredStar);
-            double chi2Val = std::pow(residual / fluxErr, 2);
-
-            ofile << std::setprecision(9);
-            ofile << measuredStar->getId() << separator << measuredStar->x << separator << measuredStar->y
-                  << separator;
-            ofile << fittedStar->getMag() << separator << measuredStar->getInstMag() << separator
-                  << measuredStar->getInstMagErr() << separator;
-            ofile << measuredStar->getInstFlux() << separator << instFluxErr << separator;
-            ofile << measuredStar->getFlux() << separator << measuredStar->getFluxErr() << separator;
-            ofile << flux << separator << fluxErr << separator << fittedStar->getFlux() << separator;
-            ofile << ccdImage->getEpoch() << separator;
-            ofile << fittedStar->getIndexInMatrix() << separator;
-            ofile << fittedStar->x << separator << fittedStar->y << separator;
-            ofile << chi2Val << separator << fittedStar->getMeasurementCount() << separator;
-            ofile << ccdImage->getCcdId() << separator << ccdImage->getVisit() << std::endl;
+
+            id.push_back(measuredStar->getId());
+            xccd.push_back(measuredStar->x);
+            yccd.push_back(measuredStar->y);
+            mag.push_back(fittedStar->getMag());
+            instMag.push_back(measuredStar->getInstMag());
+            instMagErr.push_back(measuredStar->getInstMagErr());
+            instFlux.push_back(measuredStar->getInstFlux());
+            instFluxErr.push_back(_photometryModel->tweakFluxError(*measuredStar));
+            inputFlux.push_back(measuredStar->getFlux());
+            inputFluxErr.push_back(measuredStar->getFluxErr());
+            transformedFlux.push_back(_photometryModel->transform(*ccdImage, *measuredStar));
+            transformedFluxErr.push_back(fluxErr);
+            fittedFlux.push_back(fittedStar->getFlux());
+            epoch.push_back(ccdImage->getEpoch());
+            fsindex.push_back(fittedStar->getIndexInMatrix());
+            ra.push_back(fittedStar->x);
+            dec.push_back(fittedStar->y);
+            chi2.push_back(std::pow(residual / fluxErr, 2));
+            nm.push_back(fittedStar->getMeasurementCount());
+            chip.push_back(ccdImage->getCcdId());
+            visit.push_back(ccdImage->getVisit());
         }  // loop on measurements in image
     }      // loop on images
+    table.write(filename);
 }
 
 void PhotometryFit::saveChi2RefContributions(std::string const &filename) const {
-    std::ofstream ofile(filename.c_str());
-    std::string separator = "\t";
-
-    ofile << "#ra" << separator << "dec " << separator;
-    ofile << "mag" << separator;
-    ofile << "refFlux" << separator << "refFluxErr" << separator;
-    ofile << "fittedFlux" << separator << "fittedFluxErr" << separator;
-    ofile << "fsindex" << separator << "chi2" << separator << "nm" << std::endl;
-
-    ofile << "#coordinates of fittedStar" << separator << separator;
-    ofile << "magnitude" << separator;
-    ofile << "refStar flux (nJy)" << separator << "refStar fluxErr" << separator;
-    ofile << "fittedStar flux (nJy)" << separator << "fittedStar fluxErr" << separator;
-    ofile << "unique index of the fittedStar" << separator << "refStar contribution to Chi2 (1 dof)"
-          << separator << "number of measurements of this FittedStar" << std::endl;
+    ColumnTable table;
+    auto &ra = table.addFloatColumn("ra", "ra of fittedStar");
+    auto &dec = table.addFloatColumn("dec", "dec of fittedStar");
+    auto &mag = table.addFloatColumn("mag", "magnitude");
+    auto &refFlux = table.addFloatColumn("refFlux", "refStar flux (nJy)");
+    auto &refFluxErr = table.addFloatColumn("refFluxErr", "refStar fluxErr");
+    auto &fittedFlux = table.addFloatColumn("fittedFlux", "fittedStar flux (nJy)");
+    auto &fittedFluxErr = table.addFloatColumn("fittedFluxErr", "fittedStar fluxErr");
+    auto &fsindex = table.addIntColumn("fsindex", "unique index of the fittedStar");
+    auto &chi2 = table.addFloatColumn("chi2", "refStar contribution to Chi2 (1 dof)");
+    auto &nm = table.addIntColumn("nm", "number of measurements of this FittedStar");
+    table.reserve(_associations->fittedStarList.size());
 
     // The following loop is heavily inspired from PhotometryFit::computeChi2()
     const FittedStarList &fittedStarList = _associations->fittedStarList;
@@ -309,16 +338,18 @@ void PhotometryFit::saveChi2RefContributions(std::string const &filename) const
         const RefStar *refStar = fittedStar->getRefStar();
         if (refStar == nullptr) continue;
 
-        double chi2 = std::pow(((fittedStar->getFlux() - refStar->getFlux()) / refStar->getFluxErr()), 2);
-
-        ofile << std::setprecision(9);
-        ofile << fittedStar->x << separator << fittedStar->y << separator;
-        ofile << fittedStar->getMag() << separator;
-        ofile << refStar->getFlux() << separator << refStar->getFluxErr() << separator;
-        ofile << fittedStar->getFlux() << separator << fittedStar->getFluxErr() << separator;
-        ofile << fittedStar->getIndexInMatrix() << separator << chi2 << separator
-              << fittedStar->getMeasurementCount() << std::endl;
+        ra.push_back(fittedStar->x);
+        dec.push_back(fittedStar->y);
+        mag.push_back(fittedStar->getMag());
+        refFlux.push_back(refStar->getFlux());
+        refFluxErr.push_back(refStar->getFluxErr());
+        fittedFlux.push_back(fittedStar->getFlux());
+        fittedFluxErr.push_back(fittedStar->getFluxErr());
+        fsindex.push_back(fittedStar->getIndexInMatrix());
+        chi2.push_back(std::pow(((fittedStar->getFlux() - refStar->getFlux()) / refStar->getFluxErr()), 2));
+        nm.push_back(fittedStar->getMeasurementCount());
     }  // loop on FittedStars
+    table.write(filename);
 }
 
 }  // namespace jointcal
@@ -31,7 +31,14 @@
 
 namespace {
 LOG_LOGGER _log = LOG_GET("jointcal.PhotometryMapping");
+
+// The *WithBasis methods are only valid for Chebyshev visit transforms, which is what
+// ConstrainedPhotometryModel creates; a dynamic_cast per measurement would cost as much as the basis saves.
+lsst::jointcal::PhotometryTransformChebyshev const &asChebyshev(
+        std::shared_ptr<lsst::jointcal::PhotometryTransform> const &transform) {
+    return static_cast<lsst::jointcal::PhotometryTransformChebyshev const &>(*transform);
 }
+}  // namespace
 
 namespace lsst {
 namespace jointcal {
@@ -107,6 +114,41 @@ void ChipVisitFluxMapping::computeParameterDerivatives(MeasuredStar const &measu
     }
 }
 
+double ChipVisitFluxMapping::transformWithBasis(MeasuredStar const &measuredStar, double instFlux,
+                                                Eigen::Ref<Eigen::VectorXd const> const &visitBasis) const {
+    double temp = _chipMapping->getTransform()->transform(measuredStar.x, measuredStar.y, instFlux);
+    return temp * asChebyshev(_visitMapping->getTransform()).computeChebyshevFromBasis(visitBasis);
+}
+
+double ChipVisitFluxMapping::transformErrorWithBasis(
+        MeasuredStar const &measuredStar, double instFlux, double instFluxErr,
+        Eigen::Ref<Eigen::VectorXd const> const &visitBasis) const {
+    double tempFlux =
+            _chipMapping->getTransformErrors()->transform(measuredStar.x, measuredStar.y, instFluxErr);
+    return tempFlux * asChebyshev(_visitMapping->getTransformErrors()).computeChebyshevFromBasis(visitBasis);
+}
+
+void ChipVisitFluxMapping::computeParameterDerivativesWithBasis(
+        MeasuredStar const &measuredStar, double instFlux,
+        Eigen::Ref<Eigen::VectorXd const> const &visitBasis, Eigen::Ref<Eigen::VectorXd> derivatives) const {
+    double chipScale = _chipMapping->getTransform()->transform(measuredStar.x, measuredStar.y, 1);
+    double visitScale = asChebyshev(_visitMapping->getTransform()).computeChebyshevFromBasis(visitBasis);
+
+    // NOTE: See computeParameterDerivatives and DMTN-036 for the math behind this.
+    if (getNParChip() > 0 && !_chipMapping->isFixed()) {
+        Eigen::Ref<Eigen::VectorXd> chipBlock = derivatives.segment(0, getNParChip());
+        _chipMapping->getTransform()->computeParameterDerivatives(measuredStar.x, measuredStar.y, instFlux,
+                                                                  chipBlock);
+        chipBlock *= visitScale;
+    }
+    if (getNParVisit() > 0) {
+        // The derivatives of the flux visit transform are its basis times the flux.
+        Eigen::Ref<Eigen::VectorXd> visitBlock = derivatives.segment(getNParChip(), getNParVisit());
+        visitBlock = visitBasis * instFlux;
+        visitBlock *= chipScale;
+    }
+}
+
 // ChipVisitMagnitudeMapping methods
 
 double ChipVisitMagnitudeMapping::transformError(MeasuredStar const &measuredStar, double instFlux,
@@ -137,5 +179,27 @@ void ChipVisitMagnitudeMapping::computeParameterDerivatives(MeasuredStar const &
     }
 }
 
+double ChipVisitMagnitudeMapping::transformWithBasis(
+        MeasuredStar const &measuredStar, double mag,
+        Eigen::Ref<Eigen::VectorXd const> const &visitBasis) const {
+    double temp = _chipMapping->getTransform()->transform(measuredStar.x, measuredStar.y, mag);
+    return temp + asChebyshev(_visitMapping->getTransform()).computeChebyshevFromBasis(visitBasis);
+}
+
+void ChipVisitMagnitudeMapping::computeParameterDerivativesWithBasis(
+        MeasuredStar const &measuredStar, double instFlux,
+        Eigen::Ref<Eigen::VectorXd const> const &visitBasis, Eigen::Ref<Eigen::VectorXd> derivatives) const {
+    // NOTE: See computeParameterDerivatives and DMTN-036 for the math behind this.
+    if (getNParChip() > 0 && !_chipMapping->isFixed()) {
+        Eigen::Ref<Eigen::VectorXd> chipBlock = derivatives.segment(0, getNParChip());
+        _chipMapping->getTransform()->computeParameterDerivatives(measuredStar.x, measuredStar.y, instFlux,
+                                                                  chipBlock);
+    }
+    if (getNParVisit() > 0) {
+        // The derivatives of the magnitude visit transform are its basis.
+        derivatives.segment(getNParChip(), getNParVisit()) = visitBasis;
+    }
+}
+
 }  // namespace jointcal
 }  // namespace lsst
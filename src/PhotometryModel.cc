@@ -22,7 +22,10 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <unordered_set>
+
 #include "lsst/log/Log.h"
+#include "lsst/pex/exceptions.h"
 
 #include "lsst/jointcal/CcdImage.h"
 #include "lsst/jointcal/PhotometryModel.h"
@@ -65,5 +68,110 @@ bool PhotometryModel::checkPositiveOnBBox(CcdImage const &ccdImage) const {
     return check;
 }
 
+std::unordered_map<CcdImageKey, std::shared_ptr<afw::image::PhotoCalib>> PhotometryModel::toPhotoCalibMap(
+        CcdImageList const &ccdImageList) const {
+    std::unordered_map<CcdImageKey, std::shared_ptr<afw::image::PhotoCalib>> result;
+    for (auto const &ccdImage : ccdImageList) {
+        result.emplace(ccdImage->getHashKey(), toPhotoCalib(*ccdImage));
+    }
+    return result;
+}
+
+Eigen::VectorXd PhotometryModel::getParameters() const {
+    std::vector<Eigen::VectorXd> parameters;
+    Eigen::Index total = 0;
+    for (auto const &keyedMapping : getAllMappings()) {
+        auto const *mapping = keyedMapping.second;
+        parameters.push_back(mapping->getTransform()->getParameters());
+        parameters.push_back(mapping->getTransformErrors()->getParameters());
+        total += parameters[parameters.size() - 2].size() + parameters.back().size();
+    }
+    Eigen::VectorXd result(total);
+    Eigen::Index index = 0;
+    for (auto const &vector : parameters) {
+        result.segment(index, vector.size()) = vector;
+        index += vector.size();
+    }
+    return result;
+}
+
+void PhotometryModel::setParameters(Eigen::VectorXd const &parameters) {
+    auto mappings = getAllMappings();
+    Eigen::Index total = 0;
+    for (auto const &keyedMapping : mappings) {
+        auto const *mapping = keyedMapping.second;
+        total += mapping->getTransform()->getNpar() + mapping->getTransformErrors()->getNpar();
+    }
+    if (parameters.size() != total) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          "Got " + std::to_string(parameters.size()) + " parameters for a model with " +
+                                  std::to_string(total) + ": was it constructed in the same way?");
+    }
+    Eigen::Index index = 0;
+    for (auto const &keyedMapping : mappings) {
+        auto *mapping = keyedMapping.second;
+        // Until freezeErrorTransform() is called, the error transform is the transform itself.
+        for (auto const &transform : {mapping->getTransform(), mapping->getTransformErrors()}) {
+            Eigen::Index npar = transform->getNpar();
+            transform->setParameters(parameters.segment(index, npar));
+            index += npar;
+        }
+    }
+}
+
+PhotometryModel::MappingParameters PhotometryModel::getMappingParameters() const {
+    MappingParameters result;
+    for (auto const &keyedMapping : getAllMappings()) {
+        result.emplace(keyedMapping.first, keyedMapping.second->getTransform()->getParameters());
+    }
+    return result;
+}
+
+std::size_t PhotometryModel::setMappingParameters(MappingParameters const &parameters) {
+    auto mappings = getAllMappings();
+    std::size_t nSet = 0;
+    for (auto const &keyedMapping : mappings) {
+        auto previous = parameters.find(keyedMapping.first);
+        if (previous == parameters.end()) continue;
+        auto transform = keyedMapping.second->getTransform();
+        if (previous->second.size() != static_cast<Eigen::Index>(transform->getNpar())) {
+            LOGLS_WARN(_log, "Not starting the transform of "
+                                     << keyedMapping.first << " from the previous solution: it has "
+                                     << previous->second.size() << " parameters, not "
+                                                              << transform->getNpar());
+            continue;
+        }
+        transform->setParameters(previous->second);
+        ++nSet;
+    }
+    LOGLS_INFO(_log, "Started " << nSet << " of " << mappings.size()
+                                << " transforms from the previous solution");
+    return nSet;
+}
+
+std::size_t PhotometryModel::fixMappings(std::vector<CcdImageKey> const &keys) {
+    std::unordered_set<CcdImageKey> toFix(keys.begin(), keys.end());
+    std::size_t nFixed = 0;
+    for (auto const &keyedMapping : getAllMappings()) {
+        auto *mapping = keyedMapping.second;
+        if (toFix.count(keyedMapping.first) == 0 || mapping->isFixed()) continue;
+        mapping->setFixed(true);
+        _fixedMappings.push_back(mapping);
+        ++nFixed;
+    }
+    LOGLS_INFO(_log, "Holding " << nFixed << " transforms fixed (" << getTotalParameters()
+                                << " parameters left to fit).");
+    return nFixed;
+}
+
+std::size_t PhotometryModel::releaseMappings() {
+    std::size_t nReleased = _fixedMappings.size();
+    for (auto *mapping : _fixedMappings) mapping->setFixed(false);
+    _fixedMappings.clear();
+    LOGLS_INFO(_log, "Released " << nReleased << " fixed transforms (" << getTotalParameters()
+                                 << " parameters to fit).");
+    return nReleased;
+}
+
 }  // namespace jointcal
 }  // namespace lsst
@@ -22,10 +22,16 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <array>
+#include <string>
+#include <utility>
+
 #include "ndarray.h"
 #include "Eigen/Core"
 
 #include "lsst/afw/math/detail/TrapezoidalPacker.h"
+#include "lsst/pex/exceptions.h"
 
 #include "lsst/jointcal/Point.h"
 #include "lsst/jointcal/PhotometryTransform.h"
@@ -37,38 +43,136 @@ namespace jointcal {
 
 namespace {
 
-// To evaluate a 1-d Chebyshev function without needing to have workspace, we use the
-// Clenshaw algorith, which is like going through the recurrence relation in reverse.
-// The CoeffGetter argument g is something that behaves like an array, providing access
-// to the coefficients.
-template <typename CoeffGetter>
-double evaluateFunction1d(CoeffGetter g, double x, std::size_t size) {
-    double b_kp2 = 0.0, b_kp1 = 0.0;
-    for (std::size_t k = (size - 1); k > 0; --k) {
-        double b_k = g[k] + 2 * x * b_kp1 - b_kp2;
-        b_kp2 = b_kp1;
-        b_kp1 = b_k;
+// The Chebyshev kernels below take the coefficients as a row-major [y][x] array with the given row stride,
+// and only use the terms with i+j <= order, in the same order as offsetParams and getParameters.
+// They are specialized on the order up to maxSpecializedOrder, so that the T_n(x) and T_m(y) fit in
+// fixed-size arrays on the stack and the loops can be unrolled; higher orders use the runtime versions.
+constexpr std::size_t maxSpecializedOrder = 10;
+// Number of points evaluated together by evaluateChebyshevMany, so that the compiler can vectorize the
+// recurrence and the sums over the points.
+constexpr std::size_t chebyshevBlockSize = 64;
+
+// Advance the recurrence relation: (tPrev, t) = (T_{n-1}(x), T_n(x)) -> (T_n(x), T_{n+1}(x)).
+inline void advanceTn(double x, std::size_t n, double &tPrev, double &t) {
+    double next = (n == 0) ? x : 2 * x * t - tPrev;
+    tPrev = t;
+    t = next;
+}
+
+template <std::size_t Order>
+inline std::array<double, Order + 1> computeTn(double x) {
+    std::array<double, Order + 1> Tn;
+    Tn[0] = 1;
+    if (Order >= 1) Tn[1] = x;
+    for (std::size_t i = 2; i <= Order; ++i) Tn[i] = 2 * x * Tn[i - 1] - Tn[i - 2];
+    return Tn;
+}
+
+template <std::size_t Order>
+double evaluateChebyshev(double const *coefficients, std::size_t stride, double x, double y) {
+    auto const Tnx = computeTn<Order>(x);
+    auto const Tmy = computeTn<Order>(y);
+    double result = 0;
+    for (std::size_t j = 0; j <= Order; ++j) {
+        double const *row = coefficients + j * stride;
+        double sum = 0;
+        for (std::size_t i = 0; i <= Order - j; ++i) sum += row[i] * Tnx[i];
+        result += Tmy[j] * sum;
     }
-    return g[0] + x * b_kp1 - b_kp2;
+    return result;
 }
 
-// This class imitates a 1-d array, by running evaluateFunction1d on a nested dimension;
-// this lets us reuse the logic in evaluateFunction1d for both dimensions.  Essentially,
-// we run evaluateFunction1d on a column of coefficients to evaluate T_i(x), then pass
-// the result of that to evaluateFunction1d with the results as the "coefficients" associated
-// with the T_j(y) functions.
-struct RecursionArrayImitator {
-    double operator[](Eigen::Index i) const {
-        return evaluateFunction1d(coefficients[i], x, coefficients.getSize<1>());
+template <std::size_t Order>
+void evaluateChebyshevDerivatives(double x, double y, double *derivatives) {
+    auto const Tnx = computeTn<Order>(x);
+    auto const Tmy = computeTn<Order>(y);
+    std::size_t k = 0;
+    for (std::size_t j = 0; j <= Order; ++j) {
+        for (std::size_t i = 0; i <= Order - j; ++i, ++k) derivatives[k] = Tmy[j] * Tnx[i];
     }
+}
 
-    RecursionArrayImitator(ndarray::Array<double const, 2, 2> const &coefficients_, double x_)
-            : coefficients(coefficients_), x(x_) {}
+// Evaluate at n <= chebyshevBlockSize points already mapped to [-1,1]x[-1,1].
+template <std::size_t Order>
+void evaluateChebyshevBlock(double const *coefficients, std::size_t stride, double const *x, double const *y,
+                            std::size_t n, double *result) {
+    double Tnx[Order + 1][chebyshevBlockSize];
+    double Tmy[Order + 1][chebyshevBlockSize];
+    for (std::size_t p = 0; p < n; ++p) {
+        Tnx[0][p] = Tmy[0][p] = 1;
+        result[p] = 0;
+    }
+    if (Order >= 1) {
+        for (std::size_t p = 0; p < n; ++p) {
+            Tnx[1][p] = x[p];
+            Tmy[1][p] = y[p];
+        }
+    }
+    for (std::size_t i = 2; i <= Order; ++i) {
+        for (std::size_t p = 0; p < n; ++p) {
+            Tnx[i][p] = 2 * x[p] * Tnx[i - 1][p] - Tnx[i - 2][p];
+            Tmy[i][p] = 2 * y[p] * Tmy[i - 1][p] - Tmy[i - 2][p];
+        }
+    }
+    double sum[chebyshevBlockSize];
+    for (std::size_t j = 0; j <= Order; ++j) {
+        double const *row = coefficients + j * stride;
+        for (std::size_t p = 0; p < n; ++p) sum[p] = 0;
+        for (std::size_t i = 0; i <= Order - j; ++i) {
+            for (std::size_t p = 0; p < n; ++p) sum[p] += row[i] * Tnx[i][p];
+        }
+        for (std::size_t p = 0; p < n; ++p) result[p] += Tmy[j][p] * sum[p];
+    }
+}
+
+// Runtime-order versions of the above, for orders beyond maxSpecializedOrder: the T_n(x) are recomputed
+// for each row of coefficients, which costs no more than the sums themselves and needs no workspace.
+double evaluateChebyshev(double const *coefficients, std::size_t stride, std::size_t order, double x,
+                         double y) {
+    double result = 0;
+    double tyPrev = 0, ty = 1;
+    for (std::size_t j = 0; j <= order; advanceTn(y, j++, tyPrev, ty)) {
+        double const *row = coefficients + j * stride;
+        double sum = 0;
+        double txPrev = 0, tx = 1;
+        for (std::size_t i = 0; i <= order - j; advanceTn(x, i++, txPrev, tx)) sum += row[i] * tx;
+        result += ty * sum;
+    }
+    return result;
+}
 
-    ndarray::Array<double const, 2, 2> coefficients;
-    double x;
+void evaluateChebyshevDerivatives(std::size_t order, double x, double y, double *derivatives) {
+    std::size_t k = 0;
+    double tyPrev = 0, ty = 1;
+    for (std::size_t j = 0; j <= order; advanceTn(y, j++, tyPrev, ty)) {
+        double txPrev = 0, tx = 1;
+        for (std::size_t i = 0; i <= order - j; advanceTn(x, i++, txPrev, tx), ++k) derivatives[k] = ty * tx;
+    }
+}
+
+void evaluateChebyshevBlock(double const *coefficients, std::size_t stride, std::size_t order,
+                            double const *x, double const *y, std::size_t n, double *result) {
+    for (std::size_t p = 0; p < n; ++p) {
+        result[p] = evaluateChebyshev(coefficients, stride, order, x[p], y[p]);
+    }
+}
+
+// Dispatch table of the order-specialized kernels, indexed by order.
+struct ChebyshevKernels {
+    double (*evaluate)(double const *, std::size_t, double, double);
+    void (*evaluateDerivatives)(double, double, double *);
+    void (*evaluateBlock)(double const *, std::size_t, double const *, double const *, std::size_t, double *);
 };
 
+template <std::size_t... Orders>
+constexpr std::array<ChebyshevKernels, sizeof...(Orders)> makeChebyshevKernels(
+        std::index_sequence<Orders...>) {
+    return {{ChebyshevKernels{&evaluateChebyshev<Orders>, &evaluateChebyshevDerivatives<Orders>,
+                              &evaluateChebyshevBlock<Orders>}...}};
+}
+
+constexpr auto chebyshevKernels = makeChebyshevKernels(std::make_index_sequence<maxSpecializedOrder + 1>());
+
 // Compute an affine transform that maps an arbitrary box to [-1,1]x[-1,1]
 geom::AffineTransform makeChebyshevRangeTransform(geom::Box2D const &bbox) {
     return geom::AffineTransform(
@@ -86,6 +190,28 @@ ndarray::Array<double, 2, 2> _initializeChebyshev(size_t order, bool identity) {
     }
     return coeffs;
 }
+
+// Copy coefficients, checking that they only have terms up to the order of the transform: the evaluation,
+// derivatives and parameters only use those, so any other term would be silently ignored.
+ndarray::Array<double, 2, 2> _copyChebyshev(ndarray::Array<double, 2, 2> const &coefficients) {
+    ndarray::Size const size = coefficients.getSize<0>();
+    if (size == 0 || coefficients.getSize<1>() != size) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          "PhotometryTransformChebyshev: coefficients must be a non-empty square array, "
+                          "not " + std::to_string(size) + "x" + std::to_string(coefficients.getSize<1>()));
+    }
+    for (ndarray::Size j = 0; j < size; ++j) {
+        for (ndarray::Size i = size - j; i < size; ++i) {
+            if (coefficients[j][i] != 0) {
+                throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                                  "PhotometryTransformChebyshev: coefficient [" + std::to_string(j) + "][" +
+                                          std::to_string(i) + "] is beyond order " +
+                                          std::to_string(size - 1) + " but is not 0");
+            }
+        }
+    }
+    return ndarray::copy(coefficients);
+}
 }  // namespace
 
 PhotometryTransformChebyshev::PhotometryTransformChebyshev(size_t order, geom::Box2D const &bbox,
@@ -100,7 +226,7 @@ PhotometryTransformChebyshev::PhotometryTransformChebyshev(ndarray::Array<double
                                                            geom::Box2D const &bbox)
         : _bbox(bbox),
           _toChebyshevRange(makeChebyshevRangeTransform(bbox)),
-          _coefficients(coefficients),
+          _coefficients(_copyChebyshev(coefficients)),
           _order(coefficients.size() - 1),
           _nParameters((_order + 1) * (_order + 2) / 2) {}
 
@@ -221,38 +347,84 @@ Eigen::VectorXd PhotometryTransformChebyshev::getParameters() const {
     return parameters;
 }
 
+void PhotometryTransformChebyshev::setParameters(Eigen::VectorXd const &parameters) {
+    if (parameters.size() != Eigen::Index(_nParameters)) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          "PhotometryTransformChebyshev::setParameters: got " +
+                                  std::to_string(parameters.size()) + " parameters for a transform with " +
+                                  std::to_string(_nParameters));
+    }
+    // NOTE: the indexing in this method and getParameters must be kept consistent!
+    Eigen::VectorXd::Index k = 0;
+    for (ndarray::Size j = 0; j <= _order; ++j) {
+        ndarray::Size const iMax = _order - j;  // to save re-computing `i+j <= order` every inner step.
+        for (ndarray::Size i = 0; i <= iMax; ++i, ++k) {
+            _coefficients[j][i] = parameters[k];
+        }
+    }
+}
+
 double PhotometryTransformChebyshev::computeChebyshev(double x, double y) const {
     geom::Point2D p = _toChebyshevRange(geom::Point2D(x, y));
-    return evaluateFunction1d(RecursionArrayImitator(_coefficients, p.getX()), p.getY(),
-                              _coefficients.getSize<0>());
+    std::size_t const stride = _coefficients.getStride<0>();
+    if (_order <= maxSpecializedOrder) {
+        return chebyshevKernels[_order].evaluate(_coefficients.getData(), stride, p.getX(), p.getY());
+    }
+    return evaluateChebyshev(_coefficients.getData(), stride, _order, p.getX(), p.getY());
 }
 
-void PhotometryTransformChebyshev::computeChebyshevDerivatives(
-        double x, double y, Eigen::Ref<Eigen::VectorXd> derivatives) const {
-    geom::Point2D p = _toChebyshevRange(geom::Point2D(x, y));
-    // Algorithm: compute all the individual components recursively (since we'll need them anyway),
-    // then combine them into the final answer vectors.
-    Eigen::VectorXd Tnx(_order + 1);
-    Eigen::VectorXd Tmy(_order + 1);
-    Tnx[0] = 1;
-    Tmy[0] = 1;
-    if (_order >= 1) {
-        Tnx[1] = p.getX();
-        Tmy[1] = p.getY();
+Eigen::ArrayXd PhotometryTransformChebyshev::computeChebyshev(
+        Eigen::Ref<Eigen::ArrayXd const> const &x, Eigen::Ref<Eigen::ArrayXd const> const &y) const {
+    if (x.size() != y.size()) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          "PhotometryTransformChebyshev::computeChebyshev: x and y have different sizes (" +
+                                  std::to_string(x.size()) + " and " + std::to_string(y.size()) + ")");
     }
-    for (ndarray::Size i = 2; i <= _order; ++i) {
-        Tnx[i] = 2 * p.getX() * Tnx[i - 1] - Tnx[i - 2];
-        Tmy[i] = 2 * p.getY() * Tmy[i - 1] - Tmy[i - 2];
+    Eigen::ArrayXd result(x.size());
+    std::size_t const stride = _coefficients.getStride<0>();
+    double chebyshevX[chebyshevBlockSize];
+    double chebyshevY[chebyshevBlockSize];
+    for (Eigen::Index start = 0; start < x.size(); start += chebyshevBlockSize) {
+        std::size_t const n = std::min<std::size_t>(chebyshevBlockSize, x.size() - start);
+        for (std::size_t p = 0; p < n; ++p) {
+            geom::Point2D point = _toChebyshevRange(geom::Point2D(x[start + p], y[start + p]));
+            chebyshevX[p] = point.getX();
+            chebyshevY[p] = point.getY();
+        }
+        if (_order <= maxSpecializedOrder) {
+            chebyshevKernels[_order].evaluateBlock(_coefficients.getData(), stride, chebyshevX, chebyshevY, n,
+                                                   result.data() + start);
+        } else {
+            evaluateChebyshevBlock(_coefficients.getData(), stride, _order, chebyshevX, chebyshevY, n,
+                                   result.data() + start);
+        }
     }
+    return result;
+}
 
+double PhotometryTransformChebyshev::computeChebyshevFromBasis(
+        Eigen::Ref<Eigen::VectorXd const> const &basis) const {
     // NOTE: the indexing in this method and offsetParams must be kept consistent!
+    double result = 0;
     Eigen::VectorXd::Index k = 0;
     for (ndarray::Size j = 0; j <= _order; ++j) {
         ndarray::Size const iMax = _order - j;  // to save re-computing `i+j <= order` every inner step.
         for (ndarray::Size i = 0; i <= iMax; ++i, ++k) {
-            derivatives[k] = Tmy[j] * Tnx[i];
+            result += _coefficients[j][i] * basis[k];
         }
     }
+    return result;
+}
+
+void PhotometryTransformChebyshev::computeChebyshevDerivatives(
+        double x, double y, Eigen::Ref<Eigen::VectorXd> derivatives) const {
+    geom::Point2D p = _toChebyshevRange(geom::Point2D(x, y));
+    // NOTE: the indexing in the kernels and offsetParams must be kept consistent!
+    if (_order <= maxSpecializedOrder) {
+        chebyshevKernels[_order].evaluateDerivatives(p.getX(), p.getY(), derivatives.data());
+    } else {
+        evaluateChebyshevDerivatives(_order, p.getX(), p.getY(), derivatives.data());
+    }
 }
 
 }  // namespace jointcal
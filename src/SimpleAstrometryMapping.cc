@@ -49,23 +49,53 @@ void SimpleAstrometryMapping::transformPosAndErrors(FatPoint const &where, FatPo
 
 void SimpleAstrometryMapping::positionDerivative(Point const &where, Eigen::Matrix2d &derivative,
                                                  double epsilon) const {
-    errorProp->computeDerivative(where, *lin, epsilon);
-    derivative(0, 0) = lin->getCoefficient(1, 0, 0);
+    AstrometryTransformLinear lin;
+    errorProp->computeDerivative(where, lin, epsilon);
+    derivative(0, 0) = lin.getCoefficient(1, 0, 0);
     //
     /* This does not work : it was proved by rotating the frame
        see the compilation switch ROTATE_T2 in constrainedAstrometryModel.cc
-    derivative(1,0) = lin->getCoefficient(1,0,1);
-    derivative(0,1) = lin->getCoefficient(0,1,0);
+    derivative(1,0) = lin.getCoefficient(1,0,1);
+    derivative(0,1) = lin.getCoefficient(0,1,0);
     */
-    derivative(1, 0) = lin->getCoefficient(0, 1, 0);
-    derivative(0, 1) = lin->getCoefficient(1, 0, 1);
-    derivative(1, 1) = lin->getCoefficient(0, 1, 1);
+    derivative(1, 0) = lin.getCoefficient(0, 1, 0);
+    derivative(0, 1) = lin.getCoefficient(1, 0, 1);
+    derivative(1, 1) = lin.getCoefficient(0, 1, 1);
 }
 
 void SimpleAstrometryMapping::computeTransformAndDerivatives(FatPoint const &where, FatPoint &outPoint,
                                                              Eigen::MatrixX2d &H) const {
     transformPosAndErrors(where, outPoint);
-    transform->paramDerivatives(where, &H(0, 0), &H(0, 1));
+    // A mapping that is not fit has no rows in H.
+    if (toBeFit) transform->paramDerivatives(where, &H(0, 0), &H(0, 1));
+}
+
+Eigen::VectorXd SimpleAstrometryMapping::getParameters() const {
+    Eigen::Index npar = transform->getNpar();
+    Eigen::Index nparErrors = errorProp->getNpar();
+    Eigen::VectorXd parameters(npar + nparErrors);
+    for (Eigen::Index i = 0; i < npar; ++i) parameters[i] = transform->paramRef(i);
+    for (Eigen::Index i = 0; i < nparErrors; ++i) parameters[npar + i] = errorProp->paramRef(i);
+    return parameters;
+}
+
+void SimpleAstrometryMapping::setParameters(Eigen::VectorXd const &parameters) {
+    Eigen::Index npar = transform->getNpar();
+    // errorProp may be transform itself: setting it again is harmless.
+    for (Eigen::Index i = 0; i < npar; ++i) transform->paramRef(i) = parameters[i];
+    for (Eigen::Index i = 0; i < static_cast<Eigen::Index>(errorProp->getNpar()); ++i) {
+        errorProp->paramRef(i) = parameters[npar + i];
+    }
+}
+
+Eigen::VectorXd SimpleAstrometryMapping::getTransformParameters() const {
+    Eigen::VectorXd parameters(transform->getNpar());
+    for (Eigen::Index i = 0; i < parameters.size(); ++i) parameters[i] = transform->paramRef(i);
+    return parameters;
+}
+
+void SimpleAstrometryMapping::setTransformParameters(Eigen::VectorXd const &parameters) {
+    for (Eigen::Index i = 0; i < parameters.size(); ++i) transform->paramRef(i) = parameters[i];
 }
 
 void SimpleAstrometryMapping::print(std::ostream &out) const { out << *transform; }
@@ -85,22 +115,24 @@ SimplePolyMapping::SimplePolyMapping(AstrometryTransformLinear const &CenterAndS
     // check of matrix indexing (once for all)
     MatrixX2d H(3, 2);
     assert((&H(1, 0) - &H(0, 0)) == 1);
+    updateActualResult();
 }
 
 void SimplePolyMapping::positionDerivative(Point const &where, Eigen::Matrix2d &derivative,
                                            double epsilon) const {
     Point tmp = _centerAndScale.apply(where);
-    errorProp->computeDerivative(tmp, *lin, epsilon);
-    derivative(0, 0) = lin->getCoefficient(1, 0, 0);
+    AstrometryTransformLinear lin;
+    errorProp->computeDerivative(tmp, lin, epsilon);
+    derivative(0, 0) = lin.getCoefficient(1, 0, 0);
     //
     /* This does not work : it was proved by rotating the frame
        see the compilation switch ROTATE_T2 in constrainedAstrometryModel.cc
-    derivative(1,0) = lin->getCoefficient(1,0,1);
-    derivative(0,1) = lin->getCoefficient(0,1,0);
+    derivative(1,0) = lin.getCoefficient(1,0,1);
+    derivative(0,1) = lin.getCoefficient(0,1,0);
     */
-    derivative(1, 0) = lin->getCoefficient(0, 1, 0);
-    derivative(0, 1) = lin->getCoefficient(1, 0, 1);
-    derivative(1, 1) = lin->getCoefficient(0, 1, 1);
+    derivative(1, 0) = lin.getCoefficient(0, 1, 0);
+    derivative(0, 1) = lin.getCoefficient(1, 0, 1);
+    derivative(1, 1) = lin.getCoefficient(0, 1, 1);
     derivative = preDer * derivative;
 }
 
@@ -114,7 +146,7 @@ void SimplePolyMapping::computeTransformAndDerivatives(FatPoint const &where, Fa
     outPoint.vx = tmp.vx;
     outPoint.vy = tmp.vy;
     outPoint.vxy = tmp.vxy;
-    transform->paramDerivatives(mid, &H(0, 0), &H(0, 1));
+    if (toBeFit) transform->paramDerivatives(mid, &H(0, 0), &H(0, 1));
 }
 
 void SimplePolyMapping::transformPosAndErrors(FatPoint const &where, FatPoint &outPoint) const {
@@ -128,12 +160,26 @@ void SimplePolyMapping::transformPosAndErrors(FatPoint const &where, FatPoint &o
     outPoint.vxy = tmp.vxy;
 }
 
-AstrometryTransform const &SimplePolyMapping::getTransform() const {
+void SimplePolyMapping::offsetParams(Eigen::VectorXd const &delta) {
+    SimpleAstrometryMapping::offsetParams(delta);
+    updateActualResult();
+}
+
+void SimplePolyMapping::setParameters(Eigen::VectorXd const &parameters) {
+    SimpleAstrometryMapping::setParameters(parameters);
+    updateActualResult();
+}
+
+void SimplePolyMapping::setTransformParameters(Eigen::VectorXd const &parameters) {
+    SimpleAstrometryMapping::setTransformParameters(parameters);
+    updateActualResult();
+}
+
+void SimplePolyMapping::updateActualResult() {
     // Cannot fail given the contructor:
     const AstrometryTransformPolynomial *fittedPoly =
             dynamic_cast<const AstrometryTransformPolynomial *>(&(*transform));
     actualResult = (*fittedPoly) * _centerAndScale;
-    return actualResult;
 }
 
 }  // namespace jointcal
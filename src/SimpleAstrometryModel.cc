@@ -22,8 +22,10 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <tuple>
 
 #include "astshim.h"
 #include "lsst/log/Log.h"
@@ -31,6 +33,7 @@
 #include "lsst/jointcal/SimpleAstrometryModel.h"
 #include "lsst/jointcal/SimpleAstrometryMapping.h"
 #include "lsst/jointcal/CcdImage.h"
+#include "lsst/jointcal/ParallelFor.h"
 #include "lsst/jointcal/ProjectionHandler.h"
 #include "lsst/pex/exceptions.h"
 #include "lsst/jointcal/AstrometryTransform.h"
@@ -45,6 +48,7 @@ SimpleAstrometryModel::SimpleAstrometryModel(CcdImageList const &ccdImageList,
           _skyToTangentPlane(projectionHandler)
 
 {
+    Instrumentation::Timer timer(_instrumentation, "SimpleAstrometryModel");
     std::size_t count = 0;
 
     for (auto i = ccdImageList.cbegin(); i != ccdImageList.cend(); ++i, ++count) {
@@ -92,6 +96,8 @@ SimpleAstrometryModel::SimpleAstrometryModel(CcdImageList const &ccdImageList,
                     std::unique_ptr<SimpleAstrometryMapping>(new SimplePolyMapping(shiftAndNormalize, pol));
         }
     }
+    timer.addCounter("mappings", _myMap.size());
+    timer.addCounter("parameters", getTotalParameters());
 }
 
 const AstrometryMapping *SimpleAstrometryModel::getMapping(CcdImage const &ccdImage) const {
@@ -132,6 +138,20 @@ std::size_t SimpleAstrometryModel::getTotalParameters() const {
     return total;
 }
 
+std::vector<AstrometryModel::KeyedMapping> SimpleAstrometryModel::getAllMappings() const {
+    // _myMap is unordered: sort by (visit, ccd) so that the order does not depend on the hash table.
+    std::vector<CcdImageKey> keys;
+    keys.reserve(_myMap.size());
+    for (auto const &i : _myMap) keys.push_back(i.first);
+    std::sort(keys.begin(), keys.end(), [](CcdImageKey const &a, CcdImageKey const &b) {
+        return std::tie(a.visit, a.ccd) < std::tie(b.visit, b.ccd);
+    });
+    std::vector<KeyedMapping> mappings;
+    mappings.reserve(keys.size());
+    for (auto const &key : keys) mappings.emplace_back(key, _myMap.at(key).get());
+    return mappings;
+}
+
 void SimpleAstrometryModel::print(std::ostream &out) const {
     out << "SimpleAstrometryModel: " << _myMap.size() << " mappings" << std::endl;
     out << *_skyToTangentPlane << std::endl;
@@ -148,10 +168,42 @@ const AstrometryTransform &SimpleAstrometryModel::getTransform(CcdImage const &c
 }
 
 std::shared_ptr<afw::geom::SkyWcs> SimpleAstrometryModel::makeSkyWcs(CcdImage const &ccdImage) const {
+    return makeSkyWcs(ccdImage, *getTransform(ccdImage).toAstMap(ccdImage.getImageFrame()));
+}
+
+std::unordered_map<CcdImageKey, std::shared_ptr<afw::geom::SkyWcs>> SimpleAstrometryModel::makeSkyWcsMap(
+        CcdImageList const &ccdImageList, unsigned nThreads) const {
+    std::vector<std::shared_ptr<CcdImage>> ccdImages(ccdImageList.begin(), ccdImageList.end());
+    std::vector<AstrometryTransformPolynomial const *> polynomials(ccdImages.size());
+    for (std::size_t i = 0; i < ccdImages.size(); ++i) {
+        polynomials[i] = dynamic_cast<AstrometryTransformPolynomial const *>(&getTransform(*ccdImages[i]));
+    }
+    // Only the inverse fits are run concurrently: each one just reads its own transform.
+    std::vector<std::shared_ptr<AstrometryTransformPolynomial>> inverses(ccdImages.size());
+    parallelFor(
+            ccdImages.size(),
+            [&](std::size_t i) {
+                if (polynomials[i] != nullptr) {
+                    inverses[i] = polynomials[i]->fitAstMapInverse(ccdImages[i]->getImageFrame());
+                }
+            },
+            nThreads);
+
+    std::unordered_map<CcdImageKey, std::shared_ptr<afw::geom::SkyWcs>> result;
+    for (std::size_t i = 0; i < ccdImages.size(); ++i) {
+        auto pixelsToIwc = (polynomials[i] != nullptr)
+                                   ? polynomials[i]->toAstMap(*inverses[i])
+                                   : getTransform(*ccdImages[i]).toAstMap(ccdImages[i]->getImageFrame());
+        result.emplace(ccdImages[i]->getHashKey(), makeSkyWcs(*ccdImages[i], *pixelsToIwc));
+    }
+    return result;
+}
+
+std::shared_ptr<afw::geom::SkyWcs> SimpleAstrometryModel::makeSkyWcs(CcdImage const &ccdImage,
+                                                                     ast::Mapping const &pixelsToIwc) const {
     auto proj = std::dynamic_pointer_cast<const TanRaDecToPixel>(getSkyToTangentPlane(ccdImage));
     jointcal::Point tangentPoint(proj->getTangentPoint());
 
-    auto polyMap = getTransform(ccdImage).toAstMap(ccdImage.getImageFrame());
     ast::Frame pixelFrame(2, "Domain=PIXELS");
     ast::Frame iwcFrame(2, "Domain=IWC");
 
@@ -162,7 +214,7 @@ std::shared_ptr<afw::geom::SkyWcs> SimpleAstrometryModel::makeSkyWcs(CcdImage co
     auto iwcToSkyMap = iwcToSkyWcs->getFrameDict()->getMapping("PIXELS", "SKY");
     auto skyFrame = iwcToSkyWcs->getFrameDict()->getFrame("SKY");
 
-    ast::FrameDict frameDict(pixelFrame, *polyMap, iwcFrame);
+    ast::FrameDict frameDict(pixelFrame, pixelsToIwc, iwcFrame);
     frameDict.addFrame("IWC", *iwcToSkyMap, *skyFrame);
     return std::make_shared<afw::geom::SkyWcs>(frameDict);
 }
@@ -22,8 +22,10 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <tuple>
 
 #include "lsst/log/Log.h"
 #include "lsst/jointcal/PhotometryMapping.h"
@@ -39,6 +41,8 @@ Eigen::Index SimplePhotometryModel::assignIndices(std::string const &whatToFit,
     Eigen::Index ipar = firstIndex;
     for (auto const &i : _myMap) {
         auto mapping = i.second.get();
+        // Don't assign indices for fixed parameters.
+        if (mapping->isFixed()) continue;
         mapping->setIndex(ipar);
         ipar += mapping->getNpar();
     }
@@ -48,6 +52,8 @@ Eigen::Index SimplePhotometryModel::assignIndices(std::string const &whatToFit,
 void SimplePhotometryModel::offsetParams(Eigen::VectorXd const &delta) {
     for (auto &i : _myMap) {
         auto mapping = i.second.get();
+        // Don't offset indices for fixed parameters.
+        if (mapping->isFixed()) continue;
         mapping->offsetParams(delta.segment(mapping->getIndex(), mapping->getNpar()));
     }
 }
@@ -61,6 +67,7 @@ void SimplePhotometryModel::freezeErrorTransform() {
 void SimplePhotometryModel::getMappingIndices(CcdImage const &ccdImage,
                                               std::vector<Eigen::Index> &indices) const {
     auto mapping = findMapping(ccdImage);
+    if (mapping->getNpar() == 0) return;
     if (indices.size() < mapping->getNpar()) indices.resize(mapping->getNpar());
     indices[0] = mapping->getIndex();
 }
@@ -73,6 +80,20 @@ std::size_t SimplePhotometryModel::getTotalParameters() const {
     return total;
 }
 
+std::vector<PhotometryModel::KeyedMapping> SimplePhotometryModel::getAllMappings() const {
+    // _myMap is unordered: sort by (visit, ccd) so that the order does not depend on the hash table.
+    std::vector<CcdImageKey> keys;
+    keys.reserve(_myMap.size());
+    for (auto const &i : _myMap) keys.push_back(i.first);
+    std::sort(keys.begin(), keys.end(), [](CcdImageKey const &a, CcdImageKey const &b) {
+        return std::tie(a.visit, a.ccd) < std::tie(b.visit, b.ccd);
+    });
+    std::vector<KeyedMapping> mappings;
+    mappings.reserve(keys.size());
+    for (auto const &key : keys) mappings.emplace_back(key, _myMap.at(key).get());
+    return mappings;
+}
+
 void SimplePhotometryModel::computeParameterDerivatives(MeasuredStar const &measuredStar,
                                                         CcdImage const &ccdImage,
                                                         Eigen::VectorXd &derivatives) const {
@@ -98,6 +119,7 @@ PhotometryMappingBase *SimplePhotometryModel::findMapping(CcdImage const &ccdIma
 
 SimpleFluxModel::SimpleFluxModel(CcdImageList const &ccdImageList, double errorPedestal)
         : SimplePhotometryModel(ccdImageList, LOG_GET("jointcal.SimpleFluxModel"), errorPedestal) {
+    Instrumentation::Timer timer(_instrumentation, "SimpleFluxModel");
     for (auto const &ccdImage : ccdImageList) {
         auto photoCalib = ccdImage->getPhotoCalib();
         // Use the single-frame processing calibration from the PhotoCalib as the initial value.
@@ -105,6 +127,8 @@ SimpleFluxModel::SimpleFluxModel(CcdImageList const &ccdImageList, double errorP
         _myMap.emplace(ccdImage->getHashKey(), std::make_unique<PhotometryMapping>(transform));
     }
     LOGLS_INFO(_log, "SimpleFluxModel got " << _myMap.size() << " ccdImage mappings.");
+    timer.addCounter("mappings", _myMap.size());
+    timer.addCounter("parameters", getTotalParameters());
 }
 
 double SimpleFluxModel::computeResidual(CcdImage const &ccdImage, MeasuredStar const &measuredStar) const {
@@ -135,6 +159,7 @@ void SimpleFluxModel::print(std::ostream &out) const {
 
 SimpleMagnitudeModel::SimpleMagnitudeModel(CcdImageList const &ccdImageList, double errorPedestal)
         : SimplePhotometryModel(ccdImageList, LOG_GET("jointcal.SimpleMagnitudeModel"), errorPedestal) {
+    Instrumentation::Timer timer(_instrumentation, "SimpleMagnitudeModel");
     for (auto const &ccdImage : ccdImageList) {
         auto photoCalib = ccdImage->getPhotoCalib();
         // Use the single-frame processing calibration from the PhotoCalib as the default.
@@ -143,6 +168,8 @@ SimpleMagnitudeModel::SimpleMagnitudeModel(CcdImageList const &ccdImageList, dou
         _myMap.emplace(ccdImage->getHashKey(), std::make_unique<PhotometryMapping>(transform));
     }
     LOGLS_INFO(_log, "SimpleMagnitudeModel got " << _myMap.size() << " ccdImage mappings.");
+    timer.addCounter("mappings", _myMap.size());
+    timer.addCounter("parameters", getTotalParameters());
 }
 
 double SimpleMagnitudeModel::computeResidual(CcdImage const &ccdImage,
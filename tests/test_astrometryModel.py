@@ -40,6 +40,7 @@ import lsst.geom
 import lsst.jointcal
 from lsst.jointcal import astrometryModels
 import lsst.log
+import lsst.pex.exceptions
 from lsst.meas.algorithms import astrometrySourceSelector
 
 
@@ -80,7 +81,7 @@ class AstrometryModelTestBase:
         self.inverseMaxDiff2 = 1e-5
 
         self.firstIndex = 0  # for assignIndices
-        matchCut = 2.0  # arcseconds
+        self.matchCut = 2.0  # arcseconds
         minMeasurements = 2  # accept all star pairs.
 
         jointcalControl = lsst.jointcal.JointcalControl("slot_CalibFlux")
@@ -140,7 +141,7 @@ class AstrometryModelTestBase:
 
         self.projectionHandler = lsst.jointcal.OneTPPerVisitHandler(self.associations.getCcdImageList())
 
-        self.associations.associateCatalogs(matchCut)
+        self.associations.associateCatalogs(self.matchCut)
         self.associations.prepareFittedStars(minMeasurements)
         self.associations.deprojectFittedStars()
 
@@ -163,6 +164,175 @@ class AstrometryModelTestBase:
     def testMakeSkyWcsModel2(self):
         self.CheckMakeSkyWcsModel(self.model2, self.fitter2, self.inverseMaxDiff2)
 
+    def testMakeSkyWcsMap(self):
+        """Fitting the inverses on several threads gives the same SkyWcs as
+        on one thread, and as converting one ccdImage at a time.
+        """
+        ccdImageList = self.associations.getCcdImageList()
+        for model in (self.model1, self.model2):
+            serial = model.makeSkyWcsMap(ccdImageList, nThreads=1)
+            # The constrained model keeps its AST mappings until the parameters change.
+            model.setParameters(model.getParameters())
+            parallel = model.makeSkyWcsMap(ccdImageList, nThreads=4)
+            self.assertEqual(len(serial), len(ccdImageList))
+            self.assertEqual(serial.keys(), parallel.keys())
+            for ccdImage in ccdImageList:
+                key = (ccdImage.visit, ccdImage.ccdId)
+                points = lsst.geom.Box2D(ccdImage.getDetector().getBBox()).getCorners()
+                skyPoints = serial[key].pixelToSky(points)
+                self.assertEqual(parallel[key].pixelToSky(points), skyPoints)
+                self.assertEqual(parallel[key].skyToPixel(skyPoints), serial[key].skyToPixel(skyPoints))
+                self.assertSpherePointListsAlmostEqual(model.makeSkyWcs(ccdImage).pixelToSky(points),
+                                                       skyPoints)
+
+    def testCheckpoint(self):
+        """A checkpoint should restore the associations and the model
+        parameters exactly.
+        """
+        parameters = self.model1.getParameters()
+        parameters += np.random.normal(scale=1e-6, size=len(parameters))
+        self.model1.setParameters(parameters)
+        np.testing.assert_array_equal(self.model1.getParameters(), parameters)
+        with self.assertRaises(lsst.pex.exceptions.LengthError):
+            self.model1.setParameters(parameters[:-1])
+
+        detectors = {ccdImage.getCcdId(): ccdImage.getDetector()
+                     for ccdImage in self.associations.getCcdImageList()}
+        with lsst.utils.tests.getTempFilePath(".bin") as filename:
+            self.fitter1.writeCheckpoint(filename)
+            checkpoint = lsst.jointcal.Checkpoint(filename, detectors)
+            with self.assertRaises(lsst.pex.exceptions.NotFoundError):
+                lsst.jointcal.Checkpoint(filename, {})
+        np.testing.assert_array_equal(checkpoint.getModelParameters(), parameters)
+
+        associations = checkpoint.getAssociations()
+        self.assertEqual(associations.fittedStarListSize(), self.associations.fittedStarListSize())
+        self.assertEqual(associations.refStarListSize(), self.associations.refStarListSize())
+        self.assertEqual(associations.getCommonTangentPoint().x, self.associations.getCommonTangentPoint().x)
+        self.assertEqual(associations.getCommonTangentPoint().y, self.associations.getCommonTangentPoint().y)
+        for expect, ccdImage in zip(self.associations.getCcdImageList(), associations.getCcdImageList()):
+            self.assertEqual(ccdImage.getName(), expect.getName())
+            self.assertEqual(ccdImage.getFilter(), expect.getFilter())
+            self.assertEqual(ccdImage.countStars(), expect.countStars())
+            self.assertEqual(ccdImage.getDetector().getId(), expect.getDetector().getId())
+            self.assertEqual(ccdImage.getPhotoCalib().getCalibrationMean(),
+                             expect.getPhotoCalib().getCalibrationMean())
+            for corner in lsst.geom.Box2D(ccdImage.getDetector().getBBox()).getCorners():
+                point = lsst.jointcal.Point(corner.getX(), corner.getY())
+                result = ccdImage.getPixelToCommonTangentPlane().apply(point)
+                expectPoint = expect.getPixelToCommonTangentPlane().apply(point)
+                # The WCS goes through its string serialization.
+                self.assertFloatsAlmostEqual(result.x, expectPoint.x, rtol=0, atol=1e-12)
+                self.assertFloatsAlmostEqual(result.y, expectPoint.y, rtol=0, atol=1e-12)
+
+    def testSetMappingParameters(self):
+        """setMappingParameters() should restore the transforms saved by
+        getMappingParameters(), and skip the ones that do not match.
+        """
+        ccdImage = self.associations.getCcdImageList()[0]
+        corners = lsst.geom.Box2D(ccdImage.getDetector().getBBox()).getCorners()
+        for model in (self.model1, self.model2):
+            solution = model.getMappingParameters()
+            self.assertGreater(len(solution), 0)
+            expect = model.makeSkyWcs(ccdImage).pixelToSky(corners)
+
+            parameters = model.getParameters()
+            model.setParameters(parameters + np.random.normal(scale=1e-6, size=len(parameters)))
+            # A transform the model does not have, and one with the wrong number of parameters.
+            key = next(iter(solution))
+            self.assertEqual(model.setMappingParameters({(self.badVisit, self.badCcd): np.zeros(3),
+                                                         key: np.zeros(len(solution[key]) + 1)}), 0)
+            self.assertEqual(model.setMappingParameters(solution), len(solution))
+            result = model.getMappingParameters()
+            self.assertEqual(result.keys(), solution.keys())
+            for mappingKey in solution:
+                np.testing.assert_array_equal(result[mappingKey], solution[mappingKey])
+            self.assertSpherePointListsAlmostEqual(model.makeSkyWcs(ccdImage).pixelToSky(corners), expect)
+
+    def testFixMappings(self):
+        """The transforms held fixed by fixMappings() should not be fit until
+        releaseMappings() is called.
+        """
+        ccdImage = self.associations.getCcdImageList()[0]
+        keys = [(ccdImage.visit, ccdImage.ccdId), (ccdImage.visit, -1), (-1, ccdImage.ccdId)]
+        for model in (self.model1, self.model2):
+            nFixed = model.fixMappings(keys + [(self.badVisit, self.badCcd)])
+            self.assertGreater(nFixed, 0)
+            model.assignIndices("Distortions", self.firstIndex)
+            self.assertEqual(model.getNpar(ccdImage), 0)
+
+            self.assertEqual(model.releaseMappings(), nFixed)
+            self.assertEqual(model.releaseMappings(), 0)
+            model.assignIndices("Distortions", self.firstIndex)
+            self.assertGreater(model.getNpar(ccdImage), 0)
+
+    def _associate(self, ccdImageList, minMeasurements, fixedStars=None):
+        """Associate ccdImageList on its own, against fixedStars if given."""
+        associations = lsst.jointcal.Associations()
+        for ccdImage in ccdImageList:
+            associations.addCcdImage(ccdImage)
+        associations.computeCommonTangentPoint()
+        if fixedStars is not None:
+            associations.setFixedFittedStars(fixedStars)
+        associations.associateCatalogs(self.matchCut, useFittedList=fixedStars is not None)
+        associations.prepareFittedStars(minMeasurements)
+        associations.deprojectFittedStars()
+        return associations
+
+    def testIncrementalFit(self):
+        """Fitting a new visit against the fitted stars and transforms of a
+        previous fit should leave those unchanged, and only fit the new
+        visit's transforms and stars.
+        """
+        previousImages = [ccdImage for ccdImage in self.associations.getCcdImageList()
+                          if ccdImage.visit == self.visits[0]]
+        newImages = [ccdImage for ccdImage in self.associations.getCcdImageList()
+                     if ccdImage.visit == self.visits[1]]
+
+        # The solution of a previous run, which only had the first visit.
+        previous = self._associate(previousImages, 1)
+        previousHandler = lsst.jointcal.OneTPPerVisitHandler(previous.getCcdImageList())
+        solution = self._makeModel1(previous.getCcdImageList(), previousHandler).getMappingParameters()
+        stars = previous.getFittedStarArray()
+        self.assertEqual(stars.shape, (previous.fittedStarListSize(), 9))
+
+        # Single-measurement stars of the new visit are kept, so that some are fit.
+        nAlone = self._associate(newImages, 1).fittedStarListSize()
+        associations = self._associate(newImages, 1, fixedStars=stars)
+        projectionHandler = lsst.jointcal.OneTPPerVisitHandler(associations.getCcdImageList())
+        model = self._makeModel1(associations.getCcdImageList(), projectionHandler)
+        nStarted = model.setMappingParameters(solution)
+        self.assertEqual(model.fixMappings(list(solution)), nStarted)
+        start = model.getMappingParameters()
+
+        # Restored stars are kept whether or not the new visit touches them,
+        # and the new measurements matched to them make no new stars.
+        nNew = len(associations.getFittedStarArray(includeFixed=False))
+        nFixed = associations.fittedStarListSize() - nNew
+        self.assertEqual(nFixed, len(stars))
+        self.assertGreater(nNew, 0)
+        self.assertLess(nNew, nAlone)
+
+        fitter = lsst.jointcal.AstrometryFit(associations, model, 0.02)
+        fitter.minimize("Distortions")
+        fitter.minimize("Distortions Positions")
+
+        # The restored stars come first in the fitted star list.
+        fixed = associations.getFittedStarArray()[:nFixed]
+        # Positions go through a different common tangent point and back.
+        np.testing.assert_allclose(fixed[:, :2], stars[:, :2], rtol=0, atol=1e-10)
+        np.testing.assert_allclose(fixed[:, 2:5], stars[:, 2:5], rtol=1e-8)
+        np.testing.assert_array_equal(fixed[:, 5:], stars[:, 5:])
+
+        result = model.getMappingParameters()
+        nChanged = 0
+        for key, parameters in result.items():
+            if key in solution:
+                np.testing.assert_array_equal(parameters, solution[key])
+            elif not np.array_equal(parameters, start[key]):
+                nChanged += 1
+        self.assertGreater(nChanged, 0)
+
     def CheckMakeSkyWcsModel(self, model, fitter, inverseMaxDiff):
         """Test producing a SkyWcs on a model for every cdImage,
         both post-initialization and after one fitting step.
@@ -244,10 +414,7 @@ class SimpleAstrometryModelTestCase(AstrometryModelTestBase, lsst.utils.tests.Te
         super().setUp()
         self.order1 = 3
         self.inverseMaxDiff1 = 2e-5
-        self.model1 = astrometryModels.SimpleAstrometryModel(self.associations.getCcdImageList(),
-                                                             self.projectionHandler,
-                                                             True,
-                                                             order=self.order1)
+        self.model1 = self._makeModel1(self.associations.getCcdImageList(), self.projectionHandler)
 
         self.order2 = 5
         # NOTE: because assertPairListsAlmostEqual tests an absolute
@@ -264,6 +431,10 @@ class SimpleAstrometryModelTestCase(AstrometryModelTestBase, lsst.utils.tests.Te
                                                              order=self.order2)
         self._prepModels()
 
+    def _makeModel1(self, ccdImageList, projectionHandler):
+        return astrometryModels.SimpleAstrometryModel(ccdImageList, projectionHandler, True,
+                                                      order=self.order1)
+
     def _testGetNpar(self, model, order):
         for ccdImage in self.associations.getCcdImageList():
             result = model.getNpar(ccdImage)
@@ -296,10 +467,7 @@ class ConstrainedAstrometryModelTestCase(AstrometryModelTestBase, lsst.utils.tes
         self.visitOrder1 = 3
         self.chipOrder1 = 1
         self.inverseMaxDiff1 = 1e-5
-        self.model1 = astrometryModels.ConstrainedAstrometryModel(self.associations.getCcdImageList(),
-                                                                  self.projectionHandler,
-                                                                  chipOrder=self.chipOrder1,
-                                                                  visitOrder=self.visitOrder1)
+        self.model1 = self._makeModel1(self.associations.getCcdImageList(), self.projectionHandler)
 
         self.visitOrder2 = 5
         self.chipOrder2 = 2
@@ -313,6 +481,11 @@ class ConstrainedAstrometryModelTestCase(AstrometryModelTestBase, lsst.utils.tes
         # 22 is closest to the center of the focal plane in this data, so it is not fit.
         self.fixedCcd = 22
 
+    def _makeModel1(self, ccdImageList, projectionHandler):
+        return astrometryModels.ConstrainedAstrometryModel(ccdImageList, projectionHandler,
+                                                           chipOrder=self.chipOrder1,
+                                                           visitOrder=self.visitOrder1)
+
     def _polyParams(self, chipOrder, visitOrder):
         """Number of parameters per polynomial is (d+1)(d+2)/2, summed over
         polynomials, times 2 polynomials per dimension.
@@ -29,7 +29,8 @@ import lsst.geom
 import lsst.log
 import lsst.jointcal
 from lsst.jointcal.astrometryTransform import (AstrometryTransformLinear,
-                                               AstrometryTransformPolynomial, inversePolyTransform)
+                                               AstrometryTransformPolynomial, inversePolyTransform,
+                                               fitPolynomialSurrogate)
 
 
 class AstrometryTransformPolynomialBase:
@@ -137,6 +138,42 @@ class InversePolyTransformTestCase(AstrometryTransformPolynomialBase, lsst.utils
             inversePolyTransform(self.poly2, self.frame, 1e-4, nSteps=2)
 
 
+class FitPolynomialSurrogateTestCase(AstrometryTransformPolynomialBase, lsst.utils.tests.TestCase):
+    def checkSurrogate(self, transform, surrogate, maxDiff):
+        """Test that ``surrogate(point)==transform(point)`` to within maxDiff."""
+        expect = []
+        results = []
+        for point in self.points:
+            tempPoint = lsst.jointcal.star.Point(point[0], point[1])
+            result = transform.apply(tempPoint)
+            expect.append(lsst.geom.Point2D(result.x, result.y))
+            result = surrogate.apply(tempPoint)
+            results.append(lsst.geom.Point2D(result.x, result.y))
+
+        self.assertPairListsAlmostEqual(results, expect, maxDiff=maxDiff)
+
+    def testSurrogatePoly2(self):
+        """An order 2 polynomial is reproduced exactly, by an order 2 surrogate."""
+        surrogate, error = fitPolynomialSurrogate(self.poly2, self.frame, 1e-9)
+        self.assertEqual(surrogate.getOrder(), 2)
+        self.assertLess(error, 1e-9)
+        self.checkSurrogate(self.poly2, surrogate, 1e-9)
+
+    def testSurrogatePoly9(self):
+        maxError = 1e-6
+        surrogate, error = fitPolynomialSurrogate(self.poly9, self.frame, maxError)
+        self.assertLessEqual(surrogate.getOrder(), 9)
+        self.assertLessEqual(error, maxError)
+        # The bound is only checked on a grid, so allow some slack between its points.
+        self.checkSurrogate(self.poly9, surrogate, 2*maxError)
+
+    def testNoSurrogate(self):
+        """No polynomial up to maxOrder is good enough: return None and the best error reached."""
+        surrogate, error = fitPolynomialSurrogate(self.poly9, self.frame, 1e-9, maxOrder=1)
+        self.assertIsNone(surrogate)
+        self.assertGreater(error, 1e-9)
+
+
 class AstrometryTransformPolynomialTestCase(AstrometryTransformPolynomialBase, lsst.utils.tests.TestCase):
     def checkToAstMap(self, poly, inverseMaxDiff=1e-6):
         """Test that AstrometryTransformPolynomial.toAstMap() gives accurate results.
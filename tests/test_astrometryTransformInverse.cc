@@ -0,0 +1,146 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#define BOOST_TEST_MODULE test_astrometryTransformInverse
+
+// The boost unit test header
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "lsst/jointcal/AstrometryTransform.h"
+#include "lsst/jointcal/Frame.h"
+
+namespace jointcal = lsst::jointcal;
+
+namespace {
+
+jointcal::Frame const region(0, 0, 2048, 4096);
+
+/// A third order polynomial from a chip to a focal plane in mm.
+jointcal::AstrometryTransformPolynomial makePolynomial() {
+    jointcal::AstrometryTransformPolynomial polynomial(3);
+    polynomial.getCoefficient(0, 0, 0) = -20;
+    polynomial.getCoefficient(0, 0, 1) = 35;
+    polynomial.getCoefficient(1, 0, 0) = 0.015;
+    polynomial.getCoefficient(0, 1, 0) = 1e-5;
+    polynomial.getCoefficient(1, 0, 1) = -2e-5;
+    polynomial.getCoefficient(0, 1, 1) = 0.015;
+    polynomial.getCoefficient(2, 0, 0) = 1e-9;
+    polynomial.getCoefficient(1, 1, 1) = 2e-9;
+    polynomial.getCoefficient(0, 3, 0) = 1e-13;
+    return polynomial;
+}
+
+std::vector<jointcal::Point> makePoints(jointcal::Frame const &frame, unsigned seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> x(frame.xMin, frame.xMax);
+    std::uniform_real_distribution<double> y(frame.yMin, frame.yMax);
+    std::vector<jointcal::Point> points;
+    for (int i = 0; i < 500; ++i) points.emplace_back(x(generator), y(generator));
+    return points;
+}
+
+/// Largest distance between the points of region and their round trip through transform and inverse.
+double maxRoundTripError(jointcal::AstrometryTransform const &transform,
+                         jointcal::AstrometryTransform const &inverse, jointcal::Frame const &frame) {
+    double maxDist2 = 0;
+    for (auto const &point : makePoints(frame, 1)) {
+        maxDist2 = std::max(maxDist2, inverse.apply(transform.apply(point)).computeDist2(point));
+    }
+    // the vectorized apply checks its outputs too
+    std::vector<jointcal::Point> in, out, points = makePoints(frame, 2);
+    transform.apply(points, in);
+    inverse.apply(in, out);
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        maxDist2 = std::max(maxDist2, out[i].computeDist2(points[i]));
+    }
+    return std::sqrt(maxDist2);
+}
+
+}  // namespace
+
+/// A change of the transform that leaves the cache probes alone still gives accurate inverses.
+BOOST_AUTO_TEST_CASE(test_changeMissedByProbes) {
+    double const precision = 1e-6;
+    auto polynomial = makePolynomial();
+    auto inverse = polynomial.inverseTransform(precision, region);
+    BOOST_CHECK_LT(maxRoundTripError(polynomial, *inverse, region), 10 * precision);
+
+    // Add 1e-9 (x^2 - 2048 x) (y - 2048) to the x output: it is 0 at the corners and the center of region,
+    // which are the probes, and reaches about 2 elsewhere.
+    double const scale = 1e-9;
+    polynomial.getCoefficient(2, 1, 0) += scale;
+    polynomial.getCoefficient(2, 0, 0) -= scale * 2048;
+    polynomial.getCoefficient(1, 1, 0) -= scale * 2048;
+    polynomial.getCoefficient(1, 0, 0) += scale * 2048 * 2048;
+    BOOST_CHECK_GT(polynomial.apply(jointcal::Point(1024, 1024)).computeDist2(
+                           makePolynomial().apply(jointcal::Point(1024, 1024))),
+                   1);
+
+    auto changed = polynomial.inverseTransform(precision, region);
+    BOOST_CHECK_LT(maxRoundTripError(polynomial, *changed, region), 10 * precision);
+}
+
+/// Copies of a transform do not share the inverses of the original.
+BOOST_AUTO_TEST_CASE(test_copy) {
+    double const precision = 1e-6;
+    auto polynomial = makePolynomial();
+    polynomial.inverseTransform(precision, region);
+    jointcal::AstrometryTransformPolynomial copy(polynomial);
+    copy.getCoefficient(0, 0, 0) += 1;
+    BOOST_CHECK_LT(maxRoundTripError(copy, *copy.inverseTransform(precision, region), region),
+                   10 * precision);
+    copy = polynomial;
+    BOOST_CHECK_LT(maxRoundTripError(copy, *copy.inverseTransform(precision, region), region),
+                   10 * precision);
+}
+
+/// Inverses of one transform requested from several threads at once, over more regions than it caches.
+BOOST_AUTO_TEST_CASE(test_concurrentInverses) {
+    auto const polynomial = makePolynomial();
+    std::vector<jointcal::Frame> regions;
+    for (int i = 0; i < 6; ++i) regions.emplace_back(0, 500 * i, 2048, 500 * i + 1500);
+    double const precision = 1e-6;
+
+    std::atomic<int> failures(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int pass = 0; pass < 10; ++pass) {
+                auto const &frame = regions[(t + pass) % regions.size()];
+                auto inverse = polynomial.inverseTransform(precision, frame);
+                if (maxRoundTripError(polynomial, *inverse, frame) > 10 * precision) ++failures;
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    BOOST_CHECK_EQUAL(failures, 0);
+}
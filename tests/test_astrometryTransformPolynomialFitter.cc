@@ -0,0 +1,322 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#define BOOST_TEST_MODULE test_astrometryTransformPolynomialFitter
+
+// The boost unit test header
+#include "boost/test/unit_test.hpp"
+
+#include <random>
+#include <set>
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/jointcal/AstrometryTransform.h"
+#include "lsst/jointcal/StarMatch.h"
+
+namespace jointcal = lsst::jointcal;
+
+namespace {
+
+std::size_t const order = 3;
+
+/// A third order polynomial with a large offset, as from pixels to a focal plane far from its origin.
+jointcal::AstrometryTransformPolynomial makeTruth() {
+    jointcal::AstrometryTransformPolynomial truth(order);
+    truth.getCoefficient(0, 0, 0) = 1e5;
+    truth.getCoefficient(0, 0, 1) = -2e5;
+    truth.getCoefficient(1, 0, 0) = 0.998;
+    truth.getCoefficient(0, 1, 0) = 0.02;
+    truth.getCoefficient(1, 0, 1) = -0.01;
+    truth.getCoefficient(0, 1, 1) = 1.003;
+    truth.getCoefficient(2, 0, 0) = 1e-6;
+    truth.getCoefficient(1, 1, 1) = -2e-6;
+    truth.getCoefficient(3, 0, 1) = 1e-10;
+    truth.getCoefficient(1, 2, 0) = -3e-10;
+    return truth;
+}
+
+/// Sample truth at nMatches random points of a 4k x 4k chip, with Gaussian noise of sigma on point2.
+void makeMatches(jointcal::AstrometryTransform const &truth, std::size_t nMatches, double sigma,
+                 jointcal::StarMatchList &matches) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> position(0, 4000);
+    std::normal_distribution<double> noise(0, sigma);
+    for (std::size_t i = 0; i < nMatches; ++i) {
+        jointcal::Point point1(position(rng), position(rng));
+        jointcal::Point point2 = truth.apply(point1);
+        if (sigma > 0) {
+            point2.x += noise(rng);
+            point2.y += noise(rng);
+        }
+        matches.push_back(jointcal::StarMatch(point1, point2, nullptr, nullptr));
+    }
+}
+
+/// Largest distance between transform1 and transform2 over the chip.
+double maxDistance(jointcal::AstrometryTransform const &transform1,
+                   jointcal::AstrometryTransform const &transform2) {
+    double maxDist2 = 0;
+    for (double x = 0; x <= 4000; x += 500) {
+        for (double y = 0; y <= 4000; y += 500) {
+            jointcal::Point point(x, y);
+            maxDist2 = std::max(maxDist2, transform1.apply(point).computeDist2(transform2.apply(point)));
+        }
+    }
+    return std::sqrt(maxDist2);
+}
+
+/// Sum of the squared residuals of transform over matches.
+double sumResiduals2(jointcal::StarMatchList const &matches, jointcal::AstrometryTransform const &transform) {
+    double sum = 0;
+    for (auto const &match : matches) sum += transform.apply(match.point1).computeDist2(match.point2);
+    return sum;
+}
+
+}  // namespace
+
+/// Both bases recover an exact polynomial, with a non-negative chi2 despite the large offsets.
+BOOST_AUTO_TEST_CASE(test_exactFit) {
+    auto truth = makeTruth();
+    jointcal::StarMatchList matches;
+    makeMatches(truth, 200, 0, matches);
+    for (bool orthogonal : {false, true}) {
+        jointcal::AstrometryTransformPolynomialFitter fitter(matches, order, orthogonal);
+        jointcal::AstrometryTransformPolynomial result;
+        double chi2 = -1;
+        BOOST_REQUIRE(fitter.fit(order, result, chi2));
+        BOOST_CHECK_GE(chi2, 0);
+        BOOST_CHECK_SMALL(chi2, 1e-12);
+        BOOST_CHECK_SMALL(maxDistance(result, truth), 1e-7);
+
+        // Nothing to clip, even though the residuals are not exactly 0.
+        BOOST_REQUIRE(fitter.fitWithClipping(order, 3, result, chi2));
+        BOOST_CHECK_EQUAL(fitter.getNUsed(), matches.size());
+    }
+
+    // As many matches as parameters per coordinate.
+    jointcal::StarMatchList exact;
+    makeMatches(truth, 10, 0, exact);
+    jointcal::AstrometryTransformPolynomialFitter fitter(exact, order);
+    jointcal::AstrometryTransformPolynomial result;
+    double chi2 = -1;
+    BOOST_REQUIRE(fitter.fit(order, result, chi2));
+    BOOST_CHECK_EQUAL(chi2, 0);
+}
+
+/// The two bases agree on noisy matches, for every order, and chi2 is the sum of the squared residuals.
+BOOST_AUTO_TEST_CASE(test_noisyFit) {
+    auto truth = makeTruth();
+    jointcal::StarMatchList matches;
+    makeMatches(truth, 500, 0.1, matches);
+    jointcal::AstrometryTransformPolynomialFitter normal(matches, order, false);
+    jointcal::AstrometryTransformPolynomialFitter orthogonal(matches, order, true);
+    for (std::size_t fitOrder = 1; fitOrder <= order; ++fitOrder) {
+        jointcal::AstrometryTransformPolynomial result1, result2;
+        double chi2_1, chi2_2;
+        BOOST_REQUIRE(normal.fit(fitOrder, result1, chi2_1));
+        BOOST_REQUIRE(orthogonal.fit(fitOrder, result2, chi2_2));
+        BOOST_CHECK_EQUAL(result1.getOrder(), fitOrder);
+        BOOST_CHECK_SMALL(maxDistance(result1, result2), 1e-6);
+        BOOST_CHECK_CLOSE(chi2_1, sumResiduals2(matches, result1), 1e-6);
+        BOOST_CHECK_CLOSE(chi2_2, sumResiduals2(matches, result2), 1e-6);
+    }
+    // The noise is small enough for the full order to find the truth.
+    jointcal::AstrometryTransformPolynomial result;
+    double chi2;
+    BOOST_REQUIRE(normal.fit(order, result, chi2));
+    BOOST_CHECK_SMALL(maxDistance(result, truth), 0.1);
+    // 2 coordinates of 500 matches, minus 2 x 10 parameters.
+    BOOST_CHECK_CLOSE(chi2 / (2 * 500 - 20), 0.01, 10);
+}
+
+/// Removing matches (a downdate in the monomial basis) gives the fit of the remaining ones.
+BOOST_AUTO_TEST_CASE(test_remove) {
+    auto truth = makeTruth();
+    jointcal::StarMatchList matches;
+    makeMatches(truth, 100, 0.1, matches);
+    std::set<std::size_t> removed = {0, 7, 13, 50, 99};
+    jointcal::StarMatchList kept;
+    std::size_t i = 0;
+    for (auto const &match : matches) {
+        if (removed.count(i++) == 0) kept.push_back(match);
+    }
+
+    for (bool orthogonal : {false, true}) {
+        jointcal::AstrometryTransformPolynomialFitter fitter(matches, order, orthogonal);
+        jointcal::AstrometryTransformPolynomial result, expect;
+        double chi2, expectChi2;
+        BOOST_REQUIRE(fitter.fit(order, result, chi2));  // so that the factorization exists before removals
+        for (auto index : removed) fitter.remove(index);
+        fitter.remove(0);  // removing twice has no effect
+        BOOST_CHECK_EQUAL(fitter.getNUsed(), kept.size());
+        BOOST_REQUIRE(fitter.fit(order, result, chi2));
+
+        jointcal::AstrometryTransformPolynomialFitter scratch(kept, order, orthogonal);
+        BOOST_REQUIRE(scratch.fit(order, expect, expectChi2));
+        BOOST_CHECK_SMALL(maxDistance(result, expect), 1e-8);
+        BOOST_CHECK_CLOSE(chi2, expectChi2, 1e-6);
+
+        fitter.reset();
+        BOOST_CHECK_EQUAL(fitter.getNUsed(), matches.size());
+    }
+}
+
+/// Clipping removes the outliers, and only them.
+BOOST_AUTO_TEST_CASE(test_clipping) {
+    auto truth = makeTruth();
+    jointcal::StarMatchList matches;
+    makeMatches(truth, 300, 0.1, matches);
+    std::size_t const nOutliers = 6;
+    std::size_t i = 0;
+    for (auto &match : matches) {
+        if (i++ % (matches.size() / nOutliers) == 0) match.point2.x += 3;
+    }
+
+    for (bool orthogonal : {false, true}) {
+        jointcal::AstrometryTransformPolynomialFitter fitter(matches, order, orthogonal);
+        jointcal::AstrometryTransformPolynomial result;
+        double chi2;
+        BOOST_REQUIRE(fitter.fitWithClipping(order, 5, result, chi2));
+        BOOST_CHECK_EQUAL(fitter.getNUsed(), matches.size() - nOutliers);
+        BOOST_CHECK_SMALL(maxDistance(result, truth), 0.1);
+        BOOST_CHECK_GE(chi2, 0);
+    }
+}
+
+/// Fits with too few matches fail, and leave their outputs alone.
+BOOST_AUTO_TEST_CASE(test_tooFewMatches) {
+    auto truth = makeTruth();
+    jointcal::StarMatchList matches;
+    makeMatches(truth, 9, 0.1, matches);
+    jointcal::AstrometryTransformPolynomialFitter fitter(matches, order);
+    jointcal::AstrometryTransformPolynomial result(1);
+    double chi2 = 42;
+    BOOST_CHECK(!fitter.fit(order, result, chi2));
+    BOOST_CHECK(!fitter.fitWithClipping(order, 3, result, chi2));
+    BOOST_CHECK_EQUAL(chi2, 42);
+    BOOST_CHECK_EQUAL(result.getOrder(), 1u);
+    // Lower orders still work.
+    BOOST_CHECK(fitter.fit(2, result, chi2));
+}
+
+namespace {
+
+/// Give point2 of every match a different, correlated, covariance, and point1 none.
+void setCovariances(jointcal::StarMatchList &matches) {
+    std::size_t i = 0;
+    for (auto &match : matches) {
+        match.point1 = jointcal::FatPoint(match.point1, 0, 0, 0);
+        double vx = 0.01 * (1 + i % 3);
+        double vy = 0.01 * (1 + i % 5);
+        match.point2 = jointcal::FatPoint(match.point2, vx, vy, 0.3 * std::sqrt(vx * vy));
+        ++i;
+    }
+}
+
+}  // namespace
+
+/// Without errors on point1, the weighted fit is AstrometryTransformPolynomial::fit(), in both bases.
+BOOST_AUTO_TEST_CASE(test_weightedFit) {
+    auto truth = makeTruth();
+    jointcal::StarMatchList matches;
+    makeMatches(truth, 300, 0.1, matches);
+    setCovariances(matches);
+    jointcal::AstrometryTransformPolynomial expect(order);
+    expect.fit(matches);
+
+    for (bool orthogonal : {false, true}) {
+        // The guess only propagates the errors of point1, so any will do.
+        jointcal::AstrometryTransformPolynomialFitter fitter(matches, jointcal::AstrometryTransformIdentity(),
+                                                             order, orthogonal);
+        jointcal::AstrometryTransformPolynomial result;
+        double chi2;
+        BOOST_REQUIRE(fitter.fit(order, result, chi2));
+        BOOST_CHECK_SMALL(maxDistance(result, expect), 1e-6);
+        double sumChi2 = 0;
+        for (auto const &match : matches) sumChi2 += match.computeChi2(result);
+        BOOST_CHECK_CLOSE(chi2, sumChi2, 1e-6);
+    }
+}
+
+/// Equal, uncorrelated, covariances give the unweighted fit, with its chi2 divided by the variance.
+BOOST_AUTO_TEST_CASE(test_weightedUniform) {
+    auto truth = makeTruth();
+    jointcal::StarMatchList matches;
+    makeMatches(truth, 300, 0.1, matches);
+    for (auto &match : matches) match.point2 = jointcal::FatPoint(match.point2, 0.01, 0.01, 0);
+    jointcal::AstrometryTransformPolynomialFitter unweighted(matches, order);
+    jointcal::AstrometryTransformPolynomialFitter weighted(matches, jointcal::AstrometryTransformIdentity(),
+                                                           order);
+    jointcal::AstrometryTransformPolynomial result, expect;
+    double chi2, expectChi2;
+    BOOST_REQUIRE(unweighted.fit(order, expect, expectChi2));
+    BOOST_REQUIRE(weighted.fit(order, result, chi2));
+    BOOST_CHECK_SMALL(maxDistance(result, expect), 1e-6);
+    // point1 has the default unit variances, which the identity guess adds to those of point2.
+    BOOST_CHECK_CLOSE(chi2, expectChi2 / 1.01, 1e-6);
+}
+
+/// Removing weighted matches downdates both of their rows.
+BOOST_AUTO_TEST_CASE(test_weightedRemove) {
+    auto truth = makeTruth();
+    jointcal::StarMatchList matches;
+    makeMatches(truth, 100, 0.1, matches);
+    setCovariances(matches);
+    std::set<std::size_t> removed = {0, 7, 13, 50, 99};
+    jointcal::StarMatchList kept;
+    std::size_t i = 0;
+    for (auto const &match : matches) {
+        if (removed.count(i++) == 0) kept.push_back(match);
+    }
+
+    jointcal::AstrometryTransformIdentity guess;
+    for (bool orthogonal : {false, true}) {
+        jointcal::AstrometryTransformPolynomialFitter fitter(matches, guess, order, orthogonal);
+        jointcal::AstrometryTransformPolynomial result, expect;
+        double chi2, expectChi2;
+        BOOST_REQUIRE(fitter.fit(order, result, chi2));
+        for (auto index : removed) fitter.remove(index);
+        BOOST_CHECK_EQUAL(fitter.getNUsed(), kept.size());
+        BOOST_REQUIRE(fitter.fit(order, result, chi2));
+
+        jointcal::AstrometryTransformPolynomialFitter scratch(kept, guess, order, orthogonal);
+        BOOST_REQUIRE(scratch.fit(order, expect, expectChi2));
+        BOOST_CHECK_SMALL(maxDistance(result, expect), 1e-8);
+        BOOST_CHECK_CLOSE(chi2, expectChi2, 1e-6);
+    }
+}
+
+/// A match without errors cannot be weighted.
+BOOST_AUTO_TEST_CASE(test_weightedNoErrors) {
+    auto truth = makeTruth();
+    jointcal::StarMatchList matches;
+    makeMatches(truth, 20, 0.1, matches);
+    matches.front().point1 = jointcal::FatPoint(matches.front().point1, 0, 0, 0);
+    matches.front().point2 = jointcal::FatPoint(matches.front().point2, 0, 0, 0);
+    jointcal::AstrometryTransformIdentity guess;
+    BOOST_CHECK_THROW(jointcal::AstrometryTransformPolynomialFitter fitter(matches, guess, order),
+                      lsst::pex::exceptions::InvalidParameterError);
+}
@@ -0,0 +1,76 @@
+# This file is part of jointcal.
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+"""Test the synthetic tract generator and the benchmark driver."""
+import dataclasses
+import unittest
+
+import lsst.utils.tests
+
+from lsst.jointcal import benchmark
+
+
+class BenchmarkTestCase(lsst.utils.tests.TestCase):
+    def setUp(self):
+        self.parameters = dataclasses.replace(benchmark.PRESETS["tiny"])
+
+    def test_makeSyntheticTract(self):
+        tract = benchmark.makeSyntheticTract(self.parameters)
+        nCcds = self.parameters.camera.nx*self.parameters.camera.ny
+        self.assertEqual(len(tract.detectors), nCcds)
+        self.assertEqual(len(tract.visits), self.parameters.nVisits)
+        self.assertEqual(len(tract.catalogs), nCcds*self.parameters.nVisits)
+        self.assertEqual(tract.catalogs.keys(), tract.skyWcs.keys())
+        for catalog in tract.catalogs.values():
+            self.assertGreater(len(catalog), 0)
+        self.assertGreater(len(tract.refCat), 0)
+        self.assertLess(len(tract.refCat), tract.nStars)
+
+        # The same seed gives the same tract.
+        other = benchmark.makeSyntheticTract(self.parameters)
+        key = next(iter(tract.catalogs))
+        self.assertFloatsEqual(tract.catalogs[key]["centroid_x"], other.catalogs[key]["centroid_x"])
+
+    def test_runBenchmark(self):
+        result = benchmark.runBenchmark(self.parameters)
+        self.assertEqual(list(result["stages"].keys()),
+                         ["simulate", "createCcdImages", "associate", "model", "initialize", "iterate",
+                          "output"])
+        self.assertEqual(result["sizes"]["outputWcs"], result["sizes"]["ccdImages"])
+        self.assertGreater(result["sizes"]["fittedStars"], 0)
+        self.assertGreater(result["sizes"]["refStars"], 0)
+        for phase in ("associateCatalogs", "derivatives", "factorize"):
+            self.assertIn(phase, result["phaseSummary"])
+            self.assertGreater(result["phaseSummary"][phase]["count"], 0)
+        self.assertTrue(result["result"]["modelValid"])
+
+
+class MemoryTester(lsst.utils.tests.MemoryTestCase):
+    pass
+
+
+def setup_module(module):
+    lsst.utils.tests.init()
+
+
+if __name__ == "__main__":
+    lsst.utils.tests.init()
+    unittest.main()
@@ -0,0 +1,105 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#define BOOST_TEST_DYN_LINK
+
+#define BOOST_TEST_MODULE test_blockArrowheadSolver
+
+// The boost unit test header
+#include "boost/test/unit_test.hpp"
+
+#include <random>
+#include <vector>
+
+#include "Eigen/Dense"
+
+#include "lsst/jointcal/BlockArrowheadSolver.h"
+#include "lsst/jointcal/Eigenstuff.h"
+
+using lsst::jointcal::BlockArrowheadSolver;
+
+namespace {
+/**
+ * A Hessian shaped like an astrometry fit: nCcd mappings of nPar parameters each, followed by nStar stars
+ * with 2 parameters, each star measured on 3 ccds.
+ */
+SparseMatrixD makeHessian(Eigen::Index nCcd, Eigen::Index nPar, Eigen::Index nStar) {
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<double> uniform(-1, 1);
+    std::vector<Eigen::Triplet<double, Eigen::Index>> triplets;
+    Eigen::Index const nModel = nCcd * nPar;
+    Eigen::Index term = 0;
+    for (Eigen::Index star = 0; star < nStar; ++star) {
+        for (int k = 0; k < 3; ++k) {
+            Eigen::Index ccd = generator() % nCcd;
+            for (int coordinate = 0; coordinate < 2; ++coordinate, ++term) {
+                for (Eigen::Index par = 0; par < nPar; ++par) {
+                    triplets.emplace_back(ccd * nPar + par, term, uniform(generator));
+                }
+                triplets.emplace_back(nModel + 2 * star, term, uniform(generator));
+                triplets.emplace_back(nModel + 2 * star + 1, term, uniform(generator));
+            }
+        }
+    }
+    SparseMatrixD jacobian(nModel + 2 * nStar, term);
+    jacobian.setFromTriplets(triplets.begin(), triplets.end());
+    return jacobian * jacobian.transpose();
+}
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(test_findStarBlocks) {
+    SparseMatrixD hessian = makeHessian(4, 6, 50);
+    std::vector<Eigen::Index> blockStarts;
+    BOOST_REQUIRE(BlockArrowheadSolver::findStarBlocks(hessian, 24, blockStarts));
+    BOOST_REQUIRE_EQUAL(blockStarts.size(), 51u);
+    for (std::size_t i = 0; i < blockStarts.size(); ++i) {
+        BOOST_CHECK_EQUAL(blockStarts[i], 24 + 2 * static_cast<Eigen::Index>(i));
+    }
+
+    // Coupling two stars merges their blocks, which must then fit in maxBlockSize.
+    hessian.coeffRef(24 + 5, 24 + 1) = 0.1;
+    hessian.coeffRef(24 + 1, 24 + 5) = 0.1;
+    BOOST_CHECK(!BlockArrowheadSolver::findStarBlocks(hessian, 24, blockStarts));
+    BOOST_REQUIRE(BlockArrowheadSolver::findStarBlocks(hessian, 24, blockStarts, 6));
+    BOOST_CHECK_EQUAL(blockStarts[0], 24);
+    BOOST_CHECK_EQUAL(blockStarts[1], 30);
+}
+
+BOOST_AUTO_TEST_CASE(test_solve) {
+    SparseMatrixD hessian = makeHessian(4, 6, 50);
+    std::vector<Eigen::Index> blockStarts;
+    BOOST_REQUIRE(BlockArrowheadSolver::findStarBlocks(hessian, 24, blockStarts));
+
+    BlockArrowheadSolver solver;
+    BOOST_REQUIRE(solver.compute(hessian, 24, blockStarts));
+    Eigen::VectorXd rhs = Eigen::VectorXd::LinSpaced(hessian.rows(), -1, 1);
+    Eigen::VectorXd expect = Eigen::MatrixXd(hessian).ldlt().solve(rhs);
+    BOOST_CHECK_SMALL((solver.solve(rhs) - expect).norm() / expect.norm(), 1e-10);
+
+    // Refactorizing with the same pattern reuses the symbolic analysis, and must give the same answer.
+    SparseMatrixD scaled = 2 * hessian;
+    BOOST_REQUIRE(solver.compute(scaled, 24, blockStarts));
+    BOOST_CHECK_SMALL((2 * solver.solve(rhs) - expect).norm() / expect.norm(), 1e-10);
+}
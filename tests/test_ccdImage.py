@@ -20,6 +20,7 @@
 # along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 """Test creation and use of the CcdImage class."""
+import tempfile
 import unittest
 
 import lsst.utils.tests
@@ -27,6 +28,7 @@ from lsst.jointcal import testUtils
 
 import lsst.geom
 import lsst.jointcal
+import lsst.pex.exceptions
 import lsst.obs.base
 
 
@@ -101,6 +103,106 @@ class CcdImageTestCase(lsst.utils.tests.TestCase):
     def testCcdImage2(self):
         self.checkCountStars(self.ccdImage2, self.nStars2)
 
+    def testReuseAssociation(self):
+        """A second association is restored from the first, with new but
+        identical fittedStars linked to the same measuredStars."""
+        def getAssociation():
+            result = []
+            for ccdImage in self.associations.getCcdImageList():
+                for measuredStar in ccdImage.getCatalogForFit():
+                    fittedStar = measuredStar.getFittedStar()
+                    result.append((measuredStar.x, measuredStar.y, fittedStar.x, fittedStar.y, fittedStar))
+            return result
+
+        matchCut = 3.0
+        self.associations.setReuseAssociation(True)
+        self.associations.computeCommonTangentPoint()
+        self.associations.associateCatalogs(matchCut)
+        first = getAssociation()
+        self.associations.associateCatalogs(matchCut)
+        second = getAssociation()
+
+        self.assertEqual(self.associations.fittedStarListSize(), self.nStars1 + self.nStars2)
+        self.assertEqual(len(first), len(second))
+        for expect, result in zip(first, second):
+            self.assertEqual(expect[:4], result[:4])
+            self.assertIsNot(expect[4], result[4])
+        phases = self.associations.getInstrumentation().getPhases()
+        self.assertNotIn("restored", phases[0].counters)
+        self.assertEqual(phases[1].counters["restored"], 1)
+        # The returned instrumentation is a copy: clearing it leaves ours alone.
+        self.associations.getInstrumentation().clear()
+        self.assertEqual(len(self.associations.getInstrumentation().getPhases()), len(phases))
+        self.associations.resetInstrumentation()
+        self.assertEqual(self.associations.getInstrumentation().getPhases(), [])
+
+    def testReuseAssociationAfterDeproject(self):
+        """An astrometry fit deprojects the fittedStars; the photometry fit
+        that reuses its association must still get them on the sky."""
+        matchCut = 3.0
+        self.associations.setReuseAssociation(True)
+        self.associations.computeCommonTangentPoint()
+        self.associations.associateCatalogs(matchCut)
+        expect = self.associations.getFittedStarArray()
+        self.associations.deprojectFittedStars()
+        self.assertFloatsAlmostEqual(self.associations.getFittedStarArray()[:, :2], expect[:, :2],
+                                     rtol=1e-14)
+
+        self.associations.associateCatalogs(matchCut)
+        self.assertFloatsAlmostEqual(self.associations.getFittedStarArray()[:, :2], expect[:, :2],
+                                     rtol=1e-14)
+
+    def testCreateFitView(self):
+        """Views restore the same association into stars of their own."""
+        matchCut = 3.0
+        with self.assertRaises(lsst.pex.exceptions.LogicError):
+            self.associations.createFitView()
+
+        self.associations.setReuseAssociation(True)
+        self.associations.computeCommonTangentPoint()
+        self.associations.associateCatalogs(matchCut)
+        view1 = self.associations.createFitView()
+        view2 = self.associations.createFitView()
+        view1.associateCatalogs(matchCut)
+        view2.associateCatalogs(matchCut)
+
+        self.assertEqual(view1.fittedStarListSize(), self.associations.fittedStarListSize())
+        self.assertEqual(view2.fittedStarListSize(), self.associations.fittedStarListSize())
+        for ccdImage, ccdImage1, ccdImage2 in zip(self.associations.getCcdImageList(),
+                                                  view1.getCcdImageList(), view2.getCcdImageList()):
+            self.assertEqual(ccdImage1.getName(), ccdImage.getName())
+            self.assertIsNot(ccdImage1, ccdImage)
+            for star, star1, star2 in zip(ccdImage.getCatalogForFit(), ccdImage1.getCatalogForFit(),
+                                          ccdImage2.getCatalogForFit()):
+                self.assertEqual((star1.x, star1.y), (star.x, star.y))
+                self.assertEqual((star2.x, star2.y), (star.x, star.y))
+                self.assertIsNot(star1, star2)
+                self.assertIsNot(star1.getFittedStar(), star2.getFittedStar())
+                # Each view's stars belong to the view's own CcdImages.
+                self.assertIs(star1.getCcdImage(), ccdImage1)
+                self.assertIs(star2.getCcdImage(), ccdImage2)
+
+
+    def testFitCatalogStorage(self):
+        """The whole catalogs move to the fit catalog storage at once, and
+        the catalogs to fit at the next association.
+        """
+        matchCut = 3.0
+        self.associations.computeCommonTangentPoint()
+        self.associations.associateCatalogs(matchCut)
+        heapSize = self.associations.getFitCatalogHeapSize()
+        self.assertGreater(heapSize, 0)
+        self.assertEqual(self.associations.getFitCatalogMappedSize(), 0)
+
+        with tempfile.TemporaryDirectory() as path:
+            self.associations.setFitCatalogStorage(path)
+            # Only the catalogs to fit are still on the heap.
+            self.assertGreater(self.associations.getFitCatalogHeapSize(), 0)
+            self.assertLess(self.associations.getFitCatalogHeapSize(), heapSize)
+            self.assertGreater(self.associations.getFitCatalogMappedSize(), 0)
+            self.associations.associateCatalogs(matchCut)
+            self.assertEqual(self.associations.getFitCatalogHeapSize(), 0)
+
 
 class MemoryTester(lsst.utils.tests.MemoryTestCase):
     pass
@@ -0,0 +1,100 @@
+# This file is part of jointcal.
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import unittest
+
+import numpy as np
+
+import lsst.pex.exceptions
+import lsst.utils.tests
+
+import lsst.jointcal.chi2Contributions
+import lsst.jointcal.columnTable
+
+
+class ColumnFileTestCase(lsst.utils.tests.TestCase):
+    """Test writing column files with ColumnTable and reading them back,
+    without running a fit."""
+    def setUp(self):
+        rng = np.random.default_rng(12345)
+        self.floats = rng.normal(0, 1e3, size=50)
+        self.floats[:3] = [np.inf, -0.0, 1e-300]
+        self.ints = rng.integers(-2**62, 2**62, size=50)
+
+    def testRoundTrip(self):
+        table = lsst.jointcal.columnTable.ColumnTable()
+        table.addFloatColumn("chi2", "a float column", self.floats)
+        table.addIntColumn("id", "an int column", self.ints)
+        with lsst.utils.tests.getTempFilePath(".bin") as filename:
+            table.write(filename)
+            result = lsst.jointcal.chi2Contributions.readColumnFile(filename)
+
+            # The file is little-endian whatever the host, and starts with the format version.
+            with open(filename, "rb") as infile:
+                self.assertEqual(infile.read(8), b"JCCOLS02")
+                self.assertEqual(infile.read(16), np.array([2, 50], dtype="<i8").tobytes())
+
+        self.assertEqual(result.colnames, ["chi2", "id"])
+        self.assertEqual(result["chi2"].description, "a float column")
+        self.assertEqual(result["id"].description, "an int column")
+        np.testing.assert_array_equal(result["chi2"], self.floats)
+        np.testing.assert_array_equal(result["id"], self.ints)
+        self.assertTrue(result["chi2"].dtype.isnative)
+        self.assertTrue(result["id"].dtype.isnative)
+
+    def testEmpty(self):
+        table = lsst.jointcal.columnTable.ColumnTable()
+        table.addFloatColumn("chi2", "", [])
+        with lsst.utils.tests.getTempFilePath(".bin") as filename:
+            table.write(filename)
+            result = lsst.jointcal.chi2Contributions.readColumnFile(filename)
+        self.assertEqual(len(result), 0)
+        self.assertEqual(result.colnames, ["chi2"])
+
+    def testMismatchedLengths(self):
+        table = lsst.jointcal.columnTable.ColumnTable()
+        table.addFloatColumn("chi2", "", self.floats)
+        table.addIntColumn("id", "", self.ints[:-1])
+        with lsst.utils.tests.getTempFilePath(".bin") as filename:
+            with self.assertRaises(lsst.pex.exceptions.LengthError):
+                table.write(filename)
+
+    def testWrongVersion(self):
+        """Files of another version (e.g. the native-order version 01) are
+        refused rather than misread."""
+        with lsst.utils.tests.getTempFilePath(".bin") as filename:
+            with open(filename, "wb") as outfile:
+                outfile.write(b"JCCOLS01" + np.array([0, 0], dtype=np.int64).tobytes())
+            with self.assertRaisesRegex(ValueError, "version 02"):
+                lsst.jointcal.chi2Contributions.readColumnFile(filename)
+
+
+class MemoryTester(lsst.utils.tests.MemoryTestCase):
+    pass
+
+
+def setup_module(module):
+    lsst.utils.tests.init()
+
+
+if __name__ == "__main__":
+    lsst.utils.tests.init()
+    unittest.main()
@@ -0,0 +1,86 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#define BOOST_TEST_MODULE test_eigenstuff
+
+// The boost unit test header
+#include "boost/test/unit_test.hpp"
+
+#include <random>
+#include <vector>
+
+#include "Eigen/Dense"
+
+#include "lsst/jointcal/Eigenstuff.h"
+
+namespace {
+/// A random sparse symmetric positive definite matrix shaped like a jointcal Hessian: J*J^T + epsilon*I.
+SparseMatrixD makeHessian(Eigen::Index nParams, Eigen::Index nTerms) {
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<double> uniform(-1, 1);
+    std::vector<Eigen::Triplet<double, Eigen::Index>> triplets;
+    for (Eigen::Index term = 0; term < nTerms; ++term) {
+        for (int k = 0; k < 3; ++k) {
+            triplets.emplace_back(generator() % nParams, term, uniform(generator));
+        }
+    }
+    SparseMatrixD jacobian(nParams, nTerms);
+    jacobian.setFromTriplets(triplets.begin(), triplets.end());
+    SparseMatrixD hessian = jacobian * jacobian.transpose();
+    for (Eigen::Index i = 0; i < nParams; ++i) hessian.coeffRef(i, i) += 0.1;
+    return hessian;
+}
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(test_selectedInverse) {
+    SparseMatrixD hessian = makeHessian(60, 200);
+    Eigen::MatrixXd expect = Eigen::MatrixXd(hessian).inverse();
+
+    CholmodSimplicialLDLT2<SparseMatrixD> chol(hessian);
+    BOOST_REQUIRE(chol.info() == Eigen::Success);
+    SparseMatrixD inverse = chol.selectedInverse();
+
+    // Every non-zero of the (lower triangle of the) matrix must have been computed.
+    for (Eigen::Index col = 0; col < hessian.outerSize(); ++col) {
+        for (SparseMatrixD::InnerIterator it(hessian, col); it; ++it) {
+            if (it.row() >= it.col()) {
+                BOOST_CHECK_NE(inverse.coeff(it.row(), it.col()), 0.0);
+            }
+        }
+    }
+    for (Eigen::Index col = 0; col < inverse.outerSize(); ++col) {
+        for (SparseMatrixD::InnerIterator it(inverse, col); it; ++it) {
+            BOOST_CHECK_GE(it.row(), it.col());
+            BOOST_CHECK_SMALL(it.value() - expect(it.row(), it.col()), 1e-12);
+        }
+    }
+
+    SparseMatrixD diagonal = chol.selectedInverse(true);
+    BOOST_CHECK_EQUAL(diagonal.nonZeros(), hessian.rows());
+    for (Eigen::Index i = 0; i < hessian.rows(); ++i) {
+        BOOST_CHECK_SMALL(diagonal.coeff(i, i) - expect(i, i), 1e-12);
+    }
+}
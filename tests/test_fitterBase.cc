@@ -0,0 +1,365 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Exercise minimize() and its outer loop FitterBase::iterate() on a small problem without any data: the
+ * fit of one value to reference terms, whose chi2 follows a script.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#define BOOST_TEST_MODULE test_fitterBase
+
+// The boost unit test header
+#include "boost/test/unit_test.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Eigen/Core"
+
+#include "lsst/log/Log.h"
+#include "lsst/pex/exceptions.h"
+
+#include "lsst/jointcal/Associations.h"
+#include "lsst/jointcal/Checkpoint.h"
+#include "lsst/jointcal/Chi2.h"
+#include "lsst/jointcal/FittedStar.h"
+#include "lsst/jointcal/FitterBase.h"
+#include "lsst/jointcal/RefStar.h"
+
+namespace jointcal = lsst::jointcal;
+using jointcal::MinimizeResult;
+
+namespace {
+
+/// The state of the fit after one solve.
+struct Solve {
+    double chi2;
+    bool outlier = false;   // One reference term stands out, to be rejected.
+    bool singular = false;  // The Hessian of the next solve can not be factorized.
+};
+
+int const nStars = 100;
+
+/**
+ * A fitter of one value to nStars reference terms, all with a zero reference value and unit error.
+ *
+ * The derivatives and the solves are genuine, but the chi2 of the terms follows a script, so that each
+ * minimize() step reaches the result under test; the last solve repeats.
+ */
+class ScriptedFitter : public jointcal::FitterBase {
+public:
+    explicit ScriptedFitter(std::vector<Solve> script)
+            : FitterBase(std::make_shared<jointcal::Associations>()), _script(std::move(script)) {
+        _log = LOG_GET("jointcal.test_fitterBase");
+        for (int i = 0; i < nStars; ++i) {
+            auto refStar = std::make_shared<jointcal::RefStar>(i, 0, 0, 1);
+            _associations->refStarList.push_back(refStar);
+            auto fittedStar = std::make_shared<jointcal::FittedStar>();
+            fittedStar->getMeasurementCount() = 1;
+            fittedStar->setRefStar(refStar.get());
+            _associations->fittedStarList.push_back(fittedStar);
+        }
+    }
+
+    bool modelValid = true;
+    int nMinimize = 0;
+    int nSolves = 0;
+    double value = 1;
+    mutable std::vector<std::string> chi2BaseNames;
+
+    void offsetParams(Eigen::VectorXd const &delta) override {
+        value -= delta(0);
+        ++nSolves;
+    }
+
+    // Called once by each minimize().
+    void assignIndices(std::string const &whatToFit) override {
+        ++nMinimize;
+        _nModelParams = 0;
+        _nStarParams = 1;
+        _nTotal = 1;
+        for (auto &fittedStar : _associations->fittedStarList) fittedStar->setIndexInMatrix(0);
+    }
+
+    void saveChi2Contributions(std::string const &baseName) const override {
+        chi2BaseNames.push_back(baseName);
+    }
+
+protected:
+    bool validateModel(int ndof) const override { return modelValid; }
+    void assignCovariance(SparseMatrixD const &covariance) override {}
+    // The number of steps so far, to tell which step a checkpoint was written after.
+    Eigen::VectorXd getModelParameters() const override { return Eigen::VectorXd::Constant(1, nMinimize); }
+    void saveChi2MeasContributions(std::string const &filename) const override {}
+    void saveChi2RefContributions(std::string const &filename) const override {}
+    void getIndicesOfMeasuredStar(jointcal::MeasuredStar const &measuredStar,
+                                  IndexVector &indices) const override {}
+    void getIndicesOfCcdImage(jointcal::CcdImage const &ccdImage,
+                              IndexVector &indices) const override {}
+    void accumulateStatImageList(jointcal::CcdImageList const &ccdImageList,
+                                 jointcal::Chi2Accumulator &accum) const override {}
+
+    // Share the scripted chi2 between the reference terms: unevenly (but adding up to it), so that none is
+    // an outlier unless the script says so, in which case the first one gets half of it.
+    void accumulateStatRefStars(jointcal::Chi2Accumulator &accum) const override {
+        Solve const &solve = getSolve(nSolves - 1);
+        std::vector<std::shared_ptr<jointcal::FittedStar>> terms;
+        for (auto const &fittedStar : _associations->fittedStarList) {
+            if (fittedStar->getRefStar() != nullptr) terms.push_back(fittedStar);
+        }
+        double rest = solve.outlier ? 0.5 * solve.chi2 : solve.chi2;
+        std::size_t nRest = solve.outlier ? terms.size() - 1 : terms.size();
+        for (std::size_t i = 0; i < terms.size(); ++i) {
+            if (solve.outlier && i == 0) {
+                accum.addEntry(0.5 * solve.chi2, 1, terms[i]);
+                continue;
+            }
+            std::size_t j = solve.outlier ? i - 1 : i;
+            double weight = (j % 2 == 1) ? 1.5 : (j + 1 == nRest) ? 1.0 : 0.5;
+            accum.addEntry(rest / nRest * weight, 1, terms[i]);
+        }
+    }
+
+    void leastSquareDerivativesMeasurement(
+            jointcal::CcdImage const &ccdImage, jointcal::TripletList &tripletList, Eigen::VectorXd &grad,
+            jointcal::MeasuredStarList const *measuredStarList) const override {}
+
+    void leastSquareDerivativesReference(jointcal::FittedStarList const &fittedStarList,
+                                         jointcal::TripletList &tripletList,
+                                         Eigen::VectorXd &grad) const override {
+        // An empty Jacobian makes a zero Hessian, which can not be factorized.
+        if (getSolve(nSolves).singular) return;
+        Eigen::Index kTriplets = tripletList.getNextFreeIndex();
+        for (auto const &fittedStar : fittedStarList) {
+            if (fittedStar->getRefStar() == nullptr) continue;
+            tripletList.addTriplet(0, kTriplets, 1.0);
+            grad(0) += value;
+            kTriplets += 1;
+        }
+        tripletList.setNextFreeIndex(kTriplets);
+    }
+
+private:
+    std::vector<Solve> _script;
+
+    Solve const &getSolve(int i) const {
+        return _script.at(std::min<std::size_t>(std::max(i, 0), _script.size() - 1));
+    }
+};
+
+int const maxSteps = 5;
+
+// The solves of a step that rejects an outlier and then ends with chi2 increased to the given value.
+std::vector<Solve> increasedTo(double chi2) { return {{0.9 * chi2, true}, {chi2}}; }
+
+std::vector<Solve> concat(std::vector<std::vector<Solve>> const &steps) {
+    std::vector<Solve> script;
+    for (auto const &step : steps) script.insert(script.end(), step.begin(), step.end());
+    return script;
+}
+
+std::string scratchDirectory() {
+    char const *tmpdir = std::getenv("TMPDIR");
+    return tmpdir == nullptr ? "/tmp" : tmpdir;
+}
+
+}  // namespace
+
+/// A single minimize() solves the problem and rejects the outliers.
+BOOST_AUTO_TEST_CASE(test_minimize) {
+    ScriptedFitter fitter({{150, true}, {100}});
+    BOOST_CHECK(fitter.minimize("Model", 5) == MinimizeResult::Converged);
+    BOOST_CHECK_EQUAL(fitter.nSolves, 2);
+    BOOST_CHECK_SMALL(fitter.value, 1e-12);
+    BOOST_CHECK_CLOSE(fitter.computeChi2().chi2, 100, 1e-8);
+    // The outlier is no longer a reference term.
+    BOOST_CHECK(fitter.computeChi2().ndof == nStars - 2);
+
+    ScriptedFitter noRejection(std::vector<Solve>{{150, true}});
+    BOOST_CHECK(noRejection.minimize("Model") == MinimizeResult::Converged);
+    BOOST_CHECK_EQUAL(noRejection.nSolves, 1);
+}
+
+/// A converged fit stops, after one more step in case the rank updates lost accuracy.
+BOOST_AUTO_TEST_CASE(test_converged) {
+    ScriptedFitter fitter(concat({increasedTo(150), {{100}}}));
+    auto result = fitter.iterate("Model", 5, maxSteps);
+    BOOST_CHECK(result.result == MinimizeResult::Converged);
+    BOOST_CHECK_CLOSE(result.chi2.chi2, 100, 1e-8);
+    BOOST_CHECK(result.modelValid);
+    BOOST_REQUIRE_EQUAL(result.iterations.size(), 3u);
+    BOOST_CHECK(result.iterations[0].result == MinimizeResult::Chi2Increased);
+    BOOST_CHECK_EQUAL(result.iterations[0].nRefOutliers, 1u);
+    BOOST_CHECK(result.iterations[1].result == MinimizeResult::Converged);
+    BOOST_CHECK(result.iterations[2].result == MinimizeResult::Converged);
+    BOOST_CHECK_EQUAL(fitter.nMinimize, 3);
+
+    ScriptedFitter noRankUpdate(std::vector<Solve>{{100}});
+    result = noRankUpdate.iterate("Model", 5, maxSteps, 0, false);
+    BOOST_CHECK_EQUAL(result.iterations.size(), 1u);
+}
+
+/// With refitOnlyIfInaccurate, the extra step after the rank updates is only done if a solve was inaccurate.
+BOOST_AUTO_TEST_CASE(test_refitOnlyIfInaccurate) {
+    ScriptedFitter accurate(concat({increasedTo(150), {{100}}}));
+    auto result = accurate.iterate("Model", 5, maxSteps, 0, true, false, "", "", 1e-8, "", 0, true);
+    BOOST_CHECK(result.result == MinimizeResult::Converged);
+    BOOST_CHECK_EQUAL(result.iterations.size(), 2u);
+    BOOST_CHECK_EQUAL(accurate.nMinimize, 2);
+
+    // No solve can be refined below a negative tolerance.
+    ScriptedFitter inaccurate(concat({increasedTo(150), {{100}}}));
+    result = inaccurate.iterate("Model", 5, maxSteps, 0, true, false, "", "", -1, "", 0, true);
+    BOOST_CHECK(result.result == MinimizeResult::Converged);
+    BOOST_CHECK_EQUAL(result.iterations.size(), 3u);
+    BOOST_CHECK_EQUAL(inaccurate.nMinimize, 3);
+
+    ScriptedFitter noRankUpdate(std::vector<Solve>{{100}});
+    result = noRankUpdate.iterate("Model", 5, maxSteps, 0, false, false, "", "", -1, "", 0, true);
+    BOOST_CHECK_EQUAL(result.iterations.size(), 1u);
+}
+
+/// A large final chi2/ndof is reported, but the fit still completes.
+BOOST_AUTO_TEST_CASE(test_badFinalChi2) {
+    ScriptedFitter fitter(std::vector<Solve>{{1000}});
+    auto result = fitter.iterate("Model", 5, maxSteps);
+    BOOST_CHECK(result.result == MinimizeResult::Converged);
+    BOOST_CHECK_CLOSE(result.chi2.chi2, 1000, 1e-8);
+    BOOST_CHECK(result.modelValid);
+}
+
+/// A fit that never converges stops after maxSteps, returning the last chi2.
+BOOST_AUTO_TEST_CASE(test_exceedMaxSteps) {
+    ScriptedFitter fitter(concat(std::vector<std::vector<Solve>>(maxSteps, increasedTo(120))));
+    auto result = fitter.iterate("Model", 5, maxSteps);
+    BOOST_CHECK(result.result == MinimizeResult::Chi2Increased);
+    BOOST_CHECK_CLOSE(result.chi2.chi2, 120, 1e-8);
+    BOOST_CHECK_EQUAL(fitter.nMinimize, maxSteps);
+    BOOST_REQUIRE_EQUAL(result.iterations.size(), static_cast<std::size_t>(maxSteps));
+    for (int i = 0; i < maxSteps; ++i) BOOST_CHECK_EQUAL(result.iterations[i].step, i);
+}
+
+/// DM-25159: warn, but don't fail, on moderate chi2 increases between steps.
+BOOST_AUTO_TEST_CASE(test_moderateChi2Increase) {
+    ScriptedFitter fitter(concat({increasedTo(100), increasedTo(300), {{100}}}));
+    auto result = fitter.iterate("Model", 5, maxSteps);
+    BOOST_CHECK(result.result == MinimizeResult::Converged);
+    BOOST_CHECK_EQUAL(result.iterations.size(), 4u);
+}
+
+/// DM-25159: fail on large chi2 increases between steps.
+BOOST_AUTO_TEST_CASE(test_largeChi2IncreaseFails) {
+    ScriptedFitter fitter(concat({increasedTo(1e11), increasedTo(1.123456e13)}));
+    BOOST_CHECK_THROW(fitter.iterate("Model", 5, maxSteps), lsst::pex::exceptions::RuntimeError);
+    BOOST_CHECK_EQUAL(fitter.nMinimize, 2);
+}
+
+/// Non-finite chi2s and failed factorizations stop the fit, for the caller to report.
+BOOST_AUTO_TEST_CASE(test_failures) {
+    ScriptedFitter nonFinite(concat({increasedTo(100), {{std::numeric_limits<double>::quiet_NaN()}}}));
+    auto result = nonFinite.iterate("Model", 5, maxSteps);
+    BOOST_CHECK(result.result == MinimizeResult::NonFinite);
+    BOOST_CHECK_EQUAL(result.iterations.size(), 2u);
+
+    ScriptedFitter failed(concat({increasedTo(100), {{100, false, true}}}));
+    result = failed.iterate("Model", 5, maxSteps);
+    BOOST_CHECK(result.result == MinimizeResult::Failed);
+    BOOST_CHECK_EQUAL(result.iterations.size(), 2u);
+}
+
+/// An invalid model stops the fit after the step that made it invalid.
+BOOST_AUTO_TEST_CASE(test_invalidModel) {
+    ScriptedFitter fitter(increasedTo(100));
+    fitter.modelValid = false;
+    auto result = fitter.iterate("Model", 5, maxSteps);
+    BOOST_CHECK(!result.modelValid);
+    BOOST_CHECK_EQUAL(fitter.nMinimize, 1);
+}
+
+/// The chi2 contributions of each step go to their own files, with or without "{iteration}".
+BOOST_AUTO_TEST_CASE(test_chi2BaseName) {
+    ScriptedFitter fitter(concat({increasedTo(100), {{90}}}));
+    fitter.iterate("Model", 5, maxSteps, 0, true, false, "", "out/iterate_{iteration}_chi2{type}");
+    std::vector<std::string> expect = {"out/iterate_0_chi2{type}", "out/iterate_1_chi2{type}",
+                                       "out/iterate_2_chi2{type}"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(fitter.chi2BaseNames.begin(), fitter.chi2BaseNames.end(),
+                                  expect.begin(), expect.end());
+
+    ScriptedFitter noIteration(concat({increasedTo(100), {{90}}}));
+    noIteration.iterate("Model", 5, maxSteps, 0, true, false, "", "out/chi2{type}");
+    expect = {"out/chi2-0{type}", "out/chi2-1{type}", "out/chi2-2{type}"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(noIteration.chi2BaseNames.begin(), noIteration.chi2BaseNames.end(),
+                                  expect.begin(), expect.end());
+}
+
+/// Checkpoints are only written after the steps that the fit goes on from.
+BOOST_AUTO_TEST_CASE(test_checkpoint) {
+    std::string const filename = scratchDirectory() + "/test_fitterBase_checkpoint.bin";
+    // The number of steps done when the checkpoint was written, or -1 if there is none.
+    auto checkpointStep = [&]() {
+        std::FILE *file = std::fopen(filename.c_str(), "r");
+        if (file == nullptr) return -1;
+        std::fclose(file);
+        return int(jointcal::Checkpoint(filename, {}).getModelParameters()[0]);
+    };
+    auto iterate = [&](ScriptedFitter &fitter, int interval) {
+        std::remove(filename.c_str());
+        fitter.iterate("Model", 5, maxSteps, 0, true, false, "", "", 1e-8, filename, interval);
+    };
+
+    // The last of the three steps is the one after convergence.
+    ScriptedFitter converged(concat({increasedTo(100), {{90}}}));
+    iterate(converged, 1);
+    BOOST_CHECK_EQUAL(checkpointStep(), 3);
+
+    ScriptedFitter everyOther(concat({increasedTo(100), {{90}}}));
+    iterate(everyOther, 2);
+    BOOST_CHECK_EQUAL(checkpointStep(), 2);
+    iterate(everyOther, 3);
+    BOOST_CHECK_EQUAL(checkpointStep(), -1);
+
+    for (Solve failure : {Solve{std::numeric_limits<double>::quiet_NaN()}, Solve{100, false, true}}) {
+        ScriptedFitter failed(concat({increasedTo(100), {failure}}));
+        iterate(failed, 1);
+        BOOST_CHECK_EQUAL(checkpointStep(), 1);
+    }
+
+    ScriptedFitter invalid(increasedTo(100));
+    invalid.modelValid = false;
+    iterate(invalid, 1);
+    BOOST_CHECK_EQUAL(checkpointStep(), -1);
+
+    ScriptedFitter diverged(concat({increasedTo(1e11), increasedTo(1.123456e13)}));
+    BOOST_CHECK_THROW(iterate(diverged, 1), lsst::pex::exceptions::RuntimeError);
+    BOOST_CHECK_EQUAL(checkpointStep(), 1);
+    std::remove(filename.c_str());
+}
@@ -19,14 +19,17 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+import concurrent.futures
 import itertools
 import os.path
+import tempfile
 import unittest
 from unittest import mock
 
 import numpy as np
 import pyarrow.parquet
 import astropy.time
+import astropy.units as u
 
 import lsst.log
 import lsst.utils
@@ -172,103 +175,117 @@ class TestJointcalIterateFit(JointcalTestBase, lsst.utils.tests.TestCase):
         # return values/exceptions. Default to "good" return values.
         self.fitter = mock.Mock(spec=lsst.jointcal.PhotometryFit)
         self.fitter.computeChi2.return_value = self.goodChi2
-        self.fitter.minimize.return_value = MinimizeResult.Converged
+        self.fitter.iterate.return_value = self._makeIterateResult(MinimizeResult.Converged, self.goodChi2)
         self.model = mock.Mock(spec=lsst.jointcal.SimpleFluxModel)
 
         self.jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
 
+    def _makeIterateResult(self, result, chi2, modelValid=True):
+        """Return a stand-in for the `lsst.jointcal.IterateResult` returned
+        by ``FitterBase.iterate``.
+        """
+        return mock.Mock(spec=lsst.jointcal.IterateResult, result=result, chi2=chi2,
+                         modelValid=modelValid, iterations=[])
+
     def test_iterateFit_success(self):
         chi2 = self.jointcal._iterate_fit(self.associations, self.fitter,
                                           self.maxSteps, self.name, self.whatToFit)
         self.assertEqual(chi2, self.goodChi2)
-        # Once for the for loop, the second time for the rank update.
-        self.assertEqual(self.fitter.minimize.call_count, 2)
+        # The whole outer loop is a single call into C++; by default, it always minimizes once more after
+        # convergence, as before the solves were refined.
+        self.fitter.iterate.assert_called_once_with(self.whatToFit,
+                                                    self.config.outlierRejectSigma,
+                                                    self.maxSteps,
+                                                    sigmaRelativeTolerance=0,
+                                                    doRankUpdate=True,
+                                                    doLineSearch=False,
+                                                    dumpMatrixFile="",
+                                                    chi2BaseName="",
+                                                    refinementTolerance=1e-8,
+                                                    checkpointFile="",
+                                                    checkpointInterval=0,
+                                                    refitOnlyIfInaccurate=False)
+        self.fitter.minimize.assert_not_called()
+
+        self.config.refinementTolerance = 1e-6
+        self.config.refitOnlyIfInaccurate = True
+        jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
+        jointcal._iterate_fit(self.associations, self.fitter, self.maxSteps, self.name, self.whatToFit)
+        self.assertEqual(self.fitter.iterate.call_args.kwargs["refinementTolerance"], 1e-6)
+        self.assertTrue(self.fitter.iterate.call_args.kwargs["refitOnlyIfInaccurate"])
 
     def test_iterateFit_writeChi2Outer(self):
         chi2 = self.jointcal._iterate_fit(self.associations, self.fitter,
                                           self.maxSteps, self.name, self.whatToFit,
                                           dataName=self.dataName)
         self.assertEqual(chi2, self.goodChi2)
-        # Once for the for loop, the second time for the rank update.
-        self.assertEqual(self.fitter.minimize.call_count, 2)
-        # Default config should not call saveChi2Contributions
+        # Default config should not write chi2 contributions
+        self.assertEqual(self.fitter.iterate.call_args.kwargs["chi2BaseName"], "")
         self.fitter.saveChi2Contributions.assert_not_called()
 
+        self.config.writeChi2FilesOuterLoop = True
+        jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
+        jointcal._iterate_fit(self.associations, self.fitter,
+                              self.maxSteps, self.name, self.whatToFit,
+                              dataName=self.dataName)
+        # config.debugOutputPath is prepended, and iterate fills in the step number.
+        self.assertEqual(self.fitter.iterate.call_args.kwargs["chi2BaseName"],
+                         "./testing_iterate_{iteration}_chi2-fake{type}")
+
     def test_iterateFit_failed(self):
-        self.fitter.minimize.return_value = MinimizeResult.Failed
+        self.fitter.iterate.return_value = self._makeIterateResult(MinimizeResult.Failed, self.goodChi2)
 
         with self.assertRaises(RuntimeError):
             self.jointcal._iterate_fit(self.associations, self.fitter,
                                        self.maxSteps, self.name, self.whatToFit)
-        self.assertEqual(self.fitter.minimize.call_count, 1)
+        self.assertEqual(self.fitter.iterate.call_count, 1)
 
-    def test_iterateFit_badFinalChi2(self):
-        log = mock.Mock(spec=lsst.log.Log)
-        self.jointcal.log = log
-        self.fitter.computeChi2.return_value = self.badChi2
+    def test_iterateFit_nonfinite(self):
+        self.fitter.iterate.return_value = self._makeIterateResult(MinimizeResult.NonFinite, self.nanChi2)
 
-        chi2 = self.jointcal._iterate_fit(self.associations, self.fitter,
-                                          self.maxSteps, self.name, self.whatToFit)
-        self.assertEqual(chi2, self.badChi2)
-        log.info.assert_called_with("%s %s", "Fit completed", self.badChi2)
-        log.error.assert_called_with("Potentially bad fit: High chi-squared/ndof.")
+        with self.assertRaises(FloatingPointError):
+            self.jointcal._iterate_fit(self.associations, self.fitter,
+                                       self.maxSteps, self.name, self.whatToFit,
+                                       dataName=self.dataName)
+        self.fitter.saveChi2Contributions.assert_called_once_with(
+            "./testing_failure-nonfinite_chi2-fake{type}")
 
-    def test_iterateFit_exceedMaxSteps(self):
-        log = mock.Mock(spec=lsst.log.Log)
-        self.jointcal.log = log
-        self.fitter.minimize.return_value = MinimizeResult.Chi2Increased
-        maxSteps = 3
+    def test_iterateFit_invalidModel(self):
+        self.fitter.iterate.return_value = self._makeIterateResult(MinimizeResult.Converged,
+                                                                   self.goodChi2,
+                                                                   modelValid=False)
 
+        with self.assertRaises(ValueError):
+            self.jointcal._iterate_fit(self.associations, self.fitter,
+                                       self.maxSteps, self.name, self.whatToFit)
+
+    def test_iterateFit_exceedMaxSteps(self):
+        """Running out of steps is logged in C++; the last chi2 is returned."""
+        self.fitter.iterate.return_value = self._makeIterateResult(MinimizeResult.Chi2Increased,
+                                                                   self.badChi2)
         chi2 = self.jointcal._iterate_fit(self.associations, self.fitter,
-                                          maxSteps, self.name, self.whatToFit)
-        self.assertEqual(chi2, self.goodChi2)
-        self.assertEqual(self.fitter.minimize.call_count, maxSteps)
-        log.error.assert_called_with("testing failed to converge after %s steps" % maxSteps)
+                                          3, self.name, self.whatToFit)
+        self.assertEqual(chi2, self.badChi2)
 
-    def test_moderate_chi2_increase(self):
-        """DM-25159: warn, but don't fail, on moderate chi2 increases between
-        steps.
+    def test_large_chi2_increase_fails(self):
+        """DM-25159: fail on large chi2 increases between steps (raised by
+        ``FitterBase.iterate``).
         """
-        chi2_1 = lsst.jointcal.chi2.Chi2Statistic()
-        chi2_1.chi2 = 100.0
-        chi2_1.ndof = 100
-        chi2_2 = lsst.jointcal.chi2.Chi2Statistic()
-        chi2_2.chi2 = 300.0
-        chi2_2.ndof = 100
-
-        chi2s = [self.goodChi2, chi2_1, chi2_2, self.goodChi2, self.goodChi2]
-        self.fitter.computeChi2.side_effect = chi2s
-        self.fitter.minimize.side_effect = [MinimizeResult.Chi2Increased,
-                                            MinimizeResult.Chi2Increased,
-                                            MinimizeResult.Chi2Increased,
-                                            MinimizeResult.Converged,
-                                            MinimizeResult.Converged]
-        with lsst.log.UsePythonLogging():  # so that assertLogs works with lsst.log
-            with self.assertLogs("jointcal", level="WARN") as logger:
-                self.jointcal._iterate_fit(self.associations, self.fitter,
-                                           self.maxSteps, self.name, self.whatToFit)
-            msg = "WARNING:jointcal:Significant chi2 increase by a factor of 300 / 100 = 3"
-            self.assertIn(msg, logger.output)
+        self.fitter.iterate.side_effect = RuntimeError("Large chi2 increase between steps")
+        with(self.assertRaisesRegex(RuntimeError, "Large chi2 increase")):
+            self.jointcal._iterate_fit(self.associations, self.fitter,
+                                       self.maxSteps, self.name, self.whatToFit)
 
-    def test_large_chi2_increase_fails(self):
-        """DM-25159: fail on large chi2 increases between steps."""
-        chi2_1 = lsst.jointcal.chi2.Chi2Statistic()
-        chi2_1.chi2 = 1e11
-        chi2_1.ndof = 100
-        chi2_2 = lsst.jointcal.chi2.Chi2Statistic()
-        chi2_2.chi2 = 1.123456e13  # to check floating point formatting
-        chi2_2.ndof = 100
-
-        chi2s = [chi2_1, chi2_1, chi2_2]
-        self.fitter.computeChi2.side_effect = chi2s
-        self.fitter.minimize.return_value = MinimizeResult.Chi2Increased
-        with lsst.log.UsePythonLogging():  # so that assertLogs works with lsst.log
-            with self.assertLogs("jointcal", level="WARN") as logger:
-                with(self.assertRaisesRegex(RuntimeError, "Large chi2 increase")):
-                    self.jointcal._iterate_fit(self.associations, self.fitter,
-                                               self.maxSteps, self.name, self.whatToFit)
-            msg = "WARNING:jointcal:Significant chi2 increase by a factor of 1.123e+13 / 1e+11 = 112.3"
-            self.assertIn(msg, logger.output)
+    def test_computeCovariance(self):
+        """The covariance is only computed when configured."""
+        self.jointcal._compute_covariance(self.fitter, self.whatToFit)
+        self.fitter.computeCovariance.assert_not_called()
+
+        for mode, diagonalOnly in (("full", False), ("diagonal", True)):
+            self.config.covarianceMode = mode
+            jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
+            jointcal._compute_covariance(self.fitter, self.whatToFit)
+            self.fitter.computeCovariance.assert_called_with(self.whatToFit, diagonalOnly=diagonalOnly)
 
     def test_invalid_model(self):
         self.model.validate.return_value = False
@@ -359,6 +376,8 @@ class TestJointcalFitModel(JointcalTestBase, lsst.utils.tests.TestCase):
         with mock.patch("lsst.jointcal.PhotometryFit", autospect=True) as fitPatch:
             fitPatch.return_value.computeChi2.return_value = self.goodChi2
             fitPatch.return_value.minimize.return_value = MinimizeResult.Converged
+            fitPatch.return_value.iterate.return_value.result = MinimizeResult.Converged
+            fitPatch.return_value.iterate.return_value.chi2 = self.goodChi2
 
             # config.debugOutputPath is prepended to the filenames that go into saveChi2Contributions
             expected = ["./photometry_init-ModelVisit_chi2", "./photometry_init-Model_chi2",
@@ -381,6 +400,8 @@ class TestJointcalFitModel(JointcalTestBase, lsst.utils.tests.TestCase):
         with fitPatch as fit, projectorPatch as projector:
             fit.return_value.computeChi2.return_value = self.goodChi2
             fit.return_value.minimize.return_value = MinimizeResult.Converged
+            fit.return_value.iterate.return_value.result = MinimizeResult.Converged
+            fit.return_value.iterate.return_value.chi2 = self.goodChi2
             # return a real ProjectionHandler to keep ConstrainedAstrometryModel() happy
             projector.return_value = lsst.jointcal.IdentityProjectionHandler()
 
@@ -392,6 +413,203 @@ class TestJointcalFitModel(JointcalTestBase, lsst.utils.tests.TestCase):
             fit.return_value.saveChi2Contributions.assert_has_calls(expected)
 
 
+class TestJointcalHotStart(JointcalTestBase, lsst.utils.tests.TestCase):
+    def setUp(self):
+        super().setUp()
+        self.solution = {(849375, -1): np.array([1.0, 2.0]), (-1, 12): np.array([3.0]),
+                         (850587, 13): np.array([])}
+        self.fitted = mock.Mock(spec=lsst.jointcal.PhotometryModel)
+        self.fitted.getMappingParameters.return_value = self.solution
+        self.model = mock.Mock(spec=lsst.jointcal.PhotometryModel)
+        self.model.getMappingParameters.return_value = self.solution
+        self.model.setMappingParameters.return_value = len(self.solution)
+        self.stars = np.arange(18.0).reshape(2, 9)
+        self.associations.getFittedStarArray.return_value = self.stars
+        self.tangentPoint = lsst.jointcal.Point(150.0, 2.0)
+        self.associations.getCommonTangentPoint.return_value = self.tangentPoint
+
+    def test_hot_start(self):
+        """The next run starts from the solution written at the end of a fit."""
+        with lsst.utils.tests.getTempFilePath(".npz") as filename:
+            self.config.solutionPath = os.path.dirname(filename)
+            self.config.hotStart = True
+            jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
+            jointcal._write_solution(self.fitted, self.associations, "photometry", filename)
+            self.assertTrue(jointcal._hot_start(self.model, "photometry", filename))
+            np.testing.assert_array_equal(jointcal._read_solution("photometry", filename).stars, self.stars)
+        started = self.model.setMappingParameters.call_args.args[0]
+        self.assertEqual(started.keys(), self.solution.keys())
+        for key, parameters in self.solution.items():
+            np.testing.assert_array_equal(started[key], parameters)
+
+    def test_hot_start_other_model(self):
+        """A solution fit with another model is not used."""
+        with lsst.utils.tests.getTempFilePath(".npz") as filename:
+            self.config.solutionPath = os.path.dirname(filename)
+            self.config.hotStart = True
+            jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
+            jointcal._write_solution(self.fitted, self.associations, "photometry", filename)
+            self.config.photometryModel = "simpleMagnitude"
+            jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
+            self.assertFalse(jointcal._hot_start(self.model, "photometry", filename))
+        self.model.setMappingParameters.assert_not_called()
+
+    def test_hot_start_tangent_point(self):
+        """An astrometry solution is only used with the common tangent point
+        it was fit with, which it records.
+        """
+        self.fitted = mock.Mock(spec=lsst.jointcal.AstrometryModel)
+        self.fitted.getMappingParameters.return_value = self.solution
+        self.model = mock.Mock(spec=lsst.jointcal.AstrometryModel)
+        self.model.getMappingParameters.return_value = self.solution
+        self.model.setMappingParameters.return_value = len(self.solution)
+        with lsst.utils.tests.getTempFilePath(".npz") as filename:
+            self.config.solutionPath = os.path.dirname(filename)
+            self.config.hotStart = True
+            jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
+            jointcal._write_solution(self.fitted, self.associations, "astrometry", filename)
+            np.testing.assert_array_equal(jointcal._read_solution("astrometry", filename).tangentPoint,
+                                          [150.0, 2.0])
+            self.assertFalse(jointcal._hot_start(self.model, "astrometry", filename,
+                                                 tangentPoint=lsst.jointcal.Point(150.0, 2.5)))
+            self.model.setMappingParameters.assert_not_called()
+            self.assertTrue(jointcal._hot_start(self.model, "astrometry", filename,
+                                                tangentPoint=self.tangentPoint))
+
+    def test_incremental_update(self):
+        """Only the transforms of new visits are fit in an incremental
+        update, and all of them if there are none.
+        """
+        with lsst.utils.tests.getTempFilePath(".npz") as filename:
+            self.config.solutionPath = os.path.dirname(filename)
+            self.config.hotStart = True
+            self.config.incrementalUpdate = True
+            jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
+            jointcal._write_solution(self.fitted, self.associations, "photometry", filename)
+            self.assertTrue(jointcal._hot_start(self.model, "photometry", filename))
+            self.model.fixMappings.assert_not_called()
+
+            # A new visit, and a chip whose transform changed size, are not fixed.
+            self.model.getMappingParameters.return_value = {**self.solution,
+                                                            (-1, 12): np.array([3.0, 4.0]),
+                                                            (903334, -1): np.array([5.0])}
+            self.model.setMappingParameters.return_value = len(self.solution) - 1
+            self.assertFalse(jointcal._hot_start(self.model, "photometry", filename))
+        fixed = self.model.fixMappings.call_args.args[0]
+        self.assertEqual(sorted(fixed), [(849375, -1), (850587, 13)])
+
+    def test_incremental_update_visits(self):
+        """An incremental update only loads the visits that are not in the
+        previous solution, and writes the stars and the transforms of the
+        visits it left out back with those of the new ones.
+        """
+        self.config.doAstrometry = False
+        with tempfile.TemporaryDirectory() as path:
+            self.config.solutionPath = path
+            self.config.hotStart = True
+            self.config.incrementalUpdate = True
+            jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
+            self.assertEqual(jointcal._find_previous_visits([849375, 850587], "0"), set())
+            filename = jointcal._getSolutionFile("photometry", "0")
+            jointcal._write_solution(self.fitted, self.associations, "photometry", filename)
+            previous = jointcal._read_solution("photometry", filename)
+            self.assertEqual(previous.visits, {849375, 850587})
+            self.assertFalse(jointcal._is_incremental(previous, self.associations))
+
+            # All the visits are fit again if none of them is new.
+            self.assertEqual(jointcal._find_previous_visits([849375, 850587], "0"), set())
+            self.assertEqual(jointcal._find_previous_visits([849375, 850587, 903334], "0"),
+                             {849375, 850587})
+
+            self.associations.getCcdImageList.return_value = [mock.Mock(visit=903334)]
+            self.assertTrue(jointcal._is_incremental(previous, self.associations))
+            stars = np.vstack([self.stars, np.full((1, 9), 7.0)])
+            self.associations.getFittedStarArray.return_value = stars
+            solution = {(-1, 12): np.array([3.5]), (903334, -1): np.array([5.0, 6.0])}
+            self.fitted.getMappingParameters.return_value = solution
+            jointcal._write_solution(self.fitted, self.associations, "photometry", filename)
+            result = jointcal._read_solution("photometry", filename)
+
+        self.assertEqual(result.visits, {849375, 850587, 903334})
+        np.testing.assert_array_equal(result.stars, stars)
+        expect = {**self.solution, **solution}
+        self.assertEqual(result.parameters.keys(), expect.keys())
+        for key, parameters in expect.items():
+            np.testing.assert_array_equal(result.parameters[key], parameters)
+
+    def test_no_hot_start(self):
+        """Without hotStart, or without a solution, the models are
+        initialized as usual.
+        """
+        jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
+        self.assertEqual(jointcal._getSolutionFile("photometry", "0"), "")
+        self.assertFalse(jointcal._hot_start(self.model, "photometry", ""))
+        self.config.solutionPath = "/nonexistent"
+        self.config.hotStart = True
+        jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
+        filename = jointcal._getSolutionFile("photometry", "0")
+        self.assertEqual(filename, "/nonexistent/jointcal_photometry_solution-0.npz")
+        self.assertFalse(jointcal._hot_start(self.model, "photometry", filename))
+        self.model.setMappingParameters.assert_not_called()
+
+
+class TestJointcalDeferRecords(JointcalTestBase, lsst.utils.tests.TestCase):
+    def test_defer_records(self):
+        """The measurements of fits run in worker threads are only recorded
+        by the calling thread, in the order it applies them.
+        """
+        jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
+        recorded = []
+
+        def fit(name):
+            jointcal._record(recorded.append, name)
+            return name.upper()
+
+        with concurrent.futures.ThreadPoolExecutor(max_workers=2) as executor:
+            futures = [executor.submit(jointcal._defer_records, fit, name)
+                       for name in ("astrometry", "photometry")]
+            deferred = [future.result() for future in futures]
+        self.assertEqual(recorded, [])
+        self.assertEqual([result for result, _ in deferred], ["ASTROMETRY", "PHOTOMETRY"])
+        for _, records in deferred:
+            jointcal._apply_records(records)
+        self.assertEqual(recorded, ["astrometry", "photometry"])
+
+        # Outside of a worker, records are made immediately.
+        jointcal._record(recorded.append, "shared")
+        self.assertEqual(recorded, ["astrometry", "photometry", "shared"])
+
+
+    def test_record_instrumentation(self):
+        """Each fit's timed phases become job measurements, added by the
+        calling thread.
+        """
+        jointcal = lsst.jointcal.JointcalTask(config=self.config, butler=self.butler)
+        phase = mock.Mock(wallTime=2.0, cpuTime=1.5, peakMemoryIncrease=1024, nThreads=4,
+                          counters={"triplets": 100})
+        phase.name = "minimize Distortions"
+        source = mock.Mock(spec=lsst.jointcal.AstrometryFit)
+        source.getInstrumentation.return_value.getPhases.return_value = [phase]
+
+        with concurrent.futures.ThreadPoolExecutor(max_workers=1) as executor:
+            _, records = executor.submit(jointcal._defer_records, jointcal._record_instrumentation,
+                                         "astrometry", "fit", source).result()
+        source.resetInstrumentation.assert_called_once()
+        with self.assertRaises(KeyError):
+            jointcal.job.measurements["jointcal.astrometry_fit_0_wallTime"]
+        jointcal._apply_records(records)
+
+        measurements = jointcal.job.measurements
+        self.assertEqual(measurements["jointcal.astrometry_fit_0_wallTime"].quantity, 2.0*u.s)
+        self.assertEqual(measurements["jointcal.astrometry_fit_0_cpuTime"].quantity, 1.5*u.s)
+        self.assertEqual(measurements["jointcal.astrometry_fit_0_peakMemoryIncrease"].quantity,
+                         1024*u.byte)
+        self.assertEqual(measurements["jointcal.astrometry_fit_0_nThreads"].quantity, 4)
+        self.assertEqual(measurements["jointcal.astrometry_fit_0_triplets"].quantity, 100)
+        self.assertIn("minimize Distortions",
+                      jointcal.job.metrics["jointcal.astrometry_fit_0_wallTime"].description)
+
+
 class TestComputeBoundingCircle(lsst.utils.tests.TestCase):
     """Tests of Associations.computeBoundingCircle()"""
     def _checkPointsInCircle(self, points, center, radius):
@@ -23,12 +23,14 @@ import unittest
 import os
 import tempfile
 
+import numpy as np
 from astropy import units as u
 
 import lsst.geom
 import lsst.utils
 import lsst.pex.exceptions
 import lsst.pex.config
+import lsst.jointcal.chi2Contributions
 
 import jointcalTestBase
 
@@ -107,14 +109,21 @@ class JointcalTestCFHT(jointcalTestBase.JointcalTestBase, lsst.utils.tests.TestC
 
             self._testJointcalTask(2, dist_rms_relative, self.dist_rms_absolute, pa1, metrics=metrics)
 
-            # Check for the existence of the chi2 contribution files.
+            # Check for the existence of the chi2 contribution files, and that they can be read back.
             expected = ['photometry_initial_chi2-0_r.MP9601', 'astrometry_initial_chi2-0_r.MP9601',
                         'photometry_final_chi2-0_r.MP9601', 'astrometry_final_chi2-0_r.MP9601']
             for partial in expected:
-                name = os.path.join(tempdir, partial+'-ref.csv')
+                name = os.path.join(tempdir, partial+'-ref.bin')
                 self.assertTrue(os.path.exists(name), msg="Did not find file %s"%name)
-                name = os.path.join(tempdir, partial+'-meas.csv')
+                name = os.path.join(tempdir, partial+'-meas.bin')
                 self.assertTrue(os.path.exists(name), msg='Did not find file %s'%name)
+                meas, ref = lsst.jointcal.chi2Contributions.readChi2Contributions(
+                    os.path.join(tempdir, partial))
+                self.assertGreater(len(meas), 0)
+                self.assertGreater(len(ref), 0)
+                self.assertTrue(np.all(meas['chi2'] >= 0))
+                self.assertTrue(np.all(ref['chi2'] >= 0))
+                self.assertEqual(set(meas['visit']), {849375, 850587})
 
             expected = ["initial_astrometry_model-0_r.MP9601.txt", "initial_photometry_model-0_r.MP9601.txt"]
             for name in expected:
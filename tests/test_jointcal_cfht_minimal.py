@@ -30,6 +30,7 @@ import lsst.pex.exceptions
 import jointcalTestBase
 from lsst.jointcal import jointcal
 import lsst.jointcal.testUtils
+import lsst.jointcal.hessianDump
 
 
 # for MemoryTestCase
@@ -91,15 +92,18 @@ class JointcalTestCFHTMinimal(jointcalTestBase.JointcalTestBase, lsst.utils.test
         # full calulation of PA1: the above chi2 is exact.
         self._runJointcalTask(2, metrics=metrics)
 
-        # Check that the Hessian/gradient files were written.
-        self.assertTrue(os.path.exists("photometry_preinit-0_r.MP9601-mat.txt"))
-        os.remove("photometry_preinit-0_r.MP9601-mat.txt")
-        self.assertTrue(os.path.exists("photometry_preinit-0_r.MP9601-grad.txt"))
-        os.remove("photometry_preinit-0_r.MP9601-grad.txt")
-        self.assertTrue(os.path.exists("photometry_postinit-0_r.MP9601-mat.txt"))
-        os.remove("photometry_postinit-0_r.MP9601-mat.txt")
-        self.assertTrue(os.path.exists("photometry_postinit-0_r.MP9601-grad.txt"))
-        os.remove("photometry_postinit-0_r.MP9601-grad.txt")
+        # Check that the Hessian/gradient files were written and can be read back.
+        for name in ("photometry_preinit-0_r.MP9601", "photometry_postinit-0_r.MP9601"):
+            hessian, grad, index = lsst.jointcal.hessianDump.readHessianDump(name)
+            self.assertEqual(hessian.shape, (len(grad), len(grad)))
+            self.assertEqual(abs(hessian - hessian.T).max(), 0)
+            self.assertTrue(set(index["index"]) <= set(range(len(grad))))
+            # The dump is little-endian on any machine.
+            with open(name + "-hessian.bin", "rb") as infile:
+                header = infile.read(16)
+            self.assertEqual(int.from_bytes(header[8:], "little"), len(grad))
+            os.remove(name + "-hessian.bin")
+            os.remove(name + "-index.csv")
 
         # Check that the config was persisted, we can read it, and it matches the settings above
         self.assertTrue(os.path.exists(os.path.join(self.output_dir, 'config/jointcal.py')))
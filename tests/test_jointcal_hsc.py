@@ -21,6 +21,7 @@
 
 import unittest
 import os
+import tempfile
 
 from astropy import units as u
 import numpy as np
@@ -129,6 +130,33 @@ class JointcalTestHSC(jointcalTestBase.JointcalTestBase, lsst.utils.tests.TestCa
         check_output(34648, [51, 59, 67])
         check_output(34690, [48, 56, 64])
 
+    def test_jointcalTask_2_visits_incremental_update_gen3(self):
+        """An incremental update under gen3 still writes non-empty output for
+        the visits of the previous solution.
+        """
+        queryString = "instrument='HSC' and tract=9697 and skymap='hsc_rings_v1' and band='r'"
+        with tempfile.TemporaryDirectory() as solutionPath:
+            configOptions = ["astrometryModel=simple", "photometryModel=simpleFlux",
+                             f"solutionPath={solutionPath}", "hotStart=True", "incrementalUpdate=True"]
+            self._runGen3Jointcal("lsst.obs.subaru.HyperSuprimeCam", "HSC",
+                                  queryString + f" and visit in ({self.all_visits[0]})",
+                                  configOptions=configOptions)
+            pipelineFile = os.path.join(self.path, "config/jointcalPipeline-HSC.yaml")
+            configFiles = [os.path.join(self.path, "config/config-gen3.py")] + self.configfiles
+            self._runPipeline(self.repo, pipelineFile,
+                              outputCollection="HSC/testdata/jointcal-incremental",
+                              inputCollections="refcats/gen2,HSC/testdata,HSC/calib/unbounded",
+                              queryString=queryString + f" and visit in ({self.all_visits[0]},"
+                                                        f"{self.all_visits[1]})",
+                              configFiles=configFiles,
+                              configOptions=configOptions)
+        butler = Butler(self.repo, collections=['HSC/testdata/jointcal-incremental'])
+
+        for visit, detectors in ((34648, [51, 59, 67]), (34690, [48, 56, 64])):
+            dataId = {'visit': visit, 'instrument': 'HSC', 'tract': 9697}
+            np.testing.assert_array_equal(butler.get('jointcalPhotoCalibCatalog', dataId)['id'], detectors)
+            np.testing.assert_array_equal(butler.get('jointcalSkyWcsCatalog', dataId)['id'], detectors)
+
     def test_jointcalTask_10_visits_simple_astrometry_no_photometry(self):
         """Test all 10 visits with different filters.
         Testing photometry doesn't make sense for this currently.
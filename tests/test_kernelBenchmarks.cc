@@ -0,0 +1,306 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Micro-benchmarks of the inner kernels of jointcal: each test case times one kernel over a fixed set of
+ * points (all random inputs use fixed seeds) and reports the time per point, for a range of polynomial
+ * orders or list sizes. The checks only guard against the kernels returning garbage; the timings are meant
+ * to be compared before and after changes to the kernels.
+ *
+ * The benchmarks take minutes, so they are skipped unless JOINTCAL_RUN_BENCHMARKS is set to a value other
+ * than 0 or an empty string.
+ *
+ * Environment variables:
+ *   JOINTCAL_RUN_BENCHMARKS: run the benchmarks (default: skip them).
+ *   JOINTCAL_BENCHMARK_REPEATS: number of timed passes over the points, of which the fastest is reported
+ *                               (default 3).
+ *   JOINTCAL_BENCHMARK_OUTPUT: if set, append one JSON line per measurement to this file.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#define BOOST_TEST_MODULE test_kernelBenchmarks
+
+// The boost unit test header
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Eigen/Core"
+
+#include "lsst/geom/Box.h"
+#include "lsst/jointcal/AstrometryTransform.h"
+#include "lsst/jointcal/BaseStar.h"
+#include "lsst/jointcal/ChipVisitAstrometryMapping.h"
+#include "lsst/jointcal/FastFinder.h"
+#include "lsst/jointcal/FatPoint.h"
+#include "lsst/jointcal/ListMatch.h"
+#include "lsst/jointcal/PhotometryTransform.h"
+#include "lsst/jointcal/SimpleAstrometryMapping.h"
+#include "lsst/jointcal/StarMatch.h"
+
+namespace jointcal = lsst::jointcal;
+
+namespace {
+
+/// Precondition of the benchmark suite: only run if JOINTCAL_RUN_BENCHMARKS is set.
+boost::test_tools::assertion_result benchmarksEnabled(boost::unit_test::test_unit_id) {
+    char const *run = std::getenv("JOINTCAL_RUN_BENCHMARKS");
+    boost::test_tools::assertion_result result(run != nullptr && std::string(run) != "" &&
+                                               std::string(run) != "0");
+    result.message() << "set JOINTCAL_RUN_BENCHMARKS to run the kernel benchmarks";
+    return result;
+}
+
+int getRepeats() {
+    char const *repeats = std::getenv("JOINTCAL_BENCHMARK_REPEATS");
+    return (repeats == nullptr) ? 3 : std::max(1, std::atoi(repeats));
+}
+
+/**
+ * Time kernel, which processes nPoints points, and report the fastest of getRepeats() passes in ns/point.
+ *
+ * @param name  The kernel being timed, e.g. "AstrometryTransformPolynomial::apply".
+ * @param variant  What distinguishes this measurement from the others of the same kernel, e.g. "order=3".
+ */
+double benchmark(std::string const &name, std::string const &variant, std::size_t nPoints,
+                 std::function<void()> const &kernel) {
+    double best = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < getRepeats(); ++i) {
+        auto start = std::chrono::steady_clock::now();
+        kernel();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() / nPoints);
+    }
+    BOOST_TEST_MESSAGE(name << " " << variant << " nPoints=" << nPoints << ": " << best << " ns/point");
+    char const *output = std::getenv("JOINTCAL_BENCHMARK_OUTPUT");
+    if (output != nullptr) {
+        std::ofstream ofile(output, std::ios::app);
+        ofile << "{\"kernel\": \"" << name << "\", \"variant\": \"" << variant
+              << "\", \"nPoints\": " << nPoints << ", \"nsPerPoint\": " << best << "}" << std::endl;
+    }
+    return best;
+}
+
+std::string makeVariant(std::string const &key, std::size_t value) {
+    std::ostringstream variant;
+    variant << key << "=" << value;
+    return variant.str();
+}
+
+/// Points uniformly distributed in [xMin, xMax] x [yMin, yMax].
+std::vector<jointcal::Point> makePoints(std::size_t nPoints, double xMin, double xMax, double yMin,
+                                        double yMax, unsigned seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> x(xMin, xMax);
+    std::uniform_real_distribution<double> y(yMin, yMax);
+    std::vector<jointcal::Point> points;
+    points.reserve(nPoints);
+    for (std::size_t i = 0; i < nPoints; ++i) points.emplace_back(x(generator), y(generator));
+    return points;
+}
+
+/// A polynomial close to the identity, with small random higher-order terms.
+jointcal::AstrometryTransformPolynomial makePolynomial(std::size_t order, unsigned seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(-1e-3, 1e-3);
+    jointcal::AstrometryTransformPolynomial polynomial(order);
+    for (std::size_t px = 0; px <= order; ++px) {
+        for (std::size_t py = 0; px + py <= order; ++py) {
+            for (std::size_t coord = 0; coord < 2; ++coord) {
+                polynomial.getCoefficient(px, py, coord) = uniform(generator);
+            }
+        }
+    }
+    if (order >= 1) {
+        polynomial.getCoefficient(1, 0, 0) += 1;
+        polynomial.getCoefficient(0, 1, 1) += 1;
+    }
+    return polynomial;
+}
+
+jointcal::BaseStarList makeStarList(std::vector<jointcal::Point> const &points) {
+    jointcal::BaseStarList stars;
+    for (auto const &point : points) {
+        stars.push_back(std::make_shared<jointcal::BaseStar>(point.x, point.y, 1.0, 0.1));
+    }
+    return stars;
+}
+
+std::size_t const nPoints = 20000;
+std::vector<std::size_t> const polynomialOrders = {1, 2, 3, 4, 5, 7, 9};
+std::vector<std::size_t> const listSizes = {1000, 10000, 100000};
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(kernelBenchmarks, *boost::unit_test::precondition(benchmarksEnabled))
+
+BOOST_AUTO_TEST_CASE(benchmark_polynomialApply) {
+    auto points = makePoints(nPoints, -1, 1, -1, 1, 1);
+    for (auto order : polynomialOrders) {
+        auto polynomial = makePolynomial(order, 2);
+        double sum = 0;
+        benchmark("AstrometryTransformPolynomial::apply", makeVariant("order", order), nPoints, [&]() {
+            for (auto const &point : points) {
+                double x, y;
+                polynomial.apply(point.x, point.y, x, y);
+                sum += x + y;
+            }
+        });
+        BOOST_CHECK(std::isfinite(sum));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(benchmark_polynomialParamDerivatives) {
+    auto points = makePoints(nPoints, -1, 1, -1, 1, 1);
+    for (auto order : polynomialOrders) {
+        auto polynomial = makePolynomial(order, 2);
+        std::vector<double> dx(polynomial.getNpar()), dy(polynomial.getNpar());
+        double sum = 0;
+        benchmark("AstrometryTransformPolynomial::paramDerivatives", makeVariant("order", order), nPoints,
+                  [&]() {
+                      for (auto const &point : points) {
+                          polynomial.paramDerivatives(point, dx.data(), dy.data());
+                          sum += dx.back() + dy.back();
+                      }
+                  });
+        BOOST_CHECK(std::isfinite(sum));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(benchmark_tanRaDecToPixel) {
+    // 0.2 arcsec pixels, tangent point at (150, 2) degrees.
+    jointcal::AstrometryTransformLinear tanToPixel = jointcal::AstrometryTransformLinearScale(18000.0);
+    jointcal::TanRaDecToPixel transform(tanToPixel, jointcal::Point(150, 2));
+    auto points = makePoints(nPoints, 149.5, 150.5, 1.5, 2.5, 3);
+    double sum = 0;
+    benchmark("TanRaDecToPixel::apply", "", nPoints, [&]() {
+        for (auto const &point : points) {
+            double x, y;
+            transform.apply(point.x, point.y, x, y);
+            sum += x + y;
+        }
+    });
+    BOOST_CHECK(std::isfinite(sum));
+}
+
+BOOST_AUTO_TEST_CASE(benchmark_fastFinder) {
+    auto queries = makePoints(nPoints, 0, 4000, 0, 4000, 4);
+    for (auto size : listSizes) {
+        auto stars = makeStarList(makePoints(size, 0, 4000, 0, 4000, 5));
+        jointcal::FastFinder finder(stars);
+        std::size_t found = 0;
+        benchmark("FastFinder::findClosest", makeVariant("listSize", size), nPoints, [&]() {
+            for (auto const &query : queries) {
+                if (finder.findClosest(query, 10.0) != nullptr) ++found;
+            }
+        });
+        BOOST_CHECK_GT(found, 0u);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(benchmark_listMatchCollect) {
+    for (auto size : listSizes) {
+        auto points = makePoints(size, 0, 4000, 0, 4000, 6);
+        auto list1 = makeStarList(points);
+        // list2 is list1 offset by (1, -2), plus a little noise.
+        std::mt19937 generator(7);
+        std::normal_distribution<double> noise(0, 0.05);
+        for (auto &point : points) {
+            point.x += 1 + noise(generator);
+            point.y += -2 + noise(generator);
+        }
+        auto list2 = makeStarList(points);
+        jointcal::AstrometryTransformLinearShift guess(1, -2);
+        std::size_t nMatches = 0;
+        benchmark("listMatchCollect", makeVariant("listSize", size), size, [&]() {
+            nMatches = jointcal::listMatchCollect(list1, list2, &guess, 1.0)->size();
+        });
+        BOOST_CHECK_GT(nMatches, 0.9 * size);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(benchmark_photometryTransformChebyshev) {
+    lsst::geom::Box2D bbox(lsst::geom::Point2D(0, 0), lsst::geom::Point2D(2048, 4096));
+    auto points = makePoints(nPoints, 0, 2048, 0, 4096, 8);
+    Eigen::ArrayXd x(nPoints), y(nPoints);
+    for (std::size_t i = 0; i < nPoints; ++i) {
+        x[i] = points[i].x;
+        y[i] = points[i].y;
+    }
+    for (std::size_t order = 0; order <= 9; order += (order < 5) ? 1 : 2) {
+        jointcal::FluxTransformChebyshev transform(order, bbox);
+        double sum = 0;
+        benchmark("PhotometryTransformChebyshev::transform", makeVariant("order", order), nPoints, [&]() {
+            for (auto const &point : points) sum += transform.transform(point.x, point.y, 1.0);
+        });
+        BOOST_CHECK(std::isfinite(sum));
+        Eigen::ArrayXd values;
+        benchmark("PhotometryTransformChebyshev::computeChebyshev", makeVariant("order", order), nPoints,
+                  [&]() { values = transform.computeChebyshev(x, y); });
+        BOOST_CHECK(values.allFinite());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(benchmark_chipVisitComputeTransformAndDerivatives) {
+    auto points = makePoints(nPoints, 0, 2048, 0, 4096, 9);
+    // Map the chip onto roughly [-1, 1], as ConstrainedAstrometryModel does.
+    jointcal::AstrometryTransformLinear normalize =
+            jointcal::AstrometryTransformLinearScale(2.0 / 2048, 2.0 / 4096) *
+            jointcal::AstrometryTransformLinearShift(-1024, -2048);
+    std::vector<std::pair<std::size_t, std::size_t>> const orders = {{1, 3}, {1, 5}, {3, 5}, {4, 7}};
+    for (auto const &chipAndVisit : orders) {
+        auto chipMapping = std::make_shared<jointcal::SimplePolyMapping>(
+                normalize, makePolynomial(chipAndVisit.first, 10));
+        auto visitMapping = std::make_shared<jointcal::SimplePolyMapping>(
+                jointcal::AstrometryTransformLinear(), makePolynomial(chipAndVisit.second, 11));
+        jointcal::ChipVisitAstrometryMapping mapping(chipMapping, visitMapping);
+        Eigen::MatrixX2d H(mapping.getNpar(), 2);
+        double sum = 0;
+        std::ostringstream variant;
+        variant << "chipOrder=" << chipAndVisit.first << " visitOrder=" << chipAndVisit.second;
+        benchmark("ChipVisitAstrometryMapping::computeTransformAndDerivatives", variant.str(), nPoints,
+                  [&]() {
+                      for (auto const &point : points) {
+                          jointcal::FatPoint where(point.x, point.y, 0.01, 0.01, 0);
+                          jointcal::FatPoint outPoint;
+                          mapping.computeTransformAndDerivatives(where, outPoint, H);
+                          sum += outPoint.x + H(0, 0);
+                      }
+                  });
+        BOOST_CHECK(std::isfinite(sum));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,140 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#define BOOST_TEST_MODULE test_listMatch
+
+// The boost unit test header
+#include "boost/test/unit_test.hpp"
+
+#include <cmath>
+#include <memory>
+#include <random>
+
+#include "lsst/jointcal/AstrometryTransform.h"
+#include "lsst/jointcal/BaseStar.h"
+#include "lsst/jointcal/ListMatch.h"
+#include "lsst/jointcal/StarMatch.h"
+
+namespace jointcal = lsst::jointcal;
+
+namespace {
+
+int const nStars = 100;
+int const nOutliers = 20;
+
+/// A rotation by 30 degrees, a 2% scale change and a shift.
+jointcal::AstrometryTransformLinear makeTruth() {
+    double const scale = 1.02;
+    double const angle = M_PI / 6;
+    return jointcal::AstrometryTransformLinear(15.0, -20.0, scale * std::cos(angle), -scale * std::sin(angle),
+                                               scale * std::sin(angle), scale * std::cos(angle));
+}
+
+/**
+ * Fill list1 with random stars, and list2 with their image through truth, plus outliers interleaved in
+ * flux with the true stars, so that they are among the brightest ones the matchers use.
+ */
+void makeLists(jointcal::AstrometryTransform const &truth, jointcal::BaseStarList &list1,
+               jointcal::BaseStarList &list2) {
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<double> position(0, 2000);
+    for (int i = 0; i < nStars; ++i) {
+        double flux = 1000.0 - 5 * i;
+        auto star = std::make_shared<jointcal::BaseStar>(position(rng), position(rng), flux, 1.0);
+        list1.push_back(star);
+        jointcal::Point image = truth.apply(*star);
+        list2.push_back(std::make_shared<jointcal::BaseStar>(image.x, image.y, flux, 1.0));
+    }
+    for (int i = 0; i < nOutliers; ++i) {
+        double flux = 1002.0 - 25 * i;
+        list2.push_back(std::make_shared<jointcal::BaseStar>(position(rng), position(rng), flux, 1.0));
+    }
+}
+
+jointcal::MatchConditions makeConditions() {
+    jointcal::MatchConditions conditions;
+    conditions.algorithm = 3;
+    conditions.nStarsList1 = nStars;
+    conditions.nStarsList2 = nStars + nOutliers;
+    conditions.sizeRatio = 1.0;
+    conditions.deltaSizeRatio = 0.1;
+    return conditions;
+}
+
+void checkTransform(jointcal::AstrometryTransform const &result, jointcal::AstrometryTransform const &truth) {
+    for (double x : {0.0, 1000.0, 2000.0}) {
+        for (double y : {0.0, 1000.0, 2000.0}) {
+            jointcal::Point expect = truth.apply(jointcal::Point(x, y));
+            jointcal::Point found = result.apply(jointcal::Point(x, y));
+            BOOST_CHECK_SMALL(found.x - expect.x, 1e-6);
+            BOOST_CHECK_SMALL(found.y - expect.y, 1e-6);
+        }
+    }
+}
+
+}  // namespace
+
+/// The triangle matcher recovers the transform, and only matches stars to their true images.
+BOOST_AUTO_TEST_CASE(test_matchSearchRotShift) {
+    auto truth = makeTruth();
+    jointcal::BaseStarList list1, list2;
+    makeLists(truth, list1, list2);
+
+    auto match = jointcal::matchSearchRotShift(list1, list2, makeConditions());
+    BOOST_REQUIRE(match);
+    checkTransform(*match->getTransform(), truth);
+    // listMatchCombinatorial needs more than 10 pairs to accept a solution.
+    BOOST_CHECK_GT(match->size(), 10u);
+    for (auto const &starMatch : *match) {
+        jointcal::Point expect = truth.apply(starMatch.point1);
+        BOOST_CHECK_SMALL(starMatch.point2.x - expect.x, 1e-6);
+        BOOST_CHECK_SMALL(starMatch.point2.y - expect.y, 1e-6);
+    }
+}
+
+/// listMatchCombinatorial, with algorithm 3, finds the transform that matches every true star.
+BOOST_AUTO_TEST_CASE(test_listMatchCombinatorial) {
+    auto truth = makeTruth();
+    jointcal::BaseStarList list1, list2;
+    makeLists(truth, list1, list2);
+
+    auto transform = jointcal::listMatchCombinatorial(list1, list2, makeConditions());
+    BOOST_REQUIRE(transform);
+    checkTransform(*transform, truth);
+    auto matches = jointcal::listMatchCollect(list1, list2, transform.get(), 1.0);
+    BOOST_CHECK_EQUAL(matches->size(), std::size_t(nStars));
+}
+
+/// Lists too short to build triangles from make the matcher fail cleanly.
+BOOST_AUTO_TEST_CASE(test_tooFewStars) {
+    auto truth = makeTruth();
+    jointcal::BaseStarList list1, list2;
+    makeLists(truth, list1, list2);
+    list1.resize(4);
+
+    BOOST_CHECK(!jointcal::matchSearchRotShift(list1, list2, makeConditions()));
+    BOOST_CHECK(!jointcal::listMatchCombinatorial(list1, list2, makeConditions()));
+}
@@ -0,0 +1,90 @@
+# This file is part of jointcal.
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import unittest
+
+import numpy as np
+
+import lsst.utils.tests
+
+import lsst.jointcal.listMatch
+import lsst.jointcal.star
+
+
+class ListMatchTestCase(lsst.utils.tests.TestCase):
+    """Test the combinatorial matchers through the python interface."""
+    def setUp(self):
+        rng = np.random.default_rng(12345)
+        self.nStars = 100
+        self.scale = 1.02
+        angle = np.pi/6
+        self.matrix = self.scale*np.array([[np.cos(angle), -np.sin(angle)], [np.sin(angle), np.cos(angle)]])
+        self.shift = np.array([15.0, -20.0])
+
+        positions = rng.uniform(0, 2000, size=(self.nStars, 2))
+        images = positions @ self.matrix.T + self.shift
+        fluxes = 1000.0 - 5*np.arange(self.nStars)
+        self.list1 = [lsst.jointcal.star.BaseStar(x, y, flux, 1.0)
+                      for (x, y), flux in zip(positions, fluxes)]
+        self.list2 = [lsst.jointcal.star.BaseStar(x, y, flux, 1.0)
+                      for (x, y), flux in zip(images, fluxes)]
+        # Outliers among the brightest stars of the second list.
+        self.list2 += [lsst.jointcal.star.BaseStar(x, y, 1002.0 - 25*i, 1.0)
+                       for i, (x, y) in enumerate(rng.uniform(0, 2000, size=(20, 2)))]
+
+    def testTriangles(self):
+        """The triangle matcher (algorithm 3) should recover the transform
+        despite the outliers."""
+        conditions = lsst.jointcal.listMatch.MatchConditions()
+        self.assertEqual(conditions.algorithm, 2)
+        conditions.algorithm = 3
+        conditions.nTriangleNeighbours = 6
+        conditions.nStarsList1 = len(self.list1)
+        conditions.nStarsList2 = len(self.list2)
+        conditions.deltaSizeRatio = 0.1
+
+        transform = lsst.jointcal.listMatch.listMatchCombinatorial(self.list1, self.list2, conditions)
+        self.assertIsNotNone(transform)
+        for x, y in [(0, 0), (2000, 0), (1000, 1000), (0, 2000)]:
+            result = transform.apply(lsst.jointcal.star.Point(x, y))
+            expect = self.matrix @ np.array([x, y]) + self.shift
+            self.assertFloatsAlmostEqual(result.x, expect[0], rtol=0, atol=1e-6)
+            self.assertFloatsAlmostEqual(result.y, expect[1], rtol=0, atol=1e-6)
+
+    def testNoMatch(self):
+        """Lists too short to match should give None, not raise."""
+        conditions = lsst.jointcal.listMatch.MatchConditions()
+        conditions.algorithm = 3
+        self.assertIsNone(lsst.jointcal.listMatch.listMatchCombinatorial(self.list1[:4], self.list2,
+                                                                         conditions))
+
+
+class MemoryTester(lsst.utils.tests.MemoryTestCase):
+    pass
+
+
+def setup_module(module):
+    lsst.utils.tests.init()
+
+
+if __name__ == "__main__":
+    lsst.utils.tests.init()
+    unittest.main()
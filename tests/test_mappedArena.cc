@@ -0,0 +1,133 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#define BOOST_TEST_MODULE test_mappedArena
+
+// The boost unit test header
+#include "boost/test/unit_test.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lsst/pex/exceptions.h"
+
+#include "lsst/jointcal/BaseStar.h"
+#include "lsst/jointcal/MappedArena.h"
+#include "lsst/jointcal/MeasuredStar.h"
+
+namespace jointcal = lsst::jointcal;
+
+namespace {
+
+std::string scratchDirectory() {
+    char const *tmpdir = std::getenv("TMPDIR");
+    return tmpdir == nullptr ? "/tmp" : tmpdir;
+}
+
+std::vector<std::shared_ptr<jointcal::MeasuredStar>> makeStars(
+        std::shared_ptr<jointcal::MappedArena> const &arena, std::size_t nStars) {
+    std::vector<std::shared_ptr<jointcal::MeasuredStar>> stars;
+    stars.reserve(nStars);
+    for (std::size_t i = 0; i < nStars; ++i) {
+        jointcal::BaseStar baseStar(i, 2.0 * i, 10.0 + i, 1.0);
+        stars.push_back(std::allocate_shared<jointcal::MeasuredStar>(
+                jointcal::MappedArenaAllocator<jointcal::MeasuredStar>(arena), baseStar));
+    }
+    return stars;
+}
+
+}  // namespace
+
+/// The stars survive growing the file over several chunks, and keep their values.
+BOOST_AUTO_TEST_CASE(test_allocate) {
+    // One page per chunk, so that the stars span many chunks.
+    auto arena = std::make_shared<jointcal::MappedArena>(scratchDirectory(), 1);
+    std::size_t const nStars = 5000;
+    auto stars = makeStars(arena, nStars);
+    BOOST_CHECK_GT(arena->getMappedSize(), nStars * sizeof(jointcal::MeasuredStar));
+    for (std::size_t i = 0; i < nStars; ++i) {
+        BOOST_CHECK_EQUAL(stars[i]->x, i);
+        BOOST_CHECK_EQUAL(stars[i]->y, 2.0 * i);
+        BOOST_CHECK_EQUAL(stars[i]->getFlux(), 10.0 + i);
+    }
+}
+
+/// Consecutive stars are allocated next to each other.
+BOOST_AUTO_TEST_CASE(test_contiguous) {
+    auto arena = std::make_shared<jointcal::MappedArena>(scratchDirectory());
+    auto stars = makeStars(arena, 100);
+    auto address = [&stars](std::size_t i) { return reinterpret_cast<char *>(stars[i].get()); };
+    auto stride = address(1) - address(0);
+    BOOST_CHECK_GT(stride, 0);
+    for (std::size_t i = 1; i < stars.size(); ++i) {
+        BOOST_CHECK_EQUAL(address(i) - address(i - 1), stride);
+    }
+}
+
+/// Rebuilding a catalog reuses the memory of the previous one instead of growing the file.
+BOOST_AUTO_TEST_CASE(test_reuse) {
+    auto arena = std::make_shared<jointcal::MappedArena>(scratchDirectory(), 1);
+    auto stars = makeStars(arena, 1000);
+    std::size_t const mappedSize = arena->getMappedSize();
+    for (int pass = 0; pass < 5; ++pass) {
+        stars.clear();
+        stars = makeStars(arena, 1000);
+    }
+    BOOST_CHECK_EQUAL(arena->getMappedSize(), mappedSize);
+}
+
+/// A freed block is only reused by allocations of the same size that it is aligned for.
+BOOST_AUTO_TEST_CASE(test_reuseAlignment) {
+    jointcal::MappedArena arena(scratchDirectory());
+    arena.allocate(1, 1);
+    void *unaligned = arena.allocate(24, 1);
+    BOOST_REQUIRE_NE(reinterpret_cast<std::uintptr_t>(unaligned) % 8, 0u);
+    arena.deallocate(unaligned, 24);
+
+    void *aligned = arena.allocate(24, 8);
+    BOOST_CHECK_NE(aligned, unaligned);
+    BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(aligned) % 8, 0u);
+    // The unaligned block still serves an allocation that does not need more.
+    BOOST_CHECK_EQUAL(arena.allocate(24, 1), unaligned);
+
+    arena.deallocate(aligned, 24);
+    BOOST_CHECK_EQUAL(arena.allocate(24, 8), aligned);
+}
+
+/// The stars keep the arena alive.
+BOOST_AUTO_TEST_CASE(test_lifetime) {
+    auto arena = std::make_shared<jointcal::MappedArena>(scratchDirectory());
+    auto stars = makeStars(arena, 10);
+    arena.reset();
+    BOOST_CHECK_EQUAL(stars[9]->x, 9);
+}
+
+BOOST_AUTO_TEST_CASE(test_badDirectory) {
+    BOOST_CHECK_THROW(jointcal::MappedArena("/nonexistent/jointcal"), lsst::pex::exceptions::IoError);
+}
@@ -97,6 +97,17 @@ class PhotometryModelTestBase:
         self._toPhotoCalib(self.ccdImageList[0], self.catalogs[0], self.stars[0])
         self._toPhotoCalib(self.ccdImageList[1], self.catalogs[1], self.stars[1])
 
+    def test_toPhotoCalibMap(self):
+        """The batch conversion should match converting one ccdImage at a time."""
+        result = self.model.toPhotoCalibMap(self.ccdImageList)
+        self.assertEqual(len(result), len(self.ccdImageList))
+        for ccdImage, catalog in zip(self.ccdImageList, self.catalogs):
+            photoCalib = result[(ccdImage.visit, ccdImage.ccdId)]
+            expect = self.model.toPhotoCalib(ccdImage)
+            self.assertEqual(photoCalib.getCalibrationMean(), expect.getCalibrationMean())
+            self.assertFloatsEqual(photoCalib.instFluxToNanojansky(catalog, self.fluxFieldName),
+                                   expect.instFluxToNanojansky(catalog, self.fluxFieldName))
+
     def test_freezeErrorTransform(self):
         """After calling freezeErrorTransform(), the error transform is unchanged
         by offsetParams().
@@ -115,6 +126,67 @@ class PhotometryModelTestBase:
         self.assertFloatsNotEqual(t1, t2)
         self.assertFloatsEqual(t1Err, t2Err)
 
+    def test_setParameters(self):
+        """setParameters() restores the transforms and the frozen error
+        transforms saved by getParameters().
+        """
+        ccdImage = self.ccdImageList[0]
+        star0 = self.stars[0][0]
+
+        self.model.freezeErrorTransform()
+        parameters = self.model.getParameters()
+        t1 = self.model.transform(ccdImage, star0)
+        t1Err = self.model.transformError(ccdImage, star0)
+        self.model.offsetParams(self.delta)
+        self.assertFloatsNotEqual(self.model.transform(ccdImage, star0), t1)
+
+        self.model.setParameters(parameters)
+        self.assertFloatsEqual(self.model.getParameters(), parameters)
+        self.assertFloatsEqual(self.model.transform(ccdImage, star0), t1)
+        self.assertFloatsEqual(self.model.transformError(ccdImage, star0), t1Err)
+
+    def test_setMappingParameters(self):
+        """setMappingParameters() restores the transforms saved by
+        getMappingParameters(), skipping the ones that do not match.
+        """
+        ccdImage = self.ccdImageList[0]
+        star0 = self.stars[0][0]
+
+        solution = self.model.getMappingParameters()
+        t1 = self.model.transform(ccdImage, star0)
+        self.model.offsetParams(self.delta)
+        self.assertFloatsNotEqual(self.model.transform(ccdImage, star0), t1)
+
+        # A transform the model does not have, and one with the wrong number of parameters.
+        key = next(iter(solution))
+        self.assertEqual(self.model.setMappingParameters({(-12345, 888): np.zeros(3),
+                                                          key: np.zeros(len(solution[key]) + 1)}), 0)
+        self.assertEqual(self.model.setMappingParameters(solution), len(solution))
+        self.assertFloatsEqual(self.model.transform(ccdImage, star0), t1)
+
+    def test_fixMappings(self):
+        """The transforms held fixed by fixMappings() are not fit until
+        releaseMappings() is called.
+        """
+        ccdImage = self.ccdImageList[0]
+        star0 = self.stars[0][0]
+        keys = [(ccdImage.visit, ccdImage.ccdId), (ccdImage.visit, -1), (-1, ccdImage.ccdId)]
+
+        t1 = self.model.transform(ccdImage, star0)
+        nFixed = self.model.fixMappings(keys + [(-12345, 888)])
+        self.assertGreater(nFixed, 0)
+        self.model.assignIndices("Model", self.firstIndex)
+        self.assertEqual(self.model.getNpar(ccdImage), 0)
+        self.model.offsetParams(self.delta)
+        self.assertFloatsEqual(self.model.transform(ccdImage, star0), t1)
+
+        self.assertEqual(self.model.releaseMappings(), nFixed)
+        self.assertEqual(self.model.releaseMappings(), 0)
+        self.model.assignIndices("Model", self.firstIndex)
+        self.assertGreater(self.model.getNpar(ccdImage), 0)
+        self.model.offsetParams(self.delta)
+        self.assertFloatsNotEqual(self.model.transform(ccdImage, star0), t1)
+
 
 class FluxTestBase:
     """Have the sublass also derive from ``lsst.utils.tests.TestCase`` to cause
@@ -279,6 +351,39 @@ class ConstrainedPhotometryModelTestCase(PhotometryModelTestBase):
             # almost equal because log() may have been involved in the math
             self.assertFloatsAlmostEqual(result, expect, msg=ccdImage.getName())
 
+    def test_basisCache(self):
+        """Transforms and derivatives from the cached visit basis should match
+        the ones computed directly.
+        """
+        stars = []
+        for ccdImage in self.ccdImageList:
+            ccdImage.resetCatalogForFit()
+            stars.append(ccdImage.getCatalogForFit())
+
+        def compute():
+            result = []
+            for ccdImage, ccdStars in zip(self.ccdImageList, stars):
+                for star in ccdStars:
+                    result.append((self.model.transform(ccdImage, star),
+                                   self.model.transformError(ccdImage, star),
+                                   self.model.computeParameterDerivatives(star, ccdImage)))
+            return result
+
+        expect = compute()
+        self.assertEqual(self.model.makeBasisCache(self.ccdImageList, 0), 0)
+        self.assertEqual(self.model.getBasisCacheSize(), 0)
+        size = self.model.makeBasisCache(self.ccdImageList, 2**30)
+        self.assertGreater(size, 0)
+        self.assertGreaterEqual(self.model.getBasisCacheSize(), size)
+        for (transform, error, derivatives), (expectTransform, expectError, expectDerivatives) in zip(
+                compute(), expect):
+            self.assertFloatsAlmostEqual(transform, expectTransform, rtol=1e-13)
+            self.assertFloatsAlmostEqual(error, expectError, rtol=1e-13)
+            self.assertFloatsAlmostEqual(derivatives, expectDerivatives, rtol=1e-13, atol=1e-14)
+
+        self.model.clearBasisCache()
+        self.assertEqual(self.model.getBasisCacheSize(), 0)
+
     def test_photoCalibMean(self):
         """The mean of the photoCalib should match the mean over a calibrated image."""
         image = lsst.afw.image.MaskedImageF(self.ccdImageList[0].getDetector().getBBox())
@@ -27,6 +27,7 @@ import unittest
 import lsst.utils.tests
 
 import lsst.geom
+import lsst.pex.exceptions
 from lsst.jointcal import photometryTransform
 
 
@@ -240,6 +241,56 @@ class PhotometryTransformChebyshevTestCase(PhotometryTransformTestBase, abc.ABC)
                 expect.append(self._computeChebyshevDerivative(Ty[j], Tx[i], self.value))
         self.assertFloatsAlmostEqual(np.array(expect), result)
 
+    def test_coefficientsBeyondOrder(self):
+        """Only the terms with i+j <= order can be given, and the transform
+        keeps its own copy of them.
+        """
+        TransformClass = type(self.transform2)
+        coefficients = self.coefficients.copy()
+        coefficients[1, 1] = 1
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            TransformClass(coefficients, self.bbox)
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            TransformClass(np.zeros((2, 3)), self.bbox)
+
+        coefficients = self.coefficients.copy()
+        transform = TransformClass(coefficients, self.bbox)
+        coefficients[0, 1] = 1
+        self.assertFloatsEqual(transform.getCoefficients(), self.coefficients)
+
+        with self.assertRaises(lsst.pex.exceptions.LengthError):
+            transform.setParameters(np.zeros(4))
+
+    def test_computeChebyshev(self):
+        """Test evaluating many points at once, for orders with and without
+        specialized kernels, and for more points than one evaluation block.
+        """
+        rng = np.random.RandomState(100)
+        x = rng.uniform(self.bbox.getMinX(), self.bbox.getMaxX(), 150)
+        y = rng.uniform(self.bbox.getMinY(), self.bbox.getMaxY(), 150)
+        result = self.transform2.computeChebyshev(x, y)
+        expect = np.array([self._evaluate_chebyshev(xx, yy) for xx, yy in zip(x, y)])
+        self.assertFloatsAlmostEqual(result, expect, rtol=1e-14)
+
+        cx = (self.bbox.getMinX() + self.bbox.getMaxX())/2.0
+        cy = (self.bbox.getMinY() + self.bbox.getMaxY())/2.0
+        sx = 2.0 / self.bbox.getWidth()
+        sy = 2.0 / self.bbox.getHeight()
+        for order in (7, 10, 12):
+            with self.subTest(order=order):
+                coefficients = rng.uniform(-1, 1, (order + 1, order + 1))
+                # only the terms with i+j <= order are used
+                coefficients[np.add.outer(np.arange(order + 1), np.arange(order + 1)) > order] = 0
+                transform = photometryTransform.FluxTransformChebyshev(coefficients, self.bbox)
+                result = transform.computeChebyshev(x, y)
+                expect = np.polynomial.chebyshev.chebval2d(sx*(x - cx), sy*(y - cy), coefficients.T)
+                self.assertFloatsAlmostEqual(result, expect, rtol=1e-11, atol=1e-12)
+                scalar = np.array([transform.transform(xx, yy, 1.0) for xx, yy in zip(x, y)])
+                self.assertFloatsAlmostEqual(result, scalar, rtol=1e-14)
+
+        with self.assertRaises(lsst.pex.exceptions.LengthError):
+            self.transform2.computeChebyshev(x, y[:-1])
+
     def testIntegrateBoxOrder0(self):
         r"""Test integrating over an "interesting" box.
 
@@ -0,0 +1,190 @@
+// -*- LSST-C++ -*-
+/*
+ * This file is part of jointcal.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Stress the const methods of the astrometry mappings from several threads at once: they are called
+ * concurrently when several fits run in one process, so they must not write any shared state.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#define BOOST_TEST_MODULE test_threadSafety
+
+// The boost unit test header
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Eigen/Core"
+
+#include "lsst/jointcal/AstrometryTransform.h"
+#include "lsst/jointcal/ChipVisitAstrometryMapping.h"
+#include "lsst/jointcal/FatPoint.h"
+#include "lsst/jointcal/SimpleAstrometryMapping.h"
+
+namespace jointcal = lsst::jointcal;
+
+namespace {
+
+std::size_t const nThreads = 8;
+std::size_t const nPoints = 2000;
+int const nPasses = 20;
+
+/// A polynomial close to the identity, with small random higher-order terms.
+jointcal::AstrometryTransformPolynomial makePolynomial(std::size_t order, unsigned seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(-1e-3, 1e-3);
+    jointcal::AstrometryTransformPolynomial polynomial(order);
+    for (std::size_t px = 0; px <= order; ++px) {
+        for (std::size_t py = 0; px + py <= order; ++py) {
+            for (std::size_t coord = 0; coord < 2; ++coord) {
+                polynomial.getCoefficient(px, py, coord) = uniform(generator);
+            }
+        }
+    }
+    polynomial.getCoefficient(1, 0, 0) += 1;
+    polynomial.getCoefficient(0, 1, 1) += 1;
+    return polynomial;
+}
+
+std::vector<jointcal::FatPoint> makePoints(unsigned seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> x(0, 2048);
+    std::uniform_real_distribution<double> y(0, 4096);
+    std::vector<jointcal::FatPoint> points;
+    points.reserve(nPoints);
+    for (std::size_t i = 0; i < nPoints; ++i) {
+        points.emplace_back(x(generator), y(generator), 0.01, 0.02, 0.001);
+    }
+    return points;
+}
+
+/// Everything the const methods of a mapping compute at one point.
+struct Result {
+    jointcal::FatPoint outPoint;
+    Eigen::MatrixX2d H;
+    Eigen::Matrix2d derivative;
+    jointcal::Point transformed;
+};
+
+Result evaluate(jointcal::AstrometryMapping const &mapping, jointcal::AstrometryTransform const &transform,
+                jointcal::FatPoint const &where) {
+    Result result;
+    result.H.resize(mapping.getNpar(), 2);
+    mapping.computeTransformAndDerivatives(where, result.outPoint, result.H);
+    mapping.positionDerivative(where, result.derivative, 1e-4);
+    result.transformed = transform.apply(where);
+    return result;
+}
+
+bool same(Result const &a, Result const &b) {
+    return a.outPoint.x == b.outPoint.x && a.outPoint.y == b.outPoint.y && a.outPoint.vx == b.outPoint.vx &&
+           a.outPoint.vy == b.outPoint.vy && a.outPoint.vxy == b.outPoint.vxy && a.H == b.H &&
+           a.derivative == b.derivative && a.transformed.x == b.transformed.x &&
+           a.transformed.y == b.transformed.y;
+}
+
+/**
+ * Evaluate every (mapping, transform) pair at every point serially, then from nThreads threads at once,
+ * each thread walking the mappings in a different order, and count the mismatches.
+ */
+std::size_t countMismatches(std::vector<jointcal::AstrometryMapping const *> const &mappings,
+                            std::vector<jointcal::AstrometryTransform const *> const &transforms,
+                            std::vector<jointcal::FatPoint> const &points) {
+    std::vector<std::vector<Result>> expected(mappings.size());
+    for (std::size_t m = 0; m < mappings.size(); ++m) {
+        for (auto const &point : points) expected[m].push_back(evaluate(*mappings[m], *transforms[m], point));
+    }
+
+    std::atomic<std::size_t> mismatches(0);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < nThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int pass = 0; pass < nPasses; ++pass) {
+                for (std::size_t k = 0; k < mappings.size(); ++k) {
+                    // interleave the mappings, so that the per-call scratch keeps changing size
+                    std::size_t m = (k + t + pass) % mappings.size();
+                    for (std::size_t i = 0; i < points.size(); ++i) {
+                        if (!same(evaluate(*mappings[m], *transforms[m], points[i]), expected[m][i])) {
+                            ++mismatches;
+                        }
+                    }
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    return mismatches;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(test_concurrentMappings) {
+    jointcal::AstrometryTransformLinear normalize =
+            jointcal::AstrometryTransformLinearScale(2.0 / 2048, 2.0 / 4096) *
+            jointcal::AstrometryTransformLinearShift(-1024, -2048);
+    // Two chips sharing one visit mapping, with different orders so that the per-thread scratch of
+    // ChipVisitAstrometryMapping changes size from one call to the next.
+    auto chip1 = std::make_shared<jointcal::SimplePolyMapping>(normalize, makePolynomial(1, 1));
+    auto chip2 = std::make_shared<jointcal::SimplePolyMapping>(normalize, makePolynomial(4, 2));
+    auto visit = std::make_shared<jointcal::SimplePolyMapping>(jointcal::AstrometryTransformLinear(),
+                                                               makePolynomial(5, 3));
+    jointcal::ChipVisitAstrometryMapping chipVisit1(chip1, visit);
+    jointcal::ChipVisitAstrometryMapping chipVisit2(chip2, visit);
+    jointcal::SimpleAstrometryMapping simple(makePolynomial(3, 4));
+
+    std::vector<jointcal::AstrometryMapping const *> mappings = {&chipVisit1, &chipVisit2, chip1.get(),
+                                                                 visit.get(), &simple};
+    std::vector<jointcal::AstrometryTransform const *> transforms = {
+            &chip1->getTransform(), &chip2->getTransform(), &chip1->getTransform(),
+            &visit->getTransform(), &simple.getTransform()};
+    BOOST_CHECK_EQUAL(countMismatches(mappings, transforms, makePoints(5)), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_simplePolyMappingGetTransform) {
+    // getTransform() no longer computes the product on demand: check that it follows offsetParams().
+    jointcal::AstrometryTransformLinear normalize =
+            jointcal::AstrometryTransformLinearScale(2.0 / 2048, 2.0 / 4096) *
+            jointcal::AstrometryTransformLinearShift(-1024, -2048);
+    jointcal::AstrometryTransformPolynomial polynomial = makePolynomial(3, 6);
+    jointcal::SimplePolyMapping mapping(normalize, polynomial);
+    Eigen::VectorXd delta = Eigen::VectorXd::Constant(mapping.getNpar(), 1e-4);
+    mapping.offsetParams(delta);
+    polynomial.offsetParams(delta);
+
+    for (auto const &point : makePoints(7)) {
+        jointcal::FatPoint outPoint;
+        mapping.transformPosAndErrors(point, outPoint);
+        jointcal::Point transformed = mapping.getTransform().apply(point);
+        jointcal::Point expected = polynomial.apply(normalize.apply(point));
+        BOOST_CHECK_CLOSE(transformed.x, expected.x, 1e-8);
+        BOOST_CHECK_CLOSE(transformed.y, expected.y, 1e-8);
+        BOOST_CHECK_CLOSE(outPoint.x, expected.x, 1e-8);
+        BOOST_CHECK_CLOSE(outPoint.y, expected.y, 1e-8);
+    }
+}
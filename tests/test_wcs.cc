@@ -115,4 +115,45 @@ BOOST_AUTO_TEST_CASE(test_polyfit) {
     BOOST_CHECK(fabs(chi2) < 1e-8);
 }
 
+/* test the numerical inverse, and that it follows changes to the direct transform */
+
+void checkInverse(jointcal::AstrometryTransform const &direct, jointcal::AstrometryTransform const &inverse,
+                  std::vector<jointcal::Point> const &points, double precision) {
+    std::vector<jointcal::Point> directPoints, batch;
+    direct.apply(points, directPoints);
+    inverse.apply(directPoints, batch);
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        jointcal::Point single = inverse.apply(directPoints[i]);
+        BOOST_CHECK_SMALL(single.computeDist2(points[i]), precision * precision);
+        BOOST_CHECK_EQUAL(single.x, batch[i].x);
+        BOOST_CHECK_EQUAL(single.y, batch[i].y);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_inverse) {
+    jointcal::AstrometryTransformPolynomial pol(3);
+    pol.getCoefficient(0, 0, 0) = 12.;
+    pol.getCoefficient(0, 0, 1) = -30.;
+    pol.getCoefficient(1, 0, 0) = 1.01;
+    pol.getCoefficient(0, 1, 0) = 0.02;
+    pol.getCoefficient(1, 0, 1) = -0.015;
+    pol.getCoefficient(0, 1, 1) = 0.99;
+    pol.getCoefficient(2, 0, 0) = 2e-6;
+    pol.getCoefficient(1, 2, 1) = 3e-10;
+    pol.getCoefficient(3, 0, 1) = -1e-10;
+
+    jointcal::Frame frame(0, 0, 2000, 4000);
+    // Points inside the frame, and some outside, where the inverse has to iterate.
+    std::vector<jointcal::Point> points;
+    for (double x = -100; x < 2100; x += 110)
+        for (double y = -100; y < 4100; y += 170) points.emplace_back(x, y);
+
+    double precision = 1e-6;
+    checkInverse(pol, *pol.inverseTransform(precision, frame), points, 2 * precision);
+
+    // The inverse fit for the transform above must not be reused for a modified one.
+    pol.getCoefficient(2, 0, 1) = 5e-6;
+    checkInverse(pol, *pol.inverseTransform(precision, frame), points, 2 * precision);
+}
+
 BOOST_AUTO_TEST_SUITE_END()